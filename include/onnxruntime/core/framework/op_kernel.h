@@ -130,6 +130,39 @@ class OpKernel {
     return Status::OK();
   }
 
+  // Override the following three functions to let the session persist the pre-packed state of this kernel in a
+  // file (see kOrtSessionOptionsPrepackedWeightsCacheFile), so that sessions in later processes skip PrePack().
+  // Only CPU kernels are supported as the pre-packed buffers are memory mapped from the file.
+  virtual bool SupportsPrePackedWeightsFileCache() const {
+    return false;
+  }
+
+  // Called after PrePack() has been called for all constant inputs of the kernel.
+  // @param input_idx: The input index of a constant input for which PrePack() set is_packed to true
+  // @param prepacked_buffers: The kernel adds its final pre-packed buffers for input_idx, as non-owning
+  //                           pointers, in the order UseFileCachedPrePackedBuffers() expects them.
+  //                           The contents are written to the file as is.
+  virtual Status GetPrePackedBuffersForFileCache(int /*input_idx*/,
+                                                 /*out*/ PrePackedWeights& /*prepacked_buffers*/) const {
+    ORT_NOT_IMPLEMENTED(__FUNCTION__, " is not implemented");
+  }
+
+  // Called instead of PrePack() for the constant inputs of the kernel if the file has an entry for a kernel of the
+  // same type and attributes, with the same constant inputs, created on a CPU with the same features.
+  // PrePack() is not called for any constant input of the kernel in that case, so the kernel must restore the
+  // state of all of them from the buffers of the inputs it had packed.
+  // @param prepacked_buffers: The buffers returned by GetPrePackedBuffersForFileCache(). The deleter of the
+  //                           BufferUniquePtr is NULL, the memory mapped buffers are valid for the lifetime of
+  //                           the session and must not be written to.
+  // @param input_idx: The input index of the tensor in this kernel
+  // @param used_cached_buffers: Set to true if the kernel restored its state from the buffers.
+  virtual Status UseFileCachedPrePackedBuffers(std::vector<BufferUniquePtr>& /*prepacked_buffers*/,
+                                               int /*input_idx*/,
+                                               /*out*/ bool& used_cached_buffers) {
+    used_cached_buffers = false;
+    return Status::OK();
+  }
+
   const OrtDevice GetDevice(OrtMemType mem_type) const;
   const OpKernelInfo& Info() const {
     return *op_kernel_info_;
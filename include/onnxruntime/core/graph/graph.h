@@ -1823,6 +1823,11 @@ class Graph {  // NOLINT(clang-analyzer-optin.performance.Padding): preserve exi
   // New node name should not conflict with this set.
   std::unordered_set<std::string> generated_node_names_;
 
+  // Number of nodes using each name, so GenerateNodeName does not need to scan all nodes.
+  // Built on the first call of GenerateNodeName and kept up to date by AddNode and ReleaseNode afterwards.
+  std::unordered_map<std::string, size_t> node_name_counts_;
+  bool node_names_indexed_ = false;
+
   // Strings which have been used as node_arg names.
   // New node_arg name should not conflict this this set.
   std::unordered_set<std::string> generated_node_arg_names_;
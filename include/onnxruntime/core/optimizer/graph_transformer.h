@@ -11,6 +11,9 @@
 #include "core/optimizer/graph_transformer_level.h"
 
 namespace onnxruntime {
+namespace concurrency {
+class ThreadPool;
+}
 
 /**
 @class GraphTransformer
@@ -43,17 +46,13 @@ class GraphTransformer {
 
   virtual bool ShouldOnlyApplyOnce() const { return false; }
 
+  /** Sets the thread pool to transform the subgraphs of a node (e.g. the branches of an If) concurrently with.
+  Subgraphs are transformed sequentially if it is null. */
+  void SetThreadPool(concurrency::ThreadPool* thread_pool) noexcept { thread_pool_ = thread_pool; }
+
  protected:
   /** Helper method to call ApplyImpl on any subgraphs in the Node. */
-  Status Recurse(Node& node, bool& modified, int graph_level, const logging::Logger& logger) const {
-    int subgraph_level = ++graph_level;
-    for (auto& entry : node.GetAttributeNameToMutableSubgraphMap()) {
-      auto& subgraph = *entry.second;
-      ORT_RETURN_IF_ERROR(ApplyImpl(subgraph, modified, subgraph_level, logger));
-    }
-
-    return Status::OK();
-  }
+  Status Recurse(Node& node, bool& modified, int graph_level, const logging::Logger& logger) const;
 
  private:
   ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(GraphTransformer);
@@ -69,6 +68,7 @@ class GraphTransformer {
 
   const std::string name_;
   const InlinedHashSet<std::string_view> compatible_provider_types_;
+  concurrency::ThreadPool* thread_pool_ = nullptr;
 };
 
 /**
@@ -39,7 +39,9 @@
 #pragma warning(disable : 4127)
 #pragma warning(disable : 4805)
 #endif
+#include <algorithm>
 #include <memory>
+#include <vector>
 #include "unsupported/Eigen/CXX11/ThreadPool"
 
 #if defined(__GNUC__)
@@ -789,6 +791,8 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
       ComputeCoprimes(i, &all_coprimes_.back());
     }
 
+    InitializeNumaGroups(thread_options.numa_nodes);
+
     // Eigen::MaxSizeVector has neither essential exception safety features
     // such as swap, nor it is movable. So we have to join threads right here
     // on exception
@@ -817,7 +821,7 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
 
   void Schedule(std::function<void()> fn) override {
     PerThread* pt = GetPerThread();
-    int q_idx = Rand(&pt->rand) % num_threads_;
+    unsigned q_idx = RandomQueueIndex(*pt);
     WorkerData& td = worker_data_[q_idx];
     Queue& q = td.queue;
     fn = q.PushBack(std::move(fn));
@@ -1348,6 +1352,54 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     }
   }
 
+  // Group the workers by NUMA node.  The groups are only kept if the
+  // workers span more than one node; otherwise scheduling and stealing
+  // behave exactly as without NUMA information.  Workers whose node is
+  // unknown (negative id) form a group of their own.
+  void InitializeNumaGroups(const std::vector<int>& numa_nodes) {
+    if (numa_nodes.size() < num_threads_) {
+      return;
+    }
+    std::vector<int> group_nodes;
+    worker_group_.resize(num_threads_);
+    for (unsigned q_idx = 0; q_idx < num_threads_; q_idx++) {
+      auto it = std::find(group_nodes.begin(), group_nodes.end(), numa_nodes[q_idx]);
+      if (it == group_nodes.end()) {
+        group_nodes.push_back(numa_nodes[q_idx]);
+        group_workers_.emplace_back();
+        it = group_nodes.end() - 1;
+      }
+      unsigned group = static_cast<unsigned>(it - group_nodes.begin());
+      worker_group_[q_idx] = group;
+      group_workers_[group].push_back(q_idx);
+    }
+    if (group_workers_.size() <= 1) {
+      worker_group_.clear();
+      group_workers_.clear();
+    }
+  }
+
+  // Returns the workers on the same NUMA node as the calling thread, or
+  // nullptr if the pool is not NUMA aware or the caller is not one of
+  // its workers (e.g. the main thread, whose placement we do not control).
+  const std::vector<unsigned>* LocalWorkers(const PerThread& pt) const {
+    if (group_workers_.empty() || pt.pool != this) {
+      return nullptr;
+    }
+    return &group_workers_[worker_group_[pt.thread_id]];
+  }
+
+  // Pick a random queue to push new work to, staying on the caller's
+  // NUMA node where possible.
+  unsigned RandomQueueIndex(PerThread& pt) {
+    unsigned r = Rand(&pt.rand);
+    const std::vector<unsigned>* local = LocalWorkers(pt);
+    if (local != nullptr) {
+      return (*local)[r % local->size()];
+    }
+    return r % num_threads_;
+  }
+
   typedef typename Environment::EnvThread Thread;
   struct WorkerData;
 
@@ -1498,6 +1550,11 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
   const bool set_denormal_as_zero_;
   Eigen::MaxSizeVector<WorkerData> worker_data_;
   Eigen::MaxSizeVector<Eigen::MaxSizeVector<unsigned>> all_coprimes_;
+  // NUMA groups, empty unless the workers span more than one node.
+  // worker_group_ maps a q_idx to its group, group_workers_ lists the
+  // q_idx values in each group.
+  std::vector<unsigned> worker_group_;
+  std::vector<std::vector<unsigned>> group_workers_;
   std::atomic<unsigned> blocked_;  // Count of blocked workers, used as a termination condition
   std::atomic<bool> done_;
 
@@ -1651,9 +1708,38 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
   // is that the thread is busy with other work, and we will avoid
   // "snatching" work from a thread which is just about to notice the
   // work itself.
+  //
+  // In a NUMA aware pool a worker first walks the workers on its own
+  // node.  A single attempt (TRY_ONE, made while spinning) stays on the
+  // node, even if the worker is alone on it; only when a worker has run
+  // out of work entirely (TRY_ALL) does it walk the other nodes, one
+  // after the other starting with the next one, so that loop shards tend
+  // to keep their working set within one node.
 
   Task Steal(StealAttemptKind steal_kind) {
     PerThread* pt = GetPerThread();
+    const std::vector<unsigned>* local = LocalWorkers(*pt);
+    if (local != nullptr) {
+      if (local->size() > 1) {
+        Task t = StealFromGroup(*pt, *local, steal_kind);
+        if (t) {
+          return t;
+        }
+      }
+      if (steal_kind == StealAttemptKind::TRY_ONE) {
+        return Task();
+      }
+      const unsigned num_groups = static_cast<unsigned>(group_workers_.size());
+      const unsigned local_group = worker_group_[pt->thread_id];
+      for (unsigned i = 1; i < num_groups; i++) {
+        Task t = StealFromGroup(*pt, group_workers_[(local_group + i) % num_groups], steal_kind);
+        if (t) {
+          return t;
+        }
+      }
+      return Task();
+    }
+
     unsigned size = num_threads_;
     unsigned num_attempts = (steal_kind == StealAttemptKind::TRY_ALL) ? size : 1;
     unsigned r = Rand(&pt->rand);
@@ -1677,6 +1763,30 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     return Task();
   }
 
+  Task StealFromGroup(PerThread& pt, const std::vector<unsigned>& group, StealAttemptKind steal_kind) {
+    unsigned size = static_cast<unsigned>(group.size());
+    unsigned num_attempts = (steal_kind == StealAttemptKind::TRY_ALL) ? size : 1;
+    unsigned r = Rand(&pt.rand);
+    unsigned inc = all_coprimes_[size - 1][r % all_coprimes_[size - 1].size()];
+    unsigned victim = r % size;
+
+    for (unsigned i = 0; i < num_attempts; i++) {
+      WorkerData& td = worker_data_[group[victim]];
+      if (td.GetStatus() == WorkerData::ThreadStatus::Active) {
+        Task t = td.queue.PopBack();
+        if (t) {
+          return t;
+        }
+      }
+      victim += inc;
+      if (victim >= size) {
+        victim -= size;
+      }
+    }
+
+    return Task();
+  }
+
   int NonEmptyQueueIndex() {
     PerThread* pt = GetPerThread();
     const unsigned size = static_cast<unsigned>(worker_data_.size());
@@ -366,6 +366,20 @@ class ThreadPool {
   static void StartProfiling(concurrency::ThreadPool* tp);
   static std::string StopProfiling(concurrency::ThreadPool* tp);
 
+  // Statistics of the loops a thread split across more than one thread.
+  struct ParallelLoopStats {
+    uint64_t num_loops = 0;
+    // sums over the loops of the requested degree of parallelism and of the number of threads that ran a part
+    // of the loop, which is lower when the workers are busy with other work
+    uint64_t requested_parallelism = 0;
+    uint64_t achieved_parallelism = 0;
+  };
+
+  // Accumulate the statistics of the parallel loops that the calling thread runs on any thread pool in stats,
+  // or stop collecting them if stats is nullptr. Returns the previous collector of the thread, so that nested
+  // collection can be restored. Not to be consumed as public-facing API.
+  static ParallelLoopStats* SetParallelLoopStatsCollector(ParallelLoopStats* stats);
+
  private:
   friend class LoopCounter;
 
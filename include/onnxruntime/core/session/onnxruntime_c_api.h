@@ -356,6 +356,9 @@ typedef struct OrtAllocator {
    * - NumArenaExtensions: Number of arena extensions (Relevant only for arena based allocators)
    * - NumArenaShrinkages: Number of arena shrinkages (Relevant only for arena based allocators)
    * - MaxAllocSize: The max single allocation seen.
+   * - NumCacheHits: Number of allocations served by the size class cache of an arena.
+   * - NumCacheMisses: Number of cacheable allocations that had to refill the size class cache.
+   * - InCache: Number of bytes held by the size class cache of an arena. They are not included in InUse.
    *
    * NOTE: If the allocator does not implement this function, the OrtKeyValuePairs instance will be empty.
    */
@@ -2903,6 +2906,9 @@ struct OrtApi {
    *  Use -1 to allow ORT to choose the default 1GB for max_power_of_two_extend_bytes.
    *  Ultimately, the allocation size is determined by the allocation memory request.
    *  Further allocation sizes are governed by the arena extend strategy.
+   * "size_class_cache_max_bytes": Largest allocation served by the size class cache in front of the arena.
+   *  Freed chunks up to this size are kept in per-thread shards, so that concurrent allocations of similar
+   *  sizes do not contend on the arena lock. Use 0 or -1 to disable the cache, which is the default.
    *
    * \param[in] arena_config_keys Keys to configure the arena
    * \param[in] arena_config_values Values to configure the arena
@@ -4535,6 +4541,9 @@ struct OrtApi {
                   _In_reads_(num_keys) const char* const* provider_options_keys, _In_reads_(num_keys) const char* const* provider_options_values, _In_ size_t num_keys);
 
   /** \brief Run the model asynchronously in a thread owned by intra op thread pool
+   *
+   * When dynamic batching is enabled with the "session.dynamic_batching.max_batch_size" session config entry,
+   * concurrent calls may instead be combined into a single run on a thread owned by the session.
    *
    * \param[in] session
    * \param[in] run_options If nullptr, will use a default ::OrtRunOptions
@@ -5313,6 +5322,53 @@ struct OrtApi {
    * \since Version 1.23.
    */
   ORT_API2_STATUS(AllocatorGetStats, _In_ const OrtAllocator* ort_allocator, _Outptr_ OrtKeyValuePairs** out);
+
+  /** \brief Get the statistics of the continuous profiling of a session
+   *
+   * Continuous profiling is enabled with the "session.profiling_sample_interval" session config entry.
+   * It profiles one in every N runs and aggregates the latencies of the nodes per op type.
+   * The statistics can be queried at any time, including while the session is being run.
+   *
+   * The keys are "sample_interval", "sampled_runs", "run.<stat>" for the latency of the sampled runs and
+   * "op.<op type>.<stat>" for every op type that was executed, where <stat> is one of count, mean_us, p50_us,
+   * p90_us, p99_us and max_us. Latencies are in microseconds. Op types additionally report mean_bytes_allocated,
+   * parallel_loops, mean_requested_parallelism and mean_achieved_parallelism. With the
+   * "session.profiling_node_stats" session config entry, the same statistics are reported for every executed node
+   * as "node.<node name>.<stat>".
+   *
+   * The user should call OrtApi::ReleaseKeyValuePairs on the returned instance.
+   *
+   * \param[in] session
+   * \param[out] out A pointer to the OrtKeyValuePairs instance that contains the statistics. It is empty if
+   *                 continuous profiling is not enabled for the session.
+   *
+   * \snippet{doc} snippets.dox OrtStatus Return Value
+   *
+   * \since Version 1.23.
+   */
+  ORT_API2_STATUS(SessionGetProfilingStats, _In_ const OrtSession* session, _Outptr_ OrtKeyValuePairs** out);
+
+  /** \brief Get the statistics of the dynamic batching of a session
+   *
+   * Dynamic batching is enabled with the "session.dynamic_batching.max_batch_size" session config entry.
+   * It combines concurrent OrtApi::RunAsync calls into single runs.
+   * The statistics can be queried at any time, including while the session is being run.
+   *
+   * The keys are "num_requests" for the requests that were queued, "num_batches" for the runs they were combined
+   * into, "max_requests_per_batch", and "mean_queue_delay_us" and "max_queue_delay_us" for the time between queuing
+   * a request and the start of its run, in microseconds.
+   *
+   * The user should call OrtApi::ReleaseKeyValuePairs on the returned instance.
+   *
+   * \param[in] session
+   * \param[out] out A pointer to the OrtKeyValuePairs instance that contains the statistics. It is empty if
+   *                 dynamic batching is not enabled for the session.
+   *
+   * \snippet{doc} snippets.dox OrtStatus Return Value
+   *
+   * \since Version 1.23.
+   */
+  ORT_API2_STATUS(SessionGetDynamicBatchingStats, _In_ const OrtSession* session, _Outptr_ OrtKeyValuePairs** out);
 };
 
 /*
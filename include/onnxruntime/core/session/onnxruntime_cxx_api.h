@@ -1289,6 +1289,8 @@ struct ConstSessionImpl : Base<T> {
   AllocatedStringPtr GetOverridableInitializerNameAllocated(size_t index, OrtAllocator* allocator) const;  ///< Wraps OrtApi::SessionGetOverridableInitializerName
 
   uint64_t GetProfilingStartTimeNs() const;  ///< Wraps OrtApi::SessionGetProfilingStartTimeNs
+  KeyValuePairs GetProfilingStats() const;   ///< Wraps OrtApi::SessionGetProfilingStats
+  KeyValuePairs GetDynamicBatchingStats() const;  ///< Wraps OrtApi::SessionGetDynamicBatchingStats
   ModelMetadata GetModelMetadata() const;    ///< Wraps OrtApi::SessionGetModelMetadata
 
   TypeInfo GetInputTypeInfo(size_t index) const;                   ///< Wraps OrtApi::SessionGetInputTypeInfo
@@ -1357,6 +1357,20 @@ inline uint64_t ConstSessionImpl<T>::GetProfilingStartTimeNs() const {
   return out;
 }
 
+template <typename T>
+inline KeyValuePairs ConstSessionImpl<T>::GetProfilingStats() const {
+  OrtKeyValuePairs* out;
+  ThrowOnError(GetApi().SessionGetProfilingStats(this->p_, &out));
+  return KeyValuePairs(out);
+}
+
+template <typename T>
+inline KeyValuePairs ConstSessionImpl<T>::GetDynamicBatchingStats() const {
+  OrtKeyValuePairs* out;
+  ThrowOnError(GetApi().SessionGetDynamicBatchingStats(this->p_, &out));
+  return KeyValuePairs(out);
+}
+
 template <typename T>
 inline ModelMetadata ConstSessionImpl<T>::GetModelMetadata() const {
   OrtModelMetadata* out;
@@ -249,6 +249,20 @@ static const char* const kNodePartitionConfigFile = "session.node_partition_conf
 //    Hence 64-65 is an invalid configuration, because a windows thread cannot be attached to processors across group boundary.
 static const char* const kOrtSessionOptionsConfigIntraOpThreadAffinities = "session.intra_op_thread_affinities";
 
+// This Option makes the intra op thread pool NUMA aware.
+// Workers on the same NUMA node are grouped together: work that a worker pushes goes to a worker of its own node,
+// and idle workers steal from their own node first, only crossing to other nodes once they have run out of work.
+// The value is either "auto", which looks up the node of each thread from its affinity (so it requires
+// session.intra_op_thread_affinities, or the affinities ort sets by default when intra_op_num_threads is 0),
+// or a list of node ids in the same layout as the affinity string, e.g.
+// 0;0;0;1;1;1;1
+// for a pool of 8 threads where the 1st to 3rd threads run on node 0 and the 4th to 7th on node 1.
+// Note:
+// 1. As with affinities, the number of nodes must equal to intra_op_num_threads - 1, the main thread is not listed;
+// 2. The node ids only describe the topology, they do not change where a thread runs. Pair them with affinities so
+//    that the threads, and memory they first touch, actually reside on the listed nodes.
+static const char* const kOrtSessionOptionsConfigIntraOpThreadNumaNodes = "session.intra_op_thread_numa_nodes";
+
 // This option will dump out the model to assist debugging any issues with layout transformation,
 // and is primarily intended for developer usage. It is only relevant if an execution provider that requests
 // NHWC layout is enabled such as NNAPI, XNNPACK or QNN.
@@ -302,6 +316,15 @@ static const char* const kOrtSessionOptionsModelExternalInitializersFileFolderPa
 static const char* const kOrtSessionOptionsSavePrePackedConstantInitializers =
     "session.save_external_prepacked_constant_initializers";
 
+// Path of a file to cache the pre-packed weights of CPU kernels in across processes. Kernels that support it
+// restore their pre-packed state from the memory mapped file instead of packing their constant inputs again.
+// Entries are keyed by the node, the contents of its constant inputs and the CPU features, so one file can be
+// shared by several models. A relative path is resolved against the folder of the model.
+// The file is created if it does not exist, and its content is ignored if it was written by a different build or
+// on a CPU with different features. It is not used while pre-packed initializers are saved to an external file.
+// - "path to file": there is not a default for this option, kernels pre-pack their weights in every session.
+static const char* const kOrtSessionOptionsPrepackedWeightsCacheFile = "session.prepacked_weights_cache_file";
+
 // Use this config when you want to collect memory stats for each node in the graph.
 // The file format is a CSV file with the following columns:
 // The file will be created if it does not exist, and will be overwritten if it does.
@@ -320,6 +343,78 @@ static const char* const kOrtSessionOptionsSavePrePackedConstantInitializers =
 // - "full path to file": there is not a default for this option. If the file can not be opened for writing, an error will be returned.
 static const char* const kOrtSessionOptionsCollectNodeMemoryStatsToFile = "session.collect_node_memory_stats_to_file";
 
+// Path of a file to persist the memory patterns of the session in, so that later sessions of the same model
+// (e.g. after a process restart) start with the patterns instead of generating them on the first run of each
+// input shape. A relative path is resolved against the folder of the model.
+// The file is created if it does not exist, and its content is ignored if it was written for a different model,
+// set of execution providers or build. Only used when memory patterns are enabled.
+// The file is updated by the run that generates a new pattern. Sessions in several processes may share the file,
+// each update keeps the patterns the other sessions wrote.
+// - "path to file": there is not a default for this option, patterns are only cached in memory.
+static const char* const kOrtSessionOptionsMemoryPatternCacheFile = "session.memory_pattern_cache_file";
+
+// Round the dimensions of the inputs up to a power of two when looking up a memory pattern, so that runs with
+// nearby shapes share one pattern instead of each generating their own. As with shape buckets, a pattern serves
+// the runs whose inputs are no larger in any dimension than the inputs it was traced with, a larger run is traced
+// and adds a pattern for its inputs. Dimensions with declared shape buckets use those buckets instead.
+// "0": disabled. (default)
+// "1": enabled.
+static const char* const kOrtSessionOptionsMemoryPatternDimBucketing = "session.memory_pattern_dim_bucketing";
+
+// Shape buckets for symbolic dimensions of the graph inputs, used to share one memory pattern between all runs
+// that fall into the same buckets. Each bucket is identified by its upper bound, a run uses the smallest bucket
+// that holds its dimension. A pattern of a bucket serves every run in it whose inputs are no larger in any
+// dimension than the inputs the pattern was traced with, other runs are traced and add a pattern for their inputs.
+// Runs with a dimension above the largest bucket use the regular per-shape patterns.
+// Format: "dim_param:upper_bound,upper_bound,...;dim_param:..." e.g. "seq_len:64,128,256,512;batch:1,4,16"
+// There is no default, no buckets are declared.
+static const char* const kOrtSessionOptionsMemoryPatternShapeBuckets = "session.memory_pattern_shape_buckets";
+
+// Transform the subgraphs of control flow nodes (e.g. the then and else branches of an If) concurrently on the
+// inter-op thread pool, or the intra-op thread pool when there is none, to speed up session creation.
+// Only the subgraphs are transformed concurrently: the transformers still run one after the other, rule-based
+// transformers match the nodes of a graph sequentially, and graph partitioning is unchanged. Models without control
+// flow nodes are not affected.
+// "0": disabled. (default)
+// "1": enabled.
+static const char* const kOrtSessionOptionsParallelGraphTransformation = "session.parallel_graph_transformation";
+
+// Coalesce concurrent RunAsync calls into batched runs. Requests with the same inputs, outputs and run options whose
+// input shapes only differ in the batch dimension are concatenated along it, run once, and the outputs are split back
+// into the callbacks of the requests. Only requests with CPU tensor inputs and no preallocated outputs are batched,
+// and only if the model declares the batch dimension of all of their inputs and outputs with the same symbolic
+// dimension. Batched runs are scheduled on the intra op thread pool like RunAsync calls, and are recorded as
+// "dynamic_batch_run" events when profiling is enabled. The batching statistics are returned by
+// OrtApi::SessionGetDynamicBatchingStats.
+// Maximum number of samples (sum of the batch dimension of the requests) in a batched run.
+// "0" or "1": dynamic batching is disabled. (default)
+// "> 1": dynamic batching is enabled.
+static const char* const kOrtSessionOptionsDynamicBatchingMaxBatchSize = "session.dynamic_batching.max_batch_size";
+
+// Maximum time in microseconds a request waits for other requests to join its batch. Default is "1000".
+static const char* const kOrtSessionOptionsDynamicBatchingMaxDelayUs = "session.dynamic_batching.max_delay_us";
+
+// Index of the batch dimension of all inputs and outputs. Default is "0".
+static const char* const kOrtSessionOptionsDynamicBatchingBatchDim = "session.dynamic_batching.batch_dim";
+
+// Continuous low-overhead profiling. One in every N runs is profiled, the latencies of its nodes are aggregated
+// into per op type histograms in-process and the most recent node events are kept in a fixed-size ring buffer.
+// The aggregates can be queried at any time with OrtApi::SessionGetProfilingStats. Independent of the profiling
+// enabled with OrtApi::EnableProfiling, which records every run to a file.
+// "0": disabled. (default)
+// "N > 0": profile one in every N runs.
+static const char* const kOrtSessionOptionsProfilingSampleInterval = "session.profiling_sample_interval";
+
+// Number of node events kept in the ring buffer of the continuous profiling. Default is "4096".
+static const char* const kOrtSessionOptionsProfilingRingBufferSize = "session.profiling_ring_buffer_size";
+
+// Also aggregate the statistics of the continuous profiling per node, in addition to per op type. Each node then
+// reports its latency histogram, the bytes it allocated and the parallelism its loops achieved on the intra-op
+// thread pool. Costs about 4KB of memory per node.
+// "0": disabled. (default)
+// "1": enabled.
+static const char* const kOrtSessionOptionsProfilingNodeStats = "session.profiling_node_stats";
+
 /// This is a composite CSV setting formatted as "memory limit in kb,file name for collected stats"
 /// "limit > 0": enables Capacity Aware Partitioning for Cuda EP. `limit` is optional and when absent
 /// the provider may attempt to figure out the memory available automatically.
@@ -372,6 +467,40 @@ static const char* const kOrtSessionOptionsEpContextModelExternalInitializersFil
 // - "1": Gemm FastMath mode is enabled.
 static const char* const kOrtSessionOptionsMlasGemmFastMathArm64Bfloat16 = "mlas.enable_gemm_fastmath_arm64_bfloat16";
 
+// Gemm fastmath mode on x64, using the AVX512_BF16 or AMX-BF16 instructions: MatMul computes the products in
+// bfloat16 and accumulates them in fp32. Ignored on processors without AVX512_BF16.
+// Option values:
+// - "0": Gemm FastMath mode is not enabled. [DEFAULT]
+// - "1": Gemm FastMath mode is enabled.
+static const char* const kOrtSessionOptionsMlasGemmFastMathX64Bfloat16 = "mlas.enable_gemm_fastmath_x64_bfloat16";
+
+// Runtime tuning of the MLAS SGEMM/QGEMM thread partition and blocking on the CPU EP. Tuned parameters are keyed by
+// GEMM shape, exported with InferenceSession::GetTuningResults and validated against the CPU model when loaded, so
+// results tuned on one host can be reused by later runs on the same kind of host. The options apply to the GEMMs run
+// on the intra-op thread pool of the session, so sessions that use the global thread pools share them. Tuned
+// parameters are cached process wide.
+// Option values:
+// - "0": Tuned parameters are not used. [DEFAULT]
+// - "1": Tuned parameters loaded with the tuning results are used.
+static const char* const kOrtSessionOptionsMlasGemmTunableOp = "mlas.enable_gemm_tunable_op";
+
+// Benchmark candidate parameters for GEMM shapes without a tuned result. Implies "mlas.enable_gemm_tunable_op".
+// Option values:
+// - "0": Tuning is not enabled. [DEFAULT]
+// - "1": Tuning is enabled.
+static const char* const kOrtSessionOptionsMlasGemmTuning = "mlas.enable_gemm_tuning";
+
+// Maximum time in milliseconds spent tuning a single GEMM shape. "0" means no limit. [DEFAULT]
+static const char* const kOrtSessionOptionsMlasGemmMaxTuningDurationMs = "mlas.gemm_max_tuning_duration_ms";
+
+// Evaluate ensembles of shallow trees (TreeEnsemble, TreeEnsembleRegressor and TreeEnsembleClassifier) with
+// matrix multiplications on batches of at least 32 rows instead of walking the nodes of every tree.
+// Whether it is faster depends on the trees, the batch size and the hardware, so measure it on the model.
+// Option values:
+// - "0": Trees are evaluated by walking their nodes. [DEFAULT]
+// - "1": Ensembles whose trees are at most 8 levels deep are evaluated with matrix multiplications.
+static const char* const kOrtSessionOptionsTreeEnsembleGemm = "session.tree_ensemble_gemm";
+
 // When converting DQ + MatMul -> MatMulNBits, the accuracy level of the MatMulNBits is controlled by this option.
 // Refer to MatMulNBits op schema for more details.
 // If not provided, default is 4.
@@ -333,6 +333,21 @@ Status Attention<T>::Compute(OpKernelContext* context) const {
     });
   }
 
+  const bool causal = is_unidirectional_ && sequence_length > 1;
+  if (past == nullptr &&
+      parameters.head_size == parameters.v_head_size &&
+      CanUseFlashAttention(mask_index, causal, batch_size, sequence_length, sequence_length)) {
+    int past_sequence_length = 0;
+    Tensor* present = GetPresent(context, past, batch_size, parameters.v_head_size, sequence_length,
+                                 past_sequence_length);
+    if (present != nullptr) {
+      // present is the concatenation of K and V, which are consecutive in gemm_data
+      memcpy(present->MutableData<T>(), K, present->SizeInBytes());
+    }
+    return ApplyFlashAttention(Q, K, V, mask_index, attention_bias, causal, output, batch_size, sequence_length,
+                               sequence_length, parameters.head_size, parameters.v_head_size, context);
+  }
+
   // Compute the attention score and apply the score to V
   return ApplyAttention(Q, K, V, mask_index, past, nullptr /* past_key */, nullptr /* past_value */,
                         output, nullptr /* present_key */, nullptr /* present_value */, nullptr /* output_qk */,
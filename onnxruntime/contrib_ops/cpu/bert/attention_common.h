@@ -53,6 +53,13 @@ enum AttentionKernelType {
   AttentionKernel_Default
 };
 
+enum class KVQuantizationType {
+  NONE,         // k-v cache is not quantized
+  PER_TENSOR,   // one scale for the whole cache
+  PER_HEAD,     // one scale for each head (kv_num_heads) of the cache
+  PER_CHANNEL,  // one scale for each channel (kv_num_heads * head_size) of the cache
+};
+
 constexpr bool LAYOUT_BSNH = false;
 constexpr bool LAYOUT_BNSH = true;
 
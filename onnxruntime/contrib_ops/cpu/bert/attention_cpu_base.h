@@ -4,10 +4,14 @@
 #pragma once
 
 #include "contrib_ops/cpu/bert/attention_base.h"
+#include "contrib_ops/cpu/bert/attention_common.h"
 #include "contrib_ops/cpu/bert/attention_helper.h"
 #include "core/common/common.h"
 #include "core/common/safeint.h"
 #include "core/framework/op_kernel.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/platform/env.h"
+#include "core/platform/env_var_utils.h"
 #include "contrib_ops/cpu/utils/dump_tensor.h"
 
 namespace onnxruntime {
@@ -16,7 +20,10 @@ namespace contrib {
 class AttentionCPUBase : public AttentionBase {
  protected:
   AttentionCPUBase(const OpKernelInfo& info, bool require_same_hidden_size)
-      : AttentionBase(info, require_same_hidden_size) {}
+      : AttentionBase(info, require_same_hidden_size) {
+    l2_cache_size_ = Env::Default().GetL2CacheSize();
+    disable_flash_ = ParseEnvironmentVariableWithDefault<bool>(attention::kDisableFlashAttention, false);
+  }
 
   template <typename T>
   Status ApplyAttention(const T* Q,                // Q data with shape BxNxSxH
@@ -125,6 +132,130 @@ class AttentionCPUBase : public AttentionBase {
     return Status::OK();
   }
 
+  // Whether ApplyFlashAttention supports the attention mask: a causal mask for self attention only, and a key
+  // padding mask of key sequence lengths (with or without start positions) or of shape (B, T).
+  bool CanUseFlashAttention(const Tensor* mask_index, bool causal, int batch_size, int sequence_length,
+                            int kv_sequence_length) const {
+    if (disable_flash_ || l2_cache_size_ <= 0) {
+      return false;
+    }
+    if (causal && sequence_length != kv_sequence_length) {
+      return false;
+    }
+    if (mask_index != nullptr) {
+      auto dims = mask_index->Shape().GetDims();
+      if (dims.size() == 1) {
+        return dims[0] == batch_size || dims[0] == 2 * static_cast<int64_t>(batch_size);
+      }
+      return dims.size() == 2;
+    }
+    return true;
+  }
+
+  // Computes the attention of Q, K and V without past state or materialized attention probabilities.
+  // The key padding mask is applied as a bias of mask_filter_value on the padded keys, as in ApplyAttention.
+  Status ApplyFlashAttention(const float* Q,              // Q data with shape BxNxSxH
+                             const float* K,              // K data with shape BxNxLxH
+                             const float* V,              // V value with size BxNxLxH_v
+                             const Tensor* mask_index,    // key padding mask, see CanUseFlashAttention
+                             const Tensor* attn_bias,     // additive bias of shape (B or 1)x(N or 1)xSxL
+                             bool causal,                 // whether query s only attends keys up to s
+                             Tensor* output,              // output tensor with shape BxSxD_v
+                             int batch_size,              // batch size (B)
+                             int sequence_length,         // sequence length of Q (S)
+                             int kv_sequence_length,      // sequence length of K or V (L)
+                             int qk_head_size,            // head size of Q or K (H)
+                             int v_head_size,             // head size of V (H_v)
+                             OpKernelContext* context) const {
+    AllocatorPtr allocator;
+    ORT_RETURN_IF_ERROR(context->GetTempSpaceAllocator(&allocator));
+
+    MlasFlashAttentionThreadedArgs args;
+    args.batch_size = batch_size;
+    args.num_heads = num_heads_;
+    args.q_sequence_length = sequence_length;
+    args.kv_sequence_length = kv_sequence_length;
+    args.qk_head_size = qk_head_size;
+    args.v_head_size = v_head_size;
+    args.scale = (scale_ == 0.0f) ? 1.0f / sqrt(static_cast<float>(qk_head_size)) : scale_;
+    /*
+      q_block_size, kv_block_size correspond to Br, Bc in the FlashAttention paper.
+      Let M = l2_cache_size / sizeof(float)
+      In the FlashAttention kernel, there are 5 big matrices that we need to keep in L2 cache:
+        slice of Q -- [Br, qk_head_size]
+        slice of K -- [Bc, qk_head_size]
+        slice of V -- [Bc, v_head_size]
+        result of QK -- [Br, Bc]
+        temporary output (same shape as QKV) -- [Br, v_head_size]
+      The total size of these matrices is (Br + Bc) * (qk_head_size + v_head_size) + Br * Bc
+      By taking Bc = M / (4 * (qk_head_size + v_head_size)), and Br = min(Bc, qk_head_size + v_head_size), we have
+        (Br + Bc) * (qk_head_size + v_head_size) + Br * Bc
+        <= 2 * Bc * (qk_head_size + v_head_size) + Br * Bc
+        <= 2 * Bc * (qk_head_size + v_head_size) + M/4
+        <= 2 * M/4 + M/4 = M * (3/4)
+
+      We leave 1/4 of the L2 cache for
+        1. storing small tensors l and m
+        2. instruction (code)
+    */
+    args.kv_block_size = l2_cache_size_ / (static_cast<int>(sizeof(float)) * 4 * (qk_head_size + v_head_size));
+    args.kv_block_size = std::max(args.kv_block_size, 1);  // avoid kv_block_size = 0
+    args.q_block_size = std::min(args.kv_block_size, qk_head_size + v_head_size);
+    args.kv_block_size = std::min(args.kv_block_size, kv_sequence_length);  // No point to have kv_block_size > kv_sequence_length
+    args.q_block_size = std::min(args.q_block_size, sequence_length);       // No point to have q_block_size > q_sequence_length
+
+    auto* tp = context->GetOperatorThreadPool();
+    args.thread_count = concurrency::ThreadPool::DegreeOfParallelism(tp);
+    args.buffer_size_per_thread = MlasFlashAttentionBufferSizePerThread(
+        MLAS_FLASH_ATTENTION_TYPE::Float32, args.q_block_size, args.kv_block_size, qk_head_size, v_head_size);
+    size_t buffer_bytes = SafeInt<size_t>(args.buffer_size_per_thread) * args.thread_count;
+    IAllocatorUniquePtr<void> buffer = IAllocator::MakeUniquePtr<void>(allocator, buffer_bytes);
+    args.buffer = reinterpret_cast<float*>(buffer.get());
+
+    args.query = Q;
+    args.key = K;
+    args.value = V;
+    args.output = output->MutableData<float>();
+    args.causal = causal;
+
+    if (attn_bias != nullptr) {
+      auto dims = attn_bias->Shape().GetDims();
+      const size_t matrix_size = SafeInt<size_t>(sequence_length) * kv_sequence_length;
+      args.attention_bias = attn_bias->Data<float>();
+      args.attention_bias_batch_stride = dims[0] == 1 ? 0 : SafeInt<size_t>(dims[1]) * matrix_size;
+      args.attention_bias_head_stride = dims[1] == 1 ? 0 : matrix_size;
+      args.attention_bias_row_stride = static_cast<size_t>(kv_sequence_length);
+    }
+
+    IAllocatorUniquePtr<float> key_bias;
+    if (mask_index != nullptr) {
+      key_bias = IAllocator::MakeUniquePtr<float>(allocator, SafeInt<size_t>(batch_size) * kv_sequence_length);
+      const int32_t* mask_data = mask_index->Data<int32_t>();
+      auto dims = mask_index->Shape().GetDims();
+      for (int b = 0; b < batch_size; b++) {
+        float* p = key_bias.get() + static_cast<ptrdiff_t>(b) * kv_sequence_length;
+        if (dims.size() == 2) {
+          const int32_t* raw_mask = mask_data + static_cast<ptrdiff_t>(b) * kv_sequence_length;
+          for (int t = 0; t < kv_sequence_length; t++) {
+            p[t] = raw_mask[t] > 0 ? 0.0f : mask_filter_value_;
+          }
+        } else {
+          // key sequence lengths, followed by start positions for left-side padding if there are 2B entries
+          const int end_position = std::clamp(mask_data[b], 0, kv_sequence_length);
+          const int start_position =
+              dims[0] == batch_size ? 0 : std::clamp(mask_data[b + batch_size], 0, kv_sequence_length);
+          for (int t = 0; t < kv_sequence_length; t++) {
+            p[t] = (t < start_position || t >= end_position) ? mask_filter_value_ : 0.0f;
+          }
+        }
+      }
+      args.key_bias = key_bias.get();
+    }
+
+    MlasFlashAttention(&args, tp);
+    return Status::OK();
+  }
+
   // For DecoderMaskedMultiHeadAttention
   template <typename T>
   Status ApplyAttentionWithBeams(const T* Q,
@@ -184,6 +315,9 @@ class AttentionCPUBase : public AttentionBase {
     return Status::OK();
   }
 
+  int l2_cache_size_;
+  bool disable_flash_;
+
  private:
   // Helper function to compute the attention probs. It does 2 things:
   //  attention_probs(B, N, S, T) = 1/sqrt(H) x Q(B, N, S, H) x K'(B, N, T, H -> B, N, H, T) +
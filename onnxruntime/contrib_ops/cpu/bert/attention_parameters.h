@@ -100,6 +100,8 @@ struct GroupQueryAttentionParameters : AttentionParameters {
   AttentionQkvFormat past_kv_format;
   int zeros_count;
   int* zero_ptr;
+  int kv_cache_page_size;      // number of tokens of a page of a paged kv cache, or 0 if the kv cache is not paged
+  int max_pages_per_sequence;  // dimension 1 of the block table of a paged kv cache
 };
 
 // Parameters for sparse attention.
@@ -11,6 +11,8 @@
 #include "core/common/common.h"
 #include "core/common/safeint.h"
 #include "core/framework/op_kernel.h"
+#include "core/platform/env.h"
+#include "core/platform/env_var_utils.h"
 
 namespace onnxruntime {
 namespace contrib {
@@ -35,6 +37,37 @@ class GQAAttentionBase {
     use_smooth_softmax_ = info.GetAttrOrDefault<int64_t>("smooth_softmax", 0) == 1;
 
     local_window_size_ = has_local ? static_cast<int>(info.GetAttrOrDefault<int64_t>("local_window_size", -1)) : -1;
+
+    k_quant_type_ = ParseKVQuantizationType(info.GetAttrOrDefault<std::string>("k_quant_type", "NONE"));
+    v_quant_type_ = ParseKVQuantizationType(info.GetAttrOrDefault<std::string>("v_quant_type", "NONE"));
+    kv_cache_bit_width_ = static_cast<int>(info.GetAttrOrDefault<int64_t>("kv_cache_bit_width", 0));
+    ORT_ENFORCE((k_quant_type_ == KVQuantizationType::NONE) == (v_quant_type_ == KVQuantizationType::NONE),
+                "k_quant_type and v_quant_type shall be both NONE or both quantized.");
+    if (k_quant_type_ == KVQuantizationType::NONE) {
+      ORT_ENFORCE(kv_cache_bit_width_ == 0, "kv_cache_bit_width requires k_quant_type and v_quant_type.");
+    } else {
+      ORT_ENFORCE(kv_cache_bit_width_ == 8 || kv_cache_bit_width_ == 4,
+                  "kv_cache_bit_width shall be 8 or 4 for a quantized k-v cache, got ", kv_cache_bit_width_);
+    }
+
+    l2_cache_size_ = Env::Default().GetL2CacheSize();
+    disable_flash_ = ParseEnvironmentVariableWithDefault<bool>(attention::kDisableFlashAttention, false);
+  }
+
+  static KVQuantizationType ParseKVQuantizationType(const std::string& quant_type) {
+    if (quant_type == "NONE") {
+      return KVQuantizationType::NONE;
+    }
+    if (quant_type == "PER_TENSOR") {
+      return KVQuantizationType::PER_TENSOR;
+    }
+    if (quant_type == "PER_HEAD") {
+      return KVQuantizationType::PER_HEAD;
+    }
+    if (quant_type == "PER_CHANNEL") {
+      return KVQuantizationType::PER_CHANNEL;
+    }
+    ORT_THROW("Unsupported k-v cache quantization type: ", quant_type);
   }
 
   int num_heads_;     // number of attention heads of Q
@@ -47,6 +80,13 @@ class GQAAttentionBase {
 
   bool use_smooth_softmax_;
 
+  KVQuantizationType k_quant_type_;
+  KVQuantizationType v_quant_type_;
+  int kv_cache_bit_width_;  // 0 if the k-v cache is not quantized, otherwise 8 or 4
+
+  int l2_cache_size_;
+  bool disable_flash_;
+
   template <typename T>
   Status ApplyAttention(const T* Q,                                 // Q data with shape BxNxSxH
                         const T* K,                                 // K data with shape BxN_kvxSxH
@@ -57,6 +97,9 @@ class GQAAttentionBase {
                         Tensor* output,                             // output tensor
                         Tensor* present_key,                        // present K output tensor (if separating present KV)
                         Tensor* present_value,                      // present V output tensor (if separating present KV)
+                        const Tensor* k_scale,                      // scale of the quantized K cache
+                        const Tensor* v_scale,                      // scale of the quantized V cache
+                        const Tensor* block_table,                  // pages of a paged KV cache
                         const Tensor* seqlens_k,                    // past sequence lengths tensor
                         GroupQueryAttentionParameters& parameters,  // attention parameters
                         AllocatorPtr allocator,                     // allocator for temporary tensors
@@ -76,6 +119,23 @@ class GQAAttentionBase {
     }
     int seqlen_present_kv_cache = static_cast<int>(present_key->Shape().GetDims()[2]);
 
+    if constexpr (std::is_same_v<T, float>) {
+      // A quantized or paged k-v cache is only read by the flash attention kernel.
+      if (kv_cache_bit_width_ != 0 || block_table != nullptr || (!disable_flash_ && l2_cache_size_ > 0)) {
+        return ApplyFlashAttention(Q, K, V, attention_bias, past_key, past_value, output, present_key, present_value,
+                                   k_scale, v_scale, block_table, seqlens_k, parameters, seqlen_past_kv_cache,
+                                   seqlen_present_kv_cache, allocator, tp);
+      }
+    }
+    if (kv_cache_bit_width_ != 0) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED,
+                             "A quantized k-v cache is only supported for float GroupQueryAttention.");
+    }
+    if (block_table != nullptr) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED,
+                             "A paged k-v cache is only supported for float GroupQueryAttention.");
+    }
+
     // Compute the attention score.
     bool gqa_mlas_supported = MlasGQASupported<T>(CblasNoTrans, CblasTrans) &&
                               MlasGQASupported<T>(CblasNoTrans, CblasNoTrans);
@@ -128,6 +188,273 @@ class GQAAttentionBase {
   }
 
  private:
+  // Computes the attention with MlasGQAFlashAttention, which does not materialize the BxNxSxT attention probs:
+  // the K and V of the new tokens are appended to the present buffers, then each group of heads of Q sharing
+  // a head of K and V runs an online softmax over blocks of the present buffers. With a quantized k-v cache the
+  // new K and V are quantized when they are appended, and the kernel dequantizes each block as it is read. With a
+  // paged k-v cache the present buffers are pools of pages, and the block table gives the pages of each sequence.
+  Status ApplyFlashAttention(const float* Q,                                  // Q data with shape BxNxSxH
+                             const float* K,                                  // K data with shape BxN_kvxSxH
+                             const float* V,                                  // V data with shape BxN_kvxSxH
+                             const Tensor* attention_bias,                    // Attention bias to add to QxK'
+                             const Tensor* past_key,                          // past K input tensor
+                             const Tensor* past_value,                        // past V input tensor
+                             Tensor* output,                                  // output tensor
+                             Tensor* present_key,                             // present K output tensor
+                             Tensor* present_value,                           // present V output tensor
+                             const Tensor* k_scale,                           // scale of the quantized K cache
+                             const Tensor* v_scale,                           // scale of the quantized V cache
+                             const Tensor* block_table,                       // pages of a paged KV cache
+                             const Tensor* seqlens_k,                         // past sequence lengths tensor
+                             const GroupQueryAttentionParameters& parameters,  // attention parameters
+                             const int past_buffer_sequence_length,           // sequence length of past state
+                             const int present_buffer_sequence_length,        // sequence length of present state
+                             AllocatorPtr allocator,                          // allocator for temporary buffers
+                             ThreadPool* tp) const {                          // thread pool
+    const int batch_size = parameters.batch_size;
+    const int sequence_length = parameters.sequence_length;
+    const int head_size = parameters.head_size;
+    const bool packed_qkv = parameters.is_packed_qkv;
+    const bool is_prompt = parameters.is_first_prompt;
+    const int32_t* seqlens_k_data = seqlens_k->Data<int32_t>();
+
+    const bool quantized = kv_cache_bit_width_ != 0;
+    const MLDataType cache_type = !quantized                  ? DataTypeImpl::GetType<float>()
+                                  : kv_cache_bit_width_ == 4 ? DataTypeImpl::GetType<uint8_t>()
+                                                             : DataTypeImpl::GetType<int8_t>();
+    for (const Tensor* cache : {past_key, past_value, static_cast<const Tensor*>(present_key),
+                                static_cast<const Tensor*>(present_value)}) {
+      ORT_RETURN_IF_NOT(cache == nullptr || cache->DataType() == cache_type,
+                        "The type of the k-v cache does not match kv_cache_bit_width.");
+    }
+
+    // The cache is accessed as raw bytes so that the same code appends to a float or a quantized cache.
+    const void* past_key_data = past_key != nullptr ? past_key->DataRaw() : nullptr;
+    void* present_key_data = present_key->MutableDataRaw();
+    const void* past_value_data = past_value != nullptr ? past_value->DataRaw() : nullptr;
+    void* present_value_data = present_value->MutableDataRaw();
+    const bool past_present_share_buffer = past_key_data == present_key_data && past_value_data == present_value_data;
+
+    // Scales of the quantized cache, expanded to one per channel.
+    std::vector<float> key_scale;
+    std::vector<float> value_scale;
+    if (quantized) {
+      ORT_RETURN_IF_ERROR(ExpandKVCacheScale(k_scale, k_quant_type_, head_size, key_scale));
+      ORT_RETURN_IF_ERROR(ExpandKVCacheScale(v_scale, v_quant_type_, head_size, value_scale));
+    }
+    const size_t cache_row_bytes = !quantized ? head_size * sizeof(float)
+                                              : (kv_cache_bit_width_ == 4 ? head_size / 2 : head_size);
+
+    // The pages of a paged cache are checked, as the kernel reads the cache through them.
+    const bool paged = block_table != nullptr;
+    const int32_t* block_table_data = paged ? block_table->Data<int32_t>() : nullptr;
+    const size_t page_size = static_cast<size_t>(parameters.kv_cache_page_size);
+    const size_t max_pages_per_sequence = static_cast<size_t>(parameters.max_pages_per_sequence);
+    if (paged) {
+      const int64_t page_count = present_key->Shape()[0];
+      for (int b = 0; b < batch_size; ++b) {
+        const size_t used_pages = (static_cast<size_t>(seqlens_k_data[b]) + page_size) / page_size;
+        ORT_RETURN_IF_NOT(used_pages <= max_pages_per_sequence, "The sequence of batch entry ", b,
+                          " exceeds its pages in the block table.");
+        const int32_t* pages = block_table_data + b * max_pages_per_sequence;
+        for (size_t i = 0; i < used_pages; ++i) {
+          ORT_RETURN_IF_NOT(pages[i] >= 0 && pages[i] < page_count, "Invalid page ", pages[i],
+                            " in the block table of batch entry ", b);
+        }
+      }
+    }
+
+    const ptrdiff_t q_batch_stride = packed_qkv
+                                         ? SafeInt<ptrdiff_t>(num_heads_ + 2 * kv_num_heads_) * sequence_length * head_size
+                                         : SafeInt<ptrdiff_t>(num_heads_) * sequence_length * head_size;
+    const size_t kv_input_chunk_length = SafeInt<size_t>(sequence_length) * head_size;                   // S x H
+    const size_t past_buff_chunk_bytes = SafeInt<size_t>(past_buffer_sequence_length) * cache_row_bytes;     // L rows
+    const size_t present_buff_chunk_bytes = SafeInt<size_t>(present_buffer_sequence_length) * cache_row_bytes;  // T rows
+    const float* k = packed_qkv ? Q + num_heads_ * kv_input_chunk_length : K;
+    const float* v = packed_qkv ? Q + (num_heads_ + kv_num_heads_) * kv_input_chunk_length : V;
+
+    if (!past_present_share_buffer) {
+      if (paged) {
+        // the new tokens are written to the pages of the sequences, so the pools of pages are copied
+        memcpy(present_key_data, past_key_data, present_key->SizeInBytes());
+        memcpy(present_value_data, past_value_data, present_value->SizeInBytes());
+      } else {
+        memset(present_key_data, 0, present_key->SizeInBytes());
+        memset(present_value_data, 0, present_value->SizeInBytes());
+      }
+    }
+
+    // Append the new K and V to the present buffers, once per head of K and V.
+    TensorOpCost concat_cost;
+    concat_cost.bytes_loaded = static_cast<double>(2 * present_buff_chunk_bytes);
+    concat_cost.bytes_stored = concat_cost.bytes_loaded;
+    const auto write_rows = [&](const float* rows, uint8_t* cache, size_t row_count, const float* channel_scale) {
+      if (quantized) {
+        MlasQuantizeKVCache(rows, cache, row_count, head_size, channel_scale,
+                            static_cast<size_t>(kv_cache_bit_width_));
+      } else {
+        memcpy(cache, rows, row_count * head_size * sizeof(float));
+      }
+    };
+    const auto append_chunk = [&](const void* past, const float* chunk, void* present, const float* channel_scale,
+                                  size_t past_seqlen, size_t total_seqlen, std::ptrdiff_t i) {
+      const size_t batch_index = i / kv_num_heads_;
+      const size_t kv_head_index = i % kv_num_heads_;
+      if (paged) {
+        // Only the tokens of the sequence are written. The padding rows of a right padded prompt are past
+        // total_seqlen, in pages that were not validated above and may belong to other sequences.
+        const int32_t* pages = block_table_data + batch_index * max_pages_per_sequence;
+        const size_t row_count = std::min(static_cast<size_t>(sequence_length), total_seqlen - past_seqlen);
+        for (size_t s = 0; s < row_count; ++s) {
+          const size_t position = past_seqlen + s;
+          const size_t row = (static_cast<size_t>(pages[position / page_size]) * kv_num_heads_ + kv_head_index) *
+                                 page_size +
+                             position % page_size;
+          write_rows(chunk + s * head_size, static_cast<uint8_t*>(present) + row * cache_row_bytes, 1, channel_scale);
+        }
+        return;
+      }
+
+      uint8_t* p = static_cast<uint8_t*>(present) + i * present_buff_chunk_bytes;
+      if (!past_present_share_buffer && past_seqlen > 0) {
+        memcpy(p, static_cast<const uint8_t*>(past) + i * past_buff_chunk_bytes, past_seqlen * cache_row_bytes);
+      }
+      write_rows(chunk, p + past_seqlen * cache_row_bytes, sequence_length, channel_scale);
+    };
+    ThreadPool::TryParallelFor(
+        tp, static_cast<std::ptrdiff_t>(batch_size) * kv_num_heads_, concat_cost,
+        [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+          for (std::ptrdiff_t i = begin; i != end; ++i) {
+            const size_t batch_index = i / kv_num_heads_;
+            const size_t kv_head_index = i % kv_num_heads_;
+            const size_t total_seqlen = static_cast<size_t>(seqlens_k_data[batch_index]) + 1;
+            const size_t past_seqlen = is_prompt ? 0 : total_seqlen - sequence_length;
+            const size_t input_offset = packed_qkv
+                                            ? static_cast<size_t>(q_batch_stride) * batch_index +
+                                                  kv_input_chunk_length * kv_head_index
+                                            : kv_input_chunk_length * static_cast<size_t>(i);
+            const size_t scale_offset = quantized ? kv_head_index * head_size : 0;
+            append_chunk(past_key_data, k + input_offset, present_key_data, key_scale.data() + scale_offset,
+                         past_seqlen, total_seqlen, i);
+            append_chunk(past_value_data, v + input_offset, present_value_data, value_scale.data() + scale_offset,
+                         past_seqlen, total_seqlen, i);
+          }
+        });
+
+    MlasGQAFlashAttentionArgs args;
+    args.batch_size = batch_size;
+    args.num_heads = num_heads_;
+    args.kv_num_heads = kv_num_heads_;
+    args.sequence_length = sequence_length;
+    args.head_size = head_size;
+    args.kv_buffer_sequence_length = present_buffer_sequence_length;
+    args.seqlens_k = seqlens_k_data;
+    args.is_prompt = is_prompt;
+    args.local_window_size = local_window_size_;
+    args.scale = scale_ == 0.0f ? 1.0f / sqrt(static_cast<float>(head_size)) : scale_;
+    args.softcap = softcap_;
+    args.smooth_softmax = use_smooth_softmax_;
+
+    args.attention_bias = nullptr;
+    args.attention_bias_batch_stride = 0;
+    args.attention_bias_head_stride = 0;
+    args.attention_bias_row_stride = 0;
+    if (attention_bias != nullptr) {
+      // Attention bias is of shape (B or 1, N or 1, S, T) so handle broadcasting
+      auto attention_bias_shape = attention_bias->Shape().GetDims();
+      args.attention_bias = attention_bias->Data<float>();
+      args.attention_bias_row_stride = static_cast<size_t>(attention_bias_shape[3]);
+      if (attention_bias_shape[1] != 1) {
+        args.attention_bias_head_stride = SafeInt<size_t>(sequence_length) * attention_bias_shape[3];
+      }
+      if (attention_bias_shape[0] != 1) {
+        args.attention_bias_batch_stride = SafeInt<size_t>(attention_bias_shape[1]) * sequence_length *
+                                           attention_bias_shape[3];
+      }
+    }
+
+    // Block sizes are chosen as for MlasFlashAttention so that the blocks of Q, K and V, the scores and the
+    // temporary output fit in 3/4 of the L2 cache. The rows of Q are those of all the heads of a group.
+    const int group_rows = (num_heads_ / kv_num_heads_) * sequence_length;
+    // The L2 cache size is unknown when the flash kernel is only used for the quantized cache.
+    const int l2_cache_size = l2_cache_size_ > 0 ? l2_cache_size_ : 256 * 1024;
+    args.kv_block_size = l2_cache_size / (static_cast<int>(sizeof(float)) * 4 * (2 * head_size));
+    args.kv_block_size = std::max(args.kv_block_size, 1);  // avoid kv_block_size = 0
+    args.q_block_size = std::min(args.kv_block_size, 2 * head_size);
+    args.kv_block_size = std::min(args.kv_block_size, present_buffer_sequence_length);
+    args.q_block_size = std::min(args.q_block_size, group_rows);
+
+    // For token generation there are typically fewer groups than threads, so the sequence is split across the
+    // idle threads (flash decoding) and the partial results are merged afterwards.
+    args.thread_count = concurrency::ThreadPool::DegreeOfParallelism(tp);
+    const int task_count = batch_size * kv_num_heads_ * ((group_rows + args.q_block_size - 1) / args.q_block_size);
+    const int max_total_seqlen = *std::max_element(seqlens_k_data, seqlens_k_data + batch_size) + 1;
+    const int kv_block_count = (max_total_seqlen + args.kv_block_size - 1) / args.kv_block_size;
+    args.kv_split_count = std::max(1, std::min((args.thread_count + task_count - 1) / task_count, kv_block_count));
+
+    args.buffer_size_per_thread = MlasGQAFlashAttentionBufferSizePerThread(args.q_block_size, args.kv_block_size,
+                                                                           head_size, kv_cache_bit_width_);
+    IAllocatorUniquePtr<void> buffer = IAllocator::MakeUniquePtr<void>(
+        allocator, SafeInt<size_t>(args.buffer_size_per_thread) * args.thread_count);
+    args.buffer = reinterpret_cast<float*>(buffer.get());
+
+    const size_t partial_buffer_bytes = MlasGQAFlashAttentionPartialBufferSize(batch_size, num_heads_, sequence_length,
+                                                                               head_size, args.kv_split_count);
+    IAllocatorUniquePtr<void> partial_buffer = IAllocator::MakeUniquePtr<void>(allocator, partial_buffer_bytes);
+    args.partial_buffer = reinterpret_cast<float*>(partial_buffer.get());
+
+    args.query = Q;
+    args.query_batch_stride = static_cast<size_t>(q_batch_stride);
+    args.output = output->MutableData<float>();
+    args.kv_cache_bit_width = kv_cache_bit_width_;
+    if (quantized) {
+      args.key = nullptr;
+      args.value = nullptr;
+      args.quantized_key = present_key_data;
+      args.quantized_value = present_value_data;
+      args.key_scale = key_scale.data();
+      args.value_scale = value_scale.data();
+    } else {
+      args.key = static_cast<const float*>(present_key_data);
+      args.value = static_cast<const float*>(present_value_data);
+      args.quantized_key = nullptr;
+      args.quantized_value = nullptr;
+      args.key_scale = nullptr;
+      args.value_scale = nullptr;
+    }
+    args.block_table = block_table_data;
+    args.max_pages_per_sequence = parameters.max_pages_per_sequence;
+    args.kv_page_size = parameters.kv_cache_page_size;
+
+    MlasGQAFlashAttention(&args, tp);
+    return Status::OK();
+  }
+
+  // Expands the scale of a quantized k-v cache to one scale per channel, kv_num_heads x head_size.
+  Status ExpandKVCacheScale(const Tensor* scale, KVQuantizationType quant_type, int head_size,
+                            std::vector<float>& channel_scale) const {
+    const size_t channel_count = SafeInt<size_t>(kv_num_heads_) * head_size;
+    const size_t scale_count = static_cast<size_t>(scale->Shape().Size());
+    const float* scale_data = scale->Data<float>();
+    if (quant_type == KVQuantizationType::PER_TENSOR) {
+      ORT_RETURN_IF_NOT(scale_count == 1, "A PER_TENSOR k-v cache scale shall have 1 element, got ", scale_count);
+      channel_scale.assign(channel_count, scale_data[0]);
+    } else if (quant_type == KVQuantizationType::PER_HEAD) {
+      ORT_RETURN_IF_NOT(scale_count == static_cast<size_t>(kv_num_heads_),
+                        "A PER_HEAD k-v cache scale shall have kv_num_heads elements, got ", scale_count);
+      channel_scale.resize(channel_count);
+      for (size_t h = 0; h < scale_count; h++) {
+        std::fill_n(channel_scale.begin() + h * head_size, head_size, scale_data[h]);
+      }
+    } else {
+      ORT_RETURN_IF_NOT(scale_count == channel_count,
+                        "A PER_CHANNEL k-v cache scale shall have kv_num_heads * head_size elements, got ",
+                        scale_count);
+      channel_scale.assign(scale_data, scale_data + channel_count);
+    }
+    return Status::OK();
+  }
+
   // Helper function to compute the attention probs. It does 2 things:
   //  attention_probs(B, N, S, T) = 1/sqrt(H) x Q(B, N, S, H) x K'(B, N, T, H -> B, N, H, T)
   //  attention_probs(B, N, S, T) = Softmax(attention_probs)
@@ -229,6 +556,9 @@ class GQAAttentionBase {
         }
 
         // Compute Q*K' + AttentionMask
+        // The heads are distributed over the threads by the loop rather than by MlasGemmStridedBatch, so that the
+        // softmax of a head runs while its probabilities are in the cache. The total sequence length also differs
+        // between the batch entries, and the heads of a group share their key.
         //                     original                 transposed             each iteration
         // A: Q                (B x N x) S x H          (B x N x) S x H        S x H
         // B: K'               (B x N x) T x H          (B x N x) H x T        H x T
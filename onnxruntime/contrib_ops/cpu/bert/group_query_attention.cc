@@ -22,7 +22,8 @@ namespace onnxruntime {
 namespace contrib {
 
 // These ops are internal-only, so register outside of onnx
-#define REGISTER_KERNEL_TYPED(T)                                        \
+// The k-v cache of float may also be quantized to int8, or to int4 packed in uint8.
+#define REGISTER_KERNEL_TYPED(T, CacheTypes)                            \
   ONNX_OPERATOR_TYPED_KERNEL_EX(                                        \
       GroupQueryAttention,                                              \
       kMSDomain,                                                        \
@@ -31,11 +32,12 @@ namespace contrib {
       kCpuExecutionProvider,                                            \
       KernelDefBuilder()                                                \
           .TypeConstraint("T", DataTypeImpl::GetTensorType<T>())        \
+          .TypeConstraint("T_CACHE", CacheTypes)                        \
           .TypeConstraint("M", DataTypeImpl::GetTensorType<int32_t>()), \
       GroupQueryAttention<T>);
 
-REGISTER_KERNEL_TYPED(float)
-REGISTER_KERNEL_TYPED(MLFloat16)
+REGISTER_KERNEL_TYPED(float, (BuildKernelDefConstraints<float, int8_t, uint8_t>()))
+REGISTER_KERNEL_TYPED(MLFloat16, DataTypeImpl::GetTensorType<MLFloat16>())
 
 template <typename T>
 GroupQueryAttention<T>::GroupQueryAttention(const OpKernelInfo& info)
@@ -54,6 +56,9 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
   const Tensor* sin_cache = context->Input<Tensor>(8);
   const Tensor* position_ids = context->Input<Tensor>(9);
   const Tensor* attention_bias = context->Input<Tensor>(10);
+  const Tensor* k_scale = context->Input<Tensor>(11);
+  const Tensor* v_scale = context->Input<Tensor>(12);
+  const Tensor* block_table = context->Input<Tensor>(13);
 
   GroupQueryAttentionParameters parameters = {};
   ORT_RETURN_IF_ERROR(group_query_attention_helper::CheckInputs(query,
@@ -69,7 +74,11 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
                                                                 seqlens_k,
                                                                 total_seqlen_tensor,
                                                                 scale_,
-                                                                softcap_));
+                                                                softcap_,
+                                                                kv_cache_bit_width_,
+                                                                k_scale,
+                                                                v_scale,
+                                                                block_table));
 
   ORT_RETURN_IF_ERROR(group_query_attention_helper::CheckCustomAttentionInputs(position_ids,
                                                                                attention_bias,
@@ -88,8 +97,16 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
   output_shape[2] = static_cast<int64_t>(q_hidden_size);
   Tensor* output = context->Output(0, output_shape);
 
-  std::vector<int64_t> present_k_shape({static_cast<int64_t>(batch_size), static_cast<int64_t>(kv_num_heads_), static_cast<int64_t>(present_kv_seqlen), static_cast<int64_t>(head_size)});
-  std::vector<int64_t> present_v_shape({static_cast<int64_t>(batch_size), static_cast<int64_t>(kv_num_heads_), static_cast<int64_t>(present_kv_seqlen), static_cast<int64_t>(head_size)});
+  // Two int4 values are packed in each element of a quantized cache.
+  const int cache_head_size = kv_cache_bit_width_ == 4 ? head_size / 2 : head_size;
+  std::vector<int64_t> present_k_shape({static_cast<int64_t>(batch_size), static_cast<int64_t>(kv_num_heads_), static_cast<int64_t>(present_kv_seqlen), static_cast<int64_t>(cache_head_size)});
+  std::vector<int64_t> present_v_shape({static_cast<int64_t>(batch_size), static_cast<int64_t>(kv_num_heads_), static_cast<int64_t>(present_kv_seqlen), static_cast<int64_t>(cache_head_size)});
+  if (block_table != nullptr) {
+    // a paged kv cache is updated in place, present holds the same pages as past
+    const auto past_dims = past_key->Shape().GetDims();
+    present_k_shape.assign(past_dims.begin(), past_dims.end());
+    present_v_shape.assign(past_dims.begin(), past_dims.end());
+  }
   Tensor* present_k = context->Output(1, present_k_shape);
   Tensor* present_v = context->Output(2, present_v_shape);
 
@@ -206,8 +223,8 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
 
   // Compute the attention score and apply the score to V
   return ApplyAttention(q_rotary, packed_qkv ? nullptr : k_rotary, packed_qkv ? nullptr : V.Get<Tensor>().Data<T>(),
-                        attention_bias, past_key, past_value, output, present_k, present_v,
-                        seqlens_k, parameters, allocator, context);
+                        attention_bias, past_key, past_value, output, present_k, present_v, k_scale, v_scale,
+                        block_table, seqlens_k, parameters, allocator, context);
 }
 }  // namespace contrib
 }  // namespace onnxruntime
@@ -26,10 +26,19 @@ Status CheckInputs(const T* query,
                    const T* seqlens_k,
                    const T* total_seqlen,
                    float scale,
-                   float softcap) {
+                   float softcap,
+                   int kv_cache_bit_width,
+                   const T* k_scale,
+                   const T* v_scale,
+                   const T* block_table) {
   // Note: Here S* is seqlen_past_kv_cache, S+ is seqlen_present_kv_cache
   //     past_key                   : (B, N_k, S*, H) or (B, N_k, S+, H) or nullptr
   //     past_value                 : (B, N_k, S*, H) or (B, N_k, S+, H) or nullptr
+  //                                  with a last dimension of H / 2 when the cache is quantized to int4
+  //     k_scale, v_scale           : (1), (N_k) or (N_k * H) when the cache is quantized, otherwise unused
+  // paged kv cache, with P pages of L tokens and M pages per sequence:
+  //     past_key, past_value       : (P, N_k, L, H)
+  //     block_table                : (B, M)
   // no packing for q/k/v:
   //     query            (Q)       : (B, S, D) or (B, S, (D_q + 2 D_kv))
   //     key              (K)       : (B, S, D_kv) or nullptr
@@ -111,6 +120,11 @@ Status CheckInputs(const T* query,
   }
 
   // Check past-present KV
+  const bool is_paged_kv_cache = block_table != nullptr;
+  if (is_paged_kv_cache && (past_key == nullptr || past_value == nullptr)) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' and 'past_value' shall be present with a 'block_table'.");
+  }
   int32_t past_sequence_length = 0;
   if (past_key != nullptr && past_value != nullptr) {
     const auto& past_key_dims = past_key->Shape().GetDims();
@@ -127,12 +141,17 @@ Status CheckInputs(const T* query,
                              past_value_dims.size());
     }
 
-    if (past_key_dims[0] != batch_size) {
+    if (is_paged_kv_cache) {
+      // dimension 0 is the number of pages
+      if (past_key_dims[0] != past_value_dims[0]) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                               "Input 'past_key' and 'past_value' should have same dimension 0 (number of pages)");
+      }
+    } else if (past_key_dims[0] != batch_size) {
       return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
                              "Input 'past_key' dimension 0 should be batch_size, got ",
                              past_key_dims[0]);
-    }
-    if (past_value_dims[0] != batch_size) {
+    } else if (past_value_dims[0] != batch_size) {
       return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
                              "Input 'past_value' dimension 0 should be batch_size, got ",
                              past_value_dims[0]);
@@ -155,12 +174,14 @@ Status CheckInputs(const T* query,
     // We assume all sequence in past kv are right-padded to max or past sequence length
     past_sequence_length = static_cast<int>(past_key_dims[2]);
 
-    if (past_key_dims[3] != head_size) {
+    // Two int4 values are packed in each element of a quantized cache.
+    const int cache_head_size = kv_cache_bit_width == 4 ? head_size / 2 : head_size;
+    if (past_key_dims[3] != cache_head_size) {
       return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
                              "Input 'past_key' dimension 3 should be same as head_size, got ",
                              past_key_dims[3]);
     }
-    if (past_value_dims[3] != head_size) {
+    if (past_value_dims[3] != cache_head_size) {
       return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
                              "Input 'past_value' dimension 3 should be same as head_size, got ",
                              past_value_dims[3]);
@@ -170,6 +191,27 @@ Status CheckInputs(const T* query,
                            "Input 'past_key' and 'past_value' shall be both present or both absent.");
   }
 
+  if (kv_cache_bit_width != 0) {
+    if (k_scale == nullptr || v_scale == nullptr) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "Input 'k_scale' and 'v_scale' shall be present when the k-v cache is quantized.");
+    }
+    if (kv_cache_bit_width == 4 && head_size % 2 != 0) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "head_size shall be even for an int4 k-v cache, got ", head_size);
+    }
+    const int64_t channel_count = static_cast<int64_t>(kv_num_heads) * head_size;
+    for (const T* kv_scale : {k_scale, v_scale}) {
+      const int64_t scale_count = kv_scale->Shape().Size();
+      if (scale_count != 1 && scale_count != kv_num_heads && scale_count != channel_count) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                               "Input 'k_scale' and 'v_scale' shall have 1, kv_num_heads or kv_num_heads * head_size "
+                               "elements, got ",
+                               scale_count);
+      }
+    }
+  }
+
   const auto& seqlens_k_dim = seqlens_k->Shape().GetDims();
   if (seqlens_k_dim.size() != 1 && seqlens_k_dim[0] != batch_size) {
     return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
@@ -184,6 +226,27 @@ Status CheckInputs(const T* query,
   int total_sequence_length = *((*total_seqlen).template Data<int32_t>());
   int present_sequence_length = std::max(total_sequence_length, past_sequence_length);
 
+  int kv_cache_page_size = 0;
+  int max_pages_per_sequence = 0;
+  if (is_paged_kv_cache) {
+    const auto& block_table_dims = block_table->Shape().GetDims();
+    if (block_table_dims.size() != 2 || block_table_dims[0] != batch_size) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "Input 'block_table' shall have shape (batch_size, max_pages_per_sequence).");
+    }
+    // dimension 2 of the pools of pages is the page size, and the kv cache of a sequence holds at most
+    // max_pages_per_sequence pages.
+    kv_cache_page_size = past_sequence_length;
+    max_pages_per_sequence = static_cast<int>(block_table_dims[1]);
+    past_sequence_length = kv_cache_page_size * max_pages_per_sequence;
+    present_sequence_length = past_sequence_length;
+    if (total_sequence_length > present_sequence_length) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "total_sequence_length shall not exceed page_size * max_pages_per_sequence, got ",
+                             total_sequence_length);
+    }
+  }
+
   int rotary_dim = 0;
   if (cos_cache != nullptr && sin_cache != nullptr) {
     const auto& cos_dims = cos_cache->Shape().GetDims();
@@ -262,11 +325,33 @@ Status CheckInputs(const T* query,
     output_parameters->softcap = softcap;
     output_parameters->qkv_format = qkv_format;
     output_parameters->past_kv_format = past_kv_format;
+    output_parameters->kv_cache_page_size = kv_cache_page_size;
+    output_parameters->max_pages_per_sequence = max_pages_per_sequence;
   }
 
   return Status::OK();
 }
 
+template <typename T = Tensor>
+Status CheckInputs(const T* query,
+                   const T* key,
+                   const T* value,
+                   const T* past_key,
+                   const T* past_value,
+                   const T* cos_cache,
+                   const T* sin_cache,
+                   void* parameters,
+                   int num_heads,
+                   int kv_num_heads,
+                   const T* seqlens_k,
+                   const T* total_seqlen,
+                   float scale,
+                   float softcap) {
+  return CheckInputs(query, key, value, past_key, past_value, cos_cache, sin_cache, parameters, num_heads, kv_num_heads,
+                     seqlens_k, total_seqlen, scale, softcap, 0, static_cast<const T*>(nullptr),
+                     static_cast<const T*>(nullptr), static_cast<const T*>(nullptr));
+}
+
 template <typename T = Tensor>
 Status CheckInputs(const T* query,
                    const T* key,
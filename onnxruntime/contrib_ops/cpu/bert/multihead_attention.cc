@@ -45,11 +45,6 @@ MultiHeadAttention<T>::MultiHeadAttention(const OpKernelInfo& info) : OpKernel(i
   mask_filter_value_ = info.GetAttrOrDefault<float>("mask_filter_value", -10000.0f);
   is_unidirectional_ = info.GetAttrOrDefault<int64_t>("unidirectional", 0) == 1;
 
-  const auto& env = Env::Default();
-  l2_cache_size_ = env.GetL2CacheSize();
-
-  disable_flash_ = ParseEnvironmentVariableWithDefault<bool>(attention::kDisableFlashAttention, false);
-
   disable_decoder_attention_ = ParseEnvironmentVariableWithDefault<bool>(attention::kDisableDecoderAttention, false);
 }
 
@@ -196,11 +191,8 @@ Status MultiHeadAttention<T>::Compute(OpKernelContext* context) const {
   ORT_RETURN_IF_ERROR(MaybeTransposeToBNSHAndAddBias<T>(
       context, allocator, batch_size, num_heads_, kv_sequence_length, v_head_size, value, bias, v_bias_offset, V));
 
+  const bool causal = is_unidirectional_ && q_sequence_length > 1;
   if (std::is_same_v<T, float> &&
-      !disable_flash_ &&
-      !is_unidirectional_ &&
-      key_padding_mask == nullptr &&
-      attn_bias == nullptr &&
       past_key == nullptr &&
       past_value == nullptr &&
       past_sequence_length == nullptr &&
@@ -208,59 +200,10 @@ Status MultiHeadAttention<T>::Compute(OpKernelContext* context) const {
       present_key == nullptr &&
       present_value == nullptr &&
       output_qk == nullptr &&
-      l2_cache_size_ > 0) {
-    MlasFlashAttentionThreadedArgs args;
-    args.batch_size = batch_size;
-    args.num_heads = num_heads_;
-    args.q_sequence_length = q_sequence_length;
-    args.kv_sequence_length = kv_sequence_length;
-    args.qk_head_size = qk_head_size;
-    args.v_head_size = v_head_size;
-    args.scale = (scale_ == 0.0f) ? 1.0f / sqrt(static_cast<float>(qk_head_size)) : scale_;
-    /*
-      q_block_size, kv_block_size correspond to Br, Bc in the FlashAttention paper.
-      Let M = l2_cache_size / sizeof(float)
-      In the FlashAttention kernel, there are 5 big matrices that we need to keep in L2 cache:
-        slice of Q -- [Br, qk_head_size]
-        slice of K -- [Bc, qk_head_size]
-        slice of V -- [Bc, v_head_size]
-        result of QK -- [Br, Bc]
-        temporary output (same shape as QKV) -- [Br, v_head_size]
-      The total size of these matrices is (Br + Bc) * (qk_head_size + v_head_size) + Br * Bc
-      By taking Bc = M / (4 * (qk_head_size + v_head_size)), and Br = min(Bc, qk_head_size + v_head_size), we have
-        (Br + Bc) * (qk_head_size + v_head_size) + Br * Bc
-        <= 2 * Bc * (qk_head_size + v_head_size) + Br * Bc
-        <= 2 * Bc * (qk_head_size + v_head_size) + M/4
-        <= 2 * M/4 + M/4 = M * (3/4)
-
-      We leave 1/4 of the L2 cache for
-        1. storing small tensors l and m
-        2. instruction (code)
-    */
-    args.kv_block_size = l2_cache_size_ / (static_cast<int>(sizeof(float)) * 4 * (qk_head_size + v_head_size));
-    args.kv_block_size = std::max(args.kv_block_size, 1);  // avoid kv_block_size = 0
-    args.q_block_size = std::min(args.kv_block_size, qk_head_size + v_head_size);
-    args.kv_block_size = std::min(args.kv_block_size, kv_sequence_length);  // No point to have kv_block_size > kv_sequence_length
-    args.q_block_size = std::min(args.q_block_size, q_sequence_length);     // No point to have q_block_size > q_sequence_length
-
-    auto* tp = context->GetOperatorThreadPool();
-    args.thread_count = concurrency::ThreadPool::DegreeOfParallelism(tp);
-    args.buffer_size_per_thread = (static_cast<size_t>(args.q_block_size) * 2 +
-                                   static_cast<size_t>(args.q_block_size) * static_cast<size_t>(args.kv_block_size) +
-                                   static_cast<size_t>(args.q_block_size) * static_cast<size_t>(args.v_head_size)) *
-                                  sizeof(float);
-    size_t buffer_bytes = args.buffer_size_per_thread * args.thread_count;
-    IAllocatorUniquePtr<void> buffer = IAllocator::MakeUniquePtr<void>(allocator, buffer_bytes);
-
-    args.buffer = reinterpret_cast<float*>(buffer.get());
-
-    args.query = Q.Get<Tensor>().Data<float>();
-    args.key = K.Get<Tensor>().Data<float>();
-    args.value = V.Get<Tensor>().Data<float>();
-    args.output = output->MutableData<float>();
-
-    MlasFlashAttention(&args, tp);
-    return Status::OK();
+      CanUseFlashAttention(key_padding_mask, causal, batch_size, q_sequence_length, kv_sequence_length)) {
+    return ApplyFlashAttention(Q.Get<Tensor>().Data<float>(), K.Get<Tensor>().Data<float>(),
+                               V.Get<Tensor>().Data<float>(), key_padding_mask, attn_bias, causal, output,
+                               batch_size, q_sequence_length, kv_sequence_length, qk_head_size, v_head_size, context);
   }
 
   if (use_decoder_masked_multihead_attention) {
@@ -1,6 +1,8 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <type_traits>
+
 #include "core/providers/cpu/math/gemm.h"
 
 namespace onnxruntime {
@@ -9,11 +11,51 @@ namespace contrib {
 constexpr const char* ACTIVATION_NAME_PREFIX = "activation_";
 constexpr size_t ACTIVATION_NAME_PREFIX_LEN = 11;
 
+// Maps the activations that MLAS can apply in the GEMM epilogue. Returns false for the other activations, which are
+// applied by an element-wise functor after the GEMM.
+static bool GetEpilogueActivation(const OpKernelInfo& info, const std::string& activation, MLAS_GEMM_EPILOGUE_OP& op) {
+  if (activation == "Gelu") {
+    op.Kind = MlasGemmEpilogueGelu;
+  } else if (activation == "FastGelu") {
+    op.Kind = MlasGemmEpilogueFastGelu;
+  } else if (activation == "QuickGelu") {
+    op.Kind = MlasGemmEpilogueSilu;
+    op.Scale = info.GetAttrOrDefault<float>("activation_alpha", 1.702f);
+  } else {
+    op.Kind = MlasGemmEpilogueActivation;
+    if (activation == "Relu") {
+      op.Activation.ActivationKind = MlasReluActivation;
+    } else if (activation == "Tanh") {
+      op.Activation.ActivationKind = MlasTanhActivation;
+    } else if (activation == "Sigmoid") {
+      op.Activation.ActivationKind = MlasLogisticActivation;
+    } else if (activation == "LeakyRelu") {
+      op.Activation.ActivationKind = MlasLeakyReluActivation;
+      op.Activation.Parameters.LeakyRelu.alpha = info.GetAttrOrDefault<float>("activation_alpha", 0.01f);
+    } else if (activation == "HardSigmoid") {
+      op.Activation.ActivationKind = MlasHardSigmoidActivation;
+      op.Activation.Parameters.HardSigmoid.alpha = info.GetAttrOrDefault<float>("activation_alpha", 0.2f);
+      op.Activation.Parameters.HardSigmoid.beta = info.GetAttrOrDefault<float>("activation_beta", 0.5f);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
 template <typename T>
 class FusedGemm final : public Gemm<T> {
  public:
   FusedGemm(const OpKernelInfo& info) : Gemm<T>(info) {
     std::string activation = info.GetAttrOrDefault<std::string>("activation", "");
+    if (activation.empty()) {
+      return;
+    }
+    MLAS_GEMM_EPILOGUE_OP epilogue_activation;
+    if (std::is_same<T, float>::value && GetEpilogueActivation(info, activation, epilogue_activation)) {
+      this->epilogue_activation_ = epilogue_activation;
+      return;
+    }
     NodeAttributes attrs;
     for (const auto& p : info.node().GetAttributes()) {
       if (p.first.size() > ACTIVATION_NAME_PREFIX_LEN && p.first.compare(0, ACTIVATION_NAME_PREFIX_LEN, ACTIVATION_NAME_PREFIX) == 0) {
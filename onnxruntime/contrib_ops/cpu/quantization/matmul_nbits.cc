@@ -127,6 +127,13 @@ class MatMulNBits final : public OpKernel {
   Status UseSharedPrePackedBuffers(std::vector<BufferUniquePtr>& prepacked_buffers, int input_idx,
                                    /*out*/ bool& used_shared_buffers) override;
 
+  bool SupportsPrePackedWeightsFileCache() const override;
+
+  Status GetPrePackedBuffersForFileCache(int input_idx, /*out*/ PrePackedWeights& prepacked_buffers) const override;
+
+  Status UseFileCachedPrePackedBuffers(std::vector<BufferUniquePtr>& prepacked_buffers, int input_idx,
+                                       /*out*/ bool& used_cached_buffers) override;
+
  private:
   const size_t K_;
   const size_t N_;
@@ -286,8 +293,50 @@ Status MatMulNBits<MLFloat16>::PrePack(const Tensor& tensor, int input_idx, /*ou
 
   return Status::OK();
 }
+
+// PrePack() of the fp16 specialization converts the scales and bias to fp32, which is not part of the packed B
+// buffer, so its state can't be restored from the cache file.
+template <>
+bool MatMulNBits<MLFloat16>::SupportsPrePackedWeightsFileCache() const {
+  return false;
+}
 #endif  // end !MLAS_F16VEC_INTRINSICS_SUPPORTED || !MLAS_TARGET_ARM64
 
+template <typename T1>
+bool MatMulNBits<T1>::SupportsPrePackedWeightsFileCache() const {
+  return true;
+}
+
+template <typename T1>
+Status MatMulNBits<T1>::GetPrePackedBuffersForFileCache(int input_idx, PrePackedWeights& prepacked_buffers) const {
+  // The packed B buffer also holds the scales and zero points packed by the later PrePack() calls.
+  // Packed scales (ARM64) have no buffer of their own.
+  if (input_idx == InputIndex::B) {
+    prepacked_buffers.buffers_.emplace_back(packed_b_.get(), [](void*) {});
+    prepacked_buffers.buffer_sizes_.push_back(packed_b_size_);
+  }
+  return Status::OK();
+}
+
+template <typename T1>
+Status MatMulNBits<T1>::UseFileCachedPrePackedBuffers(std::vector<BufferUniquePtr>& prepacked_buffers,
+                                                      int input_idx,
+                                                      /*out*/ bool& used_cached_buffers) {
+  used_cached_buffers = false;
+
+  if (input_idx == InputIndex::B) {
+    ORT_RETURN_IF_NOT(prepacked_buffers.size() == 1, "Expected a single pre-packed buffer for input B.");
+    packed_b_size_ = MlasQNBitGemmPackQuantBDataSize(N_, K_, nbits_, block_size_, has_zp_input_, compute_type_);
+    packed_b_ = std::move(prepacked_buffers[0]);
+    used_cached_buffers = true;
+  } else if (input_idx == InputIndex::scales) {
+    scales_are_packed_ = true;
+    used_cached_buffers = true;
+  }
+
+  return Status::OK();
+}
+
 template <typename T1>
 Status MatMulNBits<T1>::UseSharedPrePackedBuffers(std::vector<BufferUniquePtr>& prepacked_buffers, int input_idx,
                                                   /*out*/ bool& used_shared_buffers) {
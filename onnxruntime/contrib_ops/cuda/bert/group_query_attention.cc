@@ -17,6 +17,7 @@ namespace onnxruntime {
 namespace contrib {
 namespace cuda {
 
+// The k-v cache is not quantized, so it has the type of the inputs.
 #define REGISTER_KERNEL_TYPED(T)                                         \
   ONNX_OPERATOR_TYPED_KERNEL_EX(                                         \
       GroupQueryAttention,                                               \
@@ -26,6 +27,7 @@ namespace cuda {
       kCudaExecutionProvider,                                            \
       (*KernelDefBuilder::Create())                                      \
           .TypeConstraint("T", DataTypeImpl::GetTensorType<T>())         \
+          .TypeConstraint("T_CACHE", DataTypeImpl::GetTensorType<T>())   \
           .TypeConstraint("M", {DataTypeImpl::GetTensorType<int32_t>()}) \
           .MayInplace(3, 1)                                              \
           .MayInplace(4, 2)                                              \
@@ -110,6 +110,7 @@ void CPUIDInfo::X86Init() {
 
   vendor_ = GetX86Vendor(data);
   vendor_id_ = GetVendorId(vendor_);
+  model_ = GetX86Model();
 
   int num_IDs = data[0];
   if (num_IDs >= 1) {
@@ -166,6 +167,26 @@ std::string CPUIDInfo::GetX86Vendor(int32_t* data) {
   return vendor;
 }
 
+std::string CPUIDInfo::GetX86Model() {
+  int data[4] = {-1};
+  GetCPUID(static_cast<int>(0x80000000), data);
+  if (static_cast<uint32_t>(data[0]) < 0x80000004) {
+    return "";
+  }
+
+  // The brand string is returned 16 bytes at a time by leaves 0x80000002 to 0x80000004.
+  char brand[sizeof(int32_t) * 12 + 1]{};
+  for (int i = 0; i < 3; i++) {
+    GetCPUID(static_cast<int>(0x80000002 + i), data);
+    memcpy(brand + i * sizeof(data), data, sizeof(data));
+  }
+
+  std::string model{brand};
+  const auto first = model.find_first_not_of(' ');
+  const auto last = model.find_last_not_of(' ');
+  return first == std::string::npos ? "" : model.substr(first, last - first + 1);
+}
+
 #endif  // defined(CPUIDINFO_ARCH_X86)
 
 uint32_t CPUIDInfo::GetVendorId(const std::string& vendor) {
@@ -23,6 +23,13 @@ class CPUIDInfo {
     return vendor_id_;
   }
 
+  /**
+   * @return CPU model name reported by the processor, empty if unavailable
+   */
+  std::string_view GetCPUModel() const {
+    return model_;
+  }
+
   bool HasAMX_BF16() const { return has_amx_bf16_; }
   bool HasAVX() const { return has_avx_; }
   bool HasAVX2() const { return has_avx2_; }
@@ -130,6 +137,7 @@ class CPUIDInfo {
 
   std::string vendor_;
   uint32_t vendor_id_;
+  std::string model_;
 
   uint32_t GetVendorId(const std::string& vendor);
 
@@ -137,6 +145,7 @@ class CPUIDInfo {
 
   void X86Init();
   std::string GetX86Vendor(int32_t* data);
+  std::string GetX86Model();
 
 #elif defined(CPUIDINFO_ARCH_ARM)
 
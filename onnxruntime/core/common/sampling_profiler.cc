@@ -0,0 +1,244 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/common/sampling_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/common/narrow.h"
+
+namespace onnxruntime {
+namespace profiling {
+
+namespace {
+
+int FloorLog2(uint64_t value) {
+  int result = 0;
+  while (value >>= 1) {
+    ++result;
+  }
+  return result;
+}
+
+std::string FormatMicroseconds(double ns) {
+  return std::to_string(ns / 1000.0);
+}
+
+void AddHistogramStats(const std::string& prefix, const LatencyHistogram& histogram,
+                       std::unordered_map<std::string, std::string>& stats) {
+  const uint64_t count = histogram.Count();
+  stats[prefix + "count"] = std::to_string(count);
+  if (count == 0) {
+    return;
+  }
+  stats[prefix + "mean_us"] = FormatMicroseconds(static_cast<double>(histogram.Sum()) / static_cast<double>(count));
+  stats[prefix + "p50_us"] = FormatMicroseconds(static_cast<double>(histogram.ValueAtPercentile(50.0)));
+  stats[prefix + "p90_us"] = FormatMicroseconds(static_cast<double>(histogram.ValueAtPercentile(90.0)));
+  stats[prefix + "p99_us"] = FormatMicroseconds(static_cast<double>(histogram.ValueAtPercentile(99.0)));
+  stats[prefix + "max_us"] = FormatMicroseconds(static_cast<double>(histogram.Max()));
+}
+
+}  // namespace
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<size_t>(value);
+  }
+  // values in [2^e, 2^(e+1)) are split into kSubBuckets buckets of width 2^(e - kSubBucketBits)
+  const int exponent = FloorLog2(value);
+  const size_t shift = static_cast<size_t>(exponent) - kSubBucketBits;
+  const size_t sub_bucket = static_cast<size_t>(value >> shift) & (kSubBuckets - 1);
+  return (shift + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const size_t shift = index / kSubBuckets - 1;
+  const uint64_t sub_bucket = index % kSubBuckets;
+  const uint64_t lower_bound = (kSubBuckets + sub_bucket) << shift;
+  const uint64_t width = uint64_t{1} << shift;
+  return lower_bound + (width - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t current_max = max_.load(std::memory_order_relaxed);
+  while (value > current_max &&
+         !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+  // The buckets are read one by one while other threads may still record, so the total is taken from the
+  // buckets themselves rather than from count_ to get a consistent rank.
+  uint64_t total = 0;
+  for (const auto& bucket : buckets_) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(i), Max());
+    }
+  }
+  return Max();
+}
+
+void NodeExecutionStats::Record(const NodeExecutionMeasurement& measurement) {
+  latency_.Record(static_cast<uint64_t>(std::max<int64_t>(0, measurement.duration.count())));
+  bytes_allocated_.fetch_add(measurement.bytes_allocated, std::memory_order_relaxed);
+  if (measurement.parallel_loops != 0) {
+    parallel_loops_.fetch_add(measurement.parallel_loops, std::memory_order_relaxed);
+    requested_parallelism_.fetch_add(measurement.requested_parallelism, std::memory_order_relaxed);
+    achieved_parallelism_.fetch_add(measurement.achieved_parallelism, std::memory_order_relaxed);
+  }
+}
+
+void NodeExecutionStats::AddTo(const std::string& prefix, std::unordered_map<std::string, std::string>& stats) const {
+  AddHistogramStats(prefix, latency_, stats);
+  const uint64_t count = latency_.Count();
+  if (count == 0) {
+    return;
+  }
+  stats[prefix + "mean_bytes_allocated"] =
+      std::to_string(bytes_allocated_.load(std::memory_order_relaxed) / count);
+
+  const uint64_t parallel_loops = parallel_loops_.load(std::memory_order_relaxed);
+  stats[prefix + "parallel_loops"] = std::to_string(parallel_loops);
+  if (parallel_loops != 0) {
+    const auto loops = static_cast<double>(parallel_loops);
+    stats[prefix + "mean_requested_parallelism"] =
+        std::to_string(static_cast<double>(requested_parallelism_.load(std::memory_order_relaxed)) / loops);
+    stats[prefix + "mean_achieved_parallelism"] =
+        std::to_string(static_cast<double>(achieved_parallelism_.load(std::memory_order_relaxed)) / loops);
+  }
+}
+
+SamplingProfiler::SamplingProfiler(uint64_t sample_interval, size_t ring_buffer_size, bool collect_node_stats,
+                                   const std::vector<NodeInfo>& nodes)
+    : sample_interval_(sample_interval),
+      collect_node_stats_(collect_node_stats),
+      creation_time_(std::chrono::steady_clock::now()),
+      nodes_(nodes),
+      ring_buffer_(ring_buffer_size) {
+  ORT_ENFORCE(sample_interval > 0, "The sample interval must be positive.");
+
+  std::unordered_map<std::string, uint32_t> op_type_indices;
+  node_op_type_indices_.reserve(nodes_.size());
+  for (const auto& node : nodes_) {
+    auto it = op_type_indices.find(node.op_type);
+    if (it == op_type_indices.end()) {
+      it = op_type_indices.emplace(node.op_type, narrow<uint32_t>(op_types_.size())).first;
+      op_types_.push_back(node.op_type);
+      op_type_stats_.push_back(node.op_type.empty() ? nullptr : std::make_unique<NodeExecutionStats>());
+    }
+    node_op_type_indices_.push_back(it->second);
+  }
+
+  if (collect_node_stats_) {
+    node_stats_.reserve(nodes_.size());
+    for (const auto& node : nodes_) {
+      node_stats_.push_back(node.op_type.empty() ? nullptr : std::make_unique<NodeExecutionStats>());
+    }
+  }
+}
+
+bool SamplingProfiler::ShouldSampleRun() {
+  // the first run is always sampled so that short lived sessions report something
+  const bool sample = run_counter_.fetch_add(1, std::memory_order_relaxed) % sample_interval_ == 0;
+  if (sample) {
+    sampled_runs_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return sample;
+}
+
+void SamplingProfiler::RecordNodeEvent(size_t node_id, const NodeExecutionMeasurement& measurement) {
+  ORT_ENFORCE(node_id < nodes_.size(), "Node ", node_id, " was not registered with the sampling profiler.");
+  if (auto* stats = op_type_stats_[node_op_type_indices_[node_id]].get(); stats != nullptr) {
+    stats->Record(measurement);
+  }
+  if (collect_node_stats_ && node_stats_[node_id] != nullptr) {
+    node_stats_[node_id]->Record(measurement);
+  }
+
+  if (ring_buffer_.empty()) {
+    return;
+  }
+
+  const uint64_t position = ring_buffer_head_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = ring_buffer_[position % ring_buffer_.size()];
+  slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.node_id.store(node_id, std::memory_order_relaxed);
+  slot.start_ns.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(measurement.start - creation_time_).count(),
+      std::memory_order_relaxed);
+  slot.duration_ns.store(std::max<int64_t>(0, measurement.duration.count()), std::memory_order_relaxed);
+  slot.sequence.store(2 * position + 2, std::memory_order_release);
+}
+
+void SamplingProfiler::RecordRun(std::chrono::nanoseconds duration) {
+  run_histogram_.Record(static_cast<uint64_t>(std::max<int64_t>(0, duration.count())));
+}
+
+void SamplingProfiler::GetStats(std::unordered_map<std::string, std::string>& stats) const {
+  stats["sample_interval"] = std::to_string(sample_interval_);
+  stats["sampled_runs"] = std::to_string(sampled_runs_.load(std::memory_order_relaxed));
+  AddHistogramStats("run.", run_histogram_, stats);
+  for (size_t i = 0; i < op_types_.size(); ++i) {
+    if (op_type_stats_[i] != nullptr && op_type_stats_[i]->Latency().Count() != 0) {
+      op_type_stats_[i]->AddTo("op." + op_types_[i] + ".", stats);
+    }
+  }
+  for (size_t i = 0; i < node_stats_.size(); ++i) {
+    if (node_stats_[i] != nullptr && node_stats_[i]->Latency().Count() != 0) {
+      node_stats_[i]->AddTo("node." + nodes_[i].name + ".", stats);
+    }
+  }
+}
+
+std::vector<SampledNodeEvent> SamplingProfiler::GetRecentEvents() const {
+  std::vector<SampledNodeEvent> events;
+  if (ring_buffer_.empty()) {
+    return events;
+  }
+
+  const uint64_t head = ring_buffer_head_.load(std::memory_order_acquire);
+  const uint64_t size = ring_buffer_.size();
+  const uint64_t begin = head > size ? head - size : 0;
+  events.reserve(narrow<size_t>(head - begin));
+  for (uint64_t position = begin; position < head; ++position) {
+    const Slot& slot = ring_buffer_[position % size];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * position + 2) {
+      // still being written, or already overwritten by a newer event
+      continue;
+    }
+    const auto node_id = narrow<size_t>(slot.node_id.load(std::memory_order_relaxed));
+    const int64_t start_ns = slot.start_ns.load(std::memory_order_relaxed);
+    const int64_t duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+    const auto& node = nodes_[node_id];
+    events.push_back(SampledNodeEvent{node.name, node.op_type, start_ns, duration_ns});
+  }
+  return events;
+}
+
+}  // namespace profiling
+}  // namespace onnxruntime
@@ -0,0 +1,194 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/common/common.h"
+
+namespace onnxruntime {
+
+namespace profiling {
+
+/**
+ * Lock-free latency histogram with log-linear buckets.
+ * Each power of two is split into kSubBuckets linear buckets, so that the relative error of a reported
+ * percentile is bounded by 1 / kSubBuckets regardless of the magnitude of the recorded values.
+ * Recording is a couple of relaxed atomic adds and may be done concurrently from any thread.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  static constexpr size_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram() = default;
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(LatencyHistogram);
+
+  void Record(uint64_t value);
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+  /*
+  Returns an upper bound of the value below which the given percentage (0-100) of the recorded values fall.
+  The result is exact for values below kSubBuckets and otherwise within one bucket of the true value.
+  */
+  uint64_t ValueAtPercentile(double percentile) const;
+
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketUpperBound(size_t index);
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * A node execution captured by the SamplingProfiler.
+ */
+struct SampledNodeEvent {
+  std::string node_name;
+  std::string op_type;
+  // start of the execution relative to the creation of the profiler
+  int64_t start_ns;
+  int64_t duration_ns;
+};
+
+/**
+ * What was measured for one execution of a node.
+ */
+struct NodeExecutionMeasurement {
+  std::chrono::steady_clock::time_point start;
+  std::chrono::nanoseconds duration{0};
+  // temporary and dynamically allocated output memory
+  uint64_t bytes_allocated = 0;
+  // parallel loops run on the intra-op thread pool, and the sum of the threads they asked for and actually ran on
+  uint64_t parallel_loops = 0;
+  uint64_t requested_parallelism = 0;
+  uint64_t achieved_parallelism = 0;
+};
+
+/**
+ * Statistics of the sampled executions of a node or of all nodes of an op type.
+ */
+class NodeExecutionStats {
+ public:
+  NodeExecutionStats() = default;
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(NodeExecutionStats);
+
+  void Record(const NodeExecutionMeasurement& measurement);
+
+  /*
+  Adds "<prefix>{count,mean_us,p50_us,p90_us,p99_us,max_us,mean_bytes_allocated,parallel_loops,
+  mean_requested_parallelism,mean_achieved_parallelism}" to stats. The parallelism is averaged over the loops.
+  */
+  void AddTo(const std::string& prefix, std::unordered_map<std::string, std::string>& stats) const;
+
+  const LatencyHistogram& Latency() const { return latency_; }
+
+ private:
+  LatencyHistogram latency_;
+  std::atomic<uint64_t> bytes_allocated_{0};
+  std::atomic<uint64_t> parallel_loops_{0};
+  std::atomic<uint64_t> requested_parallelism_{0};
+  std::atomic<uint64_t> achieved_parallelism_{0};
+};
+
+/**
+ * Continuous low-overhead profiling.
+ * Unlike the Profiler, which records every event of every run and is meant for offline analysis, this profiles
+ * one in every sample_interval runs, aggregates the node executions per op type (and optionally per node) and
+ * keeps the most recent node events in a fixed-size ring buffer that is overwritten when full. It can therefore
+ * stay enabled in production, and the aggregates can be queried at any time while the session is being run.
+ *
+ * The nodes are registered at construction and identified by their position in the list, so that recording
+ * never allocates or takes a lock.
+ */
+class SamplingProfiler {
+ public:
+  struct NodeInfo {
+    // unique in the session, including the nodes of subgraphs
+    std::string name;
+    // empty for positions that do not hold a node
+    std::string op_type;
+  };
+
+  SamplingProfiler(uint64_t sample_interval, size_t ring_buffer_size, bool collect_node_stats,
+                   const std::vector<NodeInfo>& nodes);
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(SamplingProfiler);
+
+  /*
+  Returns whether the run that is starting should be profiled. Called once per run by each executor.
+  */
+  bool ShouldSampleRun();
+
+  /*
+  Records the execution of the node with the given position in the list of nodes for a sampled run.
+  */
+  void RecordNodeEvent(size_t node_id, const NodeExecutionMeasurement& measurement);
+
+  /*
+  Records the latency of a sampled run of the main graph.
+  */
+  void RecordRun(std::chrono::nanoseconds duration);
+
+  /*
+  Returns the aggregated statistics as key value pairs. Latencies are in microseconds.
+    "sampled_runs", "sample_interval"
+    "run.{count,mean_us,p50_us,p90_us,p99_us,max_us}"
+    "op.<op_type>.<stat>" for every op type that was executed, see NodeExecutionStats::AddTo for the stats
+    "node.<node_name>.<stat>" for every node that was executed, if node stats are collected
+  */
+  void GetStats(std::unordered_map<std::string, std::string>& stats) const;
+
+  /*
+  Returns the node events in the ring buffer, oldest first. Events that are being overwritten concurrently
+  are skipped.
+  */
+  std::vector<SampledNodeEvent> GetRecentEvents() const;
+
+  uint64_t SampleInterval() const { return sample_interval_; }
+  bool CollectsNodeStats() const { return collect_node_stats_; }
+
+ private:
+  // Written with a sequence lock: the sequence is odd while the slot is being written.
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> node_id{0};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> duration_ns{0};
+  };
+
+  const uint64_t sample_interval_;
+  const bool collect_node_stats_;
+  const std::chrono::steady_clock::time_point creation_time_;
+
+  std::vector<NodeInfo> nodes_;
+  std::vector<uint32_t> node_op_type_indices_;
+  std::vector<std::string> op_types_;
+  std::vector<std::unique_ptr<NodeExecutionStats>> op_type_stats_;
+  // empty if node stats are not collected, nullptr for positions that do not hold a node
+  std::vector<std::unique_ptr<NodeExecutionStats>> node_stats_;
+  LatencyHistogram run_histogram_;
+
+  std::atomic<uint64_t> run_counter_{0};
+  std::atomic<uint64_t> sampled_runs_{0};
+
+  std::vector<Slot> ring_buffer_;
+  std::atomic<uint64_t> ring_buffer_head_{0};
+};
+
+}  // namespace profiling
+}  // namespace onnxruntime
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include <memory>
 #include <optional>
+#include <utility>
 
 #include "core/platform/threadpool.h"
 #include "core/common/common.h"
@@ -390,6 +391,11 @@ ThreadPool::ThreadPool(Env* env,
       assert(thread_options_.affinities.size() >= size_t(threads_to_create));
     }
 
+    if (!thread_options_.numa_nodes.empty()) {
+      // Same layout as the affinities, the first element belongs to the caller thread
+      thread_options_.numa_nodes.erase(thread_options_.numa_nodes.begin());
+    }
+
     extended_eigen_threadpool_ =
         std::make_unique<ThreadPoolTempl<Env> >(name,
                                                 threads_to_create,
@@ -496,6 +502,7 @@ std::string ThreadPool::StopProfiling() {
 
 namespace {
 thread_local std::optional<ThreadPoolParallelSection> current_parallel_section;
+thread_local ThreadPool::ParallelLoopStats* current_parallel_loop_stats = nullptr;
 }
 
 ThreadPool::ParallelSection::ParallelSection(ThreadPool* tp) {
@@ -517,6 +524,17 @@ ThreadPool::ParallelSection::~ParallelSection() {
 }
 
 void ThreadPool::RunInParallel(std::function<void(unsigned idx)> fn, unsigned n, std::ptrdiff_t block_size) {
+  ParallelLoopStats* loop_stats = n > 1 ? current_parallel_loop_stats : nullptr;
+  // Work items that are not picked up by a worker before the loop completes are revoked, so counting the
+  // items that run gives the number of threads that took part in the loop.
+  std::atomic<unsigned> threads_run{0};
+  if (loop_stats != nullptr) {
+    fn = [&threads_run, fn = std::move(fn)](unsigned idx) {
+      threads_run.fetch_add(1, std::memory_order_relaxed);
+      fn(idx);
+    };
+  }
+
   if (underlying_threadpool_) {
     if (current_parallel_section.has_value()) {
       underlying_threadpool_->RunInParallelSection(*current_parallel_section,
@@ -529,6 +547,12 @@ void ThreadPool::RunInParallel(std::function<void(unsigned idx)> fn, unsigned n,
   } else {
     fn(0);
   }
+
+  if (loop_stats != nullptr) {
+    loop_stats->num_loops++;
+    loop_stats->requested_parallelism += n;
+    loop_stats->achieved_parallelism += threads_run.load(std::memory_order_relaxed);
+  }
 }
 
 bool ThreadPool::ShouldParallelizeLoop(const std::ptrdiff_t num_iterations,
@@ -664,6 +688,10 @@ std::string ThreadPool::StopProfiling(concurrency::ThreadPool* tp) {
   }
 }
 
+ThreadPool::ParallelLoopStats* ThreadPool::SetParallelLoopStatsCollector(ParallelLoopStats* stats) {
+  return std::exchange(current_parallel_loop_stats, stats);
+}
+
 void ThreadPool::EnableSpinning() {
   if (extended_eigen_threadpool_) {
     extended_eigen_threadpool_->EnableSpinning();
@@ -3,6 +3,7 @@
 
 #include "core/framework/allocator.h"
 #include "core/framework/bfc_arena.h"
+#include <thread>
 #include <type_traits>
 
 namespace onnxruntime {
@@ -12,7 +13,8 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
                    int initial_chunk_size_bytes,
                    int max_dead_bytes_per_chunk,
                    int initial_growth_chunk_size_bytes,
-                   int64_t max_power_of_two_extend_bytes)
+                   int64_t max_power_of_two_extend_bytes,
+                   int64_t size_class_cache_max_bytes)
     : IAllocator(OrtMemoryInfo(resource_allocator->Info().name,
                                OrtAllocatorType::OrtArenaAllocator,
                                resource_allocator->Info().device,
@@ -32,7 +34,8 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
                      << " initial_growth_chunk_size_bytes: " << initial_growth_chunk_size_bytes_
                      << " max_power_of_two_extend_bytes: " << max_power_of_two_extend_bytes_
                      << " memory limit: " << total_memory
-                     << " arena_extend_strategy: " << static_cast<int32_t>(arena_extend_strategy);
+                     << " arena_extend_strategy: " << static_cast<int32_t>(arena_extend_strategy)
+                     << " size_class_cache_max_bytes: " << size_class_cache_max_bytes;
 
   // static_cast<std::underlying_type_t<ArenaExtendStrategy>>(arena_extend_strategy); doesn't work on this compiler
 
@@ -75,6 +78,10 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
       ORT_ENFORCE(BinForSize(bin_size * 2) != BinFromIndex(b));
     }
   }
+
+  if (size_class_cache_max_bytes > 0) {
+    size_class_cache_ = std::make_unique<SizeClassCache>(static_cast<size_t>(size_class_cache_max_bytes));
+  }
 }
 
 BFCArena::~BFCArena() {
@@ -269,6 +276,12 @@ size_t BFCArena::RoundedBytes(size_t bytes) {
 }
 
 void* BFCArena::Alloc(size_t size) {
+  if (size_class_cache_ != nullptr && size != 0) {
+    void* p = size_class_cache_->Alloc(*this, size);
+    if (p != nullptr) {
+      return p;
+    }
+  }
   return AllocateRawInternal(size, false, nullptr, false, nullptr);
 }
 
@@ -289,6 +302,9 @@ void* BFCArena::Reserve(size_t size) {
   stats_.max_alloc_size = std::max<size_t>(static_cast<size_t>(stats_.max_alloc_size), size);
   stats_.max_bytes_in_use = std::max<int64_t>(static_cast<int64_t>(stats_.max_bytes_in_use), stats_.bytes_in_use);
   stats_.total_allocated_bytes += size;
+  if (size_class_cache_ != nullptr) {
+    size_class_cache_->AddBytesInUse(static_cast<int64_t>(size));
+  }
   return ptr;
 }
 
@@ -325,7 +341,7 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
   // The BFC allocator tries to find the best fit first.
   BinNum bin_num = BinNumForSize(rounded_bytes);
 
-  std::lock_guard<std::mutex> lock(lock_);
+  std::unique_lock<std::mutex> lock(lock_);
   // search for a valid chunk
   auto* chunk = FindChunkPtr(bin_num,
                              rounded_bytes,
@@ -341,6 +357,9 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
       if (stream)
         chunk->stream_timestamp = stream->GetCurrentTimestamp();
     }
+    if (size_class_cache_ != nullptr) {
+      size_class_cache_->AddBytesInUse(static_cast<int64_t>(chunk->size));
+    }
     return chunk->ptr;
   }
 
@@ -356,6 +375,9 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
       if (chunk->stream == nullptr && stream) {
         chunk->stream = stream;
       }
+      if (size_class_cache_ != nullptr) {
+        size_class_cache_->AddBytesInUse(static_cast<int64_t>(chunk->size));
+      }
       return chunk->ptr;
     } else {
       status = ORT_MAKE_STATUS(ONNXRUNTIME, FAIL,
@@ -364,6 +386,24 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
     }
   }
 
+  // The chunks held by the size class cache are free, hand them back to the bins where they can coalesce
+  // with their neighbors and retry once before giving up.
+  if (size_class_cache_ != nullptr && size_class_cache_->HasCachedChunks()) {
+    lock.unlock();
+    size_class_cache_->Flush(*this);
+    lock.lock();
+    chunk = FindChunkPtr(bin_num, rounded_bytes, num_bytes, stream, enable_cross_stream_reusing, wait_fn);
+    if (chunk != nullptr) {
+      if (chunk->stream == nullptr) {
+        chunk->stream = stream;
+        if (stream)
+          chunk->stream_timestamp = stream->GetCurrentTimestamp();
+      }
+      size_class_cache_->AddBytesInUse(static_cast<int64_t>(chunk->size));
+      return chunk->ptr;
+    }
+  }
+
   // We searched all bins for an existing free chunk to use and
   // couldn't find one.  This means we must have run out of memory,
   // Dump the memory log for analysis.
@@ -379,6 +419,9 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
 void BFCArena::GetStats(AllocatorStats* stats) {
   std::lock_guard<std::mutex> lock(lock_);
   *stats = stats_;
+  if (size_class_cache_ != nullptr) {
+    size_class_cache_->GetStats(stats);
+  }
 }
 
 BFCArena::Chunk* BFCArena::SplitFreeChunkFromBin(BFCArena::Bin::FreeChunkSet* free_chunks,
@@ -496,7 +539,11 @@ void BFCArena::Free(void* p) {
   if (p == nullptr) {
     return;
   }
+  if (size_class_cache_ != nullptr && size_class_cache_->Free(*this, p)) {
+    return;
+  }
   std::lock_guard<std::mutex> lock(lock_);
+  const int64_t bytes_in_use = stats_.bytes_in_use;
   auto it = reserved_chunks_.find(p);
   if (it != reserved_chunks_.end()) {
     device_allocator_->Free(it->first);
@@ -506,9 +553,17 @@ void BFCArena::Free(void* p) {
   } else {
     DeallocateRawInternal(p);
   }
+  if (size_class_cache_ != nullptr) {
+    size_class_cache_->AddBytesInUse(stats_.bytes_in_use - bytes_in_use);
+  }
 }
 
 Status BFCArena::Shrink() {
+  // Cached chunks are in use as far as the bins are concerned and would keep their regions alive.
+  if (size_class_cache_ != nullptr) {
+    size_class_cache_->Flush(*this);
+  }
+
   std::lock_guard<std::mutex> lock(lock_);
   auto num_regions = region_manager_.regions().size();
   std::vector<void*> region_ptrs;
@@ -805,6 +860,279 @@ void BFCArena::DumpMemoryLog(size_t num_bytes) {
   LOGS_DEFAULT(INFO) << "Stats: \n"
                      << stats_.DebugString();
 }
+
+BFCArena::SizeClassCache::SizeClassCache(size_t max_chunk_bytes)
+    : owner_slots_(std::make_unique<std::atomic<uintptr_t>[]>(kOwnerTableSize)),
+      owner_info_(std::make_unique<std::atomic<size_t>[]>(kOwnerTableSize)) {
+  static_assert(kMaxNumClasses <= static_cast<int>(kMinAllocationSize),
+                "size class must fit in the low bits of a chunk size");
+  num_classes_ = 0;
+  while (num_classes_ < kMaxNumClasses && ClassSize(num_classes_) <= max_chunk_bytes) {
+    ++num_classes_;
+  }
+  for (size_t i = 0; i < kOwnerTableSize; ++i) {
+    owner_slots_[i].store(kEmptySlot, std::memory_order_relaxed);
+    owner_info_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+int BFCArena::SizeClassCache::SizeClassFor(size_t rounded_bytes) const {
+  int size_class = 0;
+  while (size_class < num_classes_ && ClassSize(size_class) < rounded_bytes) {
+    ++size_class;
+  }
+  return size_class < num_classes_ ? size_class : -1;
+}
+
+BFCArena::SizeClassCache::Shard& BFCArena::SizeClassCache::ShardForCurrentThread() {
+  static thread_local const size_t shard_hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return shards_[shard_hash % kNumShards];
+}
+
+size_t BFCArena::SizeClassCache::SlotFor(const void* p) {
+  // chunk pointers are kMinAllocationSize apart, drop the bits that never differ before mixing
+  uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p)) >> kMinAllocationBits;
+  return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (kOwnerTableSize - 1);
+}
+
+bool BFCArena::SizeClassCache::Find(const void* p, CachedChunk& chunk, int& size_class) const {
+  const uintptr_t key = reinterpret_cast<uintptr_t>(p);
+  size_t slot = SlotFor(p);
+  for (size_t i = 0; i < kOwnerTableSize; ++i) {
+    uintptr_t value = owner_slots_[slot].load(std::memory_order_acquire);
+    if (value == key) {
+      const size_t info = owner_info_[slot].load(std::memory_order_relaxed);
+      chunk.ptr = const_cast<void*>(p);
+      chunk.size = info & ~(kMinAllocationSize - 1);
+      size_class = static_cast<int>(info & (kMinAllocationSize - 1));
+      return true;
+    }
+    if (value == kEmptySlot) {
+      break;
+    }
+    slot = (slot + 1) & (kOwnerTableSize - 1);
+  }
+  return false;
+}
+
+bool BFCArena::SizeClassCache::Insert(const CachedChunk& chunk, int size_class) {
+  size_t slot = SlotFor(chunk.ptr);
+  size_t deleted_slot = kOwnerTableSize;
+  for (size_t i = 0; i < kOwnerTableSize; ++i) {
+    uintptr_t value = owner_slots_[slot].load(std::memory_order_relaxed);
+    if (value == kEmptySlot) {
+      break;
+    }
+    if (value == kDeletedSlot && deleted_slot == kOwnerTableSize) {
+      deleted_slot = slot;
+    }
+    slot = (slot + 1) & (kOwnerTableSize - 1);
+  }
+
+  if (deleted_slot != kOwnerTableSize) {
+    slot = deleted_slot;
+  } else if (owner_slots_used_ + 1 > kOwnerTableSize / 2) {
+    // keep probe sequences short, and guarantee that lookups terminate on an empty slot
+    return false;
+  } else {
+    ++owner_slots_used_;
+  }
+
+  // Publish the size and class before the key, Find() reads them in the opposite order.
+  owner_info_[slot].store(chunk.size | static_cast<size_t>(size_class), std::memory_order_relaxed);
+  owner_slots_[slot].store(reinterpret_cast<uintptr_t>(chunk.ptr), std::memory_order_release);
+  return true;
+}
+
+void BFCArena::SizeClassCache::Erase(const void* p) {
+  const uintptr_t key = reinterpret_cast<uintptr_t>(p);
+  size_t slot = SlotFor(p);
+  for (size_t i = 0; i < kOwnerTableSize; ++i) {
+    uintptr_t value = owner_slots_[slot].load(std::memory_order_relaxed);
+    if (value == key) {
+      break;
+    }
+    ORT_ENFORCE(value != kEmptySlot, "Chunk is not owned by the size class cache: ", p);
+    slot = (slot + 1) & (kOwnerTableSize - 1);
+  }
+
+  // If the next slot is empty no probe sequence continues past this one, so it can be emptied
+  // instead of being marked as deleted.  Deleted slots right before it can then be emptied too.
+  const size_t next = (slot + 1) & (kOwnerTableSize - 1);
+  if (owner_slots_[next].load(std::memory_order_relaxed) != kEmptySlot) {
+    owner_slots_[slot].store(kDeletedSlot, std::memory_order_release);
+    return;
+  }
+  owner_slots_[slot].store(kEmptySlot, std::memory_order_release);
+  --owner_slots_used_;
+  slot = (slot + kOwnerTableSize - 1) & (kOwnerTableSize - 1);
+  while (owner_slots_[slot].load(std::memory_order_relaxed) == kDeletedSlot) {
+    owner_slots_[slot].store(kEmptySlot, std::memory_order_release);
+    --owner_slots_used_;
+    slot = (slot + kOwnerTableSize - 1) & (kOwnerTableSize - 1);
+  }
+}
+
+size_t BFCArena::SizeClassCache::Refill(BFCArena& arena, int size_class, CachedChunk* out) {
+  const size_t class_bytes = ClassSize(size_class);
+  const BinNum bin_num = arena.BinNumForSize(class_bytes);
+  // FindChunkPtr updates the stats as if every chunk was an allocation, only the chunk handed to the caller is one.
+  // The chunks kept in the cache are counted as hits when they are handed out. The bytes in use are tracked by
+  // the cache.
+  const AllocatorStats stats = arena.stats_;
+  size_t num_chunks = 0;
+  while (num_chunks < kBatchSize) {
+    // Only carve chunks out of memory the arena already has, growing the arena is left to the regular path.
+    Chunk* chunk = arena.FindChunkPtr(bin_num, class_bytes, class_bytes, nullptr, false);
+    if (chunk == nullptr) {
+      break;
+    }
+    CachedChunk cached{chunk->ptr, chunk->size};
+    if (!Insert(cached, size_class)) {
+      arena.DeallocateRawInternal(cached.ptr);
+      break;
+    }
+    out[num_chunks++] = cached;
+  }
+
+  arena.stats_.num_allocs = stats.num_allocs;
+  arena.stats_.max_alloc_size = stats.max_alloc_size;
+  if (num_chunks > 0) {
+    const int64_t size = static_cast<int64_t>(out[0].size);
+    ++arena.stats_.num_allocs;
+    arena.stats_.max_alloc_size = std::max(stats.max_alloc_size, size);
+    AddBytesInUse(size);
+  }
+  return num_chunks;
+}
+
+void BFCArena::SizeClassCache::Release(BFCArena& arena, const CachedChunk* chunks, size_t num_chunks) {
+  std::lock_guard<std::mutex> lock(arena.lock_);
+  for (size_t i = 0; i < num_chunks; ++i) {
+    Erase(chunks[i].ptr);
+    arena.DeallocateRawInternal(chunks[i].ptr);
+  }
+}
+
+void* BFCArena::SizeClassCache::Alloc(BFCArena& arena, size_t size) {
+  const int size_class = SizeClassFor(arena.RoundedBytes(size));
+  if (size_class < 0) {
+    return nullptr;
+  }
+
+  Shard& shard = ShardForCurrentThread();
+  {
+    std::lock_guard<OrtSpinLock> guard(shard.lock);
+    size_t& num_chunks = shard.num_chunks[size_class];
+    if (num_chunks > 0) {
+      const CachedChunk& chunk = shard.chunks[size_class][--num_chunks];
+      num_hits_.fetch_add(1, std::memory_order_relaxed);
+      bytes_in_cache_.fetch_sub(static_cast<int64_t>(chunk.size), std::memory_order_relaxed);
+      AddBytesInUse(static_cast<int64_t>(chunk.size));
+      return chunk.ptr;
+    }
+  }
+
+  num_misses_.fetch_add(1, std::memory_order_relaxed);
+  std::array<CachedChunk, kBatchSize> batch;
+  size_t batch_size = 0;
+  {
+    std::lock_guard<std::mutex> lock(arena.lock_);
+    batch_size = Refill(arena, size_class, batch.data());
+  }
+  if (batch_size == 0) {
+    return nullptr;
+  }
+
+  // Keep the first chunk for this request and stash the rest.  Another thread may have filled the
+  // shard in the meantime, in which case the surplus goes back to the bins.
+  size_t num_left = batch_size;
+  {
+    std::lock_guard<OrtSpinLock> guard(shard.lock);
+    size_t& num_chunks = shard.num_chunks[size_class];
+    while (num_left > 1 && num_chunks < kMaxChunksPerClass) {
+      const CachedChunk& chunk = batch[--num_left];
+      shard.chunks[size_class][num_chunks++] = chunk;
+      bytes_in_cache_.fetch_add(static_cast<int64_t>(chunk.size), std::memory_order_relaxed);
+    }
+  }
+  if (num_left > 1) {
+    Release(arena, batch.data() + 1, num_left - 1);
+  }
+  return batch[0].ptr;
+}
+
+bool BFCArena::SizeClassCache::Free(BFCArena& arena, void* p) {
+  CachedChunk chunk;
+  int size_class;
+  if (!Find(p, chunk, size_class)) {
+    return false;
+  }
+
+  // When the shard is full, hand a batch back to the bins so that memory held by one thread can
+  // be reused by others.
+  std::array<CachedChunk, kBatchSize> batch;
+  size_t batch_size = 0;
+  {
+    Shard& shard = ShardForCurrentThread();
+    std::lock_guard<OrtSpinLock> guard(shard.lock);
+    size_t& num_chunks = shard.num_chunks[size_class];
+    if (num_chunks == kMaxChunksPerClass) {
+      while (batch_size < kBatchSize) {
+        const CachedChunk& evicted = shard.chunks[size_class][--num_chunks];
+        bytes_in_cache_.fetch_sub(static_cast<int64_t>(evicted.size), std::memory_order_relaxed);
+        batch[batch_size++] = evicted;
+      }
+    }
+    shard.chunks[size_class][num_chunks++] = chunk;
+    bytes_in_cache_.fetch_add(static_cast<int64_t>(chunk.size), std::memory_order_relaxed);
+  }
+  AddBytesInUse(-static_cast<int64_t>(chunk.size));
+
+  if (batch_size > 0) {
+    Release(arena, batch.data(), batch_size);
+  }
+  return true;
+}
+
+void BFCArena::SizeClassCache::Flush(BFCArena& arena) {
+  std::vector<CachedChunk> chunks;
+  for (auto& shard : shards_) {
+    std::lock_guard<OrtSpinLock> guard(shard.lock);
+    for (int size_class = 0; size_class < num_classes_; ++size_class) {
+      size_t& num_chunks = shard.num_chunks[size_class];
+      for (size_t i = 0; i < num_chunks; ++i) {
+        const CachedChunk& chunk = shard.chunks[size_class][i];
+        bytes_in_cache_.fetch_sub(static_cast<int64_t>(chunk.size), std::memory_order_relaxed);
+        chunks.push_back(chunk);
+      }
+      num_chunks = 0;
+    }
+  }
+
+  Release(arena, chunks.data(), chunks.size());
+}
+
+void BFCArena::SizeClassCache::AddBytesInUse(int64_t bytes) {
+  const int64_t bytes_in_use = bytes_in_use_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  int64_t max_bytes_in_use = max_bytes_in_use_.load(std::memory_order_relaxed);
+  while (bytes_in_use > max_bytes_in_use &&
+         !max_bytes_in_use_.compare_exchange_weak(max_bytes_in_use, bytes_in_use, std::memory_order_relaxed)) {
+  }
+}
+
+void BFCArena::SizeClassCache::GetStats(AllocatorStats* stats) const {
+  const int64_t num_hits = num_hits_.load(std::memory_order_relaxed);
+  // Allocations served by the cache never reach the bins, and chunks sitting in the cache are not
+  // in use by anyone, so the arena's own byte counts do not apply.
+  stats->num_allocs += num_hits;
+  stats->bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+  stats->max_bytes_in_use = max_bytes_in_use_.load(std::memory_order_relaxed);
+  stats->num_cache_hits = num_hits;
+  stats->num_cache_misses = num_misses_.load(std::memory_order_relaxed);
+  stats->bytes_in_cache = bytes_in_cache_.load(std::memory_order_relaxed);
+}
+
 #ifdef ORT_ENABLE_STREAM
 void BFCArena::ResetChunkOnTargetStream(Stream* target_stream, bool coalesce_flag) {
   std::lock_guard<std::mutex> lock(lock_);
@@ -16,6 +16,7 @@ limitations under the License.
 
 #pragma once
 #include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <sstream>
@@ -32,6 +33,7 @@ limitations under the License.
 #include "core/framework/allocator.h"
 
 #include "core/framework/stream_handles.h"
+#include "core/platform/ort_spin_lock.h"
 
 #if defined(PLATFORM_WINDOWS)
 #include <intrin.h>
@@ -61,6 +63,8 @@ class BFCArena : public IAllocator {
   static const int DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES = 2 * 1024 * 1024;
   static const int64_t DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES = 1024 * 1024 * 1024;  // 1GB
   static const size_t DEFAULT_MAX_MEM = std::numeric_limits<size_t>::max();
+  // 0 disables the size class cache in front of the bins.
+  static const int64_t DEFAULT_SIZE_CLASS_CACHE_MAX_BYTES = 0;
 
   enum ArenaType {
     BaseArena,
@@ -73,7 +77,8 @@ class BFCArena : public IAllocator {
            int initial_chunk_size_bytes = DEFAULT_INITIAL_CHUNK_SIZE_BYTES,
            int max_dead_bytes_per_chunk = DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
            int initial_growth_chunk_size_bytes = DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES,
-           int64_t max_power_of_two_extend_bytes = DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES);
+           int64_t max_power_of_two_extend_bytes = DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+           int64_t size_class_cache_max_bytes = DEFAULT_SIZE_CLASS_CACHE_MAX_BYTES);
 
   ~BFCArena() override;
 
@@ -429,6 +434,100 @@ class BFCArena : public IAllocator {
   // Computes and returns a BinDebugInfo for each Bin.
   std::array<BinDebugInfo, kNumBins> get_bin_debug_info();
 
+  // SizeClassCache is an optional front end for small allocations made through Alloc().
+  //
+  // Requests are rounded up to a power of two size class, and chunks of a class are kept in a
+  // number of shards (selected by the calling thread) once freed, so that subsequent Alloc/Free
+  // calls of that class only take the shard's spin lock rather than lock_.  Chunks move between
+  // a shard and the bins in batches.  While held by the cache, chunks are in use as far as the
+  // bins are concerned.
+  //
+  // Pointers handed out by the cache are recorded in an open addressing table that Free() probes
+  // without taking any lock.  The table is only written while holding lock_.
+  class SizeClassCache {
+   public:
+    explicit SizeClassCache(size_t max_chunk_bytes);
+
+    // Returns nullptr if size is not cacheable, or no chunk could be obtained without extending the arena.
+    void* Alloc(BFCArena& arena, size_t size);
+
+    // Returns false if p was not handed out by the cache.
+    bool Free(BFCArena& arena, void* p);
+
+    // Returns all cached chunks to the bins.  lock_ must not be held.
+    void Flush(BFCArena& arena);
+
+    bool HasCachedChunks() const { return bytes_in_cache_.load(std::memory_order_relaxed) > 0; }
+
+    // Records allocations and frees of the arena, including those served by the cache, as the cache hands out
+    // chunks without taking lock_.
+    void AddBytesInUse(int64_t bytes);
+
+    void GetStats(AllocatorStats* stats) const;
+
+   private:
+    static constexpr int kMaxNumClasses = kNumBins;
+    static constexpr size_t kNumShards = 16;
+    static constexpr size_t kMaxChunksPerClass = 16;
+    static constexpr size_t kBatchSize = 4;
+    static constexpr size_t kOwnerTableSize = size_t{1} << 14;
+    static constexpr uintptr_t kEmptySlot = 0;
+    static constexpr uintptr_t kDeletedSlot = 1;
+
+    // A chunk may be larger than its class size if the bins did not split it, keep the actual
+    // size around for the statistics.
+    struct CachedChunk {
+      void* ptr;
+      size_t size;
+    };
+
+#ifdef _MSC_VER
+#pragma warning(push)
+// C4324: structure was padded due to alignment specifier
+#pragma warning(disable : 4324)
+#endif  // _MSC_VER
+    // Shards are used by different threads, keep their locks on separate cache lines.
+    struct alignas(64) Shard {
+      OrtSpinLock lock;
+      std::array<std::array<CachedChunk, kMaxChunksPerClass>, kMaxNumClasses> chunks{};
+      std::array<size_t, kMaxNumClasses> num_chunks{};
+    };
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif  // _MSC_VER
+
+    int SizeClassFor(size_t rounded_bytes) const;
+    static size_t ClassSize(int size_class) { return kMinAllocationSize << size_class; }
+    Shard& ShardForCurrentThread();
+
+    // Owner table operations.  Find is lock free, Insert/Erase require lock_.
+    // Chunk sizes are multiples of kMinAllocationSize, so the size class is kept in the low bits
+    // of the chunk size.
+    static size_t SlotFor(const void* p);
+    bool Find(const void* p, CachedChunk& chunk, int& size_class) const;
+    bool Insert(const CachedChunk& chunk, int size_class);
+    void Erase(const void* p);
+
+    // Takes up to kBatchSize chunks of the class out of the bins, appending them to out.  Requires lock_.
+    size_t Refill(BFCArena& arena, int size_class, CachedChunk* out);
+
+    // Hands chunks back to the bins.  Takes lock_.
+    void Release(BFCArena& arena, const CachedChunk* chunks, size_t num_chunks);
+
+    int num_classes_;
+    std::array<Shard, kNumShards> shards_;
+    std::unique_ptr<std::atomic<uintptr_t>[]> owner_slots_;
+    std::unique_ptr<std::atomic<size_t>[]> owner_info_;
+    size_t owner_slots_used_ = 0;  // slots that are not empty, including deleted ones
+
+    std::atomic<int64_t> num_hits_{0};
+    std::atomic<int64_t> num_misses_{0};
+    std::atomic<int64_t> bytes_in_cache_{0};
+    // bytes handed out by the arena and the cache, not counting the chunks held by the cache, and their peak
+    std::atomic<int64_t> bytes_in_use_{0};
+    std::atomic<int64_t> max_bytes_in_use_{0};
+  };
+
   // Structures immutable after construction
   size_t memory_limit_ = 0;
   ArenaExtendStrategy arena_extend_strategy_ = ArenaExtendStrategy::kNextPowerOfTwo;
@@ -491,6 +590,8 @@ class BFCArena : public IAllocator {
 
   mutable std::mutex lock_;
 
+  std::unique_ptr<SizeClassCache> size_class_cache_;
+
   RegionManager region_manager_;
   std::vector<Chunk> chunks_;
   // Pointer to head of linked list of free Chunks
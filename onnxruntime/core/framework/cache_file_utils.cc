@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/cache_file_utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "core/platform/env.h"
+
+namespace onnxruntime {
+namespace cache_file_utils {
+
+std::filesystem::path GetUniqueTempFilePath(const std::filesystem::path& file_path) {
+  // The pid tells processes apart, the random number covers pid reuse and the counter the threads of a process.
+  static std::atomic<uint64_t> counter{0};
+  std::random_device random_device;
+  std::ostringstream suffix;
+  suffix << '.' << Env::Default().GetSelfPid() << '.' << std::hex << random_device() << '.'
+         << counter.fetch_add(1, std::memory_order_relaxed) << ".tmp";
+
+  auto temp_path = file_path;
+  temp_path += suffix.str();
+  return temp_path;
+}
+
+Status WriteFileAtomically(const std::filesystem::path& file_path,
+                           const std::function<void(std::ostream& stream)>& write_content) {
+  const auto temp_path = GetUniqueTempFilePath(file_path);
+  std::error_code ec;
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    ORT_RETURN_IF_NOT(file.is_open(), "Failed to open ", temp_path, " for writing.");
+    write_content(file);
+    file.close();
+    if (file.fail()) {
+      std::filesystem::remove(temp_path, ec);
+      return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Failed to write ", temp_path);
+    }
+  }
+
+  std::filesystem::rename(temp_path, file_path, ec);
+  if (ec) {
+    std::error_code remove_ec;
+    std::filesystem::remove(temp_path, remove_ec);
+    return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Failed to replace ", file_path, ": ", ec.message());
+  }
+  return Status::OK();
+}
+
+Status FileLock::Acquire(const std::filesystem::path& file_path, std::unique_ptr<FileLock>& lock) {
+  // writers hold the lock for a single read and rewrite of the file, so these are generous
+  constexpr auto kTimeout = std::chrono::seconds(5);
+  constexpr auto kStaleLockAge = std::chrono::seconds(30);
+  constexpr auto kRetryInterval = std::chrono::milliseconds(10);
+
+  auto lock_path = file_path;
+  lock_path += ".lock";
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  for (;;) {
+    std::error_code ec;
+    if (std::filesystem::create_directory(lock_path, ec)) {
+      lock.reset(new FileLock(std::move(lock_path)));
+      return Status::OK();
+    }
+    ORT_RETURN_IF(ec, "Failed to create lock ", lock_path, ": ", ec.message());
+
+    const auto lock_time = std::filesystem::last_write_time(lock_path, ec);
+    if (!ec && std::filesystem::file_time_type::clock::now() - lock_time > kStaleLockAge) {
+      std::filesystem::remove(lock_path, ec);
+      continue;
+    }
+    ORT_RETURN_IF(std::chrono::steady_clock::now() > deadline, "Timed out waiting for lock ", lock_path);
+    std::this_thread::sleep_for(kRetryInterval);
+  }
+}
+
+FileLock::~FileLock() {
+  std::error_code ec;
+  std::filesystem::remove(lock_path_, ec);
+}
+
+}  // namespace cache_file_utils
+}  // namespace onnxruntime
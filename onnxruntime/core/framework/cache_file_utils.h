@@ -0,0 +1,45 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <ostream>
+
+#include "core/common/common.h"
+
+namespace onnxruntime {
+namespace cache_file_utils {
+
+// Returns the path of a temporary file next to file_path that no other thread or process uses, so that
+// concurrent writers of the same cache file never write into the same temporary file.
+std::filesystem::path GetUniqueTempFilePath(const std::filesystem::path& file_path);
+
+// Writes file_path with write_content. The content is written to a unique temporary file that is then renamed
+// over file_path, so that a reader only ever sees a complete file, written by a single writer.
+Status WriteFileAtomically(const std::filesystem::path& file_path,
+                           const std::function<void(std::ostream& stream)>& write_content);
+
+// Cross-process lock of a cache file, held while the file is read and rewritten so that concurrent writers can merge
+// their entries instead of dropping each other's. The lock is a directory next to the file, as creating a directory
+// fails atomically if it exists on all platforms. A lock that is held for longer than any writer needs is assumed to
+// be left behind by a process that died and is broken.
+class FileLock {
+ public:
+  // Waits for the lock of file_path, failing if it can not be acquired within a few seconds.
+  static Status Acquire(const std::filesystem::path& file_path, std::unique_ptr<FileLock>& lock);
+
+  ~FileLock();
+
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(FileLock);
+
+ private:
+  explicit FileLock(std::filesystem::path lock_path) : lock_path_(std::move(lock_path)) {}
+
+  std::filesystem::path lock_path_;
+};
+
+}  // namespace cache_file_utils
+}  // namespace onnxruntime
@@ -358,6 +358,9 @@ ExecutionFrame::ExecutionFrame(gsl::span<const int> feed_mlvalue_idxs, gsl::span
 #endif
       session_state_(session_state),
       mem_patterns_(nullptr) {
+#if !defined(ORT_MINIMAL_BUILD)
+  record_dynamic_allocations_ = session_state.GetNodeStatsRecorder() != nullptr;
+#endif
   Init(
       feed_mlvalue_idxs, feeds, session_state.GetInitializedTensors(),
 #if !defined(DISABLE_SPARSE_TENSORS)
@@ -551,8 +554,10 @@ Status ExecutionFrame::AllocateMLValueTensorSelfOwnBufferHelper(OrtValue& ort_va
       if (block) {
         auto it = buffers_.find(location);
         if (it != buffers_.end()) {
-          // if the block is not correct, log message then fall back to default behavior
-          if (block->size_ == size) {
+          // if the block is not correct, log message then fall back to default behavior.
+          // with dimension bucketing the pattern is shared by nearby shapes, so any tensor that fits is fine.
+          if (block->size_ == size ||
+              (session_state_.GetMemoryPatternDimBucketing() && block->size_ > size)) {
             void* buffer = it->second.get();
             auto status = AllocateTensorWithPreAllocateBufferHelper(
                 ort_value, static_cast<void*>(static_cast<char*>(buffer) + block->offset_), element_type, location,
@@ -618,7 +623,9 @@ Status ExecutionFrame::AllocateMLValueTensorSelfOwnBufferHelper(OrtValue& ort_va
   }
 
 #if !defined(ORT_MINIMAL_BUILD)
-  if (session_state_.GetNodeStatsRecorder() != nullptr) {
+  if (record_dynamic_allocations_) {
+    // nodes of different streams may allocate concurrently
+    std::lock_guard<std::mutex> lock(mtx_);
     ort_value_to_dynamic_allocations_size_.insert_or_assign(ort_value_index, size);
   }
 #endif
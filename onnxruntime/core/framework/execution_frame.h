@@ -169,7 +169,15 @@ class ExecutionFrame final : public IExecutionFrame {
   }
 
 #if !defined(ORT_MINIMAL_BUILD)
+  // Records the dynamic allocations of this run for the sampling profiler. Must be called before the nodes run.
+  void RecordDynamicAllocations() { record_dynamic_allocations_ = true; }
+
+  // thread-safe
   std::optional<size_t> GetOrtValueDynamicAllocation(int ort_value_index) const {
+    if (!record_dynamic_allocations_) {
+      return std::nullopt;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
     auto it = ort_value_to_dynamic_allocations_size_.find(ort_value_index);
     if (it != ort_value_to_dynamic_allocations_size_.end()) {
       return it->second;
@@ -273,6 +281,9 @@ class ExecutionFrame final : public IExecutionFrame {
 #endif
 
 #if !defined(ORT_MINIMAL_BUILD)
+  // Whether ort_value_to_dynamic_allocations_size_ is filled, which takes mtx_ on every dynamic allocation.
+  // Set when node stats are recorded, or when the run is sampled by the sampling profiler.
+  bool record_dynamic_allocations_ = false;
   // OrtValue index to the size of dynamic memory allocation.
   std::unordered_map<int, size_t> ort_value_to_dynamic_allocations_size_;
 #endif
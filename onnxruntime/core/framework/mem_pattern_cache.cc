@@ -0,0 +1,321 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/mem_pattern_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <unordered_set>
+
+#include "onnxruntime_config.h"
+#include "core/common/narrow.h"
+#include "core/framework/cache_file_utils.h"
+#include "core/framework/murmurhash3.h"
+#include "core/framework/ort_value_name_idx_map.h"
+#include "core/framework/sequential_execution_plan.h"
+
+namespace onnxruntime {
+
+namespace {
+
+constexpr char kMagic[8] = {'O', 'R', 'T', 'M', 'P', 'C', 'F', '\0'};
+constexpr uint32_t kFormatVersion = 2;
+
+template <typename T>
+void Write(std::string& out, T value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteString(std::string& out, const std::string& value) {
+  Write<uint64_t>(out, value.size());
+  out.append(value);
+}
+
+// Bounds checked reads from a serialized buffer.
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  Status Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    ORT_RETURN_IF(size_ - offset_ < sizeof(T), "Memory pattern cache file is truncated.");
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return Status::OK();
+  }
+
+  Status ReadBytes(size_t num_bytes, const char*& bytes) {
+    ORT_RETURN_IF(size_ - offset_ < num_bytes, "Memory pattern cache file is truncated.");
+    bytes = data_ + offset_;
+    offset_ += num_bytes;
+    return Status::OK();
+  }
+
+  // Validates an element count read from the file against the bytes left, so that a corrupt
+  // count can not trigger a huge allocation.
+  Status ReadCount(size_t min_element_size, size_t& count) {
+    uint64_t value = 0;
+    ORT_RETURN_IF_ERROR(Read(value));
+    ORT_RETURN_IF(value > (size_ - offset_) / min_element_size, "Memory pattern cache file is corrupt.");
+    count = static_cast<size_t>(value);
+    return Status::OK();
+  }
+
+  bool AtEnd() const { return offset_ == size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+std::string SerializeEntry(gsl::span<const int> feed_ort_value_idxs, gsl::span<const TensorShapeVector> feed_shapes,
+                           const MemoryPatternGroup& patterns) {
+  ORT_ENFORCE(feed_ort_value_idxs.size() == feed_shapes.size());
+  std::string out;
+  Write<uint64_t>(out, feed_shapes.size());
+  for (size_t i = 0; i < feed_shapes.size(); ++i) {
+    const auto& shape = feed_shapes[i];
+    Write<int32_t>(out, feed_ort_value_idxs[i]);
+    Write<uint64_t>(out, shape.size());
+    for (int64_t dim : shape) {
+      Write<int64_t>(out, dim);
+    }
+  }
+
+  ORT_ENFORCE(patterns.locations.size() == patterns.patterns.size());
+  Write<uint64_t>(out, patterns.locations.size());
+  for (size_t i = 0; i < patterns.locations.size(); ++i) {
+    const OrtDevice& location = patterns.locations[i];
+    Write<int8_t>(out, location.Type());
+    Write<int8_t>(out, location.MemType());
+    Write<int16_t>(out, location.Id());
+    Write<uint64_t>(out, location.GetAlignment());
+
+    const MemoryPattern& pattern = patterns.patterns[i];
+    Write<uint64_t>(out, pattern.PeakSize());
+    // sort the blocks so the file content does not depend on the hash map iteration order
+    std::vector<std::pair<int, MemoryBlock>> blocks(pattern.GetPatternsMap().begin(), pattern.GetPatternsMap().end());
+    std::sort(blocks.begin(), blocks.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    Write<uint64_t>(out, blocks.size());
+    for (const auto& [ort_value_idx, block] : blocks) {
+      Write<int32_t>(out, ort_value_idx);
+      Write<uint64_t>(out, block.offset_);
+      Write<uint64_t>(out, block.size_);
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+Status MemoryPatternCache::DeserializeEntry(const std::string& data, Entry& entry) {
+  Reader reader(data.data(), data.size());
+
+  size_t num_feeds = 0;
+  ORT_RETURN_IF_ERROR(reader.ReadCount(sizeof(int32_t) + sizeof(uint64_t), num_feeds));
+  entry.feed_ort_value_idxs.resize(num_feeds);
+  entry.feed_shapes.resize(num_feeds);
+  for (size_t i = 0; i < num_feeds; ++i) {
+    ORT_RETURN_IF_ERROR(reader.Read(entry.feed_ort_value_idxs[i]));
+    auto& shape = entry.feed_shapes[i];
+    size_t rank = 0;
+    ORT_RETURN_IF_ERROR(reader.ReadCount(sizeof(int64_t), rank));
+    shape.resize(rank);
+    for (auto& dim : shape) {
+      ORT_RETURN_IF_ERROR(reader.Read(dim));
+    }
+  }
+
+  size_t num_locations = 0;
+  ORT_RETURN_IF_ERROR(reader.ReadCount(2 * sizeof(uint64_t), num_locations));
+  entry.patterns.locations.reserve(num_locations);
+  entry.patterns.patterns.reserve(num_locations);
+  for (size_t i = 0; i < num_locations; ++i) {
+    int8_t device_type = 0;
+    int8_t mem_type = 0;
+    int16_t device_id = 0;
+    uint64_t alignment = 0;
+    ORT_RETURN_IF_ERROR(reader.Read(device_type));
+    ORT_RETURN_IF_ERROR(reader.Read(mem_type));
+    ORT_RETURN_IF_ERROR(reader.Read(device_id));
+    ORT_RETURN_IF_ERROR(reader.Read(alignment));
+    entry.patterns.locations.emplace_back(device_type, mem_type, device_id, narrow<size_t>(alignment));
+
+    MemoryPattern pattern;
+    uint64_t peak_size = 0;
+    ORT_RETURN_IF_ERROR(reader.Read(peak_size));
+    pattern.peak_size_ = narrow<size_t>(peak_size);
+    size_t num_blocks = 0;
+    ORT_RETURN_IF_ERROR(reader.ReadCount(sizeof(int32_t) + 2 * sizeof(uint64_t), num_blocks));
+    pattern.patterns_.reserve(num_blocks);
+    for (size_t b = 0; b < num_blocks; ++b) {
+      int32_t ort_value_idx = 0;
+      uint64_t offset = 0;
+      uint64_t size = 0;
+      ORT_RETURN_IF_ERROR(reader.Read(ort_value_idx));
+      ORT_RETURN_IF_ERROR(reader.Read(offset));
+      ORT_RETURN_IF_ERROR(reader.Read(size));
+      ORT_RETURN_IF(offset > peak_size || size > peak_size - offset,
+                    "Memory pattern cache file has a block outside of the pattern.");
+      pattern.patterns_[ort_value_idx] = MemoryBlock(narrow<size_t>(offset), narrow<size_t>(size));
+    }
+    entry.patterns.patterns.push_back(std::move(pattern));
+  }
+
+  ORT_RETURN_IF_NOT(reader.AtEnd(), "Memory pattern cache file has trailing data in an entry.");
+  return Status::OK();
+}
+
+MemoryPatternCache::MemoryPatternCache(std::filesystem::path file_path, uint64_t plan_fingerprint)
+    : file_path_(std::move(file_path)), plan_fingerprint_(plan_fingerprint) {}
+
+uint64_t MemoryPatternCache::ComputePlanFingerprint(const SequentialExecutionPlan& plan,
+                                                    const OrtValueNameIdxMap& ort_value_name_idx_map) {
+  // Everything a pattern refers to: the OrtValue indices, how and where each value is allocated,
+  // and the order of the steps that determines the lifetimes.
+  std::string description;
+  WriteString(description, ORT_VERSION);
+
+  Write<uint64_t>(description, plan.allocation_plan.size());
+  for (size_t i = 0; i < plan.allocation_plan.size(); ++i) {
+    std::string name;
+    if (ort_value_name_idx_map.GetName(static_cast<int>(i), name).IsOK()) {
+      WriteString(description, name);
+    }
+    const auto& per_value = plan.allocation_plan[i];
+    Write<int32_t>(description, static_cast<int32_t>(per_value.alloc_kind));
+    Write<int8_t>(description, per_value.location.Type());
+    Write<int8_t>(description, per_value.location.MemType());
+    Write<int16_t>(description, per_value.location.Id());
+    Write<uint64_t>(description, per_value.location.GetAlignment());
+    Write<int32_t>(description, per_value.reused_buffer);
+  }
+
+  Write<uint64_t>(description, plan.execution_plan.size());
+  for (const auto& logic_stream : plan.execution_plan) {
+    Write<uint64_t>(description, logic_stream->steps_.size());
+    for (const auto& step : logic_stream->steps_) {
+      WriteString(description, step->ToString());
+    }
+  }
+
+  Write<uint64_t>(description, plan.release_actions.size());
+  for (const auto& action : plan.release_actions) {
+    Write<uint64_t>(description, action.value_index);
+    Write<uint64_t>(description, action.ref_count);
+  }
+
+  uint64_t hash[2] = {0, 0};
+  MurmurHash3::x86_128(description.data(), description.size(), 0, hash);
+  return hash[0];
+}
+
+Status MemoryPatternCache::ReadFile(std::vector<std::string>& serialized_entries) const {
+  serialized_entries.clear();
+
+  std::ifstream file(file_path_, std::ios::binary);
+  if (!file.is_open()) {
+    return Status::OK();
+  }
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ORT_RETURN_IF(file.bad(), "Failed to read memory pattern cache file ", file_path_);
+
+  Reader reader(content.data(), content.size());
+  const char* magic = nullptr;
+  uint32_t version = 0;
+  uint64_t fingerprint = 0;
+  ORT_RETURN_IF_ERROR(reader.ReadBytes(sizeof(kMagic), magic));
+  ORT_RETURN_IF(std::memcmp(magic, kMagic, sizeof(kMagic)) != 0,
+                "File ", file_path_, " is not a memory pattern cache file.");
+  ORT_RETURN_IF_ERROR(reader.Read(version));
+  ORT_RETURN_IF_ERROR(reader.Read(fingerprint));
+  if (version != kFormatVersion || fingerprint != plan_fingerprint_) {
+    // written by another build, or for a different model or set of execution providers
+    return Status::OK();
+  }
+
+  size_t num_entries = 0;
+  ORT_RETURN_IF_ERROR(reader.ReadCount(sizeof(uint64_t), num_entries));
+  std::vector<std::string> serialized(num_entries);
+  for (auto& entry : serialized) {
+    size_t num_bytes = 0;
+    const char* bytes = nullptr;
+    ORT_RETURN_IF_ERROR(reader.ReadCount(1, num_bytes));
+    ORT_RETURN_IF_ERROR(reader.ReadBytes(num_bytes, bytes));
+    entry.assign(bytes, num_bytes);
+  }
+  ORT_RETURN_IF_NOT(reader.AtEnd(), "Memory pattern cache file ", file_path_, " has trailing data.");
+
+  serialized_entries = std::move(serialized);
+  return Status::OK();
+}
+
+Status MemoryPatternCache::Load(std::vector<Entry>& entries) {
+  entries.clear();
+  entries_.clear();
+  dirty_ = false;
+
+  std::vector<std::string> serialized;
+  ORT_RETURN_IF_ERROR(ReadFile(serialized));
+  std::vector<Entry> loaded(serialized.size());
+  for (size_t i = 0; i < serialized.size(); ++i) {
+    ORT_RETURN_IF_ERROR(DeserializeEntry(serialized[i], loaded[i]));
+  }
+
+  entries = std::move(loaded);
+  entries_ = std::move(serialized);
+  return Status::OK();
+}
+
+void MemoryPatternCache::Add(gsl::span<const int> feed_ort_value_idxs,
+                             gsl::span<const TensorShapeVector> feed_shapes,
+                             const MemoryPatternGroup& patterns) {
+  entries_.push_back(SerializeEntry(feed_ort_value_idxs, feed_shapes, patterns));
+  dirty_ = true;
+}
+
+Status MemoryPatternCache::Flush() {
+  if (!dirty_) {
+    return Status::OK();
+  }
+
+  // Other sessions may have written patterns since the file was read. Merge them under the lock, so that the
+  // writers do not drop each other's patterns.
+  std::unique_ptr<cache_file_utils::FileLock> lock;
+  ORT_RETURN_IF_ERROR(cache_file_utils::FileLock::Acquire(file_path_, lock));
+
+  std::vector<std::string> merged;
+  // a file that can not be read is replaced, as Load would ignore it anyway
+  if (ReadFile(merged).IsOK()) {
+    std::unordered_set<std::string> in_file(merged.begin(), merged.end());
+    for (auto& entry : entries_) {
+      if (in_file.count(entry) == 0) {
+        merged.push_back(std::move(entry));
+      }
+    }
+  } else {
+    merged = std::move(entries_);
+  }
+  entries_ = std::move(merged);
+
+  ORT_RETURN_IF_ERROR(cache_file_utils::WriteFileAtomically(file_path_, [this](std::ostream& file) {
+    std::string content(kMagic, sizeof(kMagic));
+    Write<uint32_t>(content, kFormatVersion);
+    Write<uint64_t>(content, plan_fingerprint_);
+    Write<uint64_t>(content, entries_.size());
+    for (const auto& entry : entries_) {
+      WriteString(content, entry);
+    }
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+  }));
+  dirty_ = false;
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
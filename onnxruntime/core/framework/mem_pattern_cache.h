@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/common/inlined_containers.h"
+#include "core/framework/mem_pattern.h"
+#include "core/framework/tensor_shape.h"
+
+namespace onnxruntime {
+struct SequentialExecutionPlan;
+class OrtValueNameIdxMap;
+
+/**
+Persists the memory patterns of a session to a sidecar file, so that a later session of the same model
+(e.g. after a process restart) starts with the patterns already generated instead of paying for
+tracing them on the first run of every input shape.
+
+A pattern is only valid for the allocation plan it was generated with. The file therefore records a
+fingerprint of the plan and is ignored when it does not match the plan of the loading session.
+
+Adding a pattern only records it, the file is written by Flush. SessionState flushes the cache after each
+pattern it adds, so that the patterns are kept even if the process does not shut down cleanly.
+
+Sessions in several processes may share the file. Flush merges the entries in the file with its own under a
+lock next to the file, and replaces the file atomically.
+
+Not thread-safe, SessionState serializes access with the lock of its pattern cache.
+*/
+class MemoryPatternCache {
+ public:
+  struct Entry {
+    // OrtValue indices and shapes of the feeds the patterns were generated for
+    std::vector<int> feed_ort_value_idxs;
+    std::vector<TensorShapeVector> feed_shapes;
+    MemoryPatternGroup patterns;
+  };
+
+  MemoryPatternCache(std::filesystem::path file_path, uint64_t plan_fingerprint);
+
+  // Computes a fingerprint of the allocation plan that is stable across processes.
+  static uint64_t ComputePlanFingerprint(const SequentialExecutionPlan& plan,
+                                         const OrtValueNameIdxMap& ort_value_name_idx_map);
+
+  const std::filesystem::path& GetFilePath() const noexcept { return file_path_; }
+
+  // Reads the entries in the file. A missing file, or a file written for a different plan, yields no entries.
+  // The entries that are read are kept, so that they are preserved when the file is written again.
+  Status Load(std::vector<Entry>& entries);
+
+  // Adds an entry, which is written to the file by the next Flush.
+  void Add(gsl::span<const int> feed_ort_value_idxs, gsl::span<const TensorShapeVector> feed_shapes,
+           const MemoryPatternGroup& patterns);
+
+  // Rewrites the file if entries were added since it was last read or written, keeping the entries other
+  // sessions wrote to it in the meantime.
+  Status Flush();
+
+ private:
+  // Reads the serialized entries in the file, if it exists and was written for the plan.
+  Status ReadFile(std::vector<std::string>& serialized_entries) const;
+  static Status DeserializeEntry(const std::string& data, Entry& entry);
+
+  std::filesystem::path file_path_;
+  uint64_t plan_fingerprint_;
+  // serialized entries, in the order they were added
+  std::vector<std::string> entries_;
+  // whether entries_ has entries that are not in the file yet
+  bool dirty_ = false;
+};
+
+}  // namespace onnxruntime
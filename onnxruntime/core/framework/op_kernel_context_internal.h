@@ -39,14 +39,25 @@ class OpKernelContextInternal : public OpKernelContext {
 
 #if !defined(ORT_MINIMAL_BUILD)
     if (session_state_.GetNodeStatsRecorder() != nullptr) {
-      auto alloc = OpKernelContext::GetAllocator(kernel.GetDevice(OrtMemTypeDefault));
-      if (alloc != nullptr) {
-        accounting_allocator_ = std::make_shared<AccountingAllocator>(std::move(alloc));
-      }
+      EnableAllocatorStats();
     }
 #endif
   }
 
+#if !defined(ORT_MINIMAL_BUILD)
+  // Account for the temporary allocations of the kernel so that they can be retrieved with GetAllocatorStats.
+  // Must be called before the kernel is computed.
+  void EnableAllocatorStats() {
+    if (accounting_allocator_ != nullptr) {
+      return;
+    }
+    AllocatorPtr alloc;
+    if (OpKernelContext::GetTempSpaceAllocator(&alloc).IsOK()) {
+      accounting_allocator_ = std::make_shared<AccountingAllocator>(std::move(alloc));
+    }
+  }
+#endif
+
   bool GetUseDeterministicCompute() const override {
     return session_state_.GetUseDeterministicCompute();
   }
@@ -0,0 +1,96 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/paged_kv_cache.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "core/common/safeint.h"
+#include "core/framework/tensor.h"
+
+namespace onnxruntime {
+
+PagedKVCacheManager::PagedKVCacheManager(size_t num_pages, size_t page_size, size_t max_pages_per_sequence)
+    : page_size_(page_size), max_pages_per_sequence_(max_pages_per_sequence) {
+  ORT_ENFORCE(num_pages > 0 && num_pages <= static_cast<size_t>(std::numeric_limits<int32_t>::max()),
+              "Invalid number of pages: ", num_pages);
+  ORT_ENFORCE(page_size > 0, "The page size shall be positive.");
+  ORT_ENFORCE(max_pages_per_sequence > 0, "The maximum number of pages per sequence shall be positive.");
+
+  // the lowest page index is on top of the stack
+  free_pages_.resize(num_pages);
+  for (size_t i = 0; i < num_pages; ++i) {
+    free_pages_[i] = static_cast<int32_t>(num_pages - 1 - i);
+  }
+}
+
+Status PagedKVCacheManager::CreatePagePool(MLDataType element_type, size_t num_pages, size_t kv_num_heads,
+                                           size_t page_size, size_t row_size, AllocatorPtr allocator,
+                                           OrtValue& pool) {
+  ORT_RETURN_IF(allocator == nullptr, "An allocator is required to create a page pool.");
+  const TensorShape shape({SafeInt<int64_t>(num_pages), SafeInt<int64_t>(kv_num_heads),
+                           SafeInt<int64_t>(page_size), SafeInt<int64_t>(row_size)});
+  Tensor::InitOrtValue(element_type, shape, std::move(allocator), pool);
+  return Status::OK();
+}
+
+Status PagedKVCacheManager::Reserve(int64_t sequence_id, size_t sequence_length) {
+  const size_t page_count = (sequence_length + page_size_ - 1) / page_size_;
+  if (page_count > max_pages_per_sequence_) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Sequence length ", sequence_length,
+                           " exceeds the maximum of ", max_pages_per_sequence_ * page_size_, " tokens.");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& pages = sequence_pages_[sequence_id];
+  if (page_count > pages.size()) {
+    const size_t new_page_count = page_count - pages.size();
+    if (new_page_count > free_pages_.size()) {
+      if (pages.empty()) {
+        sequence_pages_.erase(sequence_id);
+      }
+      return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Out of k-v cache pages: ", new_page_count, " requested, ",
+                             free_pages_.size(), " free.");
+    }
+    pages.insert(pages.end(), free_pages_.rbegin(),
+                 free_pages_.rbegin() + static_cast<std::ptrdiff_t>(new_page_count));
+    free_pages_.resize(free_pages_.size() - new_page_count);
+  }
+  return Status::OK();
+}
+
+void PagedKVCacheManager::Release(int64_t sequence_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sequence_pages_.find(sequence_id);
+  if (it == sequence_pages_.end()) {
+    return;
+  }
+  // push the last pages of the sequence first, so its first page is reused first
+  free_pages_.insert(free_pages_.end(), it->second.rbegin(), it->second.rend());
+  sequence_pages_.erase(it);
+}
+
+Status PagedKVCacheManager::GetBlockTable(gsl::span<const int64_t> sequence_ids,
+                                          gsl::span<int32_t> block_table) const {
+  ORT_RETURN_IF_NOT(block_table.size() == sequence_ids.size() * max_pages_per_sequence_,
+                    "The block table shall have ", sequence_ids.size() * max_pages_per_sequence_,
+                    " entries, got ", block_table.size());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::fill(block_table.begin(), block_table.end(), 0);
+  for (size_t i = 0; i < sequence_ids.size(); ++i) {
+    auto it = sequence_pages_.find(sequence_ids[i]);
+    ORT_RETURN_IF(it == sequence_pages_.end(), "Unknown sequence id ", sequence_ids[i]);
+    std::copy(it->second.begin(), it->second.end(),
+              block_table.begin() + static_cast<std::ptrdiff_t>(i * max_pages_per_sequence_));
+  }
+  return Status::OK();
+}
+
+size_t PagedKVCacheManager::GetNumFreePages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_pages_.size();
+}
+
+}  // namespace onnxruntime
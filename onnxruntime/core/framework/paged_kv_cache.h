@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <gsl/gsl>
+
+#include "core/common/common.h"
+#include "core/framework/allocator.h"
+#include "core/framework/data_types.h"
+#include "core/framework/ort_value.h"
+
+namespace onnxruntime {
+
+/**
+Hands out the pages of a paged k-v cache to concurrent generation streams.
+
+The k-v cache of a layer is a pool of fixed-size pages for key and one for value, tensors of shape
+(num_pages, kv_num_heads, page_size, head_size) created with CreatePagePool(). A sequence only holds the pages
+for the tokens it has, so memory is reserved in proportion to the actual sequence lengths instead of the maximum
+sequence length of every stream.
+
+The block table of a sequence maps page i of the sequence, its tokens i * page_size to (i + 1) * page_size - 1,
+to a page of the pool. The block tables of the sequences of a batch are the block_table input of
+GroupQueryAttention. The same pages are used in the pools of all the layers.
+
+Thread-safe, so that the streams served by a process can share one manager.
+*/
+class PagedKVCacheManager {
+ public:
+  PagedKVCacheManager(size_t num_pages, size_t page_size, size_t max_pages_per_sequence);
+
+  // Creates the pool of pages of key or value of a layer. row_size is head_size, or head_size / 2 for a cache of
+  // int4 values packed in pairs.
+  static Status CreatePagePool(MLDataType element_type, size_t num_pages, size_t kv_num_heads, size_t page_size,
+                               size_t row_size, AllocatorPtr allocator, OrtValue& pool);
+
+  // Makes the sequence hold the pages for sequence_length tokens, taking free pages as needed. A new sequence id
+  // adds a sequence. Fails without taking any page if there are not enough free pages.
+  Status Reserve(int64_t sequence_id, size_t sequence_length);
+
+  // Returns the pages of the sequence to the free pages.
+  void Release(int64_t sequence_id);
+
+  // Writes the block tables of the sequences, a row of max_pages_per_sequence entries each. Unused entries are 0.
+  Status GetBlockTable(gsl::span<const int64_t> sequence_ids, gsl::span<int32_t> block_table) const;
+
+  size_t GetNumFreePages() const;
+
+  size_t GetPageSize() const noexcept { return page_size_; }
+  size_t GetMaxPagesPerSequence() const noexcept { return max_pages_per_sequence_; }
+
+ private:
+  const size_t page_size_;
+  const size_t max_pages_per_sequence_;
+
+  mutable std::mutex mutex_;
+  // used as a stack, so that recently released pages, which are more likely to be cached, are reused first
+  std::vector<int32_t> free_pages_;
+  std::unordered_map<int64_t, std::vector<int32_t>> sequence_pages_;
+};
+
+}  // namespace onnxruntime
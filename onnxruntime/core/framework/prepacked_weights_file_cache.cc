@@ -0,0 +1,279 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/prepacked_weights_file_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "onnxruntime_config.h"
+#include "core/common/cpuid_info.h"
+#include "core/common/narrow.h"
+#include "core/framework/cache_file_utils.h"
+#include "core/framework/murmurhash3.h"
+
+namespace onnxruntime {
+
+namespace {
+
+constexpr char kMagic[8] = {'O', 'R', 'T', 'P', 'W', 'C', 'F', '\0'};
+constexpr uint32_t kFormatVersion = 2;
+// pre-packed buffers are stored at this alignment in the file, the mapping itself is page aligned
+constexpr size_t kBufferAlignment = 64;
+
+template <typename T>
+void Write(std::string& out, T value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteString(std::string& out, const std::string& value) {
+  Write<uint64_t>(out, value.size());
+  out.append(value);
+}
+
+// Checksum of a pre-packed buffer, so that Load can detect a buffer that does not hold what the index says.
+uint64_t ComputeBufferChecksum(gsl::span<const std::byte> buffer) {
+  uint64_t hash[2] = {0, 0};
+  MurmurHash3::x86_128(buffer.data(), buffer.size(), 0, hash);
+  return hash[0];
+}
+
+size_t AlignBufferOffset(size_t offset) {
+  return (offset + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment;
+}
+
+// Bounds checked reads from the mapped file.
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  Status Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    ORT_RETURN_IF(size_ - offset_ < sizeof(T), "Pre-packed weights cache file is truncated.");
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return Status::OK();
+  }
+
+  Status ReadBytes(size_t num_bytes, const char*& bytes) {
+    ORT_RETURN_IF(size_ - offset_ < num_bytes, "Pre-packed weights cache file is truncated.");
+    bytes = data_ + offset_;
+    offset_ += num_bytes;
+    return Status::OK();
+  }
+
+  // Validates an element count read from the file against the bytes left, so that a corrupt
+  // count can not trigger a huge allocation.
+  Status ReadCount(size_t min_element_size, size_t& count) {
+    uint64_t value = 0;
+    ORT_RETURN_IF_ERROR(Read(value));
+    ORT_RETURN_IF(value > (size_ - offset_) / min_element_size, "Pre-packed weights cache file is corrupt.");
+    count = static_cast<size_t>(value);
+    return Status::OK();
+  }
+
+  // Reads the location of a buffer in the data section of the file and verifies its checksum.
+  Status ReadBuffer(gsl::span<const std::byte>& buffer) {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t checksum = 0;
+    ORT_RETURN_IF_ERROR(Read(offset));
+    ORT_RETURN_IF_ERROR(Read(size));
+    ORT_RETURN_IF_ERROR(Read(checksum));
+    ORT_RETURN_IF(offset > size_ || size > size_ - offset, "Pre-packed weights cache file has a buffer outside of it.");
+    buffer = gsl::make_span(reinterpret_cast<const std::byte*>(data_ + offset), narrow<size_t>(size));
+    ORT_RETURN_IF(ComputeBufferChecksum(buffer) != checksum,
+                  "Pre-packed weights cache file has a buffer that does not match its checksum.");
+    return Status::OK();
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+}  // namespace
+
+PrepackedWeightsFileCache::PrepackedWeightsFileCache(std::filesystem::path file_path, uint64_t cpu_fingerprint)
+    : file_path_(std::move(file_path)), cpu_fingerprint_(cpu_fingerprint) {}
+
+uint64_t PrepackedWeightsFileCache::ComputeCpuFingerprint() {
+  const auto& cpu_info = CPUIDInfo::GetCPUIDInfo();
+  std::string description;
+  WriteString(description, ORT_VERSION);
+  Write<uint32_t>(description, static_cast<uint32_t>(sizeof(void*)));
+  WriteString(description, std::string(cpu_info.GetCPUVendor()));
+  const bool features[] = {
+      cpu_info.HasAMX_BF16(), cpu_info.HasAVX(), cpu_info.HasAVX2(), cpu_info.HasAVX512f(),
+      cpu_info.HasAVX512_BF16(), cpu_info.HasAVX512Skylake(), cpu_info.HasF16C(), cpu_info.HasSSE3(),
+      cpu_info.HasSSE4_1(), cpu_info.HasArmNeonDot(), cpu_info.HasArmNeon_I8MM(), cpu_info.HasArmSVE_I8MM(),
+      cpu_info.HasArmNeon_BF16(), cpu_info.HasFp16VectorAcceleration()};
+  for (bool feature : features) {
+    Write<uint8_t>(description, feature ? 1 : 0);
+  }
+
+  uint64_t hash[2] = {0, 0};
+  MurmurHash3::x86_128(description.data(), description.size(), 0, hash);
+  return hash[0];
+}
+
+Status PrepackedWeightsFileCache::Load() {
+  entries_.clear();
+  keys_.clear();
+  added_buffers_.clear();
+  has_new_entries_ = false;
+  mapped_file_.reset();
+
+  std::error_code ec;
+  const auto file_size = std::filesystem::file_size(file_path_, ec);
+  if (ec) {
+    return Status::OK();
+  }
+  ORT_RETURN_IF(file_size < sizeof(kMagic), "File ", file_path_, " is not a pre-packed weights cache file.");
+
+  Env::MappedMemoryPtr mapped_file;
+  ORT_RETURN_IF_ERROR(Env::Default().MapFileIntoMemory(file_path_.c_str(), 0, narrow<size_t>(file_size),
+                                                       mapped_file));
+
+  Reader reader(mapped_file.get(), narrow<size_t>(file_size));
+  const char* magic = nullptr;
+  uint32_t version = 0;
+  uint64_t fingerprint = 0;
+  ORT_RETURN_IF_ERROR(reader.ReadBytes(sizeof(kMagic), magic));
+  ORT_RETURN_IF(std::memcmp(magic, kMagic, sizeof(kMagic)) != 0,
+                "File ", file_path_, " is not a pre-packed weights cache file.");
+  ORT_RETURN_IF_ERROR(reader.Read(version));
+  ORT_RETURN_IF_ERROR(reader.Read(fingerprint));
+  if (version != kFormatVersion || fingerprint != cpu_fingerprint_) {
+    // written by another build, or on a CPU for which MLAS packs differently
+    return Status::OK();
+  }
+
+  std::unordered_map<std::string, Entry> entries;
+  std::vector<std::string> keys;
+  size_t num_entries = 0;
+  ORT_RETURN_IF_ERROR(reader.ReadCount(2 * sizeof(uint64_t), num_entries));
+  keys.reserve(num_entries);
+  for (size_t i = 0; i < num_entries; ++i) {
+    size_t key_size = 0;
+    const char* key_bytes = nullptr;
+    ORT_RETURN_IF_ERROR(reader.ReadCount(1, key_size));
+    ORT_RETURN_IF_ERROR(reader.ReadBytes(key_size, key_bytes));
+    std::string key(key_bytes, key_size);
+
+    Entry entry;
+    size_t num_inputs = 0;
+    ORT_RETURN_IF_ERROR(reader.ReadCount(sizeof(int32_t) + sizeof(uint8_t) + sizeof(uint64_t), num_inputs));
+    entry.resize(num_inputs);
+    for (auto& input : entry) {
+      int32_t input_idx = 0;
+      uint8_t is_packed = 0;
+      size_t num_buffers = 0;
+      ORT_RETURN_IF_ERROR(reader.Read(input_idx));
+      ORT_RETURN_IF_ERROR(reader.Read(is_packed));
+      ORT_RETURN_IF_ERROR(reader.ReadCount(3 * sizeof(uint64_t), num_buffers));
+      input.input_idx = input_idx;
+      input.is_packed = is_packed != 0;
+      input.buffers.resize(num_buffers);
+      for (auto& buffer : input.buffers) {
+        ORT_RETURN_IF_ERROR(reader.ReadBuffer(buffer));
+      }
+    }
+
+    if (entries.emplace(key, std::move(entry)).second) {
+      keys.push_back(std::move(key));
+    }
+  }
+
+  mapped_file_ = std::move(mapped_file);
+  entries_ = std::move(entries);
+  keys_ = std::move(keys);
+  return Status::OK();
+}
+
+const PrepackedWeightsFileCache::Entry* PrepackedWeightsFileCache::Find(const std::string& key) const {
+  auto it = entries_.find(key);
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+void PrepackedWeightsFileCache::Add(const std::string& key, const Entry& entry) {
+  if (entries_.count(key) != 0) {
+    return;
+  }
+
+  Entry copy = entry;
+  for (auto& input : copy) {
+    for (auto& buffer : input.buffers) {
+      auto& data = added_buffers_.emplace_back(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+      buffer = gsl::make_span(reinterpret_cast<const std::byte*>(data.data()), data.size());
+    }
+  }
+
+  entries_.emplace(key, std::move(copy));
+  keys_.push_back(key);
+  has_new_entries_ = true;
+}
+
+Status PrepackedWeightsFileCache::Save() {
+  // The index has a fixed size for a given set of entries, so it's written once to compute where
+  // the data section starts and then again with the offsets and checksums of the buffers in it.
+  auto write_index = [this](std::string& out, size_t data_offset, bool with_checksums) {
+    Write<uint64_t>(out, keys_.size());
+    for (const auto& key : keys_) {
+      WriteString(out, key);
+      const Entry& entry = entries_.at(key);
+      Write<uint64_t>(out, entry.size());
+      for (const auto& input : entry) {
+        Write<int32_t>(out, input.input_idx);
+        Write<uint8_t>(out, input.is_packed ? 1 : 0);
+        Write<uint64_t>(out, input.buffers.size());
+        for (const auto& buffer : input.buffers) {
+          data_offset = AlignBufferOffset(data_offset);
+          Write<uint64_t>(out, data_offset);
+          Write<uint64_t>(out, buffer.size());
+          Write<uint64_t>(out, with_checksums ? ComputeBufferChecksum(buffer) : 0);
+          data_offset += buffer.size();
+        }
+      }
+    }
+  };
+
+  std::string header(kMagic, sizeof(kMagic));
+  Write<uint32_t>(header, kFormatVersion);
+  Write<uint64_t>(header, cpu_fingerprint_);
+
+  std::string index;
+  write_index(index, 0, false);
+  const size_t data_offset = header.size() + index.size();
+  index.clear();
+  write_index(index, data_offset, true);
+
+  // The cache file is shared by processes, each of them writes its own temporary file and renames it into place.
+  // The buffers of loaded entries point into the mapping of the old file, which remains valid after the file is
+  // replaced.
+  ORT_RETURN_IF_ERROR(cache_file_utils::WriteFileAtomically(file_path_, [&](std::ostream& file) {
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(index.data(), static_cast<std::streamsize>(index.size()));
+
+    static const char padding[kBufferAlignment] = {};
+    size_t offset = data_offset;
+    for (const auto& key : keys_) {
+      for (const auto& input : entries_.at(key)) {
+        for (const auto& buffer : input.buffers) {
+          const size_t aligned_offset = AlignBufferOffset(offset);
+          file.write(padding, static_cast<std::streamsize>(aligned_offset - offset));
+          file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+          offset = aligned_offset + buffer.size();
+        }
+      }
+    }
+  }));
+  has_new_entries_ = false;
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
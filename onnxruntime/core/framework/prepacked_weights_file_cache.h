@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gsl/gsl>
+
+#include "core/common/common.h"
+#include "core/platform/env.h"
+
+namespace onnxruntime {
+
+/**
+Persists the pre-packed weights of kernels to a file, so that sessions in later processes can restore the
+pre-packed state of a kernel from the memory mapped file instead of calling PrePack() again.
+
+An entry holds the pre-packed buffers of all constant inputs of one kernel. It is looked up with a key that the
+session computes from the node (op type, version, attributes, input types) and the contents of its constant
+inputs. The packed layout also depends on the instructions MLAS selects at runtime, so the file records a
+fingerprint of the CPU features and build and is ignored when it does not match the loading process.
+
+The file may be shared by processes. Each writer replaces it with a complete file of its own, and every buffer is
+stored with a checksum that Load verifies, so a kernel never restores buffers that were not written for its entry.
+
+Buffers returned by Find() stay valid for the lifetime of the cache. Not thread-safe, the session only uses it
+while pre-packing, which is sequential.
+*/
+class PrepackedWeightsFileCache {
+ public:
+  struct CachedInput {
+    int input_idx = 0;
+    bool is_packed = false;
+    std::vector<gsl::span<const std::byte>> buffers;
+  };
+
+  // the cached inputs of one kernel
+  using Entry = std::vector<CachedInput>;
+
+  PrepackedWeightsFileCache(std::filesystem::path file_path, uint64_t cpu_fingerprint);
+
+  // Computes a fingerprint of the CPU features reported by CPUIDInfo and of the build.
+  static uint64_t ComputeCpuFingerprint();
+
+  const std::filesystem::path& GetFilePath() const noexcept { return file_path_; }
+
+  // Memory maps the file and reads its index. A missing file, or a file written on a different CPU or by a
+  // different build, yields no entries.
+  Status Load();
+
+  // Returns nullptr if there is no entry for the key.
+  const Entry* Find(const std::string& key) const;
+
+  // Adds an entry, copying the contents of its buffers. An existing entry for the key is kept.
+  void Add(const std::string& key, const Entry& entry);
+
+  bool HasNewEntries() const noexcept { return has_new_entries_; }
+
+  // Rewrites the file with the loaded and the added entries. Entries that another process added to the file since
+  // it was loaded are not kept.
+  Status Save();
+
+  size_t GetNumberOfEntries() const noexcept { return entries_.size(); }
+
+ private:
+  std::filesystem::path file_path_;
+  uint64_t cpu_fingerprint_;
+  Env::MappedMemoryPtr mapped_file_;
+  std::unordered_map<std::string, Entry> entries_;
+  // keys in the order they were loaded or added, so the file content is deterministic
+  std::vector<std::string> keys_;
+  // copies of the buffers of added entries
+  std::deque<std::string> added_buffers_;
+  bool has_new_entries_ = false;
+};
+
+}  // namespace onnxruntime
@@ -141,6 +141,11 @@ static void CalculateTotalInputSizes(const OpKernelContextInternal* op_kernel_co
 
 class KernelScope;
 
+// Whether the run of the main graph that is executing on this thread is sampled by the SamplingProfiler.
+// Control flow nodes execute their subgraphs on the calling thread, so the subgraph executions follow the
+// sampling decision of the main graph run.
+static thread_local bool sampled_run_on_thread = false;
+
 #ifdef CONCURRENCY_VISUALIZER
 std::string ComposeSeriesName(const GraphViewer& graph_viewer) {
   char series_name[MaxSeriesNameLengthInChars] = "MainGraph";
@@ -155,12 +160,9 @@ std::string ComposeSeriesName(const GraphViewer& graph_viewer) {
 class SessionScope {
  public:
   friend class KernelScope;
-  SessionScope(const SessionState& session_state, const ExecutionFrame& frame)
-      : session_state_(session_state)
-#if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
-        ,
+  SessionScope(const SessionState& session_state, ExecutionFrame& frame)
+      : session_state_(session_state),
         frame_(frame)
-#endif
 #ifdef CONCURRENCY_VISUALIZER
         ,
         series_(ComposeSeriesName(session_state.GetGraphViewer()))
@@ -181,6 +183,23 @@ class SessionScope {
       session_start_ = session_state.Profiler().Start();
     }
 
+    sampling_profiler_ = session_state_.GetSamplingProfiler();
+    if (sampling_profiler_ != nullptr) {
+      if (session_state_.GetGraphViewer().IsSubgraph()) {
+        sampled_ = sampled_run_on_thread;
+      } else {
+        sampled_ = sampling_profiler_->ShouldSampleRun();
+        outer_sampled_run_on_thread_ = sampled_run_on_thread;
+        sampled_run_on_thread = sampled_;
+        sampled_start_ = std::chrono::steady_clock::now();
+      }
+#if !defined(ORT_MINIMAL_BUILD)
+      if (sampled_) {
+        frame.RecordDynamicAllocations();
+      }
+#endif
+    }
+
     auto& logger = session_state_.Logger();
     VLOGS(logger, 0) << "Begin execution";
     const SequentialExecutionPlan& seq_exec_plan = *session_state_.GetExecutionPlan();
@@ -190,9 +209,6 @@ class SessionScope {
 // Enable TRACE_EXECUTION compile flag to dump execution plan
 #if defined(TRACE_EXECUTION)
     std::cout << std::make_pair(&seq_exec_plan, &session_state) << std::endl;
-#endif
-#if defined(ORT_MINIMAL_BUILD) || !defined(ORT_MEMORY_PROFILE)
-    ORT_UNUSED_PARAMETER(frame);
 #endif
   }
 
@@ -228,6 +244,13 @@ class SessionScope {
     if (session_state_.Profiler().IsEnabled()) {
       session_state_.Profiler().EndTimeAndRecordEvent(profiling::SESSION_EVENT, "SequentialExecutor::Execute", session_start_);
     }
+
+    if (sampling_profiler_ != nullptr && !session_state_.GetGraphViewer().IsSubgraph()) {
+      if (sampled_) {
+        sampling_profiler_->RecordRun(std::chrono::steady_clock::now() - sampled_start_);
+      }
+      sampled_run_on_thread = outer_sampled_run_on_thread_;
+    }
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
     auto& logger = session_state_.Logger();
     for (auto i : frame_.GetStaticMemorySizeInfo()) {
@@ -255,9 +278,11 @@ class SessionScope {
  private:
   const SessionState& session_state_;
   TimePoint session_start_;
-#if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
+  profiling::SamplingProfiler* sampling_profiler_ = nullptr;
+  bool sampled_ = false;
+  bool outer_sampled_run_on_thread_ = false;
+  std::chrono::steady_clock::time_point sampled_start_;
   const ExecutionFrame& frame_;
-#endif
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   // Whether memory profiler need create events and flush to file.
   // For partial graph run, when the last subgraph of the whole graph is executing, we need flush to file.
@@ -354,11 +379,23 @@ class KernelScope {
                                input_activation_sizes_, input_parameter_sizes_,
                                node_name_, input_type_shape_);
     }
+
+    if (session_scope_.sampled_) {
+#if !defined(ORT_MINIMAL_BUILD)
+      kernel_context_.EnableAllocatorStats();
+#endif
+      outer_parallel_loop_stats_ = concurrency::ThreadPool::SetParallelLoopStatsCollector(&parallel_loop_stats_);
+      sampled_begin_time_ = std::chrono::steady_clock::now();
+    }
   }
 
   ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(KernelScope);
 
   ~KernelScope() {
+    if (session_scope_.sampled_) {
+      RecordSampledNodeEvent();
+    }
+
 #ifdef ENABLE_NVTX_PROFILE
     node_compute_range_.End();
 #endif
@@ -405,7 +442,44 @@ class KernelScope {
   }  //~KernelScope
 
  private:
+  void RecordSampledNodeEvent() {
+    profiling::NodeExecutionMeasurement measurement;
+    measurement.start = sampled_begin_time_;
+    measurement.duration = std::chrono::steady_clock::now() - sampled_begin_time_;
+
+    concurrency::ThreadPool::SetParallelLoopStatsCollector(outer_parallel_loop_stats_);
+    measurement.parallel_loops = parallel_loop_stats_.num_loops;
+    measurement.requested_parallelism = parallel_loop_stats_.requested_parallelism;
+    measurement.achieved_parallelism = parallel_loop_stats_.achieved_parallelism;
+    if (outer_parallel_loop_stats_ != nullptr) {
+      // a control flow node accounts for the loops of the nodes of its subgraphs, as it does for their latency
+      outer_parallel_loop_stats_->num_loops += parallel_loop_stats_.num_loops;
+      outer_parallel_loop_stats_->requested_parallelism += parallel_loop_stats_.requested_parallelism;
+      outer_parallel_loop_stats_->achieved_parallelism += parallel_loop_stats_.achieved_parallelism;
+    }
+
+#if !defined(ORT_MINIMAL_BUILD)
+    AllocatorStats temp_stats;
+    if (kernel_context_.GetAllocatorStats(temp_stats)) {
+      measurement.bytes_allocated += static_cast<uint64_t>(temp_stats.total_allocated_bytes);
+    }
+    for (int i = 0, lim = kernel_context_.OutputCount(); i < lim; ++i) {
+      auto dynamic_allocation = session_scope_.frame_.GetOrtValueDynamicAllocation(
+          kernel_context_.GetOrtValueIndexForOutput(i));
+      if (dynamic_allocation.has_value()) {
+        measurement.bytes_allocated += *dynamic_allocation;
+      }
+    }
+#endif
+
+    session_scope_.sampling_profiler_->RecordNodeEvent(
+        session_state_.GetSamplingProfilerNodeOffset() + kernel_.Node().Index(), measurement);
+  }
+
   TimePoint kernel_begin_time_;
+  std::chrono::steady_clock::time_point sampled_begin_time_;
+  concurrency::ThreadPool::ParallelLoopStats parallel_loop_stats_;
+  concurrency::ThreadPool::ParallelLoopStats* outer_parallel_loop_stats_ = nullptr;
   SessionScope& session_scope_;
   const SessionState& session_state_;
   std::string node_name_;
@@ -663,7 +737,7 @@ onnxruntime::Status ExecuteThePlan(const SessionState& session_state, gsl::span<
     if (all_tensors) {
       MemoryPatternGroup mem_patterns;
       ORT_RETURN_IF_ERROR(ctx.GetExecutionFrame().GeneratePatterns(mem_patterns));
-      ORT_RETURN_IF_ERROR(session_state.UpdateMemoryPatternGroupCache(feeds, std::move(mem_patterns)));
+      ORT_RETURN_IF_ERROR(session_state.UpdateMemoryPatternGroupCache(feeds, feed_mlvalue_idxs, std::move(mem_patterns)));
     }
   }
 
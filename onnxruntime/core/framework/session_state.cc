@@ -3,18 +3,25 @@
 
 #include "core/framework/session_state.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
 #include <sstream>
 
 #include <mutex>
 #include "core/common/logging/logging.h"
+#include "core/common/parse_string.h"
 #include "core/common/safeint.h"
+#include "core/common/string_utils.h"
 #include "core/flatbuffers/schema/ort.fbs.h"
 #include "core/framework/allocator.h"
+#include "core/framework/murmurhash3.h"
 #include "core/framework/node_index_info.h"
 #include "core/framework/op_kernel.h"
 #include "core/framework/ort_value_pattern_planner.h"
 #include "core/framework/prepacked_weights_container.h"
 #include "core/framework/session_state_utils.h"
+#include "core/framework/tensorprotoutils.h"
 #include "core/framework/utils.h"
 #include "core/providers/cpu/controlflow/utils.h"
 #include "core/session/onnxruntime_session_options_config_keys.h"
@@ -75,6 +82,30 @@ class StreamCommandHandleRegistryImpl : public IStreamCommandHandleRegistry {
 };
 #endif
 
+// Parses "dim_param:bound,bound,...;dim_param:..." into sorted upper bounds per symbolic dimension.
+static Status ParseMemoryPatternShapeBuckets(const std::string& config,
+                                             InlinedHashMap<std::string, std::vector<int64_t>>& shape_buckets) {
+  for (const auto dim_buckets : utils::SplitString(config, ";")) {
+    const auto name_and_bounds = utils::SplitString(dim_buckets, ":", true);
+    ORT_RETURN_IF_NOT(name_and_bounds.size() == 2 && !name_and_bounds[0].empty(),
+                      "Invalid memory pattern shape buckets '", dim_buckets,
+                      "'. Expected 'dim_param:upper_bound,upper_bound,...'.");
+    std::vector<int64_t> upper_bounds;
+    for (const auto bound_str : utils::SplitString(name_and_bounds[1], ",")) {
+      int64_t bound = 0;
+      ORT_RETURN_IF_NOT(TryParseStringWithClassicLocale(bound_str, bound) && bound > 0,
+                        "Invalid upper bound '", bound_str, "' in memory pattern shape buckets for ",
+                        name_and_bounds[0]);
+      upper_bounds.push_back(bound);
+    }
+    ORT_RETURN_IF(upper_bounds.empty(), "No upper bounds in memory pattern shape buckets for ", name_and_bounds[0]);
+    std::sort(upper_bounds.begin(), upper_bounds.end());
+    upper_bounds.erase(std::unique(upper_bounds.begin(), upper_bounds.end()), upper_bounds.end());
+    shape_buckets[std::string(name_and_bounds[0])] = std::move(upper_bounds);
+  }
+  return Status::OK();
+}
+
 SessionState::SessionState(Graph& graph,
                            const ExecutionProviders& execution_providers,
                            concurrency::ThreadPool* thread_pool,
@@ -103,6 +134,13 @@ SessionState::SessionState(Graph& graph,
 {
   enable_mem_pattern_ = sess_options_.enable_mem_pattern &&
                         sess_options_.execution_mode == ExecutionMode::ORT_SEQUENTIAL;
+  bucket_mem_pattern_dims_ =
+      sess_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsMemoryPatternDimBucketing, "0") == "1";
+  const std::string shape_buckets =
+      sess_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsMemoryPatternShapeBuckets, "");
+  if (!shape_buckets.empty()) {
+    ORT_THROW_IF_ERROR(ParseMemoryPatternShapeBuckets(shape_buckets, mem_pattern_shape_buckets_));
+  }
   if (parent_allocators) {
     allocators_ = parent_allocators;
   } else {
@@ -416,10 +454,157 @@ static std::string GenerateKeyForPrepackedWeightsMap(const std::string& op_type,
   return ss_1.str();
 }
 
+static std::string GenerateKeyForPrepackedWeightsFileCache(const Node& node,
+                                                           gsl::span<const std::pair<int, const Tensor*>> constant_inputs) {
+  // Everything the pre-packed state of the kernel may depend on: the kernel that was selected for the node,
+  // its attributes, and the contents of its constant inputs.
+  std::ostringstream ss;
+  ss << node.Domain() << ":" << node.OpType() << ":" << node.SinceVersion() << ":" << node.GetExecutionProviderType();
+  for (const auto* input_def : node.InputDefs()) {
+    ss << ";" << (input_def->Exists() && input_def->Type() != nullptr ? *input_def->Type() : "");
+  }
+
+  std::vector<const std::string*> attribute_names;
+  attribute_names.reserve(node.GetAttributes().size());
+  for (const auto& attribute : node.GetAttributes()) {
+    attribute_names.push_back(&attribute.first);
+  }
+  std::sort(attribute_names.begin(), attribute_names.end(),
+            [](const std::string* a, const std::string* b) { return *a < *b; });
+  for (const auto* name : attribute_names) {
+    ss << ";" << *name << "=" << node.GetAttributes().at(*name).SerializeAsString();
+  }
+
+  for (const auto& [input_idx, tensor] : constant_inputs) {
+    uint64_t data_hash[2] = {0, 0};
+    MurmurHash3::x86_128(tensor->DataRaw(), tensor->SizeInBytes(), 0, data_hash);
+    ss << ";" << input_idx << ":" << tensor->GetElementType() << ":" << tensor->Shape() << ":"
+       << data_hash[0] << ":" << data_hash[1];
+  }
+
+  const std::string description = ss.str();
+  uint64_t hash[2] = {0, 0};
+  MurmurHash3::x86_128(description.data(), description.size(), 0, hash);
+  std::ostringstream key;
+  key << std::hex << std::setfill('0') << std::setw(16) << hash[0] << std::setw(16) << hash[1];
+  return key.str();
+}
+
 Status SessionState::PrepackConstantInitializedTensors(
     InlinedHashMap<std::string, size_t>& constant_initializers_use_count,
     const std::unordered_map<std::string, const OrtValue*>& initializers_to_share_map) {
-  auto prepacked_constant_weights = [this, &constant_initializers_use_count, &initializers_to_share_map](
+  PrepackedWeightsFileCache* const file_cache = GetPrepackedWeightsFileCache();
+
+  // Looks up a constant initializer consumed by a node of this graph, which may come from an outer scope graph.
+  auto find_constant_initializer = [this](const std::string& input_name) -> std::pair<SessionState*, int> {
+    SessionState* st = this;
+    do {
+      int ort_value_idx;
+      if (st->GetOrtValueNameIdxMap().GetIdx(input_name, ort_value_idx).IsOK()) {
+        if (st->constant_initialized_tensors_.count(ort_value_idx)) {
+          return {st, ort_value_idx};
+        }
+        if (st != this || !st->graph_.IsOuterScopeValue(input_name)) {
+          break;
+        }
+      }
+      st = st->Parent();
+    } while (st);
+    return {nullptr, -1};
+  };
+
+  // Restores the pre-packed state of the kernel from the cache file if it has an entry for it.
+  // Otherwise key is set to the key to record the state under once the kernel has pre-packed its weights.
+  auto restore_from_file_cache = [this, file_cache, &find_constant_initializer, &constant_initializers_use_count](
+                                     const Node& node, OpKernel& kernel, std::string& key, bool& restored) -> Status {
+    restored = false;
+    InlinedVector<std::pair<int, const Tensor*>> constant_inputs;
+    const auto& input_defs = node.InputDefs();
+    for (size_t i = 0; i < input_defs.size(); ++i) {
+      if (!input_defs[i]->Exists()) {
+        continue;
+      }
+      auto [st, ort_value_idx] = find_constant_initializer(input_defs[i]->Name());
+      if (st != nullptr) {
+        const Tensor& tensor = st->constant_initialized_tensors_[ort_value_idx].Get<Tensor>();
+        if (tensor.IsDataTypeString()) {
+          return Status::OK();
+        }
+        constant_inputs.emplace_back(static_cast<int>(i), &tensor);
+      }
+    }
+    if (constant_inputs.empty()) {
+      return Status::OK();
+    }
+
+    key = GenerateKeyForPrepackedWeightsFileCache(node, constant_inputs);
+    const auto* entry = file_cache->Find(key);
+    if (entry == nullptr || entry->size() != constant_inputs.size() ||
+        !std::equal(entry->begin(), entry->end(), constant_inputs.begin(),
+                    [](const auto& cached, const auto& input) { return cached.input_idx == input.first; })) {
+      return Status::OK();
+    }
+
+    for (const auto& cached : *entry) {
+      if (!cached.is_packed) {
+        continue;
+      }
+      std::vector<BufferUniquePtr> buffers;
+      buffers.reserve(cached.buffers.size());
+      for (const auto& buffer : cached.buffers) {
+        // BufferDeleter is nullptr because the buffer is owned by the memory mapping of the cache file
+        buffers.emplace_back(const_cast<std::byte*>(buffer.data()), BufferDeleter(nullptr));
+      }
+      bool used_cached_buffers = false;
+      ORT_RETURN_IF_ERROR(kernel.UseFileCachedPrePackedBuffers(buffers, cached.input_idx, used_cached_buffers));
+      ORT_RETURN_IF_NOT(used_cached_buffers, "The kernel corresponding to the node ", node.Name(),
+                        " did not restore its pre-packed weights from ", file_cache->GetFilePath());
+    }
+
+    for (const auto& cached : *entry) {
+      if (!cached.is_packed) {
+        continue;
+      }
+      ++number_of_prepacks_counter_;
+      const std::string& input_name = input_defs[cached.input_idx]->Name();
+      if (constant_initializers_use_count.count(input_name) && --constant_initializers_use_count[input_name] == 0) {
+        // release the constant initialized tensor
+        auto [st, ort_value_idx] = find_constant_initializer(input_name);
+        st->initialized_tensors_.erase(ort_value_idx);
+        st->constant_initialized_tensors_.erase(ort_value_idx);
+      }
+    }
+
+    LOGS(logger_, INFO) << "Restored pre-packed weights of node " << node.Name() << " from "
+                        << file_cache->GetFilePath();
+    ++used_file_cached_pre_packed_weights_counter_;
+    restored = true;
+    return Status::OK();
+  };
+
+  // Records the pre-packed state of the kernel in the cache file.
+  auto add_to_file_cache = [file_cache](const OpKernel& kernel, const std::string& key,
+                                        PrepackedWeightsFileCache::Entry& entry) -> Status {
+    std::vector<PrePackedWeights> prepacked_buffers(entry.size());
+    for (size_t i = 0; i < entry.size(); ++i) {
+      auto& cached = entry[i];
+      if (!cached.is_packed) {
+        continue;
+      }
+      ORT_RETURN_IF_ERROR(kernel.GetPrePackedBuffersForFileCache(cached.input_idx, prepacked_buffers[i]));
+      const auto& buffers = prepacked_buffers[i];
+      ORT_ENFORCE(buffers.buffers_.size() == buffers.buffer_sizes_.size());
+      for (size_t b = 0; b < buffers.buffers_.size(); ++b) {
+        cached.buffers.push_back(gsl::make_span(static_cast<const std::byte*>(buffers.buffers_[b].get()),
+                                                buffers.buffer_sizes_[b]));
+      }
+    }
+    file_cache->Add(key, entry);
+    return Status::OK();
+  };
+
+  auto prepacked_constant_weights = [this, &constant_initializers_use_count, &initializers_to_share_map, file_cache,
+                                     &restore_from_file_cache, &add_to_file_cache](
                                         bool should_cache_prepacked_weights_for_shared_initializers) -> Status {
     for (auto& node : GetGraphViewer().Nodes()) {
       if (sess_options_.IsLoadCancellationFlagSet()) {
@@ -427,6 +612,18 @@ Status SessionState::PrepackConstantInitializedTensors(
                                "Weight pre-packing was canceled due to user request.");
       }
       auto kernel = GetMutableKernel(node.Index());
+
+      std::string file_cache_key;
+      PrepackedWeightsFileCache::Entry file_cache_entry;
+      if (file_cache != nullptr && node.GetExecutionProviderType() == kCpuExecutionProvider &&
+          kernel->SupportsPrePackedWeightsFileCache()) {
+        bool restored = false;
+        ORT_RETURN_IF_ERROR(restore_from_file_cache(node, *kernel, file_cache_key, restored));
+        if (restored) {
+          continue;
+        }
+      }
+
       int input_idx = 0;
       for (auto& input_def : node.InputDefs()) {
         if (input_def->Exists()) {
@@ -593,6 +790,10 @@ Status SessionState::PrepackConstantInitializedTensors(
                   }
                 }
 
+                if (!file_cache_key.empty()) {
+                  file_cache_entry.push_back({input_idx, is_packed, {}});
+                }
+
                 if (is_packed) {
                   ++number_of_prepacks_counter_;
 
@@ -616,6 +817,10 @@ Status SessionState::PrepackConstantInitializedTensors(
         }
         input_idx++;
       }
+
+      if (!file_cache_key.empty()) {
+        ORT_RETURN_IF_ERROR(add_to_file_cache(*kernel, file_cache_key, file_cache_entry));
+      }
     }
 
     return Status::OK();
@@ -642,6 +847,60 @@ CalculateMemoryPatternsKey(const gsl::span<const OrtValue>& tensor_inputs) {
   return key;
 }
 
+static int64_t
+CalculateMemoryPatternsKey(gsl::span<const TensorShapeVector> input_shapes) {
+  int64_t key = 0;
+  for (const auto& shape : input_shapes) {
+    for (auto dim : shape) key ^= dim;
+  }
+  return key;
+}
+
+// Combines the shapes of the feeds into the key of their shape bucket. Dimensions with declared buckets are
+// replaced by the upper bound of their bucket, other dimensions are rounded up to a power of two if round_dims is
+// set. Returns false if a dimension is larger than its largest bucket.
+// feed_dims receives the dimensions of all the feeds, ordered by OrtValue index as the order of the feeds may
+// differ between runs.
+template <typename GetDims>
+static bool CalculateBucketedMemoryPatternsKey(
+    const InlinedHashMap<int, InlinedVector<const std::vector<int64_t>*>>& input_buckets, bool round_dims,
+    gsl::span<const int> feed_mlvalue_idxs, GetDims get_dims, int64_t& key, InlinedVector<int64_t>& feed_dims) {
+  InlinedVector<size_t> feed_order(feed_mlvalue_idxs.size());
+  std::iota(feed_order.begin(), feed_order.end(), size_t{0});
+  std::sort(feed_order.begin(), feed_order.end(),
+            [&feed_mlvalue_idxs](size_t a, size_t b) { return feed_mlvalue_idxs[a] < feed_mlvalue_idxs[b]; });
+
+  size_t combined_hash = 0;
+  feed_dims.clear();
+  for (size_t i : feed_order) {
+    const gsl::span<const int64_t> dims = get_dims(i);
+    const auto buckets = input_buckets.find(feed_mlvalue_idxs[i]);
+    size_t hash = std::hash<int>()(feed_mlvalue_idxs[i]);
+    for (size_t d = 0; d < dims.size(); ++d) {
+      int64_t dim = dims[d];
+      feed_dims.push_back(dim);
+      if (buckets != input_buckets.end() && d < buckets->second.size() && buckets->second[d] != nullptr) {
+        const auto& upper_bounds = *buckets->second[d];
+        auto upper_bound = std::lower_bound(upper_bounds.begin(), upper_bounds.end(), dim);
+        if (upper_bound == upper_bounds.end()) {
+          return false;
+        }
+        dim = *upper_bound;
+      } else if (round_dims && dim > 1) {
+        int64_t bucket = 1;
+        while (bucket < dim) {
+          bucket <<= 1;
+        }
+        dim = bucket;
+      }
+      HashCombine(dim, hash);
+    }
+    combined_hash += hash;
+  }
+  key = static_cast<int64_t>(combined_hash);
+  return true;
+}
+
 #ifdef ENABLE_TRAINING
 namespace {
 Status ResolveDimParams(const GraphViewer& graph,
@@ -883,6 +1142,19 @@ const MemoryPatternGroup* SessionState::GetMemoryPatternGroup(
     gsl::span<const int> feed_mlvalue_idxs,
     const InlinedHashMap<int, TensorShape>*& out_inferred_shapes) const {
   out_inferred_shapes = nullptr;
+  if (GetMemoryPatternDimBucketing()) {
+    int64_t bucket_key = 0;
+    InlinedVector<int64_t> feed_dims;
+    auto get_dims = [&tensor_inputs](size_t i) { return tensor_inputs[i].Get<Tensor>().Shape().GetDims(); };
+    if (CalculateBucketedMemoryPatternsKey(mem_pattern_input_buckets_, bucket_mem_pattern_dims_, feed_mlvalue_idxs,
+                                           get_dims, bucket_key, feed_dims)) {
+      std::lock_guard<std::mutex> lock(mem_patterns_lock_);
+      auto it = bucket_mem_patterns_.find(bucket_key);
+      // no pattern means the run is traced, which adds a pattern for its inputs to the bucket
+      return it == bucket_mem_patterns_.end() ? nullptr : it->second.Find(feed_dims);
+    }
+  }
+
   int64_t key = CalculateMemoryPatternsKey(tensor_inputs);
   std::lock_guard<std::mutex> lock(mem_patterns_lock_);
   auto it = mem_patterns_.find(key);
@@ -897,8 +1169,6 @@ const MemoryPatternGroup* SessionState::GetMemoryPatternGroup(
       out_inferred_shapes = &shape_insert.first->second;
       return ptr;
     }
-#else
-    ORT_UNUSED_PARAMETER(feed_mlvalue_idxs);
 #endif
     return nullptr;
   }
@@ -954,15 +1224,135 @@ void SessionState::ResolveMemoryPatternFlag() {
       }
     }
   }
+
+  mem_pattern_input_buckets_.clear();
+  if (enable_mem_pattern_ && !mem_pattern_shape_buckets_.empty()) {
+    for (const auto* input : graph_viewer_->GetInputs()) {
+      const auto* shape = input->Shape();
+      int ort_value_idx = 0;
+      if (shape == nullptr || !ort_value_name_idx_map_.GetIdx(input->Name(), ort_value_idx).IsOK()) {
+        continue;
+      }
+      InlinedVector<const std::vector<int64_t>*> dim_buckets(shape->dim_size(), nullptr);
+      bool bucketed = false;
+      for (int d = 0; d < shape->dim_size(); ++d) {
+        const auto& dim = shape->dim(d);
+        if (!utils::HasDimParam(dim)) {
+          continue;
+        }
+        auto buckets = mem_pattern_shape_buckets_.find(dim.dim_param());
+        if (buckets != mem_pattern_shape_buckets_.end()) {
+          dim_buckets[d] = &buckets->second;
+          bucketed = true;
+        }
+      }
+      if (bucketed) {
+        mem_pattern_input_buckets_.emplace(ort_value_idx, std::move(dim_buckets));
+      }
+    }
+  }
 }
 
 Status SessionState::UpdateMemoryPatternGroupCache(gsl::span<const OrtValue> tensor_inputs,
+                                                   gsl::span<const int> feed_mlvalue_idxs,
                                                    MemoryPatternGroup mem_patterns) const {
+  if (GetMemoryPatternDimBucketing()) {
+    int64_t bucket_key = 0;
+    InlinedVector<int64_t> feed_dims;
+    auto get_dims = [&tensor_inputs](size_t i) { return tensor_inputs[i].Get<Tensor>().Shape().GetDims(); };
+    if (CalculateBucketedMemoryPatternsKey(mem_pattern_input_buckets_, bucket_mem_pattern_dims_, feed_mlvalue_idxs,
+                                           get_dims, bucket_key, feed_dims)) {
+      std::lock_guard<std::mutex> lock(mem_patterns_lock_);
+      const MemoryPatternGroup* added = AddBucketMemoryPattern(bucket_key, std::move(feed_dims),
+                                                               std::move(mem_patterns));
+      if (added != nullptr) {
+        PersistMemoryPattern(tensor_inputs, feed_mlvalue_idxs, *added);
+      }
+      return Status::OK();
+    }
+  }
+
   int64_t key = CalculateMemoryPatternsKey(tensor_inputs);
 
   std::lock_guard<std::mutex> lock(mem_patterns_lock_);
   // Do not update if present, as the pointer to the existing one is cached
-  mem_patterns_.emplace(key, std::move(mem_patterns));
+  auto inserted = mem_patterns_.emplace(key, std::move(mem_patterns));
+  if (inserted.second) {
+    PersistMemoryPattern(tensor_inputs, feed_mlvalue_idxs, inserted.first->second);
+  }
+  return Status::OK();
+}
+
+const MemoryPatternGroup* SessionState::AddBucketMemoryPattern(int64_t bucket_key, InlinedVector<int64_t> feed_dims,
+                                                               MemoryPatternGroup mem_patterns) const {
+  auto& bucket = bucket_mem_patterns_[bucket_key];
+  // a concurrent run with inputs at least as large may have added a pattern in the meantime
+  if (bucket.Find(feed_dims) != nullptr) {
+    return nullptr;
+  }
+  bucket.generations.push_back({std::make_unique<MemoryPatternGroup>(std::move(mem_patterns)), std::move(feed_dims)});
+  return bucket.generations.back().patterns.get();
+}
+
+void SessionState::PersistMemoryPattern(gsl::span<const OrtValue> tensor_inputs,
+                                        gsl::span<const int> feed_mlvalue_idxs,
+                                        const MemoryPatternGroup& mem_patterns) const {
+  if (!mem_pattern_cache_) {
+    return;
+  }
+  std::vector<TensorShapeVector> input_shapes;
+  input_shapes.reserve(tensor_inputs.size());
+  for (const auto& input : tensor_inputs) {
+    input_shapes.push_back(input.Get<Tensor>().Shape().AsShapeVector());
+  }
+  mem_pattern_cache_->Add(feed_mlvalue_idxs, input_shapes, mem_patterns);
+  // a new pattern is only generated once per shape, so writing the file right away is cheap compared to tracing
+  FlushMemoryPatternCache();
+}
+
+void SessionState::FlushMemoryPatternCache() const {
+  if (!mem_pattern_cache_) {
+    return;
+  }
+  // failing to persist the patterns only costs the next session some time, so it is not an error
+  auto status = mem_pattern_cache_->Flush();
+  if (!status.IsOK()) {
+    LOGS(logger_, WARNING) << "Failed to update memory pattern cache file " << mem_pattern_cache_->GetFilePath()
+                           << ": " << status.ErrorMessage();
+  }
+}
+
+Status SessionState::LoadMemoryPatternCache(const std::filesystem::path& file_path) {
+  ORT_RETURN_IF_NOT(p_seq_exec_plan_.has_value(), "The execution plan is required to load memory patterns.");
+
+  auto cache = std::make_unique<MemoryPatternCache>(
+      file_path, MemoryPatternCache::ComputePlanFingerprint(*p_seq_exec_plan_, ort_value_name_idx_map_));
+  std::vector<MemoryPatternCache::Entry> entries;
+  auto status = cache->Load(entries);
+  if (!status.IsOK()) {
+    // start over with an empty cache, the file is replaced when the first pattern is generated
+    LOGS(logger_, WARNING) << "Ignoring memory pattern cache file " << file_path << ": " << status.ErrorMessage();
+    entries.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(mem_patterns_lock_);
+  for (auto& entry : entries) {
+    if (GetMemoryPatternDimBucketing()) {
+      int64_t bucket_key = 0;
+      InlinedVector<int64_t> feed_dims;
+      auto get_dims = [&entry](size_t i) { return gsl::make_span(entry.feed_shapes[i]); };
+      if (entry.feed_ort_value_idxs.size() == entry.feed_shapes.size() &&
+          CalculateBucketedMemoryPatternsKey(mem_pattern_input_buckets_, bucket_mem_pattern_dims_,
+                                             entry.feed_ort_value_idxs, get_dims, bucket_key, feed_dims)) {
+        AddBucketMemoryPattern(bucket_key, std::move(feed_dims), std::move(entry.patterns));
+        continue;
+      }
+    }
+    int64_t key = CalculateMemoryPatternsKey(entry.feed_shapes);
+    mem_patterns_.emplace(key, std::move(entry.patterns));
+  }
+  LOGS(logger_, INFO) << "Loaded " << entries.size() << " memory patterns from " << file_path;
+  mem_pattern_cache_ = std::move(cache);
   return Status::OK();
 }
 
@@ -1300,10 +1690,45 @@ Status SessionState::FinalizeSessionState(const std::basic_string<PATH_CHAR_TYPE
 
   InlinedHashMap<std::string, size_t> constant_initializers_use_count;
   ComputeConstantInitializerUseCount(graph_, constant_initializers_use_count);
-  return FinalizeSessionStateImpl(graph_location, kernel_registry_manager, nullptr, sess_options_,
-                                  remove_initializers,
-                                  GetSaveModeForPrepacks(!remove_initializers, saving_ort_format),
-                                  constant_initializers_use_count);
+  const bool save_prepacked_initializers = GetSaveModeForPrepacks(!remove_initializers, saving_ort_format);
+
+  const std::string prepacked_weights_cache_file =
+      sess_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsPrepackedWeightsCacheFile, "");
+  const bool disable_prepacking =
+      sess_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigDisablePrepacking, "0") == "1";
+  if (!prepacked_weights_cache_file.empty() && !disable_prepacking) {
+    if (save_prepacked_initializers) {
+      LOGS(logger_, WARNING) << "Pre-packed constant initializers are saved to an external file. "
+                             << "Ignoring the pre-packed weights cache file.";
+    } else {
+      std::filesystem::path cache_path = prepacked_weights_cache_file;
+      if (cache_path.is_relative() && !graph_location.empty()) {
+        cache_path = std::filesystem::path(graph_location).parent_path() / cache_path;
+      }
+      prepacked_weights_file_cache_ = std::make_unique<PrepackedWeightsFileCache>(
+          cache_path, PrepackedWeightsFileCache::ComputeCpuFingerprint());
+      auto status = prepacked_weights_file_cache_->Load();
+      if (!status.IsOK()) {
+        // start over with an empty cache, the file is replaced once the kernels have pre-packed their weights
+        LOGS(logger_, WARNING) << "Ignoring pre-packed weights cache file " << cache_path << ": "
+                               << status.ErrorMessage();
+      }
+    }
+  }
+
+  ORT_RETURN_IF_ERROR(FinalizeSessionStateImpl(graph_location, kernel_registry_manager, nullptr, sess_options_,
+                                               remove_initializers, save_prepacked_initializers,
+                                               constant_initializers_use_count));
+
+  if (prepacked_weights_file_cache_ && prepacked_weights_file_cache_->HasNewEntries()) {
+    // the cache is an optimization only, failing to update it must not fail the session
+    auto status = prepacked_weights_file_cache_->Save();
+    if (!status.IsOK()) {
+      LOGS(logger_, WARNING) << "Failed to update pre-packed weights cache file: " << status.ErrorMessage();
+    }
+  }
+
+  return Status::OK();
 }
 
 bool SessionState::GetSaveModeForPrepacks(bool saving_model, bool saving_ort_format) {
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <map>
 #include <unordered_map>
@@ -17,6 +18,7 @@
 #include "core/common/inlined_containers.h"
 #include "core/common/logging/logging.h"
 #include "core/common/profiler.h"
+#include "core/common/sampling_profiler.h"
 #include "core/framework/allocation_planner.h"
 #include "core/framework/callback.h"
 #include "core/framework/data_transfer_manager.h"
@@ -26,9 +28,11 @@
 #include "core/framework/feeds_fetches_manager.h"
 #include "core/framework/framework_common.h"
 #include "core/framework/prepacked_weights_container.h"
+#include "core/framework/prepacked_weights_file_cache.h"
 #include "core/framework/fuse_nodes_funcs.h"
 #include "core/framework/kernel_registry_manager.h"
 #include "core/framework/mem_pattern.h"
+#include "core/framework/mem_pattern_cache.h"
 #include "core/framework/ort_value.h"
 #include "core/framework/node_index_info.h"
 #include "core/framework/op_kernel.h"
@@ -102,6 +106,7 @@ class SessionState {
                AllocatorMap* parent_allocators = nullptr);
 
   ~SessionState() {
+    FlushMemoryPatternCache();
     for (auto& kvp : deleter_for_initialized_tensors_) {
       kvp.second.f(kvp.second.param);
     }
@@ -236,8 +241,23 @@ class SessionState {
   All inputs must represent Tensors
   */
   Status UpdateMemoryPatternGroupCache(gsl::span<const OrtValue> tensor_inputs,
+                                       gsl::span<const int> feed_mlvalue_idxs,
                                        MemoryPatternGroup mem_patterns) const;
 
+  /**
+  Load the memory patterns persisted in file_path, and persist patterns generated from now on to it.
+  Must be called after the session state is finalized.
+  */
+  Status LoadMemoryPatternCache(const std::filesystem::path& file_path);
+
+  /**
+  Whether memory patterns are shared by the input shapes of a bucket, either because dimensions are rounded up
+  to a power of two or because shape buckets are declared. Blocks may then hold tensors smaller than the block.
+  */
+  bool GetMemoryPatternDimBucketing() const {
+    return bucket_mem_pattern_dims_ || !mem_pattern_input_buckets_.empty();
+  }
+
   bool GetUseDeterministicCompute() const { return sess_options_.use_deterministic_compute; }
 
   /**
@@ -335,6 +355,10 @@ class SessionState {
     return used_shared_pre_packed_weights_counter_;
   }
 
+  size_t GetUsedFileCachedPrePackedWeightCounter() const {
+    return used_file_cached_pre_packed_weights_counter_;
+  }
+
   const KernelCreateInfoMap& GetKernelCreateInfoMap() const {
     return kernel_create_info_map_;
   }
@@ -375,6 +399,33 @@ class SessionState {
   /// <returns>true of false
   bool GetSaveModeForPrepacks(bool saving_model, bool saving_ort_format);
 
+  void SetSamplingProfiler(profiling::SamplingProfiler* sampling_profiler) {
+    sampling_profiler_ = sampling_profiler;
+  }
+
+  /**
+   * Returns a pointer to the SamplingProfiler if continuous profiling was enabled for the session.
+   * The object pointer is only present at the root SessionState object
+   */
+  profiling::SamplingProfiler* GetSamplingProfiler() const {
+    if (parent_ != nullptr) {
+      return parent_->GetSamplingProfiler();
+    }
+    return sampling_profiler_;
+  }
+
+  /**
+   * Sets the id of the node with index 0 of this graph in the SamplingProfiler.
+   * The nodes of a graph have consecutive ids in the profiler, so the id of a node is this offset plus its index.
+   */
+  void SetSamplingProfilerNodeOffset(size_t offset) {
+    sampling_profiler_node_offset_ = offset;
+  }
+
+  size_t GetSamplingProfilerNodeOffset() const {
+    return sampling_profiler_node_offset_;
+  }
+
 #if !defined(ORT_MINIMAL_BUILD)
 
   void SetNodeStatsRecorder(NodeStatsRecorder* node_stats_recorder) {
@@ -413,6 +464,13 @@ class SessionState {
   Status PrepackConstantInitializedTensors(InlinedHashMap<std::string, size_t>& constant_initializers_use_count,
                                            const std::unordered_map<std::string, const OrtValue*>& initializers_to_share_map);
 
+  // Returns the pre-packed weights cache file of the main graph, or nullptr if none is used.
+  PrepackedWeightsFileCache* GetPrepackedWeightsFileCache() const {
+    const SessionState* root = this;
+    while (root->parent_ != nullptr) root = root->parent_;
+    return root->prepacked_weights_file_cache_.get();
+  }
+
   SessionState* GetMutableSubgraphSessionState(onnxruntime::NodeIndex index, const std::string& attribute_name);
 
   Status CreateSubgraphSessionState();
@@ -433,6 +491,21 @@ class SessionState {
                                   const InlinedHashMap<OrtValueName, OrtDevice>& outer_scope_node_arg_to_location_map = {},
                                   bool graph_info_already_created = false);
 
+  // Adds a pattern traced for a run in the given shape bucket with the given feed dimensions, unless a pattern of
+  // the bucket already covers them. Returns the added pattern or nullptr. Requires mem_patterns_lock_.
+  const MemoryPatternGroup* AddBucketMemoryPattern(int64_t bucket_key, InlinedVector<int64_t> feed_dims,
+                                                   MemoryPatternGroup mem_patterns) const;
+
+  // Adds a newly generated pattern to the memory pattern cache and writes it to the file if a cache file is
+  // configured. Requires mem_patterns_lock_.
+  void PersistMemoryPattern(gsl::span<const OrtValue> tensor_inputs,
+                            gsl::span<const int> feed_mlvalue_idxs,
+                            const MemoryPatternGroup& mem_patterns) const;
+
+  // Writes the patterns added to the memory pattern cache to its file, logging a failure. Requires
+  // mem_patterns_lock_ unless the session state is being destroyed, which retries a failed write.
+  void FlushMemoryPatternCache() const;
+
 #ifdef ENABLE_TRAINING
   Status GeneratePatternGroupCache(
       gsl::span<const OrtValue> inputs,
@@ -447,6 +520,10 @@ class SessionState {
   // fused_funcs_mgr_ must live longer than the session_kernels_, becaues a kernel could be created from this manager
   FuncManager fused_funcs_mgr_;
 
+  // Pre-packed weights memory mapped from the cache file, must live longer than the session_kernels_ that use them.
+  // Only set in the session state of the main graph, subgraphs use the one of their root.
+  std::unique_ptr<PrepackedWeightsFileCache> prepacked_weights_file_cache_;
+
   // cache of the constructed kernels to avoid spending construction time per executor
   std::vector<std::unique_ptr<OpKernel>> session_kernels_;
   Graph& graph_;
@@ -524,6 +601,9 @@ class SessionState {
   NodeStatsRecorder* node_stats_recorder_ = nullptr;
 #endif
 
+  profiling::SamplingProfiler* sampling_profiler_ = nullptr;
+  size_t sampling_profiler_node_offset_ = 0;
+
   // switch for enable memory pattern optimization or not.
   bool enable_mem_pattern_;
 
@@ -532,6 +612,45 @@ class SessionState {
   // cache for the generated mem_patterns. key is calculated based on input shapes.
   // must be a node based container as a pointer is cached.
   mutable NodeHashMap<int64_t, MemoryPatternGroup> mem_patterns_;
+  // share patterns between the runs whose input dimensions round up to the same powers of two,
+  // using bucket_mem_patterns_
+  bool bucket_mem_pattern_dims_ = false;
+  // persists mem_patterns_ across sessions if a cache file is configured. guarded by mem_patterns_lock_.
+  std::unique_ptr<MemoryPatternCache> mem_pattern_cache_;
+
+  // Declared shape buckets: sorted upper bounds per symbolic dimension name.
+  InlinedHashMap<std::string, std::vector<int64_t>> mem_pattern_shape_buckets_;
+  // Graph inputs with a bucketed dimension, by OrtValue index. Holds the upper bounds for each dimension of the
+  // input, or nullptr for a dimension that is not bucketed.
+  InlinedHashMap<int, InlinedVector<const std::vector<int64_t>*>> mem_pattern_input_buckets_;
+
+  // Memory patterns shared by all runs whose inputs fall into one combination of shape buckets, either declared
+  // or powers of two.
+  // A pattern covers the runs whose feeds are no larger in any dimension than the feeds it was traced with.
+  // A run that no pattern covers is traced and adds a pattern, so that the patterns grow towards the upper bounds
+  // of the bucket. Patterns are never removed as execution frames of concurrent runs may still point to them.
+  struct MemoryPatternBucket {
+    struct Generation {
+      std::unique_ptr<MemoryPatternGroup> patterns;
+      // dimensions of the feeds the patterns were traced with, ordered by OrtValue index
+      InlinedVector<int64_t> feed_dims;
+    };
+    std::vector<Generation> generations;
+
+    // Returns the most recent pattern that covers the feed dimensions, or nullptr.
+    const MemoryPatternGroup* Find(gsl::span<const int64_t> feed_dims) const {
+      for (auto it = generations.rbegin(); it != generations.rend(); ++it) {
+        if (it->feed_dims.size() == feed_dims.size() &&
+            std::equal(feed_dims.begin(), feed_dims.end(), it->feed_dims.begin(),
+                       [](int64_t dim, int64_t traced_dim) { return dim <= traced_dim; })) {
+          return it->patterns.get();
+        }
+      }
+      return nullptr;
+    }
+  };
+  // guarded by mem_patterns_lock_
+  mutable NodeHashMap<int64_t, MemoryPatternBucket> bucket_mem_patterns_;
   // This is mutable under mutex in training scenarios so execution frame would make a copy
   // of the value when created.
 #ifdef ENABLE_TRAINING
@@ -593,6 +712,10 @@ class SessionState {
   // a constant initialized weight was used by the session state
   size_t used_shared_pre_packed_weights_counter_ = 0;
 
+  // Counter for number of kernels that restored their pre-packed weights from the pre-packed weights cache file
+  // instead of calling PrePack()
+  size_t used_file_cached_pre_packed_weights_counter_ = 0;
+
 #ifdef DEBUG_NODE_INPUTS_OUTPUTS
   // Counter for number of times the session graph has been executed
   size_t graph_executions_counter_ = 0;
@@ -356,6 +356,10 @@ common::Status SaveInitializedTensors(
       // do not trace string tensor
       continue;
     }
+    if (utils::HasExternalData(*entry.second) && exec_plan.GetLocation(entry.first).Type() == OrtDevice::CPU) {
+      // the tensor uses the mmap'd external data, a planned buffer would never be used but still be committed
+      continue;
+    }
     ORT_RETURN_IF_ERROR(planner.Trace(entry.first, entry.second));
   }
 
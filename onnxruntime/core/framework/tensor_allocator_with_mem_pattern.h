@@ -80,14 +80,11 @@ class TensorAllocatorWithMemPattern : public ITensorAllocator {
       return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Internal error.");
     }
     const struct OrtDevice& location = seq_plan_.GetLocation(ort_value_index);
-    auto pattern = mem_patterns_.GetPatterns(location);
-    if (pattern == nullptr) {
-      return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Mem pattern for initializer ", name, " is not found");
-    }
-    // if block is not found, means this ort_value is not traced
+    // if there is no pattern for the location or block is not found, means this ort_value is not traced
     // fall back to allocate separate buffer.
     // if it->second.get() is null, then fall back to the block not found case
-    auto block = pattern->GetBlock(ort_value_index);
+    auto pattern = mem_patterns_.GetPatterns(location);
+    auto block = pattern != nullptr ? pattern->GetBlock(ort_value_index) : nullptr;
     if (nullptr == block) {
       // not traced, only return allocator
       alloc_out = GetAllocator(location);
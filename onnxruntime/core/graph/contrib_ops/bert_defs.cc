@@ -344,6 +344,22 @@ void GroupQueryAttentionTypeAndShapeInference(ONNX_NAMESPACE::InferenceContext&
   // TODO(aciddelgado): propagate output shapes depending if kv-share buffer is on or not
   constexpr int use_max_past_present_buffer = -1;
   BaseGroupQueryAttentionTypeAndShapeInference(ctx, past_key_index, use_max_past_present_buffer);
+
+  // A paged k-v cache is updated in place, so present has the shape of the pool of pages in past.
+  constexpr size_t block_table_index = 13;
+  if (ctx.getNumInputs() > block_table_index && ctx.hasInput(block_table_index) && ctx.getNumOutputs() > 1) {
+    ONNX_NAMESPACE::propagateShapeFromInputToOutput(ctx, past_key_index, 1);
+    ONNX_NAMESPACE::propagateShapeFromInputToOutput(ctx, static_cast<size_t>(past_key_index) + 1, 2);
+  }
+
+  // A quantized k-v cache stores int8 values, or two int4 values packed per uint8.
+  const int64_t kv_cache_bit_width = getAttribute(ctx, "kv_cache_bit_width", 0);
+  if (kv_cache_bit_width != 0 && ctx.getNumOutputs() > 1) {
+    const auto cache_type = kv_cache_bit_width == 4 ? ONNX_NAMESPACE::TensorProto_DataType_UINT8
+                                                    : ONNX_NAMESPACE::TensorProto_DataType_INT8;
+    updateOutputElemType(ctx, 1, cache_type);
+    updateOutputElemType(ctx, 2, cache_type);
+  }
 }
 
 void SparseAttentionTypeAndShapeInference(ONNX_NAMESPACE::InferenceContext& ctx, int past_key_index) {
@@ -1127,6 +1143,21 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
               "Use a smooth factor in softmax.",
               AttributeProto::INT,
               static_cast<int64_t>(-1))
+        .Attr("k_quant_type",
+              "Quantization type of the key cache: NONE, PER_TENSOR, PER_HEAD or PER_CHANNEL. The scales are static "
+              "inputs, scales computed per block of tokens as the cache grows are not supported. Default value is NONE.",
+              AttributeProto::STRING,
+              std::string("NONE"))
+        .Attr("v_quant_type",
+              "Quantization type of the value cache: NONE, PER_TENSOR, PER_HEAD or PER_CHANNEL. The scales are static "
+              "inputs, scales computed per block of tokens as the cache grows are not supported. Default value is NONE.",
+              AttributeProto::STRING,
+              std::string("NONE"))
+        .Attr("kv_cache_bit_width",
+              "Bit width of the quantized k-v cache: 8 (int8) or 4 (two int4 values packed per uint8, so the last "
+              "dimension of the cache is head_size / 2). Default value is 0 meaning the cache is not quantized.",
+              AttributeProto::INT,
+              static_cast<int64_t>(0))
         .Input(0,
                "query",
                "Query with shape (batch_size, sequence_length, hidden_size), or packed QKV with shape"
@@ -1146,13 +1177,13 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
                "past_key",
                "past state key with support for format BNSH. When past_key uses same tensor as present_key"
                "(k-v cache), it is of length max_sequence_length... otherwise of length past_sequence_length.",
-               "T",
+               "T_CACHE",
                OpSchema::Optional)
         .Input(4,
                "past_value",
                "past state value with support for format BNSH. When past_value uses same tensor as present_value"
                "(k-v cache), it is of length max_sequence_length... otherwise of length past_sequence_length.",
-               "T",
+               "T_CACHE",
                OpSchema::Optional)
         .Input(5,
                "seqlens_k",
@@ -1184,6 +1215,27 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
                "additional add to QxK' with shape (batch_size or 1, num_heads or 1, sequence_length, total_sequence_length)",
                "T",
                OpSchema::Optional)
+        .Input(11,
+               "k_scale",
+               "Scale of the quantized key cache with shape (1) for PER_TENSOR, (kv_num_heads) for PER_HEAD or "
+               "(kv_num_heads * head_size) for PER_CHANNEL. Required when kv_cache_bit_width is not 0.",
+               "tensor(float)",
+               OpSchema::Optional)
+        .Input(12,
+               "v_scale",
+               "Scale of the quantized value cache with shape (1) for PER_TENSOR, (kv_num_heads) for PER_HEAD or "
+               "(kv_num_heads * head_size) for PER_CHANNEL. Required when kv_cache_bit_width is not 0.",
+               "tensor(float)",
+               OpSchema::Optional)
+        .Input(13,
+               "block_table",
+               "2D tensor with shape (batch_size, max_pages_per_sequence) for a paged k-v cache. Entry i of a batch "
+               "entry is the page of past_key and past_value holding its tokens i * page_size to "
+               "(i + 1) * page_size - 1. past_key and past_value are then pools of pages with shape "
+               "(num_pages, kv_num_heads, page_size, head_size) with the shape of present_key and present_value, "
+               "which should share their buffers as the pools are copied otherwise.",
+               "tensor(int32)",
+               OpSchema::Optional)
         .Output(0,
                 "output",
                 "3D output tensor with shape (batch_size, sequence_length, hidden_size)",
@@ -1193,14 +1245,16 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
                 "present state key with support for format BNSH. When past_key uses same tensor as present_key"
                 "(k-v buffer), it is of length max_sequence_length... otherwise of length past_sequence_length +"
                 "kv_sequence_length.",
-                "T")
+                "T_CACHE")
         .Output(2,
                 "present_value",
                 "present state value with support for format BNSH. When past_value uses same tensor as present_value"
                 "(k-v buffer), it is of length max_sequence_length... otherwise of length past_sequence_length +"
                 "kv_sequence_length.",
-                "T")
+                "T_CACHE")
         .TypeConstraint("T", {"tensor(float16)", "tensor(bfloat16)", "tensor(float)"}, "Constrain input and output to float tensors.")
+        .TypeConstraint("T_CACHE", {"tensor(float16)", "tensor(bfloat16)", "tensor(float)", "tensor(int8)", "tensor(uint8)"},
+                        "Constrain k-v cache to float tensors, or to int8/uint8 tensors when it is quantized.")
         .TypeConstraint("M", {"tensor(int32)"}, "Constrain mask to int tensor.")
         .TypeAndShapeInferenceFunction([](ONNX_NAMESPACE::InferenceContext& ctx) {
           GroupQueryAttentionTypeAndShapeInference(ctx, 3);
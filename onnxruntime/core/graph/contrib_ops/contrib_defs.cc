@@ -1702,7 +1702,8 @@ ONNX_MS_OPERATOR_SET_SCHEMA(FusedGemm, 1,
                             OpSchema()
                                 .SetDoc(R"DOC(
 The FusedGemm operator schema is the same as Gemm besides it includes attributes
-activation and leaky_relu_alpha.)DOC")
+activation and leaky_relu_alpha, and an optional residual input R that is added
+after the activation.)DOC")
                                 .Input(
                                     0,
                                     "A",
@@ -1724,6 +1725,13 @@ activation and leaky_relu_alpha.)DOC")
                                     "The shape of C should be unidirectional broadcastable to (M, N).",
                                     "T",
                                     OpSchema::Optional)
+                                .Input(
+                                    3,
+                                    "R",
+                                    "Optional residual tensor added to the output after the activation. "
+                                    "R should have M * N elements laid out in the same order as Y.",
+                                    "T",
+                                    OpSchema::Optional)
                                 .Output(0, "Y", "Output tensor of shape (M, N).", "T")
                                 .TypeConstraint(
                                     "T",
@@ -3940,16 +3940,19 @@ std::string Graph::GenerateNodeArgName(const std::string& base_name) {
 }
 
 std::string Graph::GenerateNodeName(const std::string& base_name) {
+  if (!node_names_indexed_) {
+    for (const auto& node : nodes_) {
+      if (node != nullptr) {
+        ++node_name_counts_[node->Name()];
+      }
+    }
+    node_names_indexed_ = true;
+  }
+
   // Define name-checking function for node name.
   // Return true if the input name hasn't been used. Otherwise, return false.
-  auto name_is_ok = [&](const std::string name) {
-    for (auto it = nodes_.begin(); it != nodes_.end(); ++it) {
-      if (*it == nullptr) {
-        continue;
-      }
-      if (it->get()->Name() != name) {
-        continue;
-      }
+  auto name_is_ok = [&](const std::string& name) {
+    if (node_name_counts_.find(name) != node_name_counts_.end()) {
       // Find a matched name so we cannot reuse the input name.
       return false;
     }
@@ -4000,6 +4003,9 @@ Node& Graph::AddNode(const std::string& name,
 
   const gsl::not_null<Node*> node = AllocateNode();
   node->Init(name, op_type, description, inputs, outputs, attributes, domain);
+  if (node_names_indexed_) {
+    ++node_name_counts_[node->Name()];
+  }
   if (0 != op_type.compare(kNoOp)) {
     GraphProtoSyncNeeded(true);
   }
@@ -4029,6 +4035,9 @@ Node& Graph::AddNode(const std::string& name,
 
   const gsl::not_null<Node*> node = AllocateNode();
   node->Init(name, op_type, description, inputs, outputs, std::move(attributes), domain);
+  if (node_names_indexed_) {
+    ++node_name_counts_[node->Name()];
+  }
   if (0 != op_type.compare(kNoOp)) {
     GraphProtoSyncNeeded(true);
   }
@@ -4759,6 +4768,12 @@ bool Graph::ReleaseNode(NodeIndex index) {
 
   // index is valid, but the entry may already be empty
   if (nodes_[index] != nullptr) {
+    if (node_names_indexed_) {
+      auto name_count = node_name_counts_.find(nodes_[index]->Name());
+      if (--name_count->second == 0) {
+        node_name_counts_.erase(name_count);
+      }
+    }
     nodes_[index] = nullptr;
     --num_of_nodes_;
     GraphProtoSyncNeeded(true);
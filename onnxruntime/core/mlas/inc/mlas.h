@@ -22,6 +22,8 @@ Abstract:
 #include <cstdint>
 #include <stdexcept>
 
+#include "mlas_gemm_postprocessor.h"
+
 //
 // Define the calling convention for Windows targets.
 //
@@ -98,6 +100,16 @@ Abstract:
 #endif // ARM64
 #endif // Visual Studio 16 or earlier does not support fp16 intrinsic
 
+//
+// Bfloat16 precision GEMM (SBGEMM) is implemented with the NEON bf16
+// instructions on Linux ARM64 and with the AVX512_BF16 and AMX-BF16
+// instructions on x64.
+//
+
+#if (defined(__aarch64__) && defined(__linux__)) || (defined(MLAS_TARGET_AMD64) && !defined(__APPLE__))
+#define MLAS_SBGEMM_SUPPORTED
+#endif
+
 //
 // Basic Linear Algebra Subprograms (BLAS) types.
 //
@@ -203,6 +215,74 @@ MlasActivation(
 // op(X) = X or op(X) = transpose(X) or op(X) = conjg(transpose(X))
 //
 
+/**
+ * @brief Elementwise operations that may be fused into the epilogue of a
+ * GEMM. See MLAS_GEMM_EPILOGUE_PROCESSOR.
+ */
+enum MLAS_GEMM_EPILOGUE_OP_KIND {
+    MlasGemmEpilogueScale,      /**< C = Scale * C */
+    MlasGemmEpilogueBias,       /**< C = C + Scale * Bias[n] */
+    MlasGemmEpilogueResidual,   /**< C = C + Scale * Residual[m, n] */
+    MlasGemmEpilogueActivation, /**< C = Activation(C) */
+    MlasGemmEpilogueGelu,       /**< C = 0.5 * C * (1 + erf(C / sqrt(2))) */
+    MlasGemmEpilogueFastGelu,   /**< C = 0.5 * C * (1 + tanh(sqrt(2 / pi) * (C + 0.044715 * C^3))) */
+    MlasGemmEpilogueSilu,       /**< C = C * sigmoid(Scale * C) */
+};
+
+struct MLAS_GEMM_EPILOGUE_OP {
+    MLAS_GEMM_EPILOGUE_OP_KIND Kind = MlasGemmEpilogueScale;
+    float Scale = 1.0f;           /**< multiplier for the scale, bias, residual and SiLU operations */
+    const float* Data = nullptr;  /**< address of the bias vector or the residual matrix */
+    size_t ldd = 0;               /**< leading dimension of the residual matrix */
+    MLAS_ACTIVATION Activation{}; /**< activation for MlasGemmEpilogueActivation */
+};
+
+/**
+ * @brief Composable epilogue for single precision GEMM routines.
+ *
+ * The operations are applied in the order they are added to each tile of the
+ * output matrix as soon as the tile is produced, while the tile is still hot
+ * in the cache. The result can optionally be quantized to an 8-bit output
+ * matrix, in which case the float output matrix only serves as scratch.
+ */
+class MLAS_GEMM_EPILOGUE_PROCESSOR : public MLAS_GEMM_POSTPROCESSOR<float>
+{
+   public:
+    static constexpr size_t MaximumOpCount = 8;
+
+    void AddOp(const MLAS_GEMM_EPILOGUE_OP& Op);
+
+    void AddScale(float Scale);
+
+    void AddBias(const float* Bias, float Scale = 1.0f);
+
+    void AddResidual(const float* Residual, size_t ldr, float Scale = 1.0f);
+
+    void AddActivation(const MLAS_ACTIVATION& Activation);
+
+    void AddActivation(MLAS_GEMM_EPILOGUE_OP_KIND Kind, float Alpha = 1.0f);
+
+    void SetQuantizedOutput(uint8_t* Output, size_t ldo, float Scale, uint8_t ZeroPoint);
+
+    void SetQuantizedOutput(int8_t* Output, size_t ldo, float Scale, int8_t ZeroPoint);
+
+    size_t GetOpCount() const { return OpCount_; }
+
+    bool IsEmpty() const { return OpCount_ == 0 && QuantizedOutput_ == nullptr; }
+
+    void Process(float* C, size_t StartM, size_t StartN, size_t CountM, size_t CountN, size_t ldc)
+        const override;
+
+   private:
+    MLAS_GEMM_EPILOGUE_OP Ops_[MaximumOpCount];
+    size_t OpCount_ = 0;
+    void* QuantizedOutput_ = nullptr;
+    bool QuantizedOutputSigned_ = false;
+    size_t LeadingDimensionQuantizedOutput_ = 0;
+    float QuantizedScale_ = 1.0f;
+    int32_t QuantizedZeroPoint_ = 0;
+};
+
 /**
  * @brief Supply matrices data information to single precision gemm functions
  */
@@ -216,6 +296,7 @@ struct MLAS_SGEMM_DATA_PARAMS {
     float alpha = 1.0f;       /**< Supplies the scalar alpha multiplier (see SGEMM definition) */
     float beta = 0.0f;        /**< Supplies the scalar beta multiplier (see SGEMM definition) */
     bool BIsPacked = false;   /**< Whether B is pre-packed */
+    const MLAS_GEMM_POSTPROCESSOR<float>* OutputProcessor = nullptr; /**< Optional processor applied to each output tile */
 };
 
 /**
@@ -245,6 +326,48 @@ MlasGemmBatch(
     MLAS_THREADPOOL* ThreadPool
     );
 
+/**
+ * @brief  Batched single precision matrix/matrix multiply operation (SGEMM)
+ *         where the matrices of consecutive multiplications are separated by
+ *         fixed strides, such as the heads of an attention layer.
+ *
+ *         Batches of small multiplications are partitioned across threads at
+ *         the batch level, and larger multiplications divide the threads
+ *         among the batch.
+ *
+ * @param TransA     Supplies the transpose operation for matrix A.
+ * @param TransB     Supplies the transpose operation for matrix B.
+ * @param M          Supplies the number of rows of matrix A and matrix C.
+ * @param N          Supplies the number of columns of matrix B and matrix C.
+ * @param K          Supplies the number of columns of matrix A and the number
+                     of rows of matrix B.
+ * @param Data       Supplies the matrices data parameters of the first
+                     multiplication of the batch
+ * @param StrideA    Supplies the number of elements between matrices A
+ * @param StrideB    Supplies the number of elements between matrices B, or
+                     zero if all multiplications share matrix B. Must be zero
+                     if matrix B is packed.
+ * @param StrideC    Supplies the number of elements between matrices C
+ * @param BatchSize  Supplies number of multiplications in this batch
+ * @param ThreadPool Supplies the thread pool object to use, else nullptr if the
+                     base library threading support should be used.
+ */
+void
+MLASCALL
+MlasGemmStridedBatch(
+    CBLAS_TRANSPOSE TransA,
+    CBLAS_TRANSPOSE TransB,
+    size_t M,
+    size_t N,
+    size_t K,
+    const MLAS_SGEMM_DATA_PARAMS& Data,
+    size_t StrideA,
+    size_t StrideB,
+    size_t StrideC,
+    size_t BatchSize,
+    MLAS_THREADPOOL* ThreadPool
+    );
+
 /**
  * @brief  Single precision matrix/matrix multiply operation (SGEMM)
  *
@@ -530,13 +653,15 @@ public:
         const float* Scale,
         const float* Bias,
         MLAS_QGEMM_OUTPUT_MODE Mode = MLAS_QGEMM_OUTPUT_MODE::ZeroMode,
-        MLAS_QUANTIZATION_GRANULARITY QuantGran = MLAS_QUANTIZATION_GRANULARITY::PerMatrix) :
+        MLAS_QUANTIZATION_GRANULARITY QuantGran = MLAS_QUANTIZATION_GRANULARITY::PerMatrix,
+        const MLAS_GEMM_POSTPROCESSOR<float>* Epilogue = nullptr) :
             Output_(Output),
             LeadingDimensionOutput_(LeadingDimensionOutput),
             Scale_(Scale),
             Bias_(Bias),
             OutputMode_(Mode),
-            QuantGran_(QuantGran)
+            QuantGran_(QuantGran),
+            Epilogue_(Epilogue)
     {
     }
 
@@ -570,6 +695,7 @@ private:
     const float* Bias_;
     MLAS_QGEMM_OUTPUT_MODE OutputMode_;
     MLAS_QUANTIZATION_GRANULARITY QuantGran_;
+    const MLAS_GEMM_POSTPROCESSOR<float>* Epilogue_;
 };
 
 /**
@@ -632,6 +758,90 @@ MlasGemm(
     MlasGemmBatch(Shape, &DataParams, 1, ThreadPool);
 }
 
+//
+// Runtime tuning of the SGEMM/QGEMM thread partition and blocking.
+//
+
+enum MLAS_GEMM_TUNING_KIND {
+    MlasGemmTuningSgemm,
+    MlasGemmTuningQgemm,
+};
+
+#define MLAS_GEMM_TUNING_FLAG_TRANSA        0x01
+#define MLAS_GEMM_TUNING_FLAG_TRANSB        0x02
+#define MLAS_GEMM_TUNING_FLAG_A_SIGNED      0x04
+#define MLAS_GEMM_TUNING_FLAG_B_SIGNED      0x08
+#define MLAS_GEMM_TUNING_FLAG_B_PACKED      0x10
+
+/**
+ * @brief A tuned GEMM configuration. The first group of fields identifies the
+ *        GEMM call being tuned, the second group holds the selected parameters.
+ */
+struct MLAS_GEMM_TUNING_RESULT {
+    MLAS_GEMM_TUNING_KIND Kind = MlasGemmTuningSgemm;
+    uint32_t Flags = 0;              /**< MLAS_GEMM_TUNING_FLAG_* bits */
+    size_t M = 0;
+    size_t N = 0;
+    size_t K = 0;
+    size_t BatchN = 0;
+    size_t MaximumThreadCount = 0;   /**< Maximum thread count of the thread pool */
+    size_t ThreadCountM = 0;         /**< Thread partition on the M dimension */
+    size_t ThreadCountN = 0;         /**< Thread partition on the N dimension */
+    size_t StrideN = 0;              /**< SGEMM N stride, 0 selects the built-in heuristic */
+};
+
+/**
+ * @brief Configure GEMM runtime tuning for the GEMM operations executed with
+ *        a thread pool. Each owner of a thread pool sets its own mode, the
+ *        thread pool uses tuned results while any owner has a mode set and
+ *        tunes if any of them tunes. The tuned results are cached process
+ *        wide.
+ *
+ * @param ThreadPool     Supplies the thread pool passed to MlasGemmBatch.
+ * @param Owner          Identifies the caller that sets the mode, e.g. the
+ *                       session sharing the thread pool.
+ * @param UseResults     Use tuned results in MlasGemmBatch when available.
+ *                       False removes the mode set by the owner.
+ * @param Tune           Benchmark candidate configurations for GEMM shapes
+ *                       without a tuned result. Requires UseResults.
+ * @param MaxDurationMs  Time budget to tune a single shape, 0 for no limit.
+ */
+void
+MLASCALL
+MlasGemmTuningSetMode(
+    MLAS_THREADPOOL* ThreadPool,
+    const void* Owner,
+    bool UseResults,
+    bool Tune,
+    uint32_t MaxDurationMs
+    );
+
+/**
+ * @brief Copy the tuned results. Returns the total number of results, which
+ *        may be larger than Count.
+ */
+size_t
+MLASCALL
+MlasGemmTuningGetResults(
+    MLAS_GEMM_TUNING_RESULT* Results,
+    size_t Count
+    );
+
+/**
+ * @brief Add or replace a tuned result, e.g. one loaded from a previous run.
+ */
+void
+MLASCALL
+MlasGemmTuningAddResult(
+    const MLAS_GEMM_TUNING_RESULT& Result
+    );
+
+void
+MLASCALL
+MlasGemmTuningClearResults(
+    void
+    );
+
 //
 // Symmetric QGEMM has limited buffer overrun.
 // Currently only supported in ARM64
@@ -1780,7 +1990,7 @@ MlasHalfGemmConvertPackB(
     void* PackedB
     );
 
-#if defined(__aarch64__) && defined(__linux__)
+#if defined(MLAS_SBGEMM_SUPPORTED)
 /**
  * @brief Whether current CPU supports Bfloat16(bf16) acceleration.
  */
@@ -1977,6 +2187,12 @@ MlasNhwcAvgPool(
 
 #endif
 
+enum class MLAS_FLASH_ATTENTION_TYPE {
+    Float32,
+    Float16,                        // MLAS_FP16
+    BFloat16,                       // upper 16 bits of an fp32 value
+};
+
 struct MlasFlashAttentionThreadedArgs {
     int batch_size;
     int num_heads;
@@ -1988,19 +2204,25 @@ struct MlasFlashAttentionThreadedArgs {
     int kv_block_size;
     float scale;
     int thread_count;
-    float* buffer;
-    size_t buffer_size_per_thread;
-    const float* query;
-    const float* key;
-    const float* value;
-    float* output;
+    float* buffer;                  // buffer_size_per_thread bytes for each thread
+    size_t buffer_size_per_thread;  // see MlasFlashAttentionBufferSizePerThread
+    const void* query;              // BxNxSxH_qk
+    const void* key;                // BxNxTxH_qk
+    const void* value;              // BxNxTxH_v
+    void* output;                   // BxSxNxH_v
+    MLAS_FLASH_ATTENTION_TYPE data_type = MLAS_FLASH_ATTENTION_TYPE::Float32;  // of query, key, value and output
+    bool causal = false;            // query s attends key t only if t <= s + T - S
+    const float* attention_bias = nullptr;  // optional, row s of batch b and head h starts at
+    size_t attention_bias_batch_stride = 0;  // attention_bias + b * batch_stride + h * head_stride + s * row_stride
+    size_t attention_bias_head_stride = 0;   // with a stride of 0 for a broadcast dimension
+    size_t attention_bias_row_stride = 0;
+    const float* key_bias = nullptr;  // optional, BxT bias added to the scores of each key, e.g. from a padding mask
 };
 
 /**
- * @brief Per-thread worker function for fp32 Flash Attention
- * @param thread_id    Thread index
+ * @brief Flash Attention of fp32, fp16 or bf16 query, key and value, computed in fp32
  * @param args         Arguments
- * @return
+ * @param ThreadPool   Thread pool, args->thread_count tasks are run on it
 */
 void
 MLASCALL
@@ -2008,3 +2230,139 @@ MlasFlashAttention(
     MlasFlashAttentionThreadedArgs* args,
     MLAS_THREADPOOL* ThreadPool
 );
+
+/**
+ * @brief Returns the number of bytes of each thread's buffer for Flash Attention
+ */
+size_t
+MLASCALL
+MlasFlashAttentionBufferSizePerThread(
+    MLAS_FLASH_ATTENTION_TYPE data_type,
+    int q_block_size,
+    int kv_block_size,
+    int qk_head_size,
+    int v_head_size
+);
+
+struct MlasGQAFlashAttentionArgs {
+    int batch_size;
+    int num_heads;                  // number of heads of Q and of the output
+    int kv_num_heads;               // number of heads of K and V, each shared by num_heads / kv_num_heads heads of Q
+    int sequence_length;            // number of new tokens S
+    int head_size;
+    int kv_buffer_sequence_length;  // capacity of the K and V buffers
+    const int32_t* seqlens_k;       // total sequence length - 1 of each batch entry
+    bool is_prompt;                 // whether the new tokens start at position 0
+    int local_window_size;          // number of past tokens attended to, or -1 for all
+    float scale;
+    float softcap;                  // 0 for none
+    bool smooth_softmax;
+    const float* attention_bias;    // optional, row sequence position s of batch b and head h starts at
+    size_t attention_bias_batch_stride;  // attention_bias + b * batch_stride + h * head_stride + s * row_stride
+    size_t attention_bias_head_stride;   // with a stride of 0 for a broadcast dimension
+    size_t attention_bias_row_stride;
+    int q_block_size;               // rows of Q (over the heads of a group and the new tokens) per task
+    int kv_block_size;
+    int kv_split_count;             // number of partitions of the sequence processed in parallel
+    int thread_count;
+    float* buffer;                  // buffer_size_per_thread bytes for each thread
+    size_t buffer_size_per_thread;
+    float* partial_buffer;          // partial results if kv_split_count > 1, see MlasGQAFlashAttentionPartialBufferSize
+    const float* query;             // BxNxSxH, with query_batch_stride elements between batch entries
+    size_t query_batch_stride;
+    const float* key;               // BxN_kvxTxH, T = kv_buffer_sequence_length
+    const float* value;             // BxN_kvxTxH
+    float* output;                  // BxSxNxH
+    int kv_cache_bit_width;         // 0 if key and value are fp32, otherwise 8 or 4, see MlasQuantizeKVCache
+    const void* quantized_key;      // BxN_kvxTxH quantized with key_scale, used instead of key
+    const void* quantized_value;    // BxN_kvxTxH quantized with value_scale, used instead of value
+    const float* key_scale;         // N_kvxH
+    const float* value_scale;       // N_kvxH
+    const int32_t* block_table;     // optional, B x max_pages_per_sequence, page of the cache holding each page of
+                                    // kv_page_size tokens of a sequence. The K and V buffers are then pools of
+                                    // pages of shape PxN_kvxkv_page_sizexH and kv_buffer_sequence_length is unused
+    int max_pages_per_sequence;
+    int kv_page_size;
+};
+
+/**
+ * @brief Returns the number of bytes of each thread's buffer for fp32 GroupQueryAttention flash attention
+ */
+size_t
+MLASCALL
+MlasGQAFlashAttentionBufferSizePerThread(
+    int q_block_size,
+    int kv_block_size,
+    int head_size,
+    int kv_cache_bit_width
+);
+
+/**
+ * @brief Returns the number of bytes of the partial results for fp32 GroupQueryAttention flash attention
+ *        when the sequence is split in kv_split_count partitions. 0 if kv_split_count is 1.
+ */
+size_t
+MLASCALL
+MlasGQAFlashAttentionPartialBufferSize(
+    int batch_size,
+    int num_heads,
+    int sequence_length,
+    int head_size,
+    int kv_split_count
+);
+
+/**
+ * @brief fp32 Flash Attention for GroupQueryAttention over a K/V cache
+ *
+ *        Computes softmax(scale * Q K' + bias) V with an online softmax over blocks of the sequence, so that the
+ *        attention probabilities are never materialized. The heads of Q sharing a head of K and V are processed
+ *        together, causal masking, the local window and padding are applied from seqlens_k, and for token
+ *        generation the sequence can be split across threads (flash decoding) and the partial results merged.
+ *        With a quantized K/V cache, each block of K and V is dequantized into the thread's buffer before use,
+ *        so that only the quantized cache is read from memory. With a paged K/V cache, the blocks of K and V are
+ *        looked up in the pools of pages through the block table and do not span pages.
+ * @param args         Arguments
+ * @param ThreadPool   Thread pool
+ * @return
+*/
+void
+MLASCALL
+MlasGQAFlashAttention(
+    const MlasGQAFlashAttentionArgs* args,
+    MLAS_THREADPOOL* ThreadPool
+);
+
+/**
+ * @brief Quantizes rows of the key/value cache of attention with a scale per channel, to signed int8, or to
+ *        signed int4 packed two per byte with the even channel in the low nibble.
+ * @param Input      Supplies the rows to quantize, Rows x Channels
+ * @param Output     Receives the quantized rows, of Channels or Channels / 2 bytes each
+ * @param Rows       Number of rows
+ * @param Channels   Number of channels of each row, even for int4
+ * @param Scales     Scale of each channel
+ * @param BitWidth   8 or 4
+ */
+void
+MLASCALL
+MlasQuantizeKVCache(
+    const float* Input,
+    void* Output,
+    size_t Rows,
+    size_t Channels,
+    const float* Scales,
+    size_t BitWidth
+);
+
+/**
+ * @brief Dequantizes rows of the key/value cache of attention quantized by MlasQuantizeKVCache.
+ */
+void
+MLASCALL
+MlasDequantizeKVCache(
+    const void* Input,
+    float* Output,
+    size_t Rows,
+    size_t Channels,
+    const float* Scales,
+    size_t BitWidth
+);
@@ -1,7 +1,87 @@
+#include <algorithm>
+#include <cstring>
 #include <numeric>
 
 #include "mlasi.h"
 
+namespace {
+
+size_t
+MlasFlashAttentionElementSize(
+    MLAS_FLASH_ATTENTION_TYPE data_type
+)
+{
+    return data_type == MLAS_FLASH_ATTENTION_TYPE::Float32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+void
+MlasFlashAttentionConvertToFloat(
+    MLAS_FLASH_ATTENTION_TYPE data_type,
+    const void* source,
+    float* destination,
+    size_t count
+)
+{
+    if (data_type == MLAS_FLASH_ATTENTION_TYPE::Float16) {
+        // uses the F16C or NEON fp16 conversion kernel of the platform if there is one
+        MlasConvertHalfToFloatBuffer(reinterpret_cast<const MLAS_FP16*>(source), destination, count);
+    } else {
+        const uint16_t* src = reinterpret_cast<const uint16_t*>(source);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t bits = static_cast<uint32_t>(src[i]) << 16;
+            std::memcpy(destination + i, &bits, sizeof(float));
+        }
+    }
+}
+
+void
+MlasFlashAttentionConvertFromFloat(
+    MLAS_FLASH_ATTENTION_TYPE data_type,
+    const float* source,
+    void* destination,
+    size_t count
+)
+{
+    if (data_type == MLAS_FLASH_ATTENTION_TYPE::Float16) {
+        MlasConvertFloatToHalfBuffer(source, reinterpret_cast<MLAS_FP16*>(destination), count);
+    } else {
+        uint16_t* dst = reinterpret_cast<uint16_t*>(destination);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, source + i, sizeof(float));
+            if (std::isnan(source[i])) {
+                dst[i] = 0x7fc0;
+            } else {
+                // round to nearest even
+                dst[i] = static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+size_t
+MLASCALL
+MlasFlashAttentionBufferSizePerThread(
+    MLAS_FLASH_ATTENTION_TYPE data_type,
+    int q_block_size,
+    int kv_block_size,
+    int qk_head_size,
+    int v_head_size
+)
+{
+    // l, m, S = Q * K^T and the unnormalized output
+    size_t q = static_cast<size_t>(q_block_size);
+    size_t kv = static_cast<size_t>(kv_block_size);
+    size_t size = q * 2 + q * kv + q * static_cast<size_t>(v_head_size);
+    if (data_type != MLAS_FLASH_ATTENTION_TYPE::Float32) {
+        // the blocks of Q, K and V converted to fp32
+        size += (q + kv) * static_cast<size_t>(qk_head_size) + kv * static_cast<size_t>(v_head_size);
+    }
+    return size * sizeof(float);
+}
+
 void
 MlasFlashAttentionThreaded(
     void* argptr,
@@ -20,10 +100,15 @@ MlasFlashAttentionThreaded(
     float* buffer = args->buffer;
     ptrdiff_t buffer_size_per_thread = static_cast<ptrdiff_t>(args->buffer_size_per_thread);
     ptrdiff_t thread_count = static_cast<ptrdiff_t>(args->thread_count);
-    const float* query = args->query;
-    const float* key = args->key;
-    const float* value = args->value;
-    float* output = args->output;
+    const MLAS_FLASH_ATTENTION_TYPE data_type = args->data_type;
+    const bool is_float = data_type == MLAS_FLASH_ATTENTION_TYPE::Float32;
+    const size_t element_size = MlasFlashAttentionElementSize(data_type);
+    const char* query = reinterpret_cast<const char*>(args->query);
+    const char* key = reinterpret_cast<const char*>(args->key);
+    const char* value = reinterpret_cast<const char*>(args->value);
+    char* output = reinterpret_cast<char*>(args->output);
+    // the last key attended by query s is s + causal_offset
+    const ptrdiff_t causal_offset = kv_sequence_length - q_sequence_length;
 
 #if defined(MLAS_TARGET_AMD64) || defined(MLAS_TARGET_LARCH64)
     auto&& mlas_platform = GetMlasPlatform();
@@ -59,9 +144,33 @@ MlasFlashAttentionThreaded(
         }
         float* intermediate = m + q_block_size;
         float* temp_output = intermediate + q_block_size * kv_block_size;
+        float* q_block = temp_output + q_block_size * v_head_size;
+        float* k_block = q_block + q_block_size * qk_head_size;
+        float* v_block = k_block + kv_block_size * qk_head_size;
         float negmax = 0;
 
-        for (ptrdiff_t ir = 0; ir < kv_sequence_length; ir += kv_block_size) {
+        ptrdiff_t h = batch_idx * num_heads + head_idx;
+        size_t row_size_q_capped = static_cast<size_t>(std::min(q_block_size, q_sequence_length - q_idx));
+        ptrdiff_t kv_end = kv_sequence_length;
+        if (args->causal) {
+            kv_end = std::min(kv_end, q_idx + static_cast<ptrdiff_t>(row_size_q_capped) + causal_offset);
+        }
+
+        const float* inputQ;
+        const char* inputQ_data = query + (h * q_sequence_length + q_idx) * qk_head_size * element_size;
+        if (is_float) {
+            inputQ = reinterpret_cast<const float*>(inputQ_data);
+        } else {
+            MlasFlashAttentionConvertToFloat(data_type, inputQ_data, q_block, row_size_q_capped * qk_head_size);
+            inputQ = q_block;
+        }
+
+        if (kv_end <= 0) {
+            // no key is attended by the rows of the block
+            std::fill_n(l, row_size_q_capped, 0.0f);
+        }
+
+        for (ptrdiff_t ir = 0; ir < kv_end; ir += kv_block_size) {
             /*
                 S = Q[batch_idx, head_idx, q_idx:q_idx+q_block_size, :] * (K[batch_idx, head_idx, ir:ir+kv_block_size, :]).T
                 old_m = m
@@ -71,13 +180,20 @@ MlasFlashAttentionThreaded(
                 l = exp(diff) * l + rowsum(S)
                 O = diag(exp(diff)) * O + S * V[batch_idx, head_idx, ir:ir+kv_block_size, :]
             */
-            ptrdiff_t h = batch_idx * num_heads + head_idx;
-            const float* inputQ = query + (h * q_sequence_length + q_idx) * qk_head_size;
-            const float* inputK = key + (h * kv_sequence_length + ir) * qk_head_size;
-            const float* inputV = value + (h * kv_sequence_length + ir) * v_head_size;
-
-            size_t row_size_q_capped = static_cast<size_t>(std::min(q_block_size, q_sequence_length - q_idx));
-            size_t row_size_kv_capped = static_cast<size_t>(std::min(kv_block_size, kv_sequence_length - ir));
+            size_t row_size_kv_capped = static_cast<size_t>(std::min(kv_block_size, kv_end - ir));
+            const char* inputK_data = key + (h * kv_sequence_length + ir) * qk_head_size * element_size;
+            const char* inputV_data = value + (h * kv_sequence_length + ir) * v_head_size * element_size;
+            const float* inputK;
+            const float* inputV;
+            if (is_float) {
+                inputK = reinterpret_cast<const float*>(inputK_data);
+                inputV = reinterpret_cast<const float*>(inputV_data);
+            } else {
+                MlasFlashAttentionConvertToFloat(data_type, inputK_data, k_block, row_size_kv_capped * qk_head_size);
+                MlasFlashAttentionConvertToFloat(data_type, inputV_data, v_block, row_size_kv_capped * v_head_size);
+                inputK = k_block;
+                inputV = v_block;
+            }
 
             MlasSgemmOperation(CBLAS_TRANSPOSE::CblasNoTrans,
                      CBLAS_TRANSPOSE::CblasTrans,
@@ -96,10 +212,36 @@ MlasFlashAttentionThreaded(
             for (ptrdiff_t irow = 0; irow < static_cast<ptrdiff_t>(row_size_q_capped); ++irow) {
                 float* p = intermediate + irow * row_size_kv_capped;
 
+                // keys of the block attended by the row, the others get a weight of 0
+                size_t valid_count = row_size_kv_capped;
+                if (args->causal) {
+                    ptrdiff_t attended = q_idx + irow + causal_offset + 1 - ir;
+                    valid_count = static_cast<size_t>(std::clamp(attended, ptrdiff_t{0},
+                                                                 static_cast<ptrdiff_t>(row_size_kv_capped)));
+                    std::fill(p + valid_count, p + row_size_kv_capped, 0.0f);
+                    if (valid_count == 0) {
+                        if (ir == 0) {
+                            l[irow] = 0.0f;
+                        }
+                        continue;
+                    }
+                }
+
+                if (args->attention_bias != nullptr) {
+                    const float* bias = args->attention_bias +
+                                        static_cast<size_t>(batch_idx) * args->attention_bias_batch_stride +
+                                        static_cast<size_t>(head_idx) * args->attention_bias_head_stride +
+                                        static_cast<size_t>(q_idx + irow) * args->attention_bias_row_stride + ir;
+                    MlasEltwiseAdd(p, bias, p, valid_count);
+                }
+                if (args->key_bias != nullptr) {
+                    MlasEltwiseAdd(p, args->key_bias + batch_idx * kv_sequence_length + ir, p, valid_count);
+                }
+
 #if defined(MLAS_TARGET_AMD64) || defined(MLAS_TARGET_LARCH64)
-                float rowmax = mlas_platform.ReduceMaximumF32Kernel(p, row_size_kv_capped);
+                float rowmax = mlas_platform.ReduceMaximumF32Kernel(p, valid_count);
 #else
-                float rowmax = MlasReduceMaximumF32Kernel(p, row_size_kv_capped);
+                float rowmax = MlasReduceMaximumF32Kernel(p, valid_count);
 #endif
                 float m_diff = m[irow];
                 m[irow] = std::max(m[irow], rowmax);  // new m
@@ -107,9 +249,9 @@ MlasFlashAttentionThreaded(
                 m_diff -= m[irow];  // old - new (less than 0)
 
 #if defined(MLAS_TARGET_AMD64)
-                float rowsum = mlas_platform.ComputeSumExpF32Kernel(p, p, row_size_kv_capped, &negmax);
+                float rowsum = mlas_platform.ComputeSumExpF32Kernel(p, p, valid_count, &negmax);
 #else
-                float rowsum = MlasComputeSumExpF32Kernel(p, p, row_size_kv_capped, &negmax);
+                float rowsum = MlasComputeSumExpF32Kernel(p, p, valid_count, &negmax);
 #endif
 
                 // Note: for ir == 0, there is actually no need to calculate exp_diff
@@ -140,14 +282,23 @@ MlasFlashAttentionThreaded(
                      static_cast<size_t>(v_head_size));
         }
 
-        float* output_row = output + ((batch_idx * q_sequence_length + q_idx) * num_heads + head_idx) * v_head_size;
-        ptrdiff_t row_size_q_valid = std::min(q_block_size, q_sequence_length - q_idx);
+        char* output_row = output + ((batch_idx * q_sequence_length + q_idx) * num_heads + head_idx) * v_head_size * element_size;
+        ptrdiff_t row_size_q_valid = static_cast<ptrdiff_t>(row_size_q_capped);
         // TODO: leverage advanced instruction sets
         for (ptrdiff_t irow = 0; irow < row_size_q_valid; ++irow) {
-            for (ptrdiff_t icol = 0; icol < v_head_size; ++icol) {
-                output_row[icol] = temp_output[irow * v_head_size + icol] / l[irow];
+            float* output_float = is_float ? reinterpret_cast<float*>(output_row) : temp_output + irow * v_head_size;
+            if (l[irow] == 0.0f) {
+                // a row that attends no key, possible with a causal mask and fewer keys than queries
+                std::fill_n(output_float, v_head_size, 0.0f);
+            } else {
+                for (ptrdiff_t icol = 0; icol < v_head_size; ++icol) {
+                    output_float[icol] = temp_output[irow * v_head_size + icol] / l[irow];
+                }
+            }
+            if (!is_float) {
+                MlasFlashAttentionConvertFromFloat(data_type, output_float, output_row, static_cast<size_t>(v_head_size));
             }
-            output_row += num_heads * v_head_size;
+            output_row += num_heads * v_head_size * element_size;
         }
     }
 }
@@ -165,3 +316,399 @@ MlasFlashAttention(
         static_cast<std::ptrdiff_t>(args->thread_count),
         ThreadPool);
 }
+
+size_t
+MLASCALL
+MlasGQAFlashAttentionBufferSizePerThread(
+    int q_block_size,
+    int kv_block_size,
+    int head_size,
+    int kv_cache_bit_width
+)
+{
+    // l and m, the scores of a block, and the unnormalized output
+    size_t elements = static_cast<size_t>(q_block_size) * 2 +
+                      static_cast<size_t>(q_block_size) * static_cast<size_t>(kv_block_size) +
+                      static_cast<size_t>(q_block_size) * static_cast<size_t>(head_size);
+    if (kv_cache_bit_width != 0) {
+        // the dequantized blocks of K and V
+        elements += static_cast<size_t>(kv_block_size) * static_cast<size_t>(head_size) * 2;
+    }
+    return elements * sizeof(float);
+}
+
+size_t
+MLASCALL
+MlasGQAFlashAttentionPartialBufferSize(
+    int batch_size,
+    int num_heads,
+    int sequence_length,
+    int head_size,
+    int kv_split_count
+)
+{
+    if (kv_split_count <= 1) {
+        return 0;
+    }
+
+    // m, l and the unnormalized output of every row of Q for every split
+    return static_cast<size_t>(batch_size) * static_cast<size_t>(num_heads) * static_cast<size_t>(sequence_length) *
+           static_cast<size_t>(kv_split_count) * (static_cast<size_t>(head_size) + 2) * sizeof(float);
+}
+
+namespace
+{
+
+struct MlasGQAFlashAttentionRowRange {
+    ptrdiff_t start;
+    ptrdiff_t end;
+};
+
+//
+// Returns the range of the sequence attended to by the new token at position s of batch entry batch_idx.
+//
+
+MlasGQAFlashAttentionRowRange
+MlasGQAFlashAttentionAttendedRange(
+    const MlasGQAFlashAttentionArgs* args,
+    ptrdiff_t batch_idx,
+    ptrdiff_t s
+)
+{
+    const ptrdiff_t total_seqlen = static_cast<ptrdiff_t>(args->seqlens_k[batch_idx]) + 1;
+    const ptrdiff_t past_seqlen = args->is_prompt ? 0 : total_seqlen - args->sequence_length;
+    const ptrdiff_t causal_length = past_seqlen + s + 1;
+
+    MlasGQAFlashAttentionRowRange range;
+    range.end = std::min(causal_length, total_seqlen);
+    range.start = 0;
+    // local_window_size does not include the current token
+    if (args->local_window_size >= 0 && causal_length > static_cast<ptrdiff_t>(args->local_window_size) + 1) {
+        range.start = causal_length - args->local_window_size - 1;
+    }
+    return range;
+}
+
+//
+// Normalizes the output of a row of Q from the running maximum m, the running sum l and the unnormalized output
+// of one or more partitions of the sequence.
+//
+
+void
+MlasGQAFlashAttentionNormalizeRow(
+    const float* m,
+    const float* l,
+    const float* o,
+    size_t stride,
+    ptrdiff_t count,
+    ptrdiff_t head_size,
+    bool smooth_softmax,
+    float* output
+)
+{
+    // smooth softmax adds a logit of 0 to the denominator
+    float max = smooth_softmax ? 0.0f : std::numeric_limits<float>::lowest();
+    for (ptrdiff_t i = 0; i < count; ++i) {
+        max = std::max(max, m[i * stride]);
+    }
+
+    float sum = smooth_softmax ? std::exp(-max) : 0.0f;
+    for (ptrdiff_t i = 0; i < count; ++i) {
+        sum += std::exp(m[i * stride] - max) * l[i * stride];
+    }
+
+    for (ptrdiff_t icol = 0; icol < head_size; ++icol) {
+        output[icol] = 0.0f;
+    }
+    if (sum == 0.0f) {
+        return;
+    }
+    for (ptrdiff_t i = 0; i < count; ++i) {
+        if (l[i * stride] == 0.0f) {
+            continue;
+        }
+        const float factor = std::exp(m[i * stride] - max) / sum;
+        const float* o_current = o + i * stride;
+        for (ptrdiff_t icol = 0; icol < head_size; ++icol) {
+            output[icol] += factor * o_current[icol];
+        }
+    }
+}
+
+void
+MlasGQAFlashAttentionThreaded(
+    void* argptr,
+    std::ptrdiff_t thread_id
+)
+{
+    const MlasGQAFlashAttentionArgs* args = reinterpret_cast<MlasGQAFlashAttentionArgs*>(argptr);
+    const ptrdiff_t batch_size = static_cast<ptrdiff_t>(args->batch_size);
+    const ptrdiff_t num_heads = static_cast<ptrdiff_t>(args->num_heads);
+    const ptrdiff_t kv_num_heads = static_cast<ptrdiff_t>(args->kv_num_heads);
+    const ptrdiff_t group_size = num_heads / kv_num_heads;
+    const ptrdiff_t sequence_length = static_cast<ptrdiff_t>(args->sequence_length);
+    const ptrdiff_t head_size = static_cast<ptrdiff_t>(args->head_size);
+    const ptrdiff_t kv_buffer_sequence_length = static_cast<ptrdiff_t>(args->kv_buffer_sequence_length);
+    const ptrdiff_t q_block_size = static_cast<ptrdiff_t>(args->q_block_size);
+    const ptrdiff_t kv_block_size = static_cast<ptrdiff_t>(args->kv_block_size);
+    const ptrdiff_t kv_split_count = static_cast<ptrdiff_t>(args->kv_split_count);
+    const ptrdiff_t thread_count = static_cast<ptrdiff_t>(args->thread_count);
+
+#if defined(MLAS_TARGET_AMD64) || defined(MLAS_TARGET_LARCH64)
+    auto&& mlas_platform = GetMlasPlatform();
+#endif
+
+    // The rows of Q of the heads sharing a head of K and V are contiguous, so that they form a single matrix of
+    // group_size * sequence_length rows that is multiplied by each block of K and V.
+    const ptrdiff_t group_rows = group_size * sequence_length;
+    const ptrdiff_t q_chunk_count = (group_rows + (q_block_size - 1)) / q_block_size;
+
+    ptrdiff_t task_start = 0;
+    ptrdiff_t task_end = 0;
+    const ptrdiff_t total_task_count = batch_size * kv_num_heads * q_chunk_count * kv_split_count;
+    const ptrdiff_t quotient = total_task_count / thread_count;
+    const ptrdiff_t remainder = total_task_count % thread_count;
+    if (thread_id < remainder) {
+        task_start = (quotient + 1) * thread_id;
+        task_end = task_start + quotient + 1;
+    } else {
+        task_start = quotient * thread_id + remainder;
+        task_end = task_start + quotient;
+    }
+
+    char* buffer_current_thread = reinterpret_cast<char*>(args->buffer) + thread_id * args->buffer_size_per_thread;
+    float* l = reinterpret_cast<float*>(buffer_current_thread);
+    float* m = l + q_block_size;
+    float* intermediate = m + q_block_size;
+    float* temp_output = intermediate + q_block_size * kv_block_size;
+    float* dequantized_key = temp_output + q_block_size * head_size;
+    float* dequantized_value = dequantized_key + kv_block_size * head_size;
+    const size_t kv_bit_width = static_cast<size_t>(args->kv_cache_bit_width);
+    // bytes of a quantized row of K or V
+    const ptrdiff_t quantized_row_size = kv_bit_width == 4 ? head_size / 2 : head_size;
+    const bool paged = args->block_table != nullptr;
+    const ptrdiff_t page_size = static_cast<ptrdiff_t>(args->kv_page_size);
+
+    for (ptrdiff_t task_index = task_start; task_index < task_end; ++task_index) {
+        ptrdiff_t index = task_index;
+        const ptrdiff_t split_idx = index % kv_split_count;
+        index /= kv_split_count;
+        const ptrdiff_t row_begin = (index % q_chunk_count) * q_block_size;
+        index /= q_chunk_count;
+        const ptrdiff_t kv_head_idx = index % kv_num_heads;
+        const ptrdiff_t batch_idx = index / kv_num_heads;
+        const ptrdiff_t row_count = std::min(q_block_size, group_rows - row_begin);
+
+        // Each split covers the same number of blocks of the sequence of the batch entry.
+        const ptrdiff_t total_seqlen = static_cast<ptrdiff_t>(args->seqlens_k[batch_idx]) + 1;
+        const ptrdiff_t kv_split_size =
+            ((total_seqlen + kv_split_count - 1) / kv_split_count + kv_block_size - 1) / kv_block_size * kv_block_size;
+
+        // The part of the sequence attended to by any row of the block within this split.
+        ptrdiff_t kv_begin = std::numeric_limits<ptrdiff_t>::max();
+        ptrdiff_t kv_end = 0;
+        for (ptrdiff_t irow = 0; irow < row_count; ++irow) {
+            auto range = MlasGQAFlashAttentionAttendedRange(args, batch_idx, (row_begin + irow) % sequence_length);
+            kv_begin = std::min(kv_begin, range.start);
+            kv_end = std::max(kv_end, range.end);
+        }
+        kv_begin = std::max(kv_begin, split_idx * kv_split_size);
+        kv_end = std::min(kv_end, (split_idx + 1) * kv_split_size);
+
+        for (ptrdiff_t irow = 0; irow < row_count; ++irow) {
+            m[irow] = std::numeric_limits<float>::lowest();
+            l[irow] = 0.0f;
+        }
+        std::fill_n(temp_output, row_count * head_size, 0.0f);
+
+        const float* inputQ = args->query + batch_idx * args->query_batch_stride +
+                              (kv_head_idx * group_rows + row_begin) * head_size;
+        const ptrdiff_t kv_offset = (batch_idx * kv_num_heads + kv_head_idx) * kv_buffer_sequence_length;
+        const int32_t* pages = paged ? args->block_table + batch_idx * args->max_pages_per_sequence : nullptr;
+
+        ptrdiff_t col_count = 0;
+        for (ptrdiff_t ir = kv_begin; ir < kv_end; ir += col_count) {
+            col_count = std::min(kv_block_size, kv_end - ir);
+
+            // Index of the row of K and V of sequence position ir. A block of a paged cache ends with its page.
+            ptrdiff_t kv_row = kv_offset + ir;
+            if (paged) {
+                const ptrdiff_t page_offset = ir % page_size;
+                col_count = std::min(col_count, page_size - page_offset);
+                kv_row = (static_cast<ptrdiff_t>(pages[ir / page_size]) * kv_num_heads + kv_head_idx) * page_size +
+                         page_offset;
+            }
+
+            const float* inputK;
+            const float* inputV;
+            if (kv_bit_width != 0) {
+                const ptrdiff_t quantized_offset = kv_row * quantized_row_size;
+                MlasDequantizeKVCache(static_cast<const uint8_t*>(args->quantized_key) + quantized_offset,
+                                      dequantized_key, static_cast<size_t>(col_count), static_cast<size_t>(head_size),
+                                      args->key_scale + kv_head_idx * head_size, kv_bit_width);
+                MlasDequantizeKVCache(static_cast<const uint8_t*>(args->quantized_value) + quantized_offset,
+                                      dequantized_value, static_cast<size_t>(col_count), static_cast<size_t>(head_size),
+                                      args->value_scale + kv_head_idx * head_size, kv_bit_width);
+                inputK = dequantized_key;
+                inputV = dequantized_value;
+            } else {
+                inputK = args->key + kv_row * head_size;
+                inputV = args->value + kv_row * head_size;
+            }
+
+            MlasSgemmOperation(CBLAS_TRANSPOSE::CblasNoTrans,
+                               CBLAS_TRANSPOSE::CblasTrans,
+                               static_cast<size_t>(row_count),
+                               static_cast<size_t>(col_count),
+                               static_cast<size_t>(head_size),
+                               args->scale,
+                               inputQ,
+                               static_cast<size_t>(head_size),
+                               inputK,
+                               static_cast<size_t>(head_size),
+                               0.0f,
+                               intermediate,
+                               static_cast<size_t>(col_count));
+
+            for (ptrdiff_t irow = 0; irow < row_count; ++irow) {
+                float* p = intermediate + irow * col_count;
+                const ptrdiff_t head_idx = kv_head_idx * group_size + (row_begin + irow) / sequence_length;
+                const ptrdiff_t s = (row_begin + irow) % sequence_length;
+                const auto range = MlasGQAFlashAttentionAttendedRange(args, batch_idx, s);
+                const ptrdiff_t valid_begin = std::clamp(range.start - ir, ptrdiff_t{0}, col_count);
+                const ptrdiff_t valid_end = std::clamp(range.end - ir, valid_begin, col_count);
+                const size_t valid_count = static_cast<size_t>(valid_end - valid_begin);
+
+                std::fill(p, p + valid_begin, 0.0f);
+                std::fill(p + valid_end, p + col_count, 0.0f);
+                if (valid_count == 0) {
+                    continue;
+                }
+                p += valid_begin;
+
+                if (args->softcap > 0.0f) {
+                    MlasComputeSoftcap(p, p, valid_count, args->softcap);
+                }
+                if (args->attention_bias != nullptr) {
+                    const float* bias = args->attention_bias + batch_idx * args->attention_bias_batch_stride +
+                                        head_idx * args->attention_bias_head_stride +
+                                        s * args->attention_bias_row_stride + ir + valid_begin;
+                    MlasEltwiseAdd(p, bias, p, valid_count);
+                }
+
+#if defined(MLAS_TARGET_AMD64) || defined(MLAS_TARGET_LARCH64)
+                float rowmax = mlas_platform.ReduceMaximumF32Kernel(p, valid_count);
+#else
+                float rowmax = MlasReduceMaximumF32Kernel(p, valid_count);
+#endif
+                const float old_m = m[irow];
+                m[irow] = std::max(old_m, rowmax);
+                float negmax = -m[irow];
+
+#if defined(MLAS_TARGET_AMD64)
+                float rowsum = mlas_platform.ComputeSumExpF32Kernel(p, p, valid_count, &negmax);
+#else
+                float rowsum = MlasComputeSumExpF32Kernel(p, p, valid_count, &negmax);
+#endif
+
+                if (l[irow] != 0.0f) {
+                    const float exp_diff = std::exp(old_m - m[irow]);
+                    l[irow] = exp_diff * l[irow] + rowsum;
+                    float* o = temp_output + irow * head_size;
+                    for (ptrdiff_t icol = 0; icol < head_size; ++icol) {
+                        o[icol] *= exp_diff;
+                    }
+                } else {
+                    l[irow] = rowsum;
+                }
+            }
+
+            MlasSgemmOperation(CBLAS_TRANSPOSE::CblasNoTrans,
+                               CBLAS_TRANSPOSE::CblasNoTrans,
+                               static_cast<size_t>(row_count),
+                               static_cast<size_t>(head_size),
+                               static_cast<size_t>(col_count),
+                               1.0f,
+                               intermediate,
+                               static_cast<size_t>(col_count),
+                               inputV,
+                               static_cast<size_t>(head_size),
+                               1.0f,
+                               temp_output,
+                               static_cast<size_t>(head_size));
+        }
+
+        for (ptrdiff_t irow = 0; irow < row_count; ++irow) {
+            const ptrdiff_t head_idx = kv_head_idx * group_size + (row_begin + irow) / sequence_length;
+            const ptrdiff_t s = (row_begin + irow) % sequence_length;
+            if (kv_split_count == 1) {
+                float* output_row = args->output + ((batch_idx * sequence_length + s) * num_heads + head_idx) * head_size;
+                MlasGQAFlashAttentionNormalizeRow(m + irow, l + irow, temp_output + irow * head_size, 0, 1, head_size,
+                                                  args->smooth_softmax, output_row);
+            } else {
+                // Partial results of a row of Q are stored as m, l, o for each split.
+                float* partial = args->partial_buffer +
+                                 (((batch_idx * num_heads + head_idx) * sequence_length + s) * kv_split_count + split_idx) *
+                                     (head_size + 2);
+                partial[0] = m[irow];
+                partial[1] = l[irow];
+                std::copy_n(temp_output + irow * head_size, head_size, partial + 2);
+            }
+        }
+    }
+}
+
+void
+MlasGQAFlashAttentionMergeThreaded(
+    void* argptr,
+    std::ptrdiff_t thread_id
+)
+{
+    const MlasGQAFlashAttentionArgs* args = reinterpret_cast<MlasGQAFlashAttentionArgs*>(argptr);
+    const ptrdiff_t num_heads = static_cast<ptrdiff_t>(args->num_heads);
+    const ptrdiff_t sequence_length = static_cast<ptrdiff_t>(args->sequence_length);
+    const ptrdiff_t head_size = static_cast<ptrdiff_t>(args->head_size);
+    const ptrdiff_t kv_split_count = static_cast<ptrdiff_t>(args->kv_split_count);
+    const ptrdiff_t thread_count = static_cast<ptrdiff_t>(args->thread_count);
+    const size_t stride = static_cast<size_t>(head_size) + 2;
+
+    const ptrdiff_t total_row_count = static_cast<ptrdiff_t>(args->batch_size) * num_heads * sequence_length;
+    const ptrdiff_t rows_per_thread = (total_row_count + thread_count - 1) / thread_count;
+    const ptrdiff_t row_start = std::min(thread_id * rows_per_thread, total_row_count);
+    const ptrdiff_t row_end = std::min(row_start + rows_per_thread, total_row_count);
+
+    for (ptrdiff_t row = row_start; row < row_end; ++row) {
+        const ptrdiff_t s = row % sequence_length;
+        const ptrdiff_t head_idx = (row / sequence_length) % num_heads;
+        const ptrdiff_t batch_idx = row / sequence_length / num_heads;
+        const float* partial = args->partial_buffer + row * kv_split_count * stride;
+        float* output_row = args->output + ((batch_idx * sequence_length + s) * num_heads + head_idx) * head_size;
+        MlasGQAFlashAttentionNormalizeRow(partial, partial + 1, partial + 2, stride, kv_split_count, head_size,
+                                          args->smooth_softmax, output_row);
+    }
+}
+
+}  // namespace
+
+void
+MLASCALL
+MlasGQAFlashAttention(
+    const MlasGQAFlashAttentionArgs* args,
+    MLAS_THREADPOOL* ThreadPool
+)
+{
+    void* argptr = const_cast<void*>(static_cast<const void*>(args));
+    MlasExecuteThreaded(
+        MlasGQAFlashAttentionThreaded,
+        argptr,
+        static_cast<std::ptrdiff_t>(args->thread_count),
+        ThreadPool);
+
+    if (args->kv_split_count > 1) {
+        MlasExecuteThreaded(
+            MlasGQAFlashAttentionMergeThreaded,
+            argptr,
+            static_cast<std::ptrdiff_t>(args->thread_count),
+            ThreadPool);
+    }
+}
@@ -0,0 +1,365 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    gemm_epilogue.cpp
+
+Abstract:
+
+    This module implements the composable epilogue that fuses bias, residual,
+    activation and quantization operations into the GEMM routines.
+
+--*/
+
+#include "mlasi.h"
+
+//
+// Number of columns of an output row that are processed at a time by the
+// operations that need a temporary buffer.
+//
+
+#define MLAS_GEMM_EPILOGUE_BUFFER_COUNT     256
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::AddOp(
+    const MLAS_GEMM_EPILOGUE_OP& Op
+    )
+{
+    if (OpCount_ >= MaximumOpCount) {
+        MLAS_THROW_EX(std::runtime_error, "too many mlas gemm epilogue operations");
+    }
+
+    Ops_[OpCount_++] = Op;
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::AddScale(
+    float Scale
+    )
+{
+    MLAS_GEMM_EPILOGUE_OP Op;
+    Op.Kind = MlasGemmEpilogueScale;
+    Op.Scale = Scale;
+    AddOp(Op);
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::AddBias(
+    const float* Bias,
+    float Scale
+    )
+{
+    MLAS_GEMM_EPILOGUE_OP Op;
+    Op.Kind = MlasGemmEpilogueBias;
+    Op.Scale = Scale;
+    Op.Data = Bias;
+    AddOp(Op);
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::AddResidual(
+    const float* Residual,
+    size_t ldr,
+    float Scale
+    )
+{
+    MLAS_GEMM_EPILOGUE_OP Op;
+    Op.Kind = MlasGemmEpilogueResidual;
+    Op.Scale = Scale;
+    Op.Data = Residual;
+    Op.ldd = ldr;
+    AddOp(Op);
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::AddActivation(
+    const MLAS_ACTIVATION& Activation
+    )
+{
+    //
+    // The identity activation is a no-op and is dropped.
+    //
+
+    if (Activation.ActivationKind == MlasIdentityActivation) {
+        return;
+    }
+
+    MLAS_GEMM_EPILOGUE_OP Op;
+    Op.Kind = MlasGemmEpilogueActivation;
+    Op.Activation = Activation;
+    AddOp(Op);
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::AddActivation(
+    MLAS_GEMM_EPILOGUE_OP_KIND Kind,
+    float Alpha
+    )
+{
+    if (Kind != MlasGemmEpilogueGelu && Kind != MlasGemmEpilogueFastGelu && Kind != MlasGemmEpilogueSilu) {
+        MLAS_THROW_EX(std::runtime_error, "bad mlas gemm epilogue activation kind");
+    }
+
+    MLAS_GEMM_EPILOGUE_OP Op;
+    Op.Kind = Kind;
+    Op.Scale = Alpha;
+    AddOp(Op);
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::SetQuantizedOutput(
+    uint8_t* Output,
+    size_t ldo,
+    float Scale,
+    uint8_t ZeroPoint
+    )
+{
+    QuantizedOutput_ = Output;
+    QuantizedOutputSigned_ = false;
+    LeadingDimensionQuantizedOutput_ = ldo;
+    QuantizedScale_ = Scale;
+    QuantizedZeroPoint_ = ZeroPoint;
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::SetQuantizedOutput(
+    int8_t* Output,
+    size_t ldo,
+    float Scale,
+    int8_t ZeroPoint
+    )
+{
+    QuantizedOutput_ = Output;
+    QuantizedOutputSigned_ = true;
+    LeadingDimensionQuantizedOutput_ = ldo;
+    QuantizedScale_ = Scale;
+    QuantizedZeroPoint_ = ZeroPoint;
+}
+
+template<MLAS_GEMM_EPILOGUE_OP_KIND Kind>
+void
+MlasGemmEpilogueApplyActivation(
+    float* C,
+    size_t CountN,
+    float Alpha
+    )
+/*++
+
+Routine Description:
+
+    This routine applies one of the transcendental activations to a row of the
+    output matrix. The row is processed in blocks that fit in a local buffer
+    so that the vectorized MLAS routines can be used.
+
+Arguments:
+
+    C - Supplies the address of the output row.
+
+    CountN - Supplies the number of columns of the output row.
+
+    Alpha - Supplies the multiplier of the sigmoid input for SiLU.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    float Buffer[MLAS_GEMM_EPILOGUE_BUFFER_COUNT];
+
+    while (CountN > 0) {
+
+        const size_t n = std::min(CountN, size_t(MLAS_GEMM_EPILOGUE_BUFFER_COUNT));
+
+        if (Kind == MlasGemmEpilogueGelu) {
+
+            for (size_t i = 0; i < n; i++) {
+                Buffer[i] = C[i] * 0.7071067811865476f;
+            }
+
+            MlasComputeErf(Buffer, Buffer, n);
+
+            for (size_t i = 0; i < n; i++) {
+                C[i] = 0.5f * C[i] * (1.0f + Buffer[i]);
+            }
+
+        } else if (Kind == MlasGemmEpilogueFastGelu) {
+
+            for (size_t i = 0; i < n; i++) {
+                Buffer[i] = C[i] * (0.7978845608028654f + 0.0356774081363001f * C[i] * C[i]);
+            }
+
+            MlasComputeTanh(Buffer, Buffer, n);
+
+            for (size_t i = 0; i < n; i++) {
+                C[i] = 0.5f * C[i] * (1.0f + Buffer[i]);
+            }
+
+        } else {
+
+            for (size_t i = 0; i < n; i++) {
+                Buffer[i] = Alpha * C[i];
+            }
+
+            MlasComputeLogistic(Buffer, Buffer, n);
+
+            for (size_t i = 0; i < n; i++) {
+                C[i] *= Buffer[i];
+            }
+        }
+
+        C += n;
+        CountN -= n;
+    }
+}
+
+void
+MLAS_GEMM_EPILOGUE_PROCESSOR::Process(
+    float* C,
+    size_t StartM,
+    size_t StartN,
+    size_t CountM,
+    size_t CountN,
+    size_t ldc
+    ) const
+/*++
+
+Routine Description:
+
+    This routine applies the epilogue operations to a tile of the output
+    matrix.
+
+Arguments:
+
+    C - Supplies the address of the output matrix.
+
+    StartM - Supplies the starting row offset of the tile.
+
+    StartN - Supplies the starting column offset of the tile.
+
+    CountM - Supplies the number of rows of the tile.
+
+    CountN - Supplies the number of columns of the tile.
+
+    ldc - Supplies the leading dimension of the output matrix.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    float* Tile = C + StartM * ldc + StartN;
+
+    for (size_t i = 0; i < OpCount_; i++) {
+
+        const MLAS_GEMM_EPILOGUE_OP& Op = Ops_[i];
+
+        //
+        // The MLAS activation routine handles a whole tile at once.
+        //
+
+        if (Op.Kind == MlasGemmEpilogueActivation) {
+            MlasActivation(&Op.Activation, Tile, nullptr, CountM, CountN, ldc);
+            continue;
+        }
+
+        const float Scale = Op.Scale;
+
+        for (size_t m = 0; m < CountM; m++) {
+
+            float* c = Tile + m * ldc;
+
+            switch (Op.Kind) {
+
+                case MlasGemmEpilogueScale:
+                {
+                    for (size_t n = 0; n < CountN; n++) {
+                        c[n] *= Scale;
+                    }
+                    break;
+                }
+
+                case MlasGemmEpilogueBias:
+                {
+                    const float* bias = Op.Data + StartN;
+
+                    if (Scale == 1.0f) {
+                        for (size_t n = 0; n < CountN; n++) {
+                            c[n] += bias[n];
+                        }
+                    } else {
+                        for (size_t n = 0; n < CountN; n++) {
+                            c[n] += Scale * bias[n];
+                        }
+                    }
+                    break;
+                }
+
+                case MlasGemmEpilogueResidual:
+                {
+                    const float* residual = Op.Data + (StartM + m) * Op.ldd + StartN;
+
+                    if (Scale == 1.0f) {
+                        for (size_t n = 0; n < CountN; n++) {
+                            c[n] += residual[n];
+                        }
+                    } else {
+                        for (size_t n = 0; n < CountN; n++) {
+                            c[n] += Scale * residual[n];
+                        }
+                    }
+                    break;
+                }
+
+                case MlasGemmEpilogueGelu:
+                {
+                    MlasGemmEpilogueApplyActivation<MlasGemmEpilogueGelu>(c, CountN, Scale);
+                    break;
+                }
+
+                case MlasGemmEpilogueFastGelu:
+                {
+                    MlasGemmEpilogueApplyActivation<MlasGemmEpilogueFastGelu>(c, CountN, Scale);
+                    break;
+                }
+
+                case MlasGemmEpilogueSilu:
+                {
+                    MlasGemmEpilogueApplyActivation<MlasGemmEpilogueSilu>(c, CountN, Scale);
+                    break;
+                }
+
+                default:
+                {
+                    MLAS_THROW_EX(std::runtime_error, "bad mlas gemm epilogue operation kind");
+                }
+            }
+        }
+    }
+
+    //
+    // Quantize the tile to the 8-bit output matrix.
+    //
+
+    if (QuantizedOutput_ != nullptr) {
+
+        for (size_t m = 0; m < CountM; m++) {
+
+            const float* c = Tile + m * ldc;
+            const size_t OutputOffset = (StartM + m) * LeadingDimensionQuantizedOutput_ + StartN;
+
+            if (QuantizedOutputSigned_) {
+                MlasQuantizeLinear(c, static_cast<int8_t*>(QuantizedOutput_) + OutputOffset, CountN,
+                    QuantizedScale_, static_cast<int8_t>(QuantizedZeroPoint_));
+            } else {
+                MlasQuantizeLinear(c, static_cast<uint8_t*>(QuantizedOutput_) + OutputOffset, CountN,
+                    QuantizedScale_, static_cast<uint8_t>(QuantizedZeroPoint_));
+            }
+        }
+    }
+}
@@ -0,0 +1,459 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    gemm_tuning.cpp
+
+Abstract:
+
+    This module implements runtime tuning of the thread partition and blocking
+    parameters used by the SGEMM and QGEMM batch routines.
+
+    Candidate configurations are benchmarked for the GEMM shapes seen at
+    runtime and the fastest configuration is cached per shape. The cache can
+    be exported and reloaded so that later runs on the same host skip tuning.
+
+    The tuning mode is set per thread pool, so that only the GEMM operations
+    of the sessions that enabled tuning use or produce tuned results. Every
+    owner of a thread pool sets its own mode, and the thread pool keeps a
+    mode as long as one of its owners does. The cache is shared because a
+    result only depends on the shape of the operation and the thread count.
+
+--*/
+
+#include "mlasi.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <tuple>
+#include <vector>
+
+std::atomic<size_t> MlasGemmTuningModeCount{0};
+
+namespace {
+
+using MLAS_GEMM_TUNING_KEY = std::tuple<int, uint32_t, size_t, size_t, size_t, size_t, size_t>;
+
+struct MLAS_GEMM_TUNING_STATE {
+    std::shared_mutex ModesLock;
+    std::map<MLAS_THREADPOOL*, std::map<const void*, MLAS_GEMM_TUNING_MODE>> OwnerModes;
+    std::map<MLAS_THREADPOOL*, MLAS_GEMM_TUNING_MODE> Modes;
+    std::mutex Lock;
+    std::map<MLAS_GEMM_TUNING_KEY, MLAS_GEMM_TUNING_RESULT> Results;
+    std::set<MLAS_GEMM_TUNING_KEY> Tuning;
+};
+
+MLAS_GEMM_TUNING_STATE&
+MlasGemmTuningGetState(
+    void
+    )
+{
+    static MLAS_GEMM_TUNING_STATE State;
+    return State;
+}
+
+MLAS_GEMM_TUNING_KEY
+MlasGemmTuningMakeKey(
+    const MLAS_GEMM_TUNING_RESULT& Result
+    )
+{
+    return MLAS_GEMM_TUNING_KEY(int(Result.Kind), Result.Flags, Result.M, Result.N,
+        Result.K, Result.BatchN, Result.MaximumThreadCount);
+}
+
+bool
+MlasGemmTuningIsValidParams(
+    const MLAS_GEMM_TUNING_RESULT& Result,
+    size_t BlockedN,
+    const size_t* StrideNCandidates,
+    size_t StrideNCandidateCount
+    )
+/*++
+
+Routine Description:
+
+    This routine checks that the parameters of a cached result can be used for
+    the GEMM operation. Results may have been loaded from an external source,
+    so anything that would violate an invariant of the GEMM routines is
+    rejected.
+
+--*/
+{
+    if (Result.ThreadCountM == 0 || Result.ThreadCountM > Result.M) {
+        return false;
+    }
+
+    if (Result.ThreadCountN == 0 || Result.ThreadCountN > BlockedN) {
+        return false;
+    }
+
+    if (Result.ThreadCountM * Result.ThreadCountN > Result.MaximumThreadCount) {
+        return false;
+    }
+
+    if (Result.StrideN != 0) {
+        return std::find(StrideNCandidates, StrideNCandidates + StrideNCandidateCount,
+                         Result.StrideN) != StrideNCandidates + StrideNCandidateCount;
+    }
+
+    return true;
+}
+
+void
+MlasGemmTuningAddThreadCandidates(
+    std::vector<MLAS_GEMM_TUNING_RESULT>& Candidates,
+    const MLAS_GEMM_TUNING_RESULT& Default,
+    size_t BlockedN
+    )
+/*++
+
+Routine Description:
+
+    This routine generates the thread partitions to benchmark. The total thread
+    count is varied around the default and the maximum thread count available
+    to each GEMM of the batch, and each total is split along the M dimension,
+    the N dimension and as a balanced 2D partition.
+
+--*/
+{
+    const size_t ThreadsPerGemm =
+        std::max<size_t>((Default.MaximumThreadCount + Default.BatchN - 1) / Default.BatchN, 1);
+
+    const size_t TotalThreads[] = {
+        Default.ThreadCountM * Default.ThreadCountN,
+        ThreadsPerGemm,
+        ThreadsPerGemm / 2,
+        ThreadsPerGemm / 4,
+    };
+
+    auto AddCandidate = [&](size_t ThreadCountM, size_t ThreadCountN) {
+        MLAS_GEMM_TUNING_RESULT Candidate = Default;
+        Candidate.ThreadCountM = std::min(ThreadCountM, Default.M);
+        Candidate.ThreadCountN = std::min(ThreadCountN, BlockedN);
+
+        for (const auto& Existing : Candidates) {
+            if (Existing.ThreadCountM == Candidate.ThreadCountM &&
+                Existing.ThreadCountN == Candidate.ThreadCountN) {
+                return;
+            }
+        }
+
+        Candidates.push_back(Candidate);
+    };
+
+    for (size_t Threads : TotalThreads) {
+
+        if (Threads == 0) {
+            continue;
+        }
+
+        AddCandidate(Threads, 1);
+        AddCandidate(1, Threads);
+
+        for (size_t a = size_t(std::sqrt(double(Threads))); a >= 2; a--) {
+            if (Threads % a == 0) {
+                AddCandidate(a, Threads / a);
+                AddCandidate(Threads / a, a);
+                break;
+            }
+        }
+    }
+}
+
+double
+MlasGemmTuningMeasure(
+    const MLAS_GEMM_TUNING_RESULT& Candidate,
+    const std::function<void(const MLAS_GEMM_TUNING_RESULT& Candidate)>& Benchmark
+    )
+{
+    //
+    // Warm up the caches and the thread pool, then keep the fastest of a few
+    // timed runs to filter out noise from other activity on the host.
+    //
+
+    Benchmark(Candidate);
+
+    double BestTime = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < 3; i++) {
+        const auto Start = std::chrono::steady_clock::now();
+        Benchmark(Candidate);
+        const auto Stop = std::chrono::steady_clock::now();
+        BestTime = std::min(BestTime, std::chrono::duration<double>(Stop - Start).count());
+    }
+
+    return BestTime;
+}
+
+}  // namespace
+
+bool
+MlasGemmTuningLookupMode(
+    MLAS_THREADPOOL* ThreadPool,
+    MLAS_GEMM_TUNING_MODE* Mode
+    )
+{
+    auto& State = MlasGemmTuningGetState();
+
+    std::shared_lock<std::shared_mutex> Guard(State.ModesLock);
+
+    auto it = State.Modes.find(ThreadPool);
+
+    if (it == State.Modes.end()) {
+        return false;
+    }
+
+    *Mode = it->second;
+    return true;
+}
+
+void
+MlasGemmTuningSelectParams(
+    const MLAS_GEMM_TUNING_MODE& Mode,
+    MLAS_GEMM_TUNING_RESULT& Tuning,
+    size_t BlockedN,
+    const size_t* StrideNCandidates,
+    size_t StrideNCandidateCount,
+    const std::function<void(const MLAS_GEMM_TUNING_RESULT& Candidate)>& Benchmark
+    )
+/*++
+
+Routine Description:
+
+    This routine selects the thread partition and blocking parameters for a
+    GEMM operation from the tuning cache, benchmarking the candidates first if
+    the shape has not been tuned yet and tuning is enabled.
+
+Arguments:
+
+    Mode - Supplies the tuning mode of the thread pool executing the GEMM
+        operation.
+
+    Tuning - Supplies the identifying fields and the default parameters of
+        the GEMM operation. On return, holds the parameters to use.
+
+    BlockedN - Supplies the number of thread aligned blocks along the N
+        dimension.
+
+    StrideNCandidates - Supplies the N strides to explore, or nullptr if the
+        operation does not support tuning the N stride.
+
+    StrideNCandidateCount - Supplies the number of N strides to explore.
+
+    Benchmark - Supplies a routine that executes the GEMM operation with the
+        candidate parameters without modifying the caller's output.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    auto& State = MlasGemmTuningGetState();
+    const MLAS_GEMM_TUNING_KEY Key = MlasGemmTuningMakeKey(Tuning);
+
+    const uint32_t MaxDurationMs = Mode.MaxDurationMs;
+
+    {
+        std::lock_guard<std::mutex> Guard(State.Lock);
+
+        auto it = State.Results.find(Key);
+
+        if (it != State.Results.end()) {
+            if (MlasGemmTuningIsValidParams(it->second, BlockedN, StrideNCandidates,
+                                            StrideNCandidateCount)) {
+                Tuning = it->second;
+            }
+            return;
+        }
+
+        //
+        // Only the first caller for a shape tunes it. Concurrent callers use
+        // the default parameters until the result is cached.
+        //
+
+        if (!Mode.Tune || !State.Tuning.insert(Key).second) {
+            return;
+        }
+    }
+
+    struct TUNING_ENTRY_GUARD {
+        MLAS_GEMM_TUNING_STATE& State;
+        const MLAS_GEMM_TUNING_KEY& Key;
+
+        ~TUNING_ENTRY_GUARD() {
+            std::lock_guard<std::mutex> Guard(State.Lock);
+            State.Tuning.erase(Key);
+        }
+    } TuningEntryGuard{State, Key};
+
+    //
+    // Search the thread partition with the default blocking, then search the
+    // blocking with the selected thread partition. The default configuration
+    // is always measured first so that an exhausted time budget still yields
+    // a sensible result.
+    //
+
+    const auto TuningStart = std::chrono::steady_clock::now();
+
+    auto BudgetExhausted = [&]() {
+        if (MaxDurationMs == 0) {
+            return false;
+        }
+        const auto Elapsed = std::chrono::steady_clock::now() - TuningStart;
+        return Elapsed > std::chrono::milliseconds(MaxDurationMs);
+    };
+
+    std::vector<MLAS_GEMM_TUNING_RESULT> Candidates;
+    Candidates.push_back(Tuning);
+    MlasGemmTuningAddThreadCandidates(Candidates, Tuning, BlockedN);
+
+    MLAS_GEMM_TUNING_RESULT Best = Tuning;
+    double BestTime = std::numeric_limits<double>::max();
+
+    for (const auto& Candidate : Candidates) {
+
+        const double Time = MlasGemmTuningMeasure(Candidate, Benchmark);
+
+        if (Time < BestTime) {
+            BestTime = Time;
+            Best = Candidate;
+        }
+
+        if (BudgetExhausted()) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < StrideNCandidateCount && !BudgetExhausted(); i++) {
+
+        MLAS_GEMM_TUNING_RESULT Candidate = Best;
+        Candidate.StrideN = StrideNCandidates[i];
+
+        if (Candidate.StrideN == Best.StrideN) {
+            continue;
+        }
+
+        const double Time = MlasGemmTuningMeasure(Candidate, Benchmark);
+
+        if (Time < BestTime) {
+            BestTime = Time;
+            Best = Candidate;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> Guard(State.Lock);
+        State.Results[Key] = Best;
+    }
+
+    Tuning = Best;
+}
+
+void
+MLASCALL
+MlasGemmTuningSetMode(
+    MLAS_THREADPOOL* ThreadPool,
+    const void* Owner,
+    bool UseResults,
+    bool Tune,
+    uint32_t MaxDurationMs
+    )
+{
+    auto& State = MlasGemmTuningGetState();
+
+    std::unique_lock<std::shared_mutex> Guard(State.ModesLock);
+
+    auto& OwnerModes = State.OwnerModes[ThreadPool];
+
+    if (UseResults) {
+        OwnerModes[Owner] = MLAS_GEMM_TUNING_MODE{Tune, MaxDurationMs};
+    } else {
+        OwnerModes.erase(Owner);
+    }
+
+    if (OwnerModes.empty()) {
+        State.OwnerModes.erase(ThreadPool);
+        State.Modes.erase(ThreadPool);
+    } else {
+
+        //
+        // The thread pool tunes if any of its owners does, with the largest
+        // time budget of those owners.
+        //
+
+        MLAS_GEMM_TUNING_MODE Mode{false, 0};
+
+        for (const auto& Entry : OwnerModes) {
+            if (!Entry.second.Tune) {
+                continue;
+            }
+            if (!Mode.Tune) {
+                Mode = Entry.second;
+            } else if (Mode.MaxDurationMs != 0) {
+                Mode.MaxDurationMs = (Entry.second.MaxDurationMs == 0) ?
+                    0 : std::max(Mode.MaxDurationMs, Entry.second.MaxDurationMs);
+            }
+        }
+
+        State.Modes[ThreadPool] = Mode;
+    }
+
+    MlasGemmTuningModeCount.store(State.Modes.size(), std::memory_order_relaxed);
+}
+
+size_t
+MLASCALL
+MlasGemmTuningGetResults(
+    MLAS_GEMM_TUNING_RESULT* Results,
+    size_t Count
+    )
+{
+    auto& State = MlasGemmTuningGetState();
+
+    std::lock_guard<std::mutex> Guard(State.Lock);
+
+    size_t Index = 0;
+
+    for (const auto& Entry : State.Results) {
+        if (Index >= Count) {
+            break;
+        }
+        Results[Index++] = Entry.second;
+    }
+
+    return State.Results.size();
+}
+
+void
+MLASCALL
+MlasGemmTuningAddResult(
+    const MLAS_GEMM_TUNING_RESULT& Result
+    )
+{
+    auto& State = MlasGemmTuningGetState();
+
+    std::lock_guard<std::mutex> Guard(State.Lock);
+
+    State.Results[MlasGemmTuningMakeKey(Result)] = Result;
+}
+
+void
+MLASCALL
+MlasGemmTuningClearResults(
+    void
+    )
+{
+    auto& State = MlasGemmTuningGetState();
+
+    std::lock_guard<std::mutex> Guard(State.Lock);
+
+    State.Results.clear();
+}
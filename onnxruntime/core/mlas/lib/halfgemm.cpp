@@ -419,7 +419,7 @@ HGemmOperation(
                     const MLAS_FP16* aa = a;
                     MLAS_FP16* cc = c;
                     for (size_t m = 0, countM; m < RangeCountM; m += countM) {
-                        countM = std::min(StrideM, RangeCountM - m);
+                        countM = std::min(dispatch->PackedBStrideM, RangeCountM - m);
                         // First K iteration, beta is applied to the whole C. In rest K iterations, use add mode.
                         dispatch->HGemmKernel_PackedB(
                             aa, PackedB, cc, countM, countN, countK, lda, ldc, alpha, k == 0 ? beta : beta_add.val);
@@ -483,7 +483,7 @@ HGemmOperation(
                     const MLAS_FP16* aa = a;
                     MLAS_FP16* cc = c;
                     for (size_t m = 0, countM; m < RangeCountM; m += countM) {
-                        countM = std::min(StrideM, RangeCountM - m);
+                        countM = std::min(dispatch->PackedBStrideM, RangeCountM - m);
                         // First K iteration, beta is applied to the whole C. In rest K iterations, use add mode.
                         dispatch->HGemmKernel_PackedB(
                             aa, PackedB, cc, countM, countN, countK, lda, ldc, alpha, k == 0 ? beta : beta_add.val);
@@ -681,7 +681,7 @@ struct MLAS_HGEMM_DISPATCH {
     HGemmKernel_B_Fn* HGemmKernel_B = nullptr;
 
     /**
-     * @brief C = alpha * A * Transpose(B) + beta * C. CountM <= 2. B has been packed using
+     * @brief C = alpha * A * Transpose(B) + beta * C. CountM <= PackedBStrideM. B has been packed using
      *        HPackBKernel_TransposedB_Fn or HPackBKernel_B_Fn. Use when M is large.
      *
      * @param       A                   first row of the A matrix segment. Row major.
@@ -709,4 +709,9 @@ struct MLAS_HGEMM_DISPATCH {
     );
 
     HGemmKernel_PackedB_Fn* HGemmKernel_PackedB = nullptr;
+
+    /**
+     * @brief The number of rows of A multiplied with the packed B per HGemmKernel_PackedB call.
+     */
+    size_t PackedBStrideM = 2;
 };
@@ -0,0 +1,465 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    hgemm_kernel_avx2.cpp
+
+Abstract:
+
+    This module implements the half precision GEMM kernels for AVX2 supported
+    h/w. fp16 values are loaded and converted with F16C and accumulated in
+    fp32 with FMA.
+
+    B is packed to panels of 16 columns. Each panel stores CountK rows of 16
+    fp16 values, the columns past CountN are padded with 0.
+
+--*/
+
+#include <cstring>
+
+#include "mlasi.h"
+#include "halfgemm.h"
+
+namespace hgemm_avx2 {
+
+namespace {
+
+constexpr size_t PanelN = 16;
+
+// The A rows are converted to fp32 in chunks of ChunkK.
+constexpr size_t ChunkK = 512;
+
+// 0: beta == 0, C is not read. 1: beta == 1. 2: otherwise.
+MLAS_FORCEINLINE
+int
+GetBetaMode(_mlas_fp16_ beta)
+{
+    if ((beta & 0x7fff) == 0) {
+        return 0;
+    }
+    return beta == MLAS_FP16(1.0f).val ? 1 : 2;
+}
+
+MLAS_FORCEINLINE
+__m256
+LoadHalf8(const MLAS_FP16* p)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+MLAS_FORCEINLINE
+__m256
+LoadPartialHalf8(const MLAS_FP16* p, size_t n)
+{
+    MLAS_DECLSPEC_ALIGN(uint16_t buffer[8], 16) = {};
+    std::memcpy(buffer, p, n * sizeof(MLAS_FP16));
+    return _mm256_cvtph_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(buffer)));
+}
+
+MLAS_FORCEINLINE
+void
+StoreHalf8(MLAS_FP16* p, __m256 v, size_t n)
+{
+    const __m128i h = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+    if (n >= 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), h);
+    } else {
+        MLAS_DECLSPEC_ALIGN(uint16_t buffer[8], 16);
+        _mm_store_si128(reinterpret_cast<__m128i*>(buffer), h);
+        std::memcpy(p, buffer, n * sizeof(MLAS_FP16));
+    }
+}
+
+// C = alpha * acc + beta * C for n <= 8 elements.
+MLAS_FORCEINLINE
+void
+StoreC8(MLAS_FP16* C, __m256 acc, __m256 alpha, __m256 beta, int BetaMode, size_t n)
+{
+    __m256 result;
+    if (BetaMode == 0) {
+        result = _mm256_mul_ps(acc, alpha);
+    } else {
+        __m256 c = n >= 8 ? LoadHalf8(C) : LoadPartialHalf8(C, n);
+        if (BetaMode == 2) {
+            c = _mm256_mul_ps(c, beta);
+        }
+        result = _mm256_fmadd_ps(acc, alpha, c);
+    }
+    StoreHalf8(C, result, n);
+}
+
+void
+ConvertA(const MLAS_FP16* A, size_t lda, size_t CountM, size_t CountK, float* Af)
+{
+    for (size_t m = 0; m < CountM; ++m) {
+        const MLAS_FP16* a = A + m * lda;
+        float* af = Af + m * ChunkK;
+        size_t k = 0;
+        for (; k + 8 <= CountK; k += 8) {
+            _mm256_storeu_ps(af + k, LoadHalf8(a + k));
+        }
+        if (k < CountK) {
+            _mm256_storeu_ps(af + k, LoadPartialHalf8(a + k, CountK - k));
+        }
+    }
+}
+
+//
+// Computes RowCount rows of VecCount * 8 columns of C. The B block is made of
+// 16 column panels PanelStride apart, row k of a panel is at k * ldb. The last
+// vector loads LastCount columns.
+//
+template <size_t RowCount, size_t VecCount>
+MLAS_FORCEINLINE
+void
+ComputeBlock(
+    const float* Af,
+    const MLAS_FP16* B,
+    size_t ldb,
+    size_t PanelStride,
+    size_t CountK,
+    size_t LastCount,
+    __m256 acc[RowCount][VecCount]
+)
+{
+    for (size_t k = 0; k < CountK; ++k) {
+        __m256 b[VecCount];
+        for (size_t v = 0; v < VecCount; ++v) {
+            const MLAS_FP16* bv = B + (v / 2) * PanelStride + (v % 2) * 8;
+            b[v] = (v + 1 < VecCount || LastCount == 8) ? LoadHalf8(bv) : LoadPartialHalf8(bv, LastCount);
+        }
+        for (size_t r = 0; r < RowCount; ++r) {
+            const __m256 a = _mm256_broadcast_ss(Af + r * ChunkK + k);
+            for (size_t v = 0; v < VecCount; ++v) {
+                acc[r][v] = _mm256_fmadd_ps(a, b[v], acc[r][v]);
+            }
+        }
+        B += ldb;
+    }
+}
+
+//
+// C = alpha * A * B + beta * C for RowCount rows and CountN <= VecCount * 8
+// columns. B is either row major or packed, see ComputeBlock. A is converted
+// in chunks of ChunkK into Af, unless ConvertedA says Af already holds the
+// whole A.
+//
+template <size_t RowCount, size_t VecCount>
+void
+GemmBlock(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    bool PackedB,
+    float* Af,
+    bool ConvertedA,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    __m256 acc[RowCount][VecCount];
+    for (size_t r = 0; r < RowCount; ++r) {
+        for (size_t v = 0; v < VecCount; ++v) {
+            acc[r][v] = _mm256_setzero_ps();
+        }
+    }
+
+    // the packed panels are padded with 0
+    const size_t LastCount = PackedB ? 8 : CountN - (VecCount - 1) * 8;
+    const size_t PanelStride = PackedB ? CountK * PanelN : PanelN;
+    for (size_t k = 0, countK; k < CountK; k += countK) {
+        countK = std::min(ChunkK, CountK - k);
+        if (!ConvertedA) {
+            ConvertA(A + k, lda, RowCount, countK, Af);
+        }
+        ComputeBlock<RowCount, VecCount>(Af, B + k * ldb, ldb, PanelStride, countK, LastCount, acc);
+    }
+
+    const __m256 alpha_v = _mm256_set1_ps(MLAS_Half2Float(alpha));
+    const __m256 beta_v = _mm256_set1_ps(MLAS_Half2Float(beta));
+    const int BetaMode = GetBetaMode(beta);
+    for (size_t r = 0; r < RowCount; ++r) {
+        for (size_t v = 0; v < VecCount; ++v) {
+            StoreC8(C + r * ldc + v * 8, acc[r][v], alpha_v, beta_v, BetaMode, std::min<size_t>(8, CountN - v * 8));
+        }
+    }
+}
+
+template <size_t RowCount>
+void
+GemmRows(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    bool PackedB,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    MLAS_DECLSPEC_ALIGN(float Af[RowCount * ChunkK], 32);
+    const bool ConvertedA = CountK <= ChunkK;
+    if (ConvertedA) {
+        ConvertA(A, lda, RowCount, CountK, Af);
+    }
+
+    // 1 or 2 rows x 4 vectors, or up to 6 rows x 2 vectors of accumulators
+    constexpr size_t VecCount = RowCount <= 2 ? 4 : 2;
+    constexpr size_t BlockN = VecCount * 8;
+
+    for (size_t n = 0; n < CountN; n += BlockN) {
+        const size_t countN = std::min(BlockN, CountN - n);
+        const MLAS_FP16* b = PackedB ? B + n * CountK : B + n;
+        const size_t vecs = (countN + 7) / 8;
+        if (vecs == VecCount) {
+            GemmBlock<RowCount, VecCount>(A, b, C + n, countN, CountK, lda, ldb, ldc, PackedB, Af, ConvertedA, alpha, beta);
+        } else if (vecs == 1) {
+            GemmBlock<RowCount, 1>(A, b, C + n, countN, CountK, lda, ldb, ldc, PackedB, Af, ConvertedA, alpha, beta);
+        } else if constexpr (VecCount == 4) {
+            if (vecs == 2) {
+                GemmBlock<RowCount, 2>(A, b, C + n, countN, CountK, lda, ldb, ldc, PackedB, Af, ConvertedA, alpha, beta);
+            } else {
+                GemmBlock<RowCount, 3>(A, b, C + n, countN, CountK, lda, ldb, ldc, PackedB, Af, ConvertedA, alpha, beta);
+            }
+        }
+    }
+}
+
+//
+// Returns the sums of the 4 vectors in a 128-bit vector.
+//
+MLAS_FORCEINLINE
+__m128
+ReduceSum4(__m256 v0, __m256 v1, __m256 v2, __m256 v3)
+{
+    const __m256 s = _mm256_hadd_ps(_mm256_hadd_ps(v0, v1), _mm256_hadd_ps(v2, v3));
+    return _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+}
+
+template <size_t RowCount>
+void
+GemmTransposedBRows(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    const __m256 alpha_v = _mm256_set1_ps(MLAS_Half2Float(alpha));
+    const __m256 beta_v = _mm256_set1_ps(MLAS_Half2Float(beta));
+    const int BetaMode = GetBetaMode(beta);
+
+    for (size_t n = 0; n < CountN; n += 4) {
+        const size_t countN = std::min<size_t>(4, CountN - n);
+        const MLAS_FP16* b[4];
+        for (size_t i = 0; i < 4; ++i) {
+            // the missing columns repeat the last one and are not stored
+            b[i] = B + (n + std::min(i, countN - 1)) * ldb;
+        }
+
+        __m256 acc[RowCount][4];
+        for (size_t r = 0; r < RowCount; ++r) {
+            for (size_t i = 0; i < 4; ++i) {
+                acc[r][i] = _mm256_setzero_ps();
+            }
+        }
+
+        size_t k = 0;
+        for (; k + 8 <= CountK; k += 8) {
+            __m256 bv[4];
+            for (size_t i = 0; i < 4; ++i) {
+                bv[i] = LoadHalf8(b[i] + k);
+            }
+            for (size_t r = 0; r < RowCount; ++r) {
+                const __m256 a = LoadHalf8(A + r * lda + k);
+                for (size_t i = 0; i < 4; ++i) {
+                    acc[r][i] = _mm256_fmadd_ps(a, bv[i], acc[r][i]);
+                }
+            }
+        }
+        if (k < CountK) {
+            const size_t countK = CountK - k;
+            __m256 bv[4];
+            for (size_t i = 0; i < 4; ++i) {
+                bv[i] = LoadPartialHalf8(b[i] + k, countK);
+            }
+            for (size_t r = 0; r < RowCount; ++r) {
+                const __m256 a = LoadPartialHalf8(A + r * lda + k, countK);
+                for (size_t i = 0; i < 4; ++i) {
+                    acc[r][i] = _mm256_fmadd_ps(a, bv[i], acc[r][i]);
+                }
+            }
+        }
+
+        for (size_t r = 0; r < RowCount; ++r) {
+            const __m128 sum = ReduceSum4(acc[r][0], acc[r][1], acc[r][2], acc[r][3]);
+            StoreC8(C + r * ldc + n, _mm256_castps128_ps256(sum), alpha_v, beta_v, BetaMode, countN);
+        }
+    }
+}
+
+}  // namespace
+
+void
+HPackB_TransposedB_Kernel(
+    const MLAS_FP16* B,
+    MLAS_FP16* PackedB,
+    size_t CountN,
+    size_t CountK,
+    size_t ldb
+)
+{
+    for (size_t n = 0; n < CountN; n += PanelN) {
+        const size_t countN = std::min(PanelN, CountN - n);
+        for (size_t i = 0; i < countN; ++i) {
+            const MLAS_FP16* b = B + (n + i) * ldb;
+            for (size_t k = 0; k < CountK; ++k) {
+                PackedB[k * PanelN + i] = b[k];
+            }
+        }
+        for (size_t i = countN; i < PanelN; ++i) {
+            for (size_t k = 0; k < CountK; ++k) {
+                PackedB[k * PanelN + i].val = 0;
+            }
+        }
+        PackedB += CountK * PanelN;
+    }
+}
+
+void
+HPackB_B_Kernel(
+    const MLAS_FP16* B,
+    MLAS_FP16* PackedB,
+    size_t CountN,
+    size_t CountK,
+    size_t ldb
+)
+{
+    for (size_t n = 0; n < CountN; n += PanelN) {
+        const size_t countN = std::min(PanelN, CountN - n);
+        const MLAS_FP16* b = B + n;
+        for (size_t k = 0; k < CountK; ++k) {
+            if (countN == PanelN) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(PackedB),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+            } else {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(PackedB), _mm256_setzero_si256());
+                std::memcpy(PackedB, b, countN * sizeof(MLAS_FP16));
+            }
+            b += ldb;
+            PackedB += PanelN;
+        }
+    }
+}
+
+void
+HGemm_TransposedB_Kernel(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    if (CountM == 1) {
+        GemmTransposedBRows<1>(A, B, C, CountN, CountK, lda, ldb, ldc, alpha, beta);
+    } else {
+        GemmTransposedBRows<2>(A, B, C, CountN, CountK, lda, ldb, ldc, alpha, beta);
+    }
+}
+
+void
+HGemm_B_Kernel(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    if (CountM == 1) {
+        GemmRows<1>(A, B, C, CountN, CountK, lda, ldb, ldc, false, alpha, beta);
+    } else {
+        GemmRows<2>(A, B, C, CountN, CountK, lda, ldb, ldc, false, alpha, beta);
+    }
+}
+
+void
+HGemm_PackedB_Kernel(
+    const MLAS_FP16* A,
+    const MLAS_FP16* PackedB,
+    MLAS_FP16* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    switch (CountM) {
+        case 1:
+            GemmRows<1>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 2:
+            GemmRows<2>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 3:
+            GemmRows<3>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 4:
+            GemmRows<4>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 5:
+            GemmRows<5>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        default:
+            GemmRows<6>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+    }
+}
+
+}  // namespace hgemm_avx2
+
+const MLAS_HGEMM_DISPATCH MlasHGemmDispatchAvx2 = [](){
+    MLAS_HGEMM_DISPATCH d;
+    d.HPackBKernel_TransposedB = hgemm_avx2::HPackB_TransposedB_Kernel;
+    d.HPackBKernel_B = hgemm_avx2::HPackB_B_Kernel;
+    d.HGemmKernel_TransposedB = hgemm_avx2::HGemm_TransposedB_Kernel;
+    d.HGemmKernel_B = hgemm_avx2::HGemm_B_Kernel;
+    d.HGemmKernel_PackedB = hgemm_avx2::HGemm_PackedB_Kernel;
+    d.PackedBStrideM = 6;
+    return d;
+}();
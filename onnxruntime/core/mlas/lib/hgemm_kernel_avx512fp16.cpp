@@ -0,0 +1,386 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    hgemm_kernel_avx512fp16.cpp
+
+Abstract:
+
+    This module implements the half precision GEMM kernels for AVX512_FP16
+    supported h/w. Like the NEON kernels, the products are accumulated in
+    fp16.
+
+    B is packed to panels of 32 columns. Each panel stores CountK rows of 32
+    fp16 values, the columns past CountN are padded with 0.
+
+--*/
+
+#include "mlasi.h"
+#include "halfgemm.h"
+
+namespace hgemm_avx512fp16 {
+
+namespace {
+
+constexpr size_t PanelN = 32;
+
+// 0: beta == 0, C is not read. 1: beta == 1. 2: otherwise.
+MLAS_FORCEINLINE
+int
+GetBetaMode(_mlas_fp16_ beta)
+{
+    if ((beta & 0x7fff) == 0) {
+        return 0;
+    }
+    return beta == MLAS_FP16(1.0f).val ? 1 : 2;
+}
+
+MLAS_FORCEINLINE
+__mmask32
+GetMask(size_t n)
+{
+    return n >= 32 ? __mmask32(0xffffffff) : __mmask32((uint32_t(1) << n) - 1);
+}
+
+MLAS_FORCEINLINE
+__m512h
+BroadcastHalf(_mlas_fp16_ v)
+{
+    return _mm512_castsi512_ph(_mm512_set1_epi16(static_cast<short>(v)));
+}
+
+MLAS_FORCEINLINE
+__m512h
+LoadHalf32(const MLAS_FP16* p, __mmask32 mask)
+{
+    return _mm512_castsi512_ph(_mm512_maskz_loadu_epi16(mask, p));
+}
+
+// C = alpha * acc + beta * C for the columns in mask.
+MLAS_FORCEINLINE
+void
+StoreC32(MLAS_FP16* C, __m512h acc, __m512h alpha, __m512h beta, int BetaMode, __mmask32 mask)
+{
+    __m512h result;
+    if (BetaMode == 0) {
+        result = _mm512_mul_ph(acc, alpha);
+    } else {
+        __m512h c = LoadHalf32(C, mask);
+        if (BetaMode == 2) {
+            c = _mm512_mul_ph(c, beta);
+        }
+        result = _mm512_fmadd_ph(acc, alpha, c);
+    }
+    _mm512_mask_storeu_epi16(C, mask, _mm512_castph_si512(result));
+}
+
+//
+// C = alpha * A * B + beta * C for RowCount rows and CountN <= VecCount * 32
+// columns. The B block is made of 32 column panels PanelStride apart, row k of
+// a panel is at k * ldb.
+//
+template <size_t RowCount, size_t VecCount>
+void
+GemmBlock(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    size_t PanelStride,
+    __mmask32 LoadMask,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    __m512h acc[RowCount][VecCount];
+    for (size_t r = 0; r < RowCount; ++r) {
+        for (size_t v = 0; v < VecCount; ++v) {
+            acc[r][v] = _mm512_setzero_ph();
+        }
+    }
+
+    for (size_t k = 0; k < CountK; ++k) {
+        __m512h b[VecCount];
+        for (size_t v = 0; v < VecCount; ++v) {
+            b[v] = LoadHalf32(B + v * PanelStride, v + 1 < VecCount ? __mmask32(0xffffffff) : LoadMask);
+        }
+        for (size_t r = 0; r < RowCount; ++r) {
+            const __m512h a = BroadcastHalf(A[r * lda + k].val);
+            for (size_t v = 0; v < VecCount; ++v) {
+                acc[r][v] = _mm512_fmadd_ph(a, b[v], acc[r][v]);
+            }
+        }
+        B += ldb;
+    }
+
+    const __m512h alpha_v = BroadcastHalf(alpha);
+    const __m512h beta_v = BroadcastHalf(beta);
+    const int BetaMode = GetBetaMode(beta);
+    for (size_t r = 0; r < RowCount; ++r) {
+        for (size_t v = 0; v < VecCount; ++v) {
+            StoreC32(C + r * ldc + v * 32, acc[r][v], alpha_v, beta_v, BetaMode, GetMask(CountN - v * 32));
+        }
+    }
+}
+
+template <size_t RowCount>
+void
+GemmRows(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    bool PackedB,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    // 1 or 2 rows x 4 vectors, or up to 6 rows x 2 vectors of accumulators
+    constexpr size_t VecCount = RowCount <= 2 ? 4 : 2;
+    constexpr size_t BlockN = VecCount * 32;
+    const size_t PanelStride = PackedB ? CountK * PanelN : PanelN;
+
+    for (size_t n = 0; n < CountN; n += BlockN) {
+        const size_t countN = std::min(BlockN, CountN - n);
+        const MLAS_FP16* b = PackedB ? B + n * CountK : B + n;
+        // the packed panels are padded with 0
+        const __mmask32 LoadMask = PackedB ? __mmask32(0xffffffff) : GetMask(countN % 32 == 0 ? 32 : countN % 32);
+        const size_t vecs = (countN + 31) / 32;
+        if (vecs == VecCount) {
+            GemmBlock<RowCount, VecCount>(A, b, C + n, countN, CountK, lda, ldb, ldc, PanelStride, LoadMask, alpha, beta);
+        } else if (vecs == 1) {
+            GemmBlock<RowCount, 1>(A, b, C + n, countN, CountK, lda, ldb, ldc, PanelStride, LoadMask, alpha, beta);
+        } else if constexpr (VecCount == 4) {
+            if (vecs == 2) {
+                GemmBlock<RowCount, 2>(A, b, C + n, countN, CountK, lda, ldb, ldc, PanelStride, LoadMask, alpha, beta);
+            } else {
+                GemmBlock<RowCount, 3>(A, b, C + n, countN, CountK, lda, ldb, ldc, PanelStride, LoadMask, alpha, beta);
+            }
+        }
+    }
+}
+
+MLAS_FORCEINLINE
+float
+ReduceSum(__m512h v)
+{
+    const __m512 lo = _mm512_cvtxph_ps(_mm256_castsi256_ph(_mm512_castsi512_si256(_mm512_castph_si512(v))));
+    const __m512 hi = _mm512_cvtxph_ps(_mm256_castsi256_ph(_mm512_extracti64x4_epi64(_mm512_castph_si512(v), 1)));
+    return _mm512_reduce_add_ps(_mm512_add_ps(lo, hi));
+}
+
+template <size_t RowCount>
+void
+GemmTransposedBRows(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    const float alphaf = MLAS_Half2Float(alpha);
+    const float betaf = MLAS_Half2Float(beta);
+    const int BetaMode = GetBetaMode(beta);
+
+    for (size_t n = 0; n < CountN; n += 4) {
+        const size_t countN = std::min<size_t>(4, CountN - n);
+        const MLAS_FP16* b[4];
+        for (size_t i = 0; i < 4; ++i) {
+            // the missing columns repeat the last one and are not stored
+            b[i] = B + (n + std::min(i, countN - 1)) * ldb;
+        }
+
+        __m512h acc[RowCount][4];
+        for (size_t r = 0; r < RowCount; ++r) {
+            for (size_t i = 0; i < 4; ++i) {
+                acc[r][i] = _mm512_setzero_ph();
+            }
+        }
+
+        for (size_t k = 0; k < CountK; k += 32) {
+            const __mmask32 mask = GetMask(CountK - k);
+            __m512h bv[4];
+            for (size_t i = 0; i < 4; ++i) {
+                bv[i] = LoadHalf32(b[i] + k, mask);
+            }
+            for (size_t r = 0; r < RowCount; ++r) {
+                const __m512h a = LoadHalf32(A + r * lda + k, mask);
+                for (size_t i = 0; i < 4; ++i) {
+                    acc[r][i] = _mm512_fmadd_ph(a, bv[i], acc[r][i]);
+                }
+            }
+        }
+
+        for (size_t r = 0; r < RowCount; ++r) {
+            MLAS_FP16* c = C + r * ldc + n;
+            for (size_t i = 0; i < countN; ++i) {
+                float result = ReduceSum(acc[r][i]) * alphaf;
+                if (BetaMode == 1) {
+                    result += c[i].ToFloat();
+                } else if (BetaMode == 2) {
+                    result += c[i].ToFloat() * betaf;
+                }
+                c[i] = MLAS_FP16(result);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+void
+HPackB_TransposedB_Kernel(
+    const MLAS_FP16* B,
+    MLAS_FP16* PackedB,
+    size_t CountN,
+    size_t CountK,
+    size_t ldb
+)
+{
+    for (size_t n = 0; n < CountN; n += PanelN) {
+        const size_t countN = std::min(PanelN, CountN - n);
+        for (size_t i = 0; i < countN; ++i) {
+            const MLAS_FP16* b = B + (n + i) * ldb;
+            for (size_t k = 0; k < CountK; ++k) {
+                PackedB[k * PanelN + i] = b[k];
+            }
+        }
+        for (size_t i = countN; i < PanelN; ++i) {
+            for (size_t k = 0; k < CountK; ++k) {
+                PackedB[k * PanelN + i].val = 0;
+            }
+        }
+        PackedB += CountK * PanelN;
+    }
+}
+
+void
+HPackB_B_Kernel(
+    const MLAS_FP16* B,
+    MLAS_FP16* PackedB,
+    size_t CountN,
+    size_t CountK,
+    size_t ldb
+)
+{
+    for (size_t n = 0; n < CountN; n += PanelN) {
+        const __mmask32 mask = GetMask(CountN - n);
+        const MLAS_FP16* b = B + n;
+        for (size_t k = 0; k < CountK; ++k) {
+            _mm512_storeu_si512(PackedB, _mm512_maskz_loadu_epi16(mask, b));
+            b += ldb;
+            PackedB += PanelN;
+        }
+    }
+}
+
+void
+HGemm_TransposedB_Kernel(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    if (CountM == 1) {
+        GemmTransposedBRows<1>(A, B, C, CountN, CountK, lda, ldb, ldc, alpha, beta);
+    } else {
+        GemmTransposedBRows<2>(A, B, C, CountN, CountK, lda, ldb, ldc, alpha, beta);
+    }
+}
+
+void
+HGemm_B_Kernel(
+    const MLAS_FP16* A,
+    const MLAS_FP16* B,
+    MLAS_FP16* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldb,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    if (CountM == 1) {
+        GemmRows<1>(A, B, C, CountN, CountK, lda, ldb, ldc, false, alpha, beta);
+    } else {
+        GemmRows<2>(A, B, C, CountN, CountK, lda, ldb, ldc, false, alpha, beta);
+    }
+}
+
+void
+HGemm_PackedB_Kernel(
+    const MLAS_FP16* A,
+    const MLAS_FP16* PackedB,
+    MLAS_FP16* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t lda,
+    size_t ldc,
+    _mlas_fp16_ alpha,
+    _mlas_fp16_ beta
+)
+{
+    switch (CountM) {
+        case 1:
+            GemmRows<1>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 2:
+            GemmRows<2>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 3:
+            GemmRows<3>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 4:
+            GemmRows<4>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        case 5:
+            GemmRows<5>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+        default:
+            GemmRows<6>(A, PackedB, C, CountN, CountK, lda, PanelN, ldc, true, alpha, beta);
+            break;
+    }
+}
+
+}  // namespace hgemm_avx512fp16
+
+const MLAS_HGEMM_DISPATCH MlasHGemmDispatchAvx512Fp16 = [](){
+    MLAS_HGEMM_DISPATCH d;
+    d.HPackBKernel_TransposedB = hgemm_avx512fp16::HPackB_TransposedB_Kernel;
+    d.HPackBKernel_B = hgemm_avx512fp16::HPackB_B_Kernel;
+    d.HGemmKernel_TransposedB = hgemm_avx512fp16::HGemm_TransposedB_Kernel;
+    d.HGemmKernel_B = hgemm_avx512fp16::HGemm_B_Kernel;
+    d.HGemmKernel_PackedB = hgemm_avx512fp16::HGemm_PackedB_Kernel;
+    d.PackedBStrideM = 6;
+    return d;
+}();
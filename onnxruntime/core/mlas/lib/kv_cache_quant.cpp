@@ -0,0 +1,134 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    kv_cache_quant.cpp
+
+Abstract:
+
+    This module implements the quantization and dequantization of the key/value
+    cache of attention to signed int8 or int4 with a scale per channel.
+
+--*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "kv_cache_quant.h"
+
+void
+MlasDequantizeKVCacheS8_FallBack(
+    const int8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+)
+{
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < channels; ++c) {
+            output[c] = static_cast<float>(input[c]) * scales[c];
+        }
+        input += channels;
+        output += channels;
+    }
+}
+
+void
+MlasDequantizeKVCacheS4_FallBack(
+    const uint8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+)
+{
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < channels; c += 2) {
+            const uint8_t packed = input[c / 2];
+            // sign extend each nibble
+            const int8_t low = static_cast<int8_t>(static_cast<uint8_t>(packed << 4)) >> 4;
+            const int8_t high = static_cast<int8_t>(packed) >> 4;
+            output[c] = static_cast<float>(low) * scales[c];
+            output[c + 1] = static_cast<float>(high) * scales[c + 1];
+        }
+        input += channels / 2;
+        output += channels;
+    }
+}
+
+void
+MLASCALL
+MlasQuantizeKVCache(
+    const float* Input,
+    void* Output,
+    size_t Rows,
+    size_t Channels,
+    const float* Scales,
+    size_t BitWidth
+)
+{
+    const int32_t maximum = BitWidth == 4 ? 7 : 127;
+    const int32_t minimum = -maximum - 1;
+
+    auto quantize = [&](float value, float scale) {
+        const float scaled = scale != 0.0f ? std::nearbyint(value / scale) : 0.0f;
+        return static_cast<int32_t>(std::clamp(scaled, static_cast<float>(minimum), static_cast<float>(maximum)));
+    };
+
+    if (BitWidth == 4) {
+        uint8_t* output = static_cast<uint8_t*>(Output);
+        for (size_t r = 0; r < Rows; ++r) {
+            for (size_t c = 0; c < Channels; c += 2) {
+                const int32_t low = quantize(Input[c], Scales[c]);
+                const int32_t high = quantize(Input[c + 1], Scales[c + 1]);
+                output[c / 2] = static_cast<uint8_t>((low & 0x0F) | ((high & 0x0F) << 4));
+            }
+            Input += Channels;
+            output += Channels / 2;
+        }
+    } else {
+        int8_t* output = static_cast<int8_t*>(Output);
+        for (size_t r = 0; r < Rows; ++r) {
+            for (size_t c = 0; c < Channels; ++c) {
+                output[c] = static_cast<int8_t>(quantize(Input[c], Scales[c]));
+            }
+            Input += Channels;
+            output += Channels;
+        }
+    }
+}
+
+void
+MLASCALL
+MlasDequantizeKVCache(
+    const void* Input,
+    float* Output,
+    size_t Rows,
+    size_t Channels,
+    const float* Scales,
+    size_t BitWidth
+)
+{
+    const auto* dispatch = GetMlasPlatform().KVCacheQuantDispatch;
+
+    if (BitWidth == 4) {
+        const auto* input = static_cast<const uint8_t*>(Input);
+        if (dispatch == nullptr || dispatch->DequantizeS4 == nullptr) {
+            MlasDequantizeKVCacheS4_FallBack(input, Output, Rows, Channels, Scales);
+            return;
+        }
+        dispatch->DequantizeS4(input, Output, Rows, Channels, Scales);
+    } else {
+        const auto* input = static_cast<const int8_t*>(Input);
+        if (dispatch == nullptr || dispatch->DequantizeS8 == nullptr) {
+            MlasDequantizeKVCacheS8_FallBack(input, Output, Rows, Channels, Scales);
+            return;
+        }
+        dispatch->DequantizeS8(input, Output, Rows, Channels, Scales);
+    }
+}
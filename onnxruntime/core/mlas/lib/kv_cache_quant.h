@@ -0,0 +1,63 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    kv_cache_quant.h
+
+Abstract:
+
+    This module includes kernel function prototypes and helper functions for
+    quantizing and dequantizing the key/value cache of attention.
+
+--*/
+
+#pragma once
+
+#include "mlasi.h"
+
+struct MLAS_KV_CACHE_QUANT_DISPATCH {
+    // dequantize rows of signed int8 with a scale per channel
+    typedef void(DequantizeS8_Fn)(
+        const int8_t* input,
+        float* output,
+        size_t rows,
+        size_t channels,
+        const float* scales
+    );
+
+    DequantizeS8_Fn* DequantizeS8 = nullptr;
+
+    // dequantize rows of signed int4, two per byte with the even channel in the low nibble,
+    // with a scale per channel
+    typedef void(DequantizeS4_Fn)(
+        const uint8_t* input,
+        float* output,
+        size_t rows,
+        size_t channels,
+        const float* scales
+    );
+
+    DequantizeS4_Fn* DequantizeS4 = nullptr;
+};
+
+void
+MlasDequantizeKVCacheS8_FallBack(
+    const int8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+);
+
+void
+MlasDequantizeKVCacheS4_FallBack(
+    const uint8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+);
@@ -0,0 +1,97 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    kv_cache_quant_kernel_avx2.cpp
+
+Abstract:
+
+    This module implements the key/value cache dequantization kernels for AVX2
+    supported h/w.
+
+--*/
+
+#include "kv_cache_quant.h"
+
+namespace kv_cache_quant_avx2 {
+
+namespace {
+
+void
+DequantizeS8Kernel_Avx2(
+    const int8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+)
+{
+    for (size_t r = 0; r < rows; ++r) {
+        size_t c = 0;
+        for (; c + 8 <= channels; c += 8) {
+            const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + c));
+            const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+            _mm256_storeu_ps(output + c, _mm256_mul_ps(values, _mm256_loadu_ps(scales + c)));
+        }
+        for (; c < channels; ++c) {
+            output[c] = static_cast<float>(input[c]) * scales[c];
+        }
+        input += channels;
+        output += channels;
+    }
+}
+
+void
+DequantizeS4Kernel_Avx2(
+    const uint8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+)
+{
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    const __m128i sign_bit = _mm_set1_epi8(0x08);
+
+    for (size_t r = 0; r < rows; ++r) {
+        size_t c = 0;
+        for (; c + 16 <= channels; c += 16) {
+            // 8 bytes hold 16 channels, the even ones in the low nibbles
+            const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + c / 2));
+            __m128i low = _mm_and_si128(packed, low_mask);
+            __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), low_mask);
+            // sign extend the nibbles: (v ^ 8) - 8
+            low = _mm_sub_epi8(_mm_xor_si128(low, sign_bit), sign_bit);
+            high = _mm_sub_epi8(_mm_xor_si128(high, sign_bit), sign_bit);
+            const __m128i bytes = _mm_unpacklo_epi8(low, high);
+
+            const __m256 values0 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+            const __m256 values1 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(bytes, 8)));
+            _mm256_storeu_ps(output + c, _mm256_mul_ps(values0, _mm256_loadu_ps(scales + c)));
+            _mm256_storeu_ps(output + c + 8, _mm256_mul_ps(values1, _mm256_loadu_ps(scales + c + 8)));
+        }
+        if (c < channels) {
+            MlasDequantizeKVCacheS4_FallBack(input + c / 2, output + c, 1, channels - c, scales + c);
+        }
+        input += channels / 2;
+        output += channels;
+    }
+}
+
+}  // namespace
+
+}  // namespace kv_cache_quant_avx2
+
+//
+// Kernel dispatch structure definition.
+//
+const MLAS_KV_CACHE_QUANT_DISPATCH MlasKVCacheQuantDispatchAvx2 = []() {
+    MLAS_KV_CACHE_QUANT_DISPATCH d;
+    d.DequantizeS8 = kv_cache_quant_avx2::DequantizeS8Kernel_Avx2;
+    d.DequantizeS4 = kv_cache_quant_avx2::DequantizeS4Kernel_Avx2;
+    return d;
+}();
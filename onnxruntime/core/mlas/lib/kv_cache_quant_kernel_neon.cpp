@@ -0,0 +1,109 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    kv_cache_quant_kernel_neon.cpp
+
+Abstract:
+
+    This module implements the key/value cache dequantization kernels for ARM
+    NEON.
+
+--*/
+
+#include <arm_neon.h>
+
+#include "kv_cache_quant.h"
+
+namespace kv_cache_quant_neon {
+
+namespace {
+
+MLAS_FORCEINLINE void
+DequantizeS8x8(
+    int8x8_t bytes,
+    const float* scales,
+    float* output
+)
+{
+    const int16x8_t values = vmovl_s8(bytes);
+    const float32x4_t values0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(values)));
+    const float32x4_t values1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(values)));
+    vst1q_f32(output, vmulq_f32(values0, vld1q_f32(scales)));
+    vst1q_f32(output + 4, vmulq_f32(values1, vld1q_f32(scales + 4)));
+}
+
+void
+DequantizeS8Kernel_Neon(
+    const int8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+)
+{
+    for (size_t r = 0; r < rows; ++r) {
+        size_t c = 0;
+        for (; c + 8 <= channels; c += 8) {
+            DequantizeS8x8(vld1_s8(input + c), scales + c, output + c);
+        }
+        for (; c < channels; ++c) {
+            output[c] = static_cast<float>(input[c]) * scales[c];
+        }
+        input += channels;
+        output += channels;
+    }
+}
+
+void
+DequantizeS4Kernel_Neon(
+    const uint8_t* input,
+    float* output,
+    size_t rows,
+    size_t channels,
+    const float* scales
+)
+{
+    const uint8x8_t low_mask = vdup_n_u8(0x0F);
+    const int8x8_t sign_bit = vdup_n_s8(0x08);
+
+    for (size_t r = 0; r < rows; ++r) {
+        size_t c = 0;
+        for (; c + 16 <= channels; c += 16) {
+            // 8 bytes hold 16 channels, the even ones in the low nibbles
+            const uint8x8_t packed = vld1_u8(input + c / 2);
+            int8x8_t low = vreinterpret_s8_u8(vand_u8(packed, low_mask));
+            int8x8_t high = vreinterpret_s8_u8(vshr_n_u8(packed, 4));
+            // sign extend the nibbles: (v ^ 8) - 8
+            low = vsub_s8(veor_s8(low, sign_bit), sign_bit);
+            high = vsub_s8(veor_s8(high, sign_bit), sign_bit);
+            const int8x8x2_t bytes = vzip_s8(low, high);
+
+            DequantizeS8x8(bytes.val[0], scales + c, output + c);
+            DequantizeS8x8(bytes.val[1], scales + c + 8, output + c + 8);
+        }
+        if (c < channels) {
+            MlasDequantizeKVCacheS4_FallBack(input + c / 2, output + c, 1, channels - c, scales + c);
+        }
+        input += channels / 2;
+        output += channels;
+    }
+}
+
+}  // namespace
+
+}  // namespace kv_cache_quant_neon
+
+//
+// Kernel dispatch structure definition.
+//
+const MLAS_KV_CACHE_QUANT_DISPATCH MlasKVCacheQuantDispatchNeon = []() {
+    MLAS_KV_CACHE_QUANT_DISPATCH d;
+    d.DequantizeS8 = kv_cache_quant_neon::DequantizeS8Kernel_Neon;
+    d.DequantizeS4 = kv_cache_quant_neon::DequantizeS4Kernel_Neon;
+    return d;
+}();
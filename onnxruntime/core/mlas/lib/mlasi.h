@@ -311,6 +311,19 @@ static_assert(sizeof(MLAS_FP16) == FP16_SIZE);
 #define MLAS_DGEMM_STRIDEN                          64
 #define MLAS_DGEMM_STRIDEK                          128
 
+//
+// Define the limits for which SGEMM reads matrix B in place using the small
+// matrix kernels instead of copying it to a packed buffer. The packed buffer
+// is reused for every row of matrix A, so copying it pays off from two rows
+// if matrix B is not transposed and from three rows if it is transposed, as
+// measured against the FMA3 kernels. Larger matrices B that do not fit in
+// the cache are also left to the packed kernels.
+//
+
+#define MLAS_SGEMM_SMALL_KERNEL_MAXIMUM_M           1
+#define MLAS_SGEMM_SMALL_KERNEL_TRANSB_MAXIMUM_M    2
+#define MLAS_SGEMM_SMALL_KERNEL_MAXIMUM_NK          (256 * 1024)
+
 //
 // Define the alignment for segmenting a GEMM operation across multiple
 // threads.
@@ -950,7 +963,7 @@ extern "C" {
 #define MLAS_QGEMM_THREAD_COMPLEXITY                65536
 #define MLAS_HGEMM_THREAD_COMPLEXITY                65536
 
-#if defined(__aarch64__) && defined(__linux__)
+#if defined(MLAS_SBGEMM_SUPPORTED)
 #define MLAS_SBGEMM_THREAD_COMPLEXITY (size_t(64) * size_t(1024))
 #endif
 
@@ -960,6 +973,27 @@ extern "C" {
 
 void
 MlasSgemmOperation(
+    CBLAS_TRANSPOSE TransA,
+    CBLAS_TRANSPOSE TransB,
+    size_t M,
+    size_t N,
+    size_t K,
+    float alpha,
+    const float* A,
+    size_t lda,
+    const float* B,
+    size_t ldb,
+    float beta,
+    float* C,
+    size_t ldc,
+    size_t TunedStrideN = 0,
+    const MLAS_GEMM_POSTPROCESSOR<float>* OutputProcessor = nullptr,
+    size_t RangeStartM = 0,
+    size_t RangeStartN = 0
+    );
+
+bool
+MlasSgemmSmallKernel(
     CBLAS_TRANSPOSE TransA,
     CBLAS_TRANSPOSE TransB,
     size_t M,
@@ -1062,6 +1096,8 @@ extern const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAvx512;
 
 extern const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAvx512vnni;
 
+extern const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAmx;
+
 //
 // Rotary embedding dispatch structure.
 //
@@ -1069,11 +1105,27 @@ struct MLAS_ROPE_DISPATCH;
 extern const MLAS_ROPE_DISPATCH MlasRopeDispatchNeon;
 extern const MLAS_ROPE_DISPATCH MlasRopeDispatchAvx2;
 
+//
+// Key/value cache quantization dispatch structure.
+//
+struct MLAS_KV_CACHE_QUANT_DISPATCH;
+extern const MLAS_KV_CACHE_QUANT_DISPATCH MlasKVCacheQuantDispatchNeon;
+extern const MLAS_KV_CACHE_QUANT_DISPATCH MlasKVCacheQuantDispatchAvx2;
+
 //
 // half gemm dispatch structure
 //
 struct MLAS_HGEMM_DISPATCH;
 extern const MLAS_HGEMM_DISPATCH MlasHGemmDispatchNeon;
+extern const MLAS_HGEMM_DISPATCH MlasHGemmDispatchAvx2;
+extern const MLAS_HGEMM_DISPATCH MlasHGemmDispatchAvx512Fp16;
+
+//
+// bfloat16 gemm dispatch structure
+//
+struct MLAS_SBGEMM_DISPATCH;
+extern const MLAS_SBGEMM_DISPATCH MlasSBGemmDispatchAvx512Bf16;
+extern const MLAS_SBGEMM_DISPATCH MlasSBGemmDispatchAmx;
 
 // softmax dispatch structure
 struct MLAS_SOFTMAX_DISPATCH;
@@ -1248,7 +1300,11 @@ struct MLAS_PLATFORM {
     MLAS_CAST_F32_TO_F16_KERNEL* CastF32ToF16Kernel;
 
     const MLAS_ROPE_DISPATCH* RopeDispatch{nullptr};
+    const MLAS_KV_CACHE_QUANT_DISPATCH* KVCacheQuantDispatch{nullptr};
     const MLAS_HGEMM_DISPATCH* HGemmDispatch{nullptr};
+#if defined(MLAS_TARGET_AMD64)
+    const MLAS_SBGEMM_DISPATCH* SBGemmDispatch{nullptr};
+#endif
     const MLAS_SOFTMAX_DISPATCH* SoftmaxDispatch{nullptr};
     const MLAS_ELTWISE_DISPATCH* EltwiseDispatch{nullptr};
 };
@@ -1352,6 +1408,58 @@ MlasPartitionWork(
     }
 }
 
+//
+// GEMM runtime tuning.
+//
+// MlasGemmBatch fills in the identifying fields and the default parameters of
+// Tuning and calls MlasGemmTuningSelectParams when tuning is active for its
+// thread pool. The parameters are replaced with a cached result or, when
+// tuning is enabled, with the fastest candidate measured by invoking
+// Benchmark. Candidate N strides are only explored when StrideNCandidates is
+// supplied.
+//
+
+struct MLAS_GEMM_TUNING_MODE {
+    bool Tune;
+    uint32_t MaxDurationMs;
+};
+
+extern std::atomic<size_t> MlasGemmTuningModeCount;
+
+bool
+MlasGemmTuningLookupMode(
+    MLAS_THREADPOOL* ThreadPool,
+    MLAS_GEMM_TUNING_MODE* Mode
+    );
+
+inline
+bool
+MlasGemmTuningIsActive(
+    MLAS_THREADPOOL* ThreadPool,
+    MLAS_GEMM_TUNING_MODE* Mode
+    )
+{
+    //
+    // Avoid the lookup while no thread pool has a tuning mode.
+    //
+
+    if (MlasGemmTuningModeCount.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    return MlasGemmTuningLookupMode(ThreadPool, Mode);
+}
+
+void
+MlasGemmTuningSelectParams(
+    const MLAS_GEMM_TUNING_MODE& Mode,
+    MLAS_GEMM_TUNING_RESULT& Tuning,
+    size_t BlockedN,
+    const size_t* StrideNCandidates,
+    size_t StrideNCandidateCount,
+    const std::function<void(const MLAS_GEMM_TUNING_RESULT& Candidate)>& Benchmark
+    );
+
 //
 // Define the minimum floating point value (and its bit value equivalent) that
 // has no fractional bits. This number can be used for fast rounding of floating
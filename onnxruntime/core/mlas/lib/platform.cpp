@@ -404,6 +404,8 @@ Return Value:
                 this->CastF16ToF32Kernel = &MlasCastF16ToF32KernelAvx2;
                 this->CastF32ToF16Kernel = &MlasCastF32ToF16KernelAvx2;
                 this->RopeDispatch = &MlasRopeDispatchAvx2;
+                this->KVCacheQuantDispatch = &MlasKVCacheQuantDispatchAvx2;
+                this->HGemmDispatch = &MlasHGemmDispatchAvx2;
 
 
                 //
@@ -524,8 +526,36 @@ Return Value:
                     if (MlasInitAMX()) {
                         this->GemmU8U8Dispatch = &MlasGemmU8S8DispatchAmx;
                         this->GemmU8S8Dispatch = &MlasGemmU8S8DispatchAmx;
+
+                        if (this->QNBitGemmDispatch == &MlasSQNBitGemmDispatchAvx512vnni) {
+                            this->QNBitGemmDispatch = &MlasSQNBitGemmDispatchAmx;
+                        }
                     }
                 }
+
+                //
+                // Check if the processor supports AVX512_BF16, and AMX-TILE
+                // and AMX-BF16 features.
+                //
+                if (this->Avx512Supported_ && (Cpuid7_1[0] & (0b1 << 5)) != 0) {
+                    this->SBGemmDispatch = &MlasSBGemmDispatchAvx512Bf16;
+
+                    if ((Cpuid7[3] & 0b1 << 22) != 0 &&
+                        (Cpuid7[3] & 0b1 << 24) != 0 &&
+                        (xcr0 & XFEATURE_MASK_XTILE) == XFEATURE_MASK_XTILE &&
+                        MlasInitAMX()) {
+                        this->SBGemmDispatch = &MlasSBGemmDispatchAmx;
+                    }
+                }
+
+#if (defined(_MSC_VER) && (_MSC_VER >= 1933)) || (defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 12))
+                //
+                // Check if the processor supports AVX512_FP16.
+                //
+                if (this->Avx512Supported_ && (Cpuid7[3] & (0b1 << 23)) != 0) {
+                    this->HGemmDispatch = &MlasHGemmDispatchAvx512Fp16;
+                }
+#endif  // (defined(_MSC_VER) && (_MSC_VER >= 1933)) || (defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 12))
 #endif // __APPLE__
 
 #endif // ORT_MINIMAL_BUILD
@@ -548,6 +578,7 @@ Return Value:
     this->ConvSymU8S8Dispatch = &MlasConvSymU8DispatchNeon;
     this->ConvSymS8S8Dispatch = &MlasConvSymS8DispatchNeon;
     this->RopeDispatch = &MlasRopeDispatchNeon;
+    this->KVCacheQuantDispatch = &MlasKVCacheQuantDispatchNeon;
     this->HGemmDispatch = &MlasHGemmDispatchNeon;
     this->SoftmaxDispatch = &MlasSoftmaxDispatchNeon;
     this->EltwiseDispatch = &MlasEltwiseDispatchNeon;
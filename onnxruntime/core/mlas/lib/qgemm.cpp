@@ -18,6 +18,8 @@ Abstract:
 #include "mlasi.h"
 #include "qgemm.h"
 
+#include <vector>
+
 //
 // Define the parameters to execute segments of a QGEMM operation on worker
 // threads.
@@ -165,10 +167,10 @@ MlasGemmBatch(
 
     MLAS_GEMM_QUANT_WORK_BLOCK WorkBlock;
 
-    if (N > M) {
+    const size_t BlockedN = (N + MLAS_QGEMM_STRIDEN_THREAD_ALIGN - 1) /
+        MLAS_QGEMM_STRIDEN_THREAD_ALIGN;
 
-        const size_t BlockedN = (N + MLAS_QGEMM_STRIDEN_THREAD_ALIGN - 1) /
-            MLAS_QGEMM_STRIDEN_THREAD_ALIGN;
+    if (N > M) {
 
         if (size_t(ThreadsPerGemm) > BlockedN) {
             ThreadsPerGemm = ptrdiff_t(BlockedN);
@@ -186,13 +188,72 @@ MlasGemmBatch(
         WorkBlock.ThreadCountM = ThreadsPerGemm;
         WorkBlock.ThreadCountN = 1;
     }
-    TargetThreadCount = ThreadsPerGemm * BatchN;
 
-    MlasTrySimpleParallel(ThreadPool, TargetThreadCount, [&](ptrdiff_t tid) {
-        const auto gemm_i = tid / ThreadsPerGemm;
-        const auto blk_i = tid % ThreadsPerGemm;
-        MlasGemmQuantThreaded(&WorkBlock, &Shape, &DataParams[gemm_i], blk_i);
-    });
+    auto ExecuteBatch = [&](const MLAS_GEMM_QUANT_WORK_BLOCK& BatchWorkBlock,
+                            const MLAS_GEMM_QUANT_DATA_PARAMS* BatchData) {
+        const ptrdiff_t BatchThreadsPerGemm = BatchWorkBlock.ThreadCountM * BatchWorkBlock.ThreadCountN;
+
+        MlasTrySimpleParallel(ThreadPool, BatchThreadsPerGemm * BatchN, [&](ptrdiff_t tid) {
+            const auto gemm_i = tid / BatchThreadsPerGemm;
+            const auto blk_i = tid % BatchThreadsPerGemm;
+            MlasGemmQuantThreaded(&BatchWorkBlock, &Shape, &BatchData[gemm_i], blk_i);
+        });
+    };
+
+    MLAS_GEMM_TUNING_MODE TuningMode;
+
+    if (MlasGemmTuningIsActive(ThreadPool, &TuningMode) && M != 0 && N != 0) {
+
+        MLAS_GEMM_TUNING_RESULT Tuning;
+        Tuning.Kind = MlasGemmTuningQgemm;
+        Tuning.Flags = (Shape.AIsSigned ? MLAS_GEMM_TUNING_FLAG_A_SIGNED : 0) |
+                       (Shape.BIsSigned ? MLAS_GEMM_TUNING_FLAG_B_SIGNED : 0) |
+                       (DataParams[0].BIsPacked ? MLAS_GEMM_TUNING_FLAG_B_PACKED : 0);
+        Tuning.M = M;
+        Tuning.N = N;
+        Tuning.K = K;
+        Tuning.BatchN = BatchN;
+        Tuning.MaximumThreadCount = size_t(MaximumThreadCount);
+        Tuning.ThreadCountM = size_t(WorkBlock.ThreadCountM);
+        Tuning.ThreadCountN = size_t(WorkBlock.ThreadCountN);
+
+        //
+        // The blocking of QGEMM is defined by the kernel dispatch, so only the
+        // thread partition is tuned. Benchmark into a scratch copy of the
+        // output without the output processor, which may accumulate into a
+        // caller buffer.
+        //
+
+        std::vector<int32_t> ScratchC;
+        std::vector<MLAS_GEMM_QUANT_DATA_PARAMS> ScratchData;
+
+        MlasGemmTuningSelectParams(TuningMode, Tuning, BlockedN, nullptr, 0,
+            [&](const MLAS_GEMM_TUNING_RESULT& Candidate)
+        {
+            if (ScratchData.empty()) {
+                ScratchC.resize(BatchN * M * N);
+                ScratchData.assign(DataParams, DataParams + BatchN);
+                for (size_t b = 0; b < BatchN; b++) {
+                    int32_t* c = ScratchC.data() + b * M * N;
+                    for (size_t m = 0; m < M; m++) {
+                        std::copy_n(DataParams[b].C + m * DataParams[b].ldc, N, c + m * N);
+                    }
+                    ScratchData[b].C = c;
+                    ScratchData[b].ldc = N;
+                    ScratchData[b].OutputProcessor = nullptr;
+                }
+            }
+            MLAS_GEMM_QUANT_WORK_BLOCK CandidateWorkBlock;
+            CandidateWorkBlock.ThreadCountM = ptrdiff_t(Candidate.ThreadCountM);
+            CandidateWorkBlock.ThreadCountN = ptrdiff_t(Candidate.ThreadCountN);
+            ExecuteBatch(CandidateWorkBlock, ScratchData.data());
+        });
+
+        WorkBlock.ThreadCountM = ptrdiff_t(Tuning.ThreadCountM);
+        WorkBlock.ThreadCountN = ptrdiff_t(Tuning.ThreadCountN);
+    }
+
+    ExecuteBatch(WorkBlock, DataParams);
 }
 
 
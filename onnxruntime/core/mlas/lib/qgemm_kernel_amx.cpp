@@ -18,16 +18,6 @@ Abstract:
 #include "qgemm.h"
 #include "amx_common.h"
 
-
-#define TMM0 0
-#define TMM1 1
-#define TMM2 2
-#define TMM3 3
-#define TMM4 4
-#define TMM5 5
-#define TMM6 6
-#define TMM7 7
-
 #define KPACK (4 / sizeof(type_t))  // Vertical K packing into Dword
 
 #define TILE_M 16
@@ -166,17 +156,6 @@ MlasGemmQuantCopyPackB<MLAS_GEMM_U8S8_KERNEL_AMX>(
 }
 
 
-// Tile configure structure
-struct tileconfig_t {
-    uint8_t palette_id = 0;
-    uint8_t start_row = 0;
-    uint8_t reserved1[14] = {0};
-    uint16_t colb[8] = {0};
-    uint8_t reserved2[16] = {0};
-    uint8_t rows[8] = {0};
-    uint8_t reserved3[8] = {0};
-};
-
 template <>
 MLAS_FORCEINLINE
 void
@@ -98,6 +98,15 @@ void MLAS_QGEMM_SCALE_BIAS_OUTPUT_PROCESSOR::Process(
                 ldc);
         }
     }
+
+    //
+    // Apply the float epilogue to the scaled tile while it is still in the
+    // cache.
+    //
+
+    if (Epilogue_ != nullptr) {
+        Epilogue_->Process(Output_, StartM, StartN, CountM, CountN, LeadingDimensionOutput_);
+    }
 }
 
 template<bool HasBias, MLAS_QGEMM_OUTPUT_MODE Mode, MLAS_QUANTIZATION_GRANULARITY QuantGran>
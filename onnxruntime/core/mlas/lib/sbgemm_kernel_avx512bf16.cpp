@@ -0,0 +1,507 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    sbgemm_kernel_avx512bf16.cpp
+
+Abstract:
+
+    This module implements the bfloat16 precision GEMM kernels for x64
+    processors with the AVX512_BF16 instructions, and with the AMX-BF16
+    tile instructions.
+
+    Matrix B is packed in panels of 16 columns. Inside a panel, each pair of
+    rows is stored as 16 interleaved pairs of bf16 values: the layout of a B
+    operand of VDPBF16PS and of a B tile of TDPBF16PS alike. The rows of each
+    block of Strides.K rows are padded to 32, the K dimension of a tile.
+
+--*/
+
+#include "mlasi.h"
+#include "sbgemm.h"
+
+#if defined(MLAS_SBGEMM_SUPPORTED) && defined(MLAS_TARGET_AMD64)
+
+#include "amx_common.h"
+
+struct MLAS_SBGEMM_KERNEL_AVX512BF16 {
+    static constexpr bool PackNeeded = true;
+    static constexpr size_t KernelMaxM = 8;  // max # rows the vectorized kernel can process
+    static constexpr size_t PackedK = 32;
+    static constexpr size_t PackedN = MLAS_SGEMM_STRIDEN_THREAD_ALIGN;
+    static constexpr MLAS_SBGEMM_STRIDES Strides{128, 128, 256};  // M:N:K
+};
+
+struct MLAS_SBGEMM_KERNEL_AMX {
+    static constexpr bool PackNeeded = true;
+    static constexpr size_t KernelMaxM = 16;  // rows of a tile
+    static constexpr size_t PackedK = 32;
+    static constexpr size_t PackedN = MLAS_SGEMM_STRIDEN_THREAD_ALIGN;
+    static constexpr MLAS_SBGEMM_STRIDES Strides{128, 128, 256};  // M:N:K
+};
+
+static_assert(MLAS_SGEMM_STRIDEN_THREAD_ALIGN == 16, "a panel of packed B is the 16 columns of a zmm register");
+
+MLAS_FORCEINLINE
+__m512bh
+MlasSBGemmCastToBf16(__m512i Vector)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return Vector;
+#else
+    return (__m512bh)Vector;
+#endif
+}
+
+MLAS_FORCEINLINE
+__m512i
+MlasSBGemmCastFromBf16(__m512bh Vector)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return Vector;
+#else
+    return (__m512i)Vector;
+#endif
+}
+
+MLAS_FORCEINLINE
+__mmask16
+MlasSBGemmMask(size_t Count)
+{
+    return (Count >= 16) ? __mmask16(0xFFFF) : __mmask16((1u << Count) - 1);
+}
+
+/*
+    This routine converts fp32 to bf16 and copies the CountK x CountN matrix B
+    to the packed buffer, in blocks of Strides.K rows.
+*/
+static void
+MlasSBGemmConvertPackBAvx512Bf16(
+    bfloat16_t* PackedB, const float* B, size_t ldb, size_t CountN, size_t CountK
+)
+{
+    constexpr MLAS_SBGEMM_STRIDES Strides = MLAS_SBGEMM_KERNEL_AVX512BF16::Strides;
+    constexpr size_t PackedK = MLAS_SBGEMM_KERNEL_AVX512BF16::PackedK;
+
+    //
+    // Interleave the 16 values of two rows, converted to the low and high
+    // halves of a vector.
+    //
+    const __m512i InterleaveIndex = _mm512_set_epi16(
+        31, 15, 30, 14, 29, 13, 28, 12, 27, 11, 26, 10, 25, 9, 24, 8,
+        23, 7, 22, 6, 21, 5, 20, 4, 19, 3, 18, 2, 17, 1, 16, 0
+    );
+
+    size_t CountBlockK;
+    for (size_t k = 0; k < CountK; k += CountBlockK) {
+        CountBlockK = std::min(CountK - k, Strides.K);
+        const size_t AlignedBlockK = (CountBlockK + PackedK - 1) & ~(PackedK - 1);
+
+        for (size_t n = 0; n < CountN; n += 16) {
+            const __mmask16 Mask = MlasSBGemmMask(CountN - n);
+            const float* b = B + k * ldb + n;
+
+            for (size_t kk = 0; kk < AlignedBlockK; kk += 2) {
+                const __m512 Row0 = (kk < CountBlockK) ? _mm512_maskz_loadu_ps(Mask, b + kk * ldb) : _mm512_setzero_ps();
+                const __m512 Row1 = (kk + 1 < CountBlockK) ? _mm512_maskz_loadu_ps(Mask, b + (kk + 1) * ldb) : _mm512_setzero_ps();
+                const __m512i Rows = MlasSBGemmCastFromBf16(_mm512_cvtne2ps_pbh(Row1, Row0));
+                _mm512_storeu_si512(PackedB, _mm512_permutexvar_epi16(InterleaveIndex, Rows));
+                PackedB += 32;
+            }
+        }
+    }
+}
+
+template <>
+void
+MlasSBGemmConvertPackB<MLAS_SBGEMM_KERNEL_AVX512BF16>(
+    bfloat16_t* PackedB, const float* B, size_t ldb, size_t CountN, size_t CountK
+)
+{
+    MlasSBGemmConvertPackBAvx512Bf16(PackedB, B, ldb, CountN, CountK);
+}
+
+template <>
+void
+MlasSBGemmConvertPackB<MLAS_SBGEMM_KERNEL_AMX>(
+    bfloat16_t* PackedB, const float* B, size_t ldb, size_t CountN, size_t CountK
+)
+{
+    MlasSBGemmConvertPackBAvx512Bf16(PackedB, B, ldb, CountN, CountK);
+}
+
+/*
+    This routine converts CountM rows of fp32 matrix A to bf16, each row
+    padded with zeros to AlignedK values. A pair of bf16 values is handled as
+    a 32-bit element, the A operand of VDPBF16PS.
+*/
+static void
+MlasSBGemmConvertA(
+    uint32_t* PanelA, const float* A, size_t lda, size_t CountM, size_t CountK, size_t AlignedK
+)
+{
+    for (size_t m = 0; m < CountM; m++) {
+        const float* a = A + m * lda;
+        uint32_t* d = PanelA + m * (AlignedK / 2);
+
+        for (size_t k = 0; k < AlignedK; k += 32) {
+            const size_t Remaining = CountK - k;
+            const __m512 Values0 = _mm512_maskz_loadu_ps(MlasSBGemmMask(Remaining), a + k);
+            const __m512 Values1 = _mm512_maskz_loadu_ps(
+                (Remaining > 16) ? MlasSBGemmMask(Remaining - 16) : __mmask16(0), a + k + 16
+            );
+            _mm512_storeu_si512(d + k / 2, MlasSBGemmCastFromBf16(_mm512_cvtne2ps_pbh(Values1, Values0)));
+        }
+    }
+}
+
+/*
+    This routine computes RowCount rows by PanelCount panels of 16 columns of
+    matrix C with the AVX512_BF16 dot products.
+*/
+template <size_t RowCount, size_t PanelCount>
+MLAS_FORCEINLINE void
+MlasSBGemmComputeBlockAvx512Bf16(
+    const uint32_t* PanelA,
+    size_t AlignedK,
+    const bfloat16_t* B,
+    size_t CountN,
+    float* C,
+    size_t ldc,
+    const float* Bias,
+    bool ZeroMode
+)
+{
+    const size_t PairCountK = AlignedK / 2;
+
+    __m512 Accumulators[RowCount][PanelCount];
+
+    for (size_t r = 0; r < RowCount; r++) {
+        for (size_t p = 0; p < PanelCount; p++) {
+            Accumulators[r][p] = _mm512_setzero_ps();
+        }
+    }
+
+    for (size_t k = 0; k < PairCountK; k++) {
+        __m512bh BElements[PanelCount];
+
+        for (size_t p = 0; p < PanelCount; p++) {
+            BElements[p] = MlasSBGemmCastToBf16(_mm512_loadu_si512(B + p * AlignedK * 16 + k * 32));
+        }
+
+        for (size_t r = 0; r < RowCount; r++) {
+            const __m512bh AElements = MlasSBGemmCastToBf16(_mm512_set1_epi32(int32_t(PanelA[r * PairCountK + k])));
+
+            for (size_t p = 0; p < PanelCount; p++) {
+                Accumulators[r][p] = _mm512_dpbf16_ps(Accumulators[r][p], AElements, BElements[p]);
+            }
+        }
+    }
+
+    for (size_t p = 0; p < PanelCount; p++) {
+        const __mmask16 Mask = MlasSBGemmMask(CountN - p * 16);
+        const __m512 BiasElements = (ZeroMode && Bias != nullptr) ? _mm512_maskz_loadu_ps(Mask, Bias + p * 16)
+                                                                  : _mm512_setzero_ps();
+
+        for (size_t r = 0; r < RowCount; r++) {
+            float* c = C + r * ldc + p * 16;
+            const __m512 Addend = ZeroMode ? BiasElements : _mm512_maskz_loadu_ps(Mask, c);
+            _mm512_mask_storeu_ps(c, Mask, _mm512_add_ps(Accumulators[r][p], Addend));
+        }
+    }
+}
+
+template <size_t RowCount>
+void
+MlasSBGemmKernelAvx512Bf16Rows(
+    const uint32_t* PanelA,
+    size_t AlignedK,
+    const bfloat16_t* B,
+    size_t CountN,
+    float* C,
+    size_t ldc,
+    const float* Bias,
+    bool ZeroMode
+)
+{
+    const size_t PanelStride = AlignedK * 16;
+
+    for (size_t n = 0; n < CountN; n += 32) {
+        const float* bias = (Bias != nullptr) ? Bias + n : nullptr;
+
+        if (CountN - n > 16) {
+            MlasSBGemmComputeBlockAvx512Bf16<RowCount, 2>(PanelA, AlignedK, B, CountN - n, C + n, ldc, bias, ZeroMode);
+        } else {
+            MlasSBGemmComputeBlockAvx512Bf16<RowCount, 1>(PanelA, AlignedK, B, CountN - n, C + n, ldc, bias, ZeroMode);
+        }
+
+        B += 2 * PanelStride;
+    }
+}
+
+/*
+    This routine computes up to 8 rows of matrix C for a block of at most
+    Strides.K rows of packed matrix B.
+*/
+static void
+MlasSBGemmKernelAvx512Bf16(
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    const float* A,
+    size_t lda,
+    const bfloat16_t* B,
+    float* C,
+    size_t ldc,
+    const float* Bias,
+    bool ZeroMode
+)
+{
+    constexpr size_t KernelMaxM = MLAS_SBGEMM_KERNEL_AVX512BF16::KernelMaxM;
+    constexpr size_t PackedK = MLAS_SBGEMM_KERNEL_AVX512BF16::PackedK;
+
+    MLAS_DECLSPEC_ALIGN(uint32_t PanelA[KernelMaxM * MLAS_SBGEMM_KERNEL_AVX512BF16::Strides.K / 2], 64);
+
+    const size_t AlignedK = (CountK + PackedK - 1) & ~(PackedK - 1);
+
+    while (CountM > 0) {
+        const size_t RowCount = std::min(CountM, KernelMaxM);
+
+        MlasSBGemmConvertA(PanelA, A, lda, RowCount, CountK, AlignedK);
+
+        switch (RowCount) {
+            case 1:
+                MlasSBGemmKernelAvx512Bf16Rows<1>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            case 2:
+                MlasSBGemmKernelAvx512Bf16Rows<2>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            case 3:
+                MlasSBGemmKernelAvx512Bf16Rows<3>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            case 4:
+                MlasSBGemmKernelAvx512Bf16Rows<4>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            case 5:
+                MlasSBGemmKernelAvx512Bf16Rows<5>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            case 6:
+                MlasSBGemmKernelAvx512Bf16Rows<6>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            case 7:
+                MlasSBGemmKernelAvx512Bf16Rows<7>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+            default:
+                MlasSBGemmKernelAvx512Bf16Rows<8>(PanelA, AlignedK, B, CountN, C, ldc, Bias, ZeroMode);
+                break;
+        }
+
+        A += lda * RowCount;
+        C += ldc * RowCount;
+        CountM -= RowCount;
+    }
+}
+
+template <>
+MLAS_FORCEINLINE void
+MlasSBGemmKernel<MLAS_SBGEMM_KERNEL_AVX512BF16>(
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    const float* A,
+    size_t lda,
+    const bfloat16_t* B,
+    float* C,
+    size_t ldc,
+    const float* Bias,
+    const bool ZeroMode
+)
+{
+    MlasSBGemmKernelAvx512Bf16(CountM, CountN, CountK, A, lda, B, C, ldc, Bias, ZeroMode);
+}
+
+/*
+    This routine loads the configuration of 8 tiles of 16 rows by 64 bytes,
+    unless the thread has it already. The configuration is the one of the
+    QGEMM AMX kernel, so that the kernels can alternate on a thread.
+*/
+static void
+MlasSBGemmTileConfigAmx()
+{
+    static thread_local struct tileconfig_t tc = {0};
+
+    if (tc.palette_id == 0) {
+        tc.palette_id = 1;
+        for (int t = 0; t < 8; t++) {
+            tc.rows[t] = 16;
+            tc.colb[t] = 64;
+        }
+    }
+
+    struct tileconfig_t current_tc = {0};
+    tile_storeconfig(&current_tc);
+
+    if (std::memcmp(&current_tc, &tc, sizeof(tc)) != 0) {
+        tile_loadconfig(&tc);
+    }
+}
+
+/*
+    This routine copies a tile of 16 rows by CountN columns of matrix C, or
+    of the bias, to a buffer to be loaded as the initial value of a tile.
+*/
+MLAS_FORCEINLINE void
+MlasSBGemmInitTileAmx(float* Tile, const float* C, size_t ldc, size_t CountN, const float* Bias, bool ZeroMode)
+{
+    const __mmask16 Mask = MlasSBGemmMask(CountN);
+    const __m512 BiasElements = (Bias != nullptr) ? _mm512_maskz_loadu_ps(Mask, Bias) : _mm512_setzero_ps();
+
+    for (size_t r = 0; r < 16; r++) {
+        _mm512_store_ps(Tile + r * 16, ZeroMode ? BiasElements : _mm512_maskz_loadu_ps(Mask, C + r * ldc));
+    }
+}
+
+MLAS_FORCEINLINE void
+MlasSBGemmStoreTileAmx(float* C, size_t ldc, size_t CountN, const float* Tile)
+{
+    const __mmask16 Mask = MlasSBGemmMask(CountN);
+
+    for (size_t r = 0; r < 16; r++) {
+        _mm512_mask_storeu_ps(C + r * ldc, Mask, _mm512_load_ps(Tile + r * 16));
+    }
+}
+
+/*
+    This routine computes blocks of 16 rows by 32 columns of matrix C with
+    the AMX-BF16 tiles: TMM0 and TMM1 accumulate the two panels of 16 columns
+    of C, TMM2 holds 16 rows by 32 values of A, TMM3 and TMM4 hold 32 rows by
+    16 columns of the two panels of B. The remaining rows are computed with
+    the AVX512_BF16 kernel.
+*/
+template <>
+void
+MlasSBGemmKernel<MLAS_SBGEMM_KERNEL_AMX>(
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    const float* A,
+    size_t lda,
+    const bfloat16_t* B,
+    float* C,
+    size_t ldc,
+    const float* Bias,
+    const bool ZeroMode
+)
+{
+    constexpr size_t TileM = MLAS_SBGEMM_KERNEL_AMX::KernelMaxM;
+    constexpr size_t PackedK = MLAS_SBGEMM_KERNEL_AMX::PackedK;
+
+    MLAS_DECLSPEC_ALIGN(uint32_t PanelA[TileM * MLAS_SBGEMM_KERNEL_AMX::Strides.K / 2], 64);
+    MLAS_DECLSPEC_ALIGN(float Tile[16 * 16], 64);
+
+    const size_t AlignedK = (CountK + PackedK - 1) & ~(PackedK - 1);
+    const size_t PanelStride = AlignedK * 16;
+    const int StrideA = int(AlignedK * sizeof(bfloat16_t));
+    const int StrideB = int(16 * 2 * sizeof(bfloat16_t));
+    const int StrideC = int(ldc * sizeof(float));
+
+    if (CountM >= TileM) {
+        MlasSBGemmTileConfigAmx();
+    }
+
+    while (CountM >= TileM) {
+        MlasSBGemmConvertA(PanelA, A, lda, TileM, CountK, AlignedK);
+
+        const bfloat16_t* b = B;
+
+        for (size_t n = 0; n < CountN; n += 32) {
+            const size_t CountN0 = std::min(CountN - n, size_t(16));
+            const size_t CountN1 = (CountN - n > 16) ? std::min(CountN - n - 16, size_t(16)) : 0;
+            float* c = C + n;
+            const float* bias = (Bias != nullptr) ? Bias + n : nullptr;
+
+            //
+            // Initialize the accumulators from matrix C, from the bias or
+            // with zeros. Full tiles of C are loaded and stored in place.
+            //
+            if (!ZeroMode && CountN0 == 16) {
+                tile_loadd(TMM0, c, StrideC);
+            } else if (bias == nullptr && ZeroMode) {
+                tile_zero(TMM0);
+            } else {
+                MlasSBGemmInitTileAmx(Tile, c, ldc, CountN0, bias, ZeroMode);
+                tile_loadd(TMM0, Tile, 64);
+            }
+
+            if (CountN1 > 0) {
+                if (!ZeroMode && CountN1 == 16) {
+                    tile_loadd(TMM1, c + 16, StrideC);
+                } else if (bias == nullptr && ZeroMode) {
+                    tile_zero(TMM1);
+                } else {
+                    MlasSBGemmInitTileAmx(Tile, c + 16, ldc, CountN1, (bias != nullptr) ? bias + 16 : nullptr, ZeroMode);
+                    tile_loadd(TMM1, Tile, 64);
+                }
+            }
+
+            for (size_t k = 0; k < AlignedK; k += PackedK) {
+                tile_loadd(TMM2, PanelA + k / 2, StrideA);
+                tile_loadd(TMM3, b + k * 16, StrideB);
+                tile_dpbf16ps(TMM0, TMM2, TMM3);
+
+                if (CountN1 > 0) {
+                    tile_loadd(TMM4, b + PanelStride + k * 16, StrideB);
+                    tile_dpbf16ps(TMM1, TMM2, TMM4);
+                }
+            }
+
+            if (CountN0 == 16) {
+                tile_stored(TMM0, c, StrideC);
+            } else {
+                tile_stored(TMM0, Tile, 64);
+                MlasSBGemmStoreTileAmx(c, ldc, CountN0, Tile);
+            }
+
+            if (CountN1 == 16) {
+                tile_stored(TMM1, c + 16, StrideC);
+            } else if (CountN1 > 0) {
+                tile_stored(TMM1, Tile, 64);
+                MlasSBGemmStoreTileAmx(c + 16, ldc, CountN1, Tile);
+            }
+
+            b += 2 * PanelStride;
+        }
+
+        A += lda * TileM;
+        C += ldc * TileM;
+        CountM -= TileM;
+    }
+
+    if (CountM > 0) {
+        MlasSBGemmKernelAvx512Bf16(CountM, CountN, CountK, A, lda, B, C, ldc, Bias, ZeroMode);
+    }
+}
+
+const MLAS_SBGEMM_DISPATCH MlasSBGemmDispatchAvx512Bf16 = {
+    MlasSBGemmOperation<MLAS_SBGEMM_KERNEL_AVX512BF16>,
+    MlasSBGemmConvertPackBAvx512Bf16,
+    MLAS_SBGEMM_KERNEL_AVX512BF16::PackedK,
+    MLAS_SBGEMM_KERNEL_AVX512BF16::PackedN,
+    MLAS_SBGEMM_KERNEL_AVX512BF16::KernelMaxM,
+    0
+};
+
+const MLAS_SBGEMM_DISPATCH MlasSBGemmDispatchAmx = {
+    MlasSBGemmOperation<MLAS_SBGEMM_KERNEL_AMX>,
+    MlasSBGemmConvertPackBAvx512Bf16,
+    MLAS_SBGEMM_KERNEL_AMX::PackedK,
+    MLAS_SBGEMM_KERNEL_AMX::PackedN,
+    MLAS_SBGEMM_KERNEL_AMX::KernelMaxM,
+    0
+};
+
+#endif  // defined(MLAS_SBGEMM_SUPPORTED) && defined(MLAS_TARGET_AMD64)
@@ -17,6 +17,8 @@ Abstract:
 
 #include "mlasi.h"
 
+#include <vector>
+
 //
 // Define the number of rows from matrix A to transpose to a local buffer.
 //
@@ -26,6 +28,14 @@ Abstract:
 
 #define MLAS_SGEMM_TRANSA_ROWS              12
 
+//
+// Define the number of rows of matrix C that are computed before applying the
+// output processor, so that the processed rows are still in the cache. This is
+// a multiple of the number of rows handled by each kernel.
+//
+
+#define MLAS_SGEMM_OUTPUT_PROCESSOR_ROWS    12
+
 //
 // Define the parameters to execute segments of a SGEMM operation on worker
 // threads.
@@ -1093,7 +1103,11 @@ MlasSgemmOperation(
     size_t ldb,
     float beta,
     float* C,
-    size_t ldc
+    size_t ldc,
+    size_t TunedStrideN,
+    const MLAS_GEMM_POSTPROCESSOR<float>* OutputProcessor,
+    size_t RangeStartM,
+    size_t RangeStartN
     )
 /*++
 
@@ -1131,6 +1145,18 @@ Arguments:
 
     ldc - Supplies the first dimension of matrix C.
 
+    TunedStrideN - Supplies the N stride selected by runtime tuning, or zero
+        to derive the strides from the shape of the operation.
+
+    OutputProcessor - Supplies an optional processor that is applied to each
+        block of the output matrix once it is fully accumulated.
+
+    RangeStartM - Supplies the row offset of matrix C within the output matrix
+        passed to the output processor.
+
+    RangeStartN - Supplies the column offset of matrix C within the output
+        matrix passed to the output processor.
+
 Return Value:
 
     None.
@@ -1145,8 +1171,13 @@ Return Value:
     // the output matrix and exit.
     //
 
+    float* OutputBase = C - RangeStartM * ldc - RangeStartN;
+
     if (K == 0) {
         MlasSgemmMultiplyBeta(C, M, N, ldc, beta);
+        if (OutputProcessor != nullptr) {
+            OutputProcessor->Process(OutputBase, RangeStartM, RangeStartN, M, N, ldc);
+        }
         return;
     }
 
@@ -1171,6 +1202,9 @@ Return Value:
 
         if (SgemmKernelM1Routine != nullptr) {
             SgemmKernelM1Routine(A, B, C, K, N, ldb, beta);
+            if (OutputProcessor != nullptr) {
+                OutputProcessor->Process(OutputBase, RangeStartM, RangeStartN, M, N, ldc);
+            }
             return;
         }
 
@@ -1178,6 +1212,9 @@ Return Value:
 
         if (TransB == CblasNoTrans) {
             MlasGemvFloatKernel(A, B, C, K, N, ldb, (beta == 0.0f));
+            if (OutputProcessor != nullptr) {
+                OutputProcessor->Process(OutputBase, RangeStartM, RangeStartN, M, N, ldc);
+            }
             return;
         }
 
@@ -1207,6 +1244,9 @@ Return Value:
 
         if (SgemmKernelM1Routine != nullptr) {
             SgemmKernelM1Routine(B, A, C, K, M, lda, beta);
+            if (OutputProcessor != nullptr) {
+                OutputProcessor->Process(OutputBase, RangeStartM, RangeStartN, M, N, ldc);
+            }
             return;
         }
 
@@ -1214,6 +1254,19 @@ Return Value:
 
     }
 
+    //
+    // Handle the case of one or two rows by reading matrix B in place.
+    // Otherwise, the cost of packing matrix B is not amortized across enough
+    // rows.
+    //
+
+    if (MlasSgemmSmallKernel(TransA, TransB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc)) {
+        if (OutputProcessor != nullptr) {
+            OutputProcessor->Process(OutputBase, RangeStartM, RangeStartN, M, N, ldc);
+        }
+        return;
+    }
+
     //
     // Compute the strides to step through slices of the input matrices.
     //
@@ -1225,7 +1278,18 @@ Return Value:
     size_t StrideN = MLAS_SGEMM_STRIDEN;
     size_t StrideK = MLAS_SGEMM_STRIDEK;
 
-    if (N >= K) {
+    if (TunedStrideN != 0) {
+
+        //
+        // The tuned stride keeps the B panel size constant. The tuner only
+        // selects strides that keep the K stride within the A panel when
+        // matrix A is transposed.
+        //
+
+        StrideN = TunedStrideN;
+        StrideK = (MLAS_SGEMM_STRIDEN * MLAS_SGEMM_STRIDEK) / TunedStrideN;
+
+    } else if (N >= K) {
 
         while (StrideK / 2 >= K) {
             StrideN *= 2;
@@ -1285,9 +1349,32 @@ Return Value:
 
             float* c = C + n;
 
+            //
+            // Apply the output processor while computing the last slice along
+            // the K dimension, a block of rows at a time.
+            //
+
+            const bool ProcessOutput = (OutputProcessor != nullptr) && (k + CountK == K);
+
             if (TransA == CblasNoTrans) {
 
-                MlasSgemmKernelLoop(A + k, PanelB, c, CountK, M, CountN, lda, ldc, alpha, ZeroMode);
+                if (ProcessOutput) {
+
+                    size_t CountM;
+
+                    for (size_t m = 0; m < M; m += CountM) {
+
+                        CountM = std::min(M - m, size_t(MLAS_SGEMM_OUTPUT_PROCESSOR_ROWS));
+
+                        MlasSgemmKernelLoop(A + k + m * lda, PanelB, c + m * ldc, CountK, CountM, CountN, lda, ldc, alpha, ZeroMode);
+
+                        OutputProcessor->Process(OutputBase, RangeStartM + m, RangeStartN + n, CountM, CountN, ldc);
+                    }
+
+                } else {
+
+                    MlasSgemmKernelLoop(A + k, PanelB, c, CountK, M, CountN, lda, ldc, alpha, ZeroMode);
+                }
 
             } else {
 
@@ -1301,6 +1388,7 @@ Return Value:
                     //
 
                     size_t RowsTransposed = std::min(RowsRemaining, size_t(MLAS_SGEMM_TRANSA_ROWS));
+                    size_t m = M - RowsRemaining;
 
                     MlasSgemmTransposeA(PanelA, a, lda, RowsTransposed, CountK);
 
@@ -1312,6 +1400,10 @@ Return Value:
                     //
 
                     c = MlasSgemmKernelLoop(PanelA, PanelB, c, CountK, RowsTransposed, CountN, CountK, ldc, alpha, ZeroMode);
+
+                    if (ProcessOutput) {
+                        OutputProcessor->Process(OutputBase, RangeStartM + m, RangeStartN + n, RowsTransposed, CountN, ldc);
+                    }
                 }
             }
 
@@ -1334,7 +1426,9 @@ MlasSgemmPackedOperation(
     size_t AlignedN,
     float beta,
     float* C,
-    size_t ldc
+    size_t ldc,
+    const MLAS_GEMM_POSTPROCESSOR<float>* OutputProcessor,
+    size_t RangeStartM
     )
 /*++
 
@@ -1374,6 +1468,12 @@ Arguments:
 
     ldc - Supplies the first dimension of matrix C.
 
+    OutputProcessor - Supplies an optional processor that is applied to each
+        block of the output matrix once it is fully accumulated.
+
+    RangeStartM - Supplies the row offset of matrix C within the output matrix
+        passed to the output processor.
+
 Return Value:
 
     None.
@@ -1381,6 +1481,7 @@ Return Value:
 --*/
 {
     float PanelA[MLAS_SGEMM_TRANSA_ROWS * MLAS_SGEMM_PACKED_STRIDEK];
+    float* OutputBase = C - RangeStartM * ldc - RangeStartN;
 
     //
     // Step through each slice of matrix B along the N dimension.
@@ -1420,9 +1521,32 @@ Return Value:
             const float* pb = (const float*)PackedB + AlignedN * k + CountK * SliceStartN;
             float* c = C + n;
 
+            //
+            // Apply the output processor while computing the last slice along
+            // the K dimension, a block of rows at a time.
+            //
+
+            const bool ProcessOutput = (OutputProcessor != nullptr) && (k + CountK == K);
+
             if (TransA == CblasNoTrans) {
 
-                MlasSgemmKernelLoop(A + k, pb, c, CountK, M, CountN, lda, ldc, alpha, ZeroMode);
+                if (ProcessOutput) {
+
+                    size_t CountM;
+
+                    for (size_t m = 0; m < M; m += CountM) {
+
+                        CountM = std::min(M - m, size_t(MLAS_SGEMM_OUTPUT_PROCESSOR_ROWS));
+
+                        MlasSgemmKernelLoop(A + k + m * lda, pb, c + m * ldc, CountK, CountM, CountN, lda, ldc, alpha, ZeroMode);
+
+                        OutputProcessor->Process(OutputBase, RangeStartM + m, RangeStartN + n, CountM, CountN, ldc);
+                    }
+
+                } else {
+
+                    MlasSgemmKernelLoop(A + k, pb, c, CountK, M, CountN, lda, ldc, alpha, ZeroMode);
+                }
 
             } else {
 
@@ -1436,6 +1560,7 @@ Return Value:
                     //
 
                     size_t RowsTransposed = std::min(RowsRemaining, size_t(MLAS_SGEMM_TRANSA_ROWS));
+                    size_t m = M - RowsRemaining;
 
                     MlasSgemmTransposeA(PanelA, a, lda, RowsTransposed, CountK);
 
@@ -1447,6 +1572,10 @@ Return Value:
                     //
 
                     c = MlasSgemmKernelLoop(PanelA, pb, c, CountK, RowsTransposed, CountN, CountK, ldc, alpha, ZeroMode);
+
+                    if (ProcessOutput) {
+                        OutputProcessor->Process(OutputBase, RangeStartM + m, RangeStartN + n, RowsTransposed, CountN, ldc);
+                    }
                 }
             }
 
@@ -1459,6 +1588,7 @@ void
 MlasSgemmThreaded(
     const ptrdiff_t ThreadCountM,
     const ptrdiff_t ThreadCountN,
+    const size_t StrideN,
     const CBLAS_TRANSPOSE TransA,
     const CBLAS_TRANSPOSE TransB,
     const size_t M,
@@ -1481,6 +1611,8 @@ Arguments:
 
     ThreadCountN - Supplies the total thread partition on the N dimension.
 
+    StrideN - Supplies the tuned N stride, or zero to use the default.
+
     TransA - Supplies the transpose operation on A matrix
 
     TransB - Supplies the transpose operation on B matrix
@@ -1542,7 +1674,8 @@ Return Value:
 
         MlasSgemmPackedOperation(TransA, RangeCountM, RangeStartN, RangeCountN,
             K, DataParams->alpha, A, lda, DataParams->B,
-            BlockedN * MLAS_SGEMM_STRIDEN_THREAD_ALIGN, DataParams->beta, C, ldc);
+            BlockedN * MLAS_SGEMM_STRIDEN_THREAD_ALIGN, DataParams->beta, C, ldc,
+            DataParams->OutputProcessor, RangeStartM);
 
     } else {
 
@@ -1551,9 +1684,79 @@ Return Value:
         const float* B = (const float*)DataParams->B + RangeStartN * ((TransB == CblasNoTrans) ? 1 : ldb);
 
         MlasSgemmOperation(TransA, TransB, RangeCountM, RangeCountN, K,
-            DataParams->alpha, A, lda, B, ldb, DataParams->beta, C, ldc);
+            DataParams->alpha, A, lda, B, ldb, DataParams->beta, C, ldc, StrideN,
+            DataParams->OutputProcessor, RangeStartM, RangeStartN);
+    }
+}
+template<typename GetDataParams>
+void
+MlasSgemmSmallBatch(
+    CBLAS_TRANSPOSE TransA,
+    CBLAS_TRANSPOSE TransB,
+    size_t M,
+    size_t N,
+    size_t K,
+    GetDataParams GetData,
+    size_t BatchSize,
+    MLAS_THREADPOOL* ThreadPool
+    )
+/*++
+
+Routine Description:
+
+    This routine executes a batch of small SGEMM operations by assigning a
+    contiguous range of whole operations to each thread, instead of
+    scheduling a task per operation.
+
+Arguments:
+
+    TransA - Supplies the transpose operation on A matrix
+
+    TransB - Supplies the transpose operation on B matrix
+
+    M, N, K - Supplies the shape of the multiplications
+
+    GetData - Supplies a callable that returns the data parameters of an
+        operation given its index in the batch.
+
+    BatchSize - Supplies the number of operations in the batch.
+
+    ThreadPool - Supplies the thread pool object to use, else nullptr if the
+        base library threading support should be used.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    const double Complexity = double(M) * double(N) * double(K) * double(BatchSize);
+
+    ptrdiff_t ThreadCount = ptrdiff_t(Complexity / double(MLAS_SGEMM_THREAD_COMPLEXITY)) + 1;
+    ptrdiff_t MaximumThreadCount = MlasGetMaximumThreadCount(ThreadPool);
+
+    if (ThreadCount >= MaximumThreadCount) {
+        ThreadCount = MaximumThreadCount;
     }
+
+    if (size_t(ThreadCount) > BatchSize) {
+        ThreadCount = ptrdiff_t(BatchSize);
+    }
+
+    MlasTrySimpleParallel(ThreadPool, ThreadCount, [&](ptrdiff_t tid) {
+
+        size_t BatchStart;
+        size_t BatchCount;
+
+        MlasPartitionWork(tid, ThreadCount, BatchSize, &BatchStart, &BatchCount);
+
+        for (size_t b = BatchStart; b < BatchStart + BatchCount; b++) {
+            const MLAS_SGEMM_DATA_PARAMS DataParams = GetData(b);
+            MlasSgemmThreaded(1, 1, 0, TransA, TransB, M, N, K, &DataParams, 0);
+        }
+    });
 }
+
 #if defined(_MSC_VER) && !defined(__clang__)
 #pragma warning(push)
 // Chance of arithmetic overflow could be reduced
@@ -1598,10 +1801,10 @@ MlasGemmBatch(
     ptrdiff_t ThreadCountM;
     ptrdiff_t ThreadCountN;
 
-    if (N > M) {
+    const size_t BlockedN = (N + MLAS_SGEMM_STRIDEN_THREAD_ALIGN - 1) /
+        MLAS_SGEMM_STRIDEN_THREAD_ALIGN;
 
-        const size_t BlockedN = (N + MLAS_SGEMM_STRIDEN_THREAD_ALIGN - 1) /
-            MLAS_SGEMM_STRIDEN_THREAD_ALIGN;
+    if (N > M) {
 
         if (size_t(ThreadsPerGemm) > BlockedN) {
             ThreadsPerGemm = ptrdiff_t(BlockedN);
@@ -1620,20 +1823,166 @@ MlasGemmBatch(
         ThreadCountN = 1;
     }
 
-    MlasTrySimpleParallel(ThreadPool,
-        ThreadsPerGemm * static_cast<ptrdiff_t>(BatchSize),
-        [=](ptrdiff_t tid)
-    {
-        ptrdiff_t GemmIdx = tid / ThreadsPerGemm;
-        ptrdiff_t ThreadIdx = tid % ThreadsPerGemm;
-        MlasSgemmThreaded(ThreadCountM, ThreadCountN,
-            TransA, TransB, M, N, K, &(Data[GemmIdx]), ThreadIdx);
-    });
+    //
+    // Execute a batch of operations that each run single threaded by
+    // partitioning the batch itself. Tuning explores the per operation
+    // partitions, so it continues to use the generic path.
+    //
+
+    MLAS_GEMM_TUNING_MODE TuningMode;
+    const bool TuningActive = MlasGemmTuningIsActive(ThreadPool, &TuningMode);
+
+    if (ThreadsPerGemm == 1 && BatchSize > 1 && !TuningActive) {
+        MlasSgemmSmallBatch(TransA, TransB, M, N, K,
+            [Data](size_t b) { return Data[b]; }, BatchSize, ThreadPool);
+        return;
+    }
+
+    auto ExecuteBatch = [=](ptrdiff_t BatchThreadCountM, ptrdiff_t BatchThreadCountN,
+                            size_t StrideN, const MLAS_SGEMM_DATA_PARAMS* BatchData) {
+        const ptrdiff_t BatchThreadsPerGemm = BatchThreadCountM * BatchThreadCountN;
+
+        MlasTrySimpleParallel(ThreadPool,
+            BatchThreadsPerGemm * static_cast<ptrdiff_t>(BatchSize),
+            [=](ptrdiff_t tid)
+        {
+            ptrdiff_t GemmIdx = tid / BatchThreadsPerGemm;
+            ptrdiff_t ThreadIdx = tid % BatchThreadsPerGemm;
+            MlasSgemmThreaded(BatchThreadCountM, BatchThreadCountN, StrideN,
+                TransA, TransB, M, N, K, &(BatchData[GemmIdx]), ThreadIdx);
+        });
+    };
+
+    size_t StrideN = 0;
+
+    if (TuningActive && M != 0 && N != 0) {
+
+        MLAS_GEMM_TUNING_RESULT Tuning;
+        Tuning.Kind = MlasGemmTuningSgemm;
+        Tuning.Flags = (TransA != CblasNoTrans ? MLAS_GEMM_TUNING_FLAG_TRANSA : 0) |
+                       (TransB != CblasNoTrans ? MLAS_GEMM_TUNING_FLAG_TRANSB : 0) |
+                       (Data[0].BIsPacked ? MLAS_GEMM_TUNING_FLAG_B_PACKED : 0);
+        Tuning.M = M;
+        Tuning.N = N;
+        Tuning.K = K;
+        Tuning.BatchN = BatchSize;
+        Tuning.MaximumThreadCount = size_t(MaximumThreadCount);
+        Tuning.ThreadCountM = size_t(ThreadCountM);
+        Tuning.ThreadCountN = size_t(ThreadCountN);
+
+        //
+        // The packed path uses a fixed blocking. Otherwise, explore N strides
+        // for the B panel, excluding the strides whose K stride overflows the
+        // A panel used to transpose matrix A.
+        //
+
+        static const size_t StrideNCandidates[] = {32, 64, 128, 256, 512};
+
+        const size_t* StrideNFirst = StrideNCandidates;
+        size_t StrideNCount = std::size(StrideNCandidates);
+
+        if (Data[0].BIsPacked) {
+            StrideNFirst = nullptr;
+            StrideNCount = 0;
+        } else if (TransA != CblasNoTrans) {
+            StrideNFirst = StrideNCandidates + 2;
+            StrideNCount -= 2;
+        }
+
+        //
+        // Benchmark into a scratch copy of the output so that the caller's
+        // output is only written once with the selected parameters. The
+        // output processor only runs for the final execution.
+        //
+
+        std::vector<float> ScratchC;
+        std::vector<MLAS_SGEMM_DATA_PARAMS> ScratchData;
+
+        MlasGemmTuningSelectParams(TuningMode, Tuning, BlockedN, StrideNFirst, StrideNCount,
+            [&](const MLAS_GEMM_TUNING_RESULT& Candidate)
+        {
+            if (ScratchData.empty()) {
+                ScratchC.resize(BatchSize * M * N);
+                ScratchData.assign(Data, Data + BatchSize);
+                for (size_t b = 0; b < BatchSize; b++) {
+                    float* c = ScratchC.data() + b * M * N;
+                    for (size_t m = 0; m < M; m++) {
+                        std::copy_n(Data[b].C + m * Data[b].ldc, N, c + m * N);
+                    }
+                    ScratchData[b].C = c;
+                    ScratchData[b].ldc = N;
+                    ScratchData[b].OutputProcessor = nullptr;
+                }
+            }
+            ExecuteBatch(ptrdiff_t(Candidate.ThreadCountM), ptrdiff_t(Candidate.ThreadCountN),
+                Candidate.StrideN, ScratchData.data());
+        });
+
+        ThreadCountM = ptrdiff_t(Tuning.ThreadCountM);
+        ThreadCountN = ptrdiff_t(Tuning.ThreadCountN);
+        StrideN = Tuning.StrideN;
+    }
+
+    ExecuteBatch(ThreadCountM, ThreadCountN, StrideN, Data);
 }
 #if defined(_MSC_VER) && !defined(__clang__)
 #pragma warning(pop)
 #endif
 
+void
+MLASCALL
+MlasGemmStridedBatch(
+    CBLAS_TRANSPOSE TransA,
+    CBLAS_TRANSPOSE TransB,
+    size_t M,
+    size_t N,
+    size_t K,
+    const MLAS_SGEMM_DATA_PARAMS& Data,
+    size_t StrideA,
+    size_t StrideB,
+    size_t StrideC,
+    size_t BatchSize,
+    MLAS_THREADPOOL* ThreadPool
+    )
+{
+    if (Data.BIsPacked && StrideB != 0) {
+        MLAS_THROW_EX(std::invalid_argument, "packed matrix B must be shared by the batch");
+    }
+
+    auto GetData = [&Data, StrideA, StrideB, StrideC](size_t b) {
+        MLAS_SGEMM_DATA_PARAMS DataParams = Data;
+        DataParams.A += b * StrideA;
+        DataParams.B += b * StrideB;
+        DataParams.C += b * StrideC;
+        return DataParams;
+    };
+
+    if (BatchSize == 0) {
+        return;
+    }
+
+    const double Complexity = double(M) * double(N) * double(K);
+
+    if (BatchSize > 1 && Complexity < double(MLAS_SGEMM_THREAD_COMPLEXITY) * double(BatchSize)) {
+        MlasSgemmSmallBatch(TransA, TransB, M, N, K, GetData, BatchSize, ThreadPool);
+        return;
+    }
+
+    //
+    // Multiplications that are large enough to use multiple threads are
+    // expanded to the data parameters of the batch, so that the threads are
+    // divided among the multiplications as for MlasGemmBatch.
+    //
+
+    std::vector<MLAS_SGEMM_DATA_PARAMS> BatchData(BatchSize);
+
+    for (size_t b = 0; b < BatchSize; b++) {
+        BatchData[b] = GetData(b);
+    }
+
+    MlasGemmBatch(TransA, TransB, M, N, K, BatchData.data(), BatchSize, ThreadPool);
+}
+
 size_t
 MLASCALL
 MlasGemmPackBSize(
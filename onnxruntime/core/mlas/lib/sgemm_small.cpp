@@ -0,0 +1,367 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    sgemm_small.cpp
+
+Abstract:
+
+    This module implements register blocked kernels for single precision
+    matrix/matrix multiply operations (SGEMM) with one or two rows.
+
+    These kernels read matrices A and B in place. For a single row, copying
+    matrix B to a packed buffer costs about as much as the multiply itself,
+    so avoiding the copy is faster than using the packed kernels as long as
+    matrix B stays in the cache.
+
+--*/
+
+#include "mlasi.h"
+
+MLAS_FORCEINLINE
+void
+MlasSgemmSmallStoreOutput(
+    float* C,
+    float Value,
+    float alpha,
+    float beta
+    )
+{
+    if (beta == 0.0f) {
+        *C = alpha * Value;
+    } else {
+        *C = alpha * Value + beta * *C;
+    }
+}
+
+MLAS_FORCEINLINE
+void
+MlasSgemmSmallStoreOutput(
+    float* C,
+    MLAS_FLOAT32X4 Vector,
+    MLAS_FLOAT32X4 AlphaBroadcast,
+    float beta
+    )
+{
+    Vector = MlasMultiplyFloat32x4(Vector, AlphaBroadcast);
+
+    if (beta != 0.0f) {
+        Vector = MlasMultiplyAddFloat32x4(MlasLoadFloat32x4(C), beta, Vector);
+    }
+
+    MlasStoreFloat32x4(C, Vector);
+}
+
+void
+MlasSgemmSmallKernelNoTransB(
+    size_t N,
+    size_t K,
+    float alpha,
+    const float* A,
+    size_t StrideAK,
+    const float* B,
+    size_t ldb,
+    float beta,
+    float* C
+    )
+/*++
+
+Routine Description:
+
+    This routine computes a row of the output matrix, where matrix B is not
+    transposed. Blocks of eight columns are accumulated in registers by
+    broadcasting an element of matrix A against a row of matrix B.
+
+Arguments:
+
+    N - Supplies the number of columns of matrix B and matrix C.
+
+    K - Supplies the number of columns of matrix A and the number of rows of
+        matrix B.
+
+    alpha - Supplies the scalar alpha multiplier (see SGEMM definition).
+
+    A - Supplies the address of the row of matrix A.
+
+    StrideAK - Supplies the distance between elements of adjacent columns of
+        matrix A.
+
+    B - Supplies the address of matrix B.
+
+    ldb - Supplies the first dimension of matrix B.
+
+    beta - Supplies the scalar beta multiplier (see SGEMM definition).
+
+    C - Supplies the address of the row of matrix C.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    const MLAS_FLOAT32X4 AlphaBroadcast = MlasBroadcastFloat32x4(alpha);
+
+    size_t n = 0;
+
+    for (; n + 8 <= N; n += 8) {
+
+        MLAS_FLOAT32X4 Accumulator0 = MlasZeroFloat32x4();
+        MLAS_FLOAT32X4 Accumulator1 = MlasZeroFloat32x4();
+
+        const float* b = B + n;
+
+        for (size_t k = 0; k < K; k++) {
+            const MLAS_FLOAT32X4 ABroadcast = MlasBroadcastFloat32x4(A + k * StrideAK);
+            Accumulator0 = MlasMultiplyAddFloat32x4(ABroadcast, MlasLoadFloat32x4(b), Accumulator0);
+            Accumulator1 = MlasMultiplyAddFloat32x4(ABroadcast, MlasLoadFloat32x4(b + 4), Accumulator1);
+            b += ldb;
+        }
+
+        MlasSgemmSmallStoreOutput(C + n, Accumulator0, AlphaBroadcast, beta);
+        MlasSgemmSmallStoreOutput(C + n + 4, Accumulator1, AlphaBroadcast, beta);
+    }
+
+    if (n + 4 <= N) {
+
+        MLAS_FLOAT32X4 Accumulator = MlasZeroFloat32x4();
+
+        const float* b = B + n;
+
+        for (size_t k = 0; k < K; k++) {
+            const MLAS_FLOAT32X4 ABroadcast = MlasBroadcastFloat32x4(A + k * StrideAK);
+            Accumulator = MlasMultiplyAddFloat32x4(ABroadcast, MlasLoadFloat32x4(b), Accumulator);
+            b += ldb;
+        }
+
+        MlasSgemmSmallStoreOutput(C + n, Accumulator, AlphaBroadcast, beta);
+
+        n += 4;
+    }
+
+    for (; n < N; n++) {
+
+        float Accumulator = 0.0f;
+
+        const float* b = B + n;
+
+        for (size_t k = 0; k < K; k++) {
+            Accumulator += A[k * StrideAK] * *b;
+            b += ldb;
+        }
+
+        MlasSgemmSmallStoreOutput(C + n, Accumulator, alpha, beta);
+    }
+}
+
+void
+MlasSgemmSmallKernelTransB(
+    size_t N,
+    size_t K,
+    float alpha,
+    const float* A,
+    const float* B,
+    size_t ldb,
+    float beta,
+    float* C
+    )
+/*++
+
+Routine Description:
+
+    This routine computes a row of the output matrix, where matrix A is not
+    transposed and matrix B is transposed. Both operands are then contiguous
+    along the K dimension, so blocks of four columns are computed as dot
+    products.
+
+Arguments:
+
+    N - Supplies the number of columns of matrix B and matrix C.
+
+    K - Supplies the number of columns of matrix A and the number of rows of
+        matrix B.
+
+    alpha - Supplies the scalar alpha multiplier (see SGEMM definition).
+
+    A - Supplies the address of the row of matrix A.
+
+    B - Supplies the address of matrix B.
+
+    ldb - Supplies the first dimension of matrix B.
+
+    beta - Supplies the scalar beta multiplier (see SGEMM definition).
+
+    C - Supplies the address of the row of matrix C.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    size_t n = 0;
+
+    for (; n + 4 <= N; n += 4) {
+
+        const float* b0 = B + n * ldb;
+        const float* b1 = b0 + ldb;
+        const float* b2 = b1 + ldb;
+        const float* b3 = b2 + ldb;
+
+        MLAS_FLOAT32X4 Accumulator0 = MlasZeroFloat32x4();
+        MLAS_FLOAT32X4 Accumulator1 = MlasZeroFloat32x4();
+        MLAS_FLOAT32X4 Accumulator2 = MlasZeroFloat32x4();
+        MLAS_FLOAT32X4 Accumulator3 = MlasZeroFloat32x4();
+
+        size_t k = 0;
+
+        for (; k + 4 <= K; k += 4) {
+            const MLAS_FLOAT32X4 A0 = MlasLoadFloat32x4(A + k);
+            Accumulator0 = MlasMultiplyAddFloat32x4(A0, MlasLoadFloat32x4(b0 + k), Accumulator0);
+            Accumulator1 = MlasMultiplyAddFloat32x4(A0, MlasLoadFloat32x4(b1 + k), Accumulator1);
+            Accumulator2 = MlasMultiplyAddFloat32x4(A0, MlasLoadFloat32x4(b2 + k), Accumulator2);
+            Accumulator3 = MlasMultiplyAddFloat32x4(A0, MlasLoadFloat32x4(b3 + k), Accumulator3);
+        }
+
+        float Sum0 = MlasReduceAddFloat32x4(Accumulator0);
+        float Sum1 = MlasReduceAddFloat32x4(Accumulator1);
+        float Sum2 = MlasReduceAddFloat32x4(Accumulator2);
+        float Sum3 = MlasReduceAddFloat32x4(Accumulator3);
+
+        for (; k < K; k++) {
+            Sum0 += A[k] * b0[k];
+            Sum1 += A[k] * b1[k];
+            Sum2 += A[k] * b2[k];
+            Sum3 += A[k] * b3[k];
+        }
+
+        MlasSgemmSmallStoreOutput(C + n, Sum0, alpha, beta);
+        MlasSgemmSmallStoreOutput(C + n + 1, Sum1, alpha, beta);
+        MlasSgemmSmallStoreOutput(C + n + 2, Sum2, alpha, beta);
+        MlasSgemmSmallStoreOutput(C + n + 3, Sum3, alpha, beta);
+    }
+
+    for (; n < N; n++) {
+
+        const float* b = B + n * ldb;
+
+        MLAS_FLOAT32X4 Accumulator = MlasZeroFloat32x4();
+
+        size_t k = 0;
+
+        for (; k + 4 <= K; k += 4) {
+            Accumulator = MlasMultiplyAddFloat32x4(MlasLoadFloat32x4(A + k), MlasLoadFloat32x4(b + k), Accumulator);
+        }
+
+        float Sum = MlasReduceAddFloat32x4(Accumulator);
+
+        for (; k < K; k++) {
+            Sum += A[k] * b[k];
+        }
+
+        MlasSgemmSmallStoreOutput(C + n, Sum, alpha, beta);
+    }
+}
+
+bool
+MlasSgemmSmallKernel(
+    CBLAS_TRANSPOSE TransA,
+    CBLAS_TRANSPOSE TransB,
+    size_t M,
+    size_t N,
+    size_t K,
+    float alpha,
+    const float* A,
+    size_t lda,
+    const float* B,
+    size_t ldb,
+    float beta,
+    float* C,
+    size_t ldc
+    )
+/*++
+
+Routine Description:
+
+    This routine implements the single precision matrix/matrix multiply
+    operation (SGEMM) for one or two rows without packing matrix B.
+
+Arguments:
+
+    TransA - Supplies the transpose operation for matrix A.
+
+    TransB - Supplies the transpose operation for matrix B.
+
+    M - Supplies the number of rows of matrix A and matrix C.
+
+    N - Supplies the number of columns of matrix B and matrix C.
+
+    K - Supplies the number of columns of matrix A and the number of rows of
+        matrix B.
+
+    alpha - Supplies the scalar alpha multiplier (see SGEMM definition).
+
+    A - Supplies the address of matrix A.
+
+    lda - Supplies the first dimension of matrix A.
+
+    B - Supplies the address of matrix B.
+
+    ldb - Supplies the first dimension of matrix B.
+
+    beta - Supplies the scalar beta multiplier (see SGEMM definition).
+
+    C - Supplies the address of matrix C.
+
+    ldc - Supplies the first dimension of matrix C.
+
+Return Value:
+
+    Returns true if the operation was computed, else false if the shape of
+    the operation is not handled by these kernels.
+
+--*/
+{
+    //
+    // Leave matrices B that do not fit in the cache to the packed kernels.
+    //
+
+    if (N * K > MLAS_SGEMM_SMALL_KERNEL_MAXIMUM_NK) {
+        return false;
+    }
+
+    if (TransB == CblasNoTrans) {
+
+        if (M > MLAS_SGEMM_SMALL_KERNEL_MAXIMUM_M) {
+            return false;
+        }
+
+        const size_t StrideAM = (TransA == CblasNoTrans) ? lda : 1;
+        const size_t StrideAK = (TransA == CblasNoTrans) ? 1 : lda;
+
+        for (size_t m = 0; m < M; m++) {
+            MlasSgemmSmallKernelNoTransB(N, K, alpha, A + m * StrideAM, StrideAK, B, ldb, beta, C + m * ldc);
+        }
+
+        return true;
+    }
+
+    //
+    // The rows of a transposed matrix A are not contiguous along the K
+    // dimension, so leave this combination to the packed kernels.
+    //
+
+    if (TransA != CblasNoTrans || M > MLAS_SGEMM_SMALL_KERNEL_TRANSB_MAXIMUM_M) {
+        return false;
+    }
+
+    for (size_t m = 0; m < M; m++) {
+        MlasSgemmSmallKernelTransB(N, K, alpha, A + m * lda, B, ldb, beta, C + m * ldc);
+    }
+
+    return true;
+}
@@ -0,0 +1,401 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    sqnbitgemm_kernel_amx.cpp
+
+Abstract:
+
+    This module implements the AMX-INT8 kernel of the float/quantized 4-bit
+    integer matrix multiplication for SQNBIT_CompInt8.
+
+    Matrix B keeps the layout packed for the AVX512VNNI kernels, so that the
+    kernels can share the packed weights. The 4-bit blocks of a panel of 32
+    columns are unpacked once to unsigned 8-bit tiles in the VNNI layout and
+    multiplied with the signed 8-bit tiles of the quantized matrix A by
+    TDPBSUD. The int32 results of each block are scaled and accumulated in
+    fp32.
+
+--*/
+
+#include <algorithm>
+#include <cassert>
+
+#include "amx_common.h"
+
+namespace
+{
+
+constexpr size_t TileM = 16;
+constexpr size_t TileN = 16;
+
+//
+// PackQuantB packs the 4-bit data of matrix B in sub blocks of 128 values
+// for SQNBIT_CompInt8: the 64 bytes of a sub block hold | v0 v64 | v1 v65 |
+// ... | v63 v127 |. The sub blocks of each group of 4 columns are
+// interleaved, except for the remaining columns of matrix B. For blocks of
+// 32 or 64 values, the blocks of the last partial sub block are packed one
+// by one, | v0 v16 | ... | v15 v31 | for a block of 32 values, and the
+// blocks of each group of 4 columns are interleaved.
+//
+// The kernel is called with whole groups of 4 columns but the last ones,
+// so the remaining columns of matrix B are the remaining columns of CountN.
+//
+constexpr size_t PackedSubBlkLen = 128;
+
+struct MLAS_Q4_PACKED_LAYOUT {
+    size_t BlkLen;
+    size_t BlockCountK;
+    size_t CountN;
+    size_t BlksPerSubBlk;
+    size_t FullSubBlkCountK;
+    size_t StrideN;
+
+    MLAS_Q4_PACKED_LAYOUT(size_t blk_len, size_t block_count_k, size_t count_n)
+        : BlkLen(blk_len),
+          BlockCountK(block_count_k),
+          CountN(count_n),
+          BlksPerSubBlk(std::max(PackedSubBlkLen / blk_len, size_t{1})),
+          FullSubBlkCountK(block_count_k * blk_len / PackedSubBlkLen),
+          StrideN(block_count_k * blk_len / 2)
+    {
+    }
+
+    bool RemainderColumn(size_t n) const { return n >= (CountN & ~size_t{3}); }
+
+    size_t SubBlkOffset(size_t n, size_t k_subblk) const
+    {
+        if (RemainderColumn(n)) {
+            return n * StrideN + k_subblk * (PackedSubBlkLen / 2);
+        }
+        return (n & ~size_t{3}) * StrideN + k_subblk * 4 * (PackedSubBlkLen / 2) + (n & 3) * (PackedSubBlkLen / 2);
+    }
+
+    // Offset of a block of the last partial sub block.
+    size_t BlkOffset(size_t n, size_t k_blk) const
+    {
+        if (RemainderColumn(n)) {
+            return n * StrideN + k_blk * (BlkLen / 2);
+        }
+        const size_t b = k_blk - FullSubBlkCountK * BlksPerSubBlk;
+        return (n & ~size_t{3}) * StrideN + FullSubBlkCountK * 4 * (PackedSubBlkLen / 2) + (b * 4 + (n & 3)) * (BlkLen / 2);
+    }
+
+    size_t ScaleOffset(size_t n, size_t k_blk) const
+    {
+        if (RemainderColumn(n)) {
+            return n * BlockCountK + k_blk;
+        }
+        const size_t k_subblk = k_blk / BlksPerSubBlk;
+        const size_t b = k_blk % BlksPerSubBlk;
+        size_t offset = (n & ~size_t{3}) * BlockCountK + k_subblk * BlksPerSubBlk * 4;
+        if (k_subblk < BlockCountK / BlksPerSubBlk) {
+            offset += (n & 3) * BlksPerSubBlk + b;
+        } else {
+            offset += b * 4 + (n & 3);
+        }
+        return offset;
+    }
+};
+
+/*
+    This routine returns the values k0 to k0 + 63 of column n of matrix B,
+    zero extended to unsigned 8-bit.
+*/
+MLAS_FORCEINLINE __m512i
+MlasQ4Int8LoadColumnAmx(const MLAS_Q4_PACKED_LAYOUT& Layout, const std::byte* QuantBData, size_t n, size_t k0)
+{
+    const __m256i LowMask256 = _mm256_set1_epi8(0x0F);
+    const __m128i LowMask128 = _mm_set1_epi8(0x0F);
+
+    const size_t k_subblk = k0 / PackedSubBlkLen;
+
+    if (k_subblk < Layout.FullSubBlkCountK) {
+        const __m512i Bytes = _mm512_loadu_si512(QuantBData + Layout.SubBlkOffset(n, k_subblk));
+        const __m512i Values = (k0 % PackedSubBlkLen == 0) ? Bytes : _mm512_srli_epi16(Bytes, 4);
+        return _mm512_and_si512(Values, _mm512_set1_epi8(0x0F));
+    }
+
+    const size_t k_blk = k0 / Layout.BlkLen;
+
+    if (Layout.BlkLen == 64) {
+        const __m256i Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(QuantBData + Layout.BlkOffset(n, k_blk)));
+        const __m256i Low = _mm256_and_si256(Bytes, LowMask256);
+        const __m256i High = _mm256_and_si256(_mm256_srli_epi16(Bytes, 4), LowMask256);
+        return _mm512_inserti64x4(_mm512_castsi256_si512(Low), High, 1);
+    }
+
+    assert(Layout.BlkLen == 32);
+
+    __m256i Blocks[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+
+    for (size_t b = 0; b < 2 && k_blk + b < Layout.BlockCountK; b++) {
+        const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(QuantBData + Layout.BlkOffset(n, k_blk + b)));
+        const __m128i Low = _mm_and_si128(Bytes, LowMask128);
+        const __m128i High = _mm_and_si128(_mm_srli_epi16(Bytes, 4), LowMask128);
+        Blocks[b] = _mm256_inserti128_si256(_mm256_castsi128_si256(Low), High, 1);
+    }
+
+    return _mm512_inserti64x4(_mm512_castsi256_si512(Blocks[0]), Blocks[1], 1);
+}
+
+/*
+    This routine transposes 16 rows by 16 columns of 32-bit elements.
+*/
+MLAS_FORCEINLINE void
+MlasTranspose16x16Epi32(__m512i Rows[16])
+{
+    __m512i t[16];
+    __m512i u[16];
+
+    for (size_t i = 0; i < 16; i += 2) {
+        t[i] = _mm512_unpacklo_epi32(Rows[i], Rows[i + 1]);
+        t[i + 1] = _mm512_unpackhi_epi32(Rows[i], Rows[i + 1]);
+    }
+
+    for (size_t i = 0; i < 16; i += 4) {
+        u[i] = _mm512_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm512_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm512_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm512_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    for (size_t e = 0; e < 4; e++) {
+        const __m512i v0 = _mm512_shuffle_i32x4(u[e], u[4 + e], 0x44);
+        const __m512i v1 = _mm512_shuffle_i32x4(u[8 + e], u[12 + e], 0x44);
+        const __m512i w0 = _mm512_shuffle_i32x4(u[e], u[4 + e], 0xEE);
+        const __m512i w1 = _mm512_shuffle_i32x4(u[8 + e], u[12 + e], 0xEE);
+        Rows[e] = _mm512_shuffle_i32x4(v0, v1, 0x88);
+        Rows[4 + e] = _mm512_shuffle_i32x4(v0, v1, 0xDD);
+        Rows[8 + e] = _mm512_shuffle_i32x4(w0, w1, 0x88);
+        Rows[12 + e] = _mm512_shuffle_i32x4(w0, w1, 0xDD);
+    }
+}
+
+/*
+    This routine unpacks CountN (at most 16) columns of matrix B starting at
+    column n to a panel of tiles for TDPBSUD: row r of the panel holds the
+    values 4 * r to 4 * r + 3 of the 16 columns. The scales of the blocks are
+    copied to rows of ScaleStride floats. Missing columns are zero.
+*/
+void
+MlasQ4Int8UnpackBAmx(
+    const MLAS_Q4_PACKED_LAYOUT& Layout,
+    const std::byte* QuantBData,
+    const float* QuantBScale,
+    size_t n,
+    size_t CountN,
+    uint8_t* PanelB,
+    float* PanelScale,
+    size_t ScaleStride
+)
+{
+    const size_t CountK = Layout.BlockCountK * Layout.BlkLen;
+
+    for (size_t k0 = 0; k0 < CountK; k0 += 64) {
+        __m512i Rows[16];
+
+        for (size_t j = 0; j < 16; j++) {
+            Rows[j] = (j < CountN) ? MlasQ4Int8LoadColumnAmx(Layout, QuantBData, n + j, k0) : _mm512_setzero_si512();
+        }
+
+        MlasTranspose16x16Epi32(Rows);
+
+        for (size_t r = 0; r < 16; r++) {
+            _mm512_store_si512(PanelB + (k0 / 4 + r) * 64, Rows[r]);
+        }
+    }
+
+    for (size_t k_blk = 0; k_blk < Layout.BlockCountK; k_blk++) {
+        for (size_t j = 0; j < 16; j++) {
+            PanelScale[k_blk * ScaleStride + j] = (j < CountN) ? QuantBScale[Layout.ScaleOffset(n + j, k_blk)] : 0.0f;
+        }
+    }
+}
+
+/*
+    This routine loads the configuration of the tiles: TMM0 to TMM3 hold
+    16 rows by 16 int32 values of C, TMM4 and TMM5 hold 16 rows by KT values
+    of A and TMM6 and TMM7 hold KT / 4 rows of 16 columns by 4 values of B.
+*/
+void
+MlasQ4Int8TileConfigAmx(size_t KT)
+{
+    struct tileconfig_t tc = {0};
+
+    tc.palette_id = 1;
+    for (int t = 0; t < 8; t++) {
+        tc.rows[t] = 16;
+        tc.colb[t] = 64;
+    }
+    tc.colb[TMM4] = tc.colb[TMM5] = uint16_t(KT);
+    tc.rows[TMM6] = tc.rows[TMM7] = uint8_t(KT / 4);
+
+    struct tileconfig_t current_tc = {0};
+    tile_storeconfig(&current_tc);
+
+    if (std::memcmp(&current_tc, &tc, sizeof(tc)) != 0) {
+        tile_loadconfig(&tc);
+    }
+}
+
+/*
+    This routine scales the int32 results of a block of 16 rows by 16 columns
+    and accumulates them in fp32.
+*/
+MLAS_FORCEINLINE void
+MlasQ4Int8AccumulateTileAmx(
+    float* Acc,
+    const int32_t* Tile,
+    const float* QuantAScale,
+    size_t BlockCountK,
+    const float* ScaleB
+)
+{
+    const __m512 BlockScaleB = _mm512_load_ps(ScaleB);
+
+    for (size_t r = 0; r < TileM; r++) {
+        const __m512 Scale = _mm512_mul_ps(_mm512_set1_ps(QuantAScale[r * BlockCountK]), BlockScaleB);
+        const __m512 Dot = _mm512_cvtepi32_ps(_mm512_load_si512(Tile + r * TileN));
+        _mm512_store_ps(Acc + r * TileN, _mm512_fmadd_ps(Dot, Scale, _mm512_load_ps(Acc + r * TileN)));
+    }
+}
+
+MLAS_FORCEINLINE void
+MlasQ4Int8StoreTileAmx(float* C, size_t ldc, size_t CountN, const float* Acc, const float* Bias)
+{
+    const __mmask16 Mask = __mmask16((1u << CountN) - 1);
+    const __m512 BiasElements = (Bias != nullptr) ? _mm512_maskz_loadu_ps(Mask, Bias) : _mm512_setzero_ps();
+
+    for (size_t r = 0; r < TileM; r++) {
+        _mm512_mask_storeu_ps(C + r * ldc, Mask, _mm512_add_ps(_mm512_load_ps(Acc + r * TileN), BiasElements));
+    }
+}
+
+}  // namespace
+
+/*
+    This routine computes C = sum over the blocks of QuantAScale * QuantBScale *
+    (QuantA . QuantBData) + Bias for blocks of 32 values or more, for CountM a
+    multiple of 16. The products of the block sums of A and B that apply the
+    zero points of B are accumulated by the caller.
+*/
+void MLASCALL
+MlasQ4Int8GemmKernelAmx(
+    size_t BlkLen,
+    const std::byte* QuantA,
+    const float* QuantAScale,
+    const std::byte* QuantBData,
+    const float* QuantBScale,
+    float* C,
+    size_t CountM,
+    size_t CountN,
+    size_t BlockCountK,
+    const float* Bias,
+    size_t ldc
+)
+{
+    assert(BlkLen >= 32 && BlkLen % 32 == 0);
+    assert(CountM % TileM == 0);
+
+    const MLAS_Q4_PACKED_LAYOUT Layout(BlkLen, BlockCountK, CountN);
+
+    const size_t KT = std::min(BlkLen, size_t{64});
+    const size_t lda = BlockCountK * BlkLen;
+    const size_t PanelSize = MlasDivRoundup(lda, 64) * 64 * TileN;
+    const size_t ScaleStride = 2 * TileN;
+
+    MlasThreadedBufAlloc(2 * PanelSize + BlockCountK * ScaleStride * sizeof(float));
+
+    uint8_t* PanelB = ThreadedBufHolder.get();
+    float* PanelScale = reinterpret_cast<float*>(PanelB + 2 * PanelSize);
+
+    MLAS_DECLSPEC_ALIGN(int32_t Tiles[4][TileM * TileN], 64);
+    MLAS_DECLSPEC_ALIGN(float Acc[4][TileM * TileN], 64);
+
+    MlasQ4Int8TileConfigAmx(KT);
+
+    for (size_t n = 0; n < CountN; n += 2 * TileN) {
+        const size_t CountN0 = std::min(CountN - n, TileN);
+        const size_t CountN1 = (CountN - n > TileN) ? std::min(CountN - n - TileN, TileN) : 0;
+
+        MlasQ4Int8UnpackBAmx(Layout, QuantBData, QuantBScale, n, CountN0, PanelB, PanelScale, ScaleStride);
+        if (CountN1 > 0) {
+            MlasQ4Int8UnpackBAmx(Layout, QuantBData, QuantBScale, n + TileN, CountN1, PanelB + PanelSize, PanelScale + TileN, ScaleStride);
+        }
+
+        for (size_t m = 0; m < CountM; m += 2 * TileM) {
+            const bool TwoRowTiles = CountM - m > TileM;
+            const std::byte* a = QuantA + m * lda;
+            const float* a_scale = QuantAScale + m * BlockCountK;
+
+            std::fill_n(&Acc[0][0], 4 * TileM * TileN, 0.0f);
+
+            for (size_t k_blk = 0; k_blk < BlockCountK; k_blk++) {
+                tile_zero(TMM0);
+                tile_zero(TMM1);
+                tile_zero(TMM2);
+                tile_zero(TMM3);
+
+                for (size_t k = k_blk * BlkLen; k < (k_blk + 1) * BlkLen; k += KT) {
+                    tile_loadd(TMM4, a + k, lda);
+                    tile_loadd(TMM6, PanelB + k / 4 * 64, 64);
+                    tile_dpbsud(TMM0, TMM4, TMM6);
+
+                    if (CountN1 > 0) {
+                        tile_loadd(TMM7, PanelB + PanelSize + k / 4 * 64, 64);
+                        tile_dpbsud(TMM1, TMM4, TMM7);
+                    }
+
+                    if (TwoRowTiles) {
+                        tile_loadd(TMM5, a + TileM * lda + k, lda);
+                        tile_dpbsud(TMM2, TMM5, TMM6);
+
+                        if (CountN1 > 0) {
+                            tile_dpbsud(TMM3, TMM5, TMM7);
+                        }
+                    }
+                }
+
+                const float* ScaleB = PanelScale + k_blk * ScaleStride;
+
+                tile_stored(TMM0, Tiles[0], 64);
+                MlasQ4Int8AccumulateTileAmx(Acc[0], Tiles[0], a_scale + k_blk, BlockCountK, ScaleB);
+
+                if (CountN1 > 0) {
+                    tile_stored(TMM1, Tiles[1], 64);
+                    MlasQ4Int8AccumulateTileAmx(Acc[1], Tiles[1], a_scale + k_blk, BlockCountK, ScaleB + TileN);
+                }
+
+                if (TwoRowTiles) {
+                    tile_stored(TMM2, Tiles[2], 64);
+                    MlasQ4Int8AccumulateTileAmx(Acc[2], Tiles[2], a_scale + TileM * BlockCountK + k_blk, BlockCountK, ScaleB);
+
+                    if (CountN1 > 0) {
+                        tile_stored(TMM3, Tiles[3], 64);
+                        MlasQ4Int8AccumulateTileAmx(Acc[3], Tiles[3], a_scale + TileM * BlockCountK + k_blk, BlockCountK, ScaleB + TileN);
+                    }
+                }
+            }
+
+            float* c = C + m * ldc + n;
+            const float* bias = (Bias != nullptr) ? Bias + n : nullptr;
+
+            MlasQ4Int8StoreTileAmx(c, ldc, CountN0, Acc[0], bias);
+            if (CountN1 > 0) {
+                MlasQ4Int8StoreTileAmx(c + TileN, ldc, CountN1, Acc[1], (bias != nullptr) ? bias + TileN : nullptr);
+            }
+
+            if (TwoRowTiles) {
+                MlasQ4Int8StoreTileAmx(c + TileM * ldc, ldc, CountN0, Acc[2], bias);
+                if (CountN1 > 0) {
+                    MlasQ4Int8StoreTileAmx(c + TileM * ldc + TileN, ldc, CountN1, Acc[3], (bias != nullptr) ? bias + TileN : nullptr);
+                }
+            }
+        }
+    }
+}
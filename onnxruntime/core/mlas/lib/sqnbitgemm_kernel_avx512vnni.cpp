@@ -206,6 +206,38 @@ SQ4BitGemmM1Kernel_CompInt8_avx512vnni(
     }
 }
 
+//
+// Accumulates to C the products of the block sums of A and B, which apply the
+// zero points of B.
+//
+MLAS_FORCEINLINE
+void
+QNBitGemmAccumulateBlkSum(
+    const float* ABlockSum,
+    const float* QuantBBlkSum,
+    float* C,
+    size_t CountM,
+    size_t CountN,
+    size_t BlockCountK,
+    size_t ldc
+)
+{
+    float* c_blk = C;
+    const float* b_blk_sum = QuantBBlkSum;
+
+    size_t RowsRemaining = CountM;
+    const float* a_blksum_row = ABlockSum;
+    while (RowsRemaining > 0) {
+        auto RowsHandled = GetMlasPlatform().GemmFloatKernel(
+            a_blksum_row, b_blk_sum, c_blk, BlockCountK, RowsRemaining, CountN, BlockCountK, ldc, 1.f, false
+        );
+
+        c_blk += ldc * RowsHandled;
+        a_blksum_row += BlockCountK * RowsHandled;
+        RowsRemaining -= RowsHandled;
+    }
+}
+
 MLAS_FORCEINLINE
 size_t
 SQ4BitGemmKernel_BlkSum_CompInt8_avx512vnni(
@@ -282,20 +314,90 @@ SQ4BitGemmKernel_BlkSum_CompInt8_avx512vnni(
         );
     }
 
-    float* c_blk = C;
-    const float* b_blk_sum = QuantBBlkSum;
+    QNBitGemmAccumulateBlkSum(ABlockSum, QuantBBlkSum, C, CountM, CountN, BlockCountK, ldc);
+    return CountM;
+}
 
-    size_t RowsRemaining = CountM;
-    const float* a_blksum_row = ABlockSum;
-    while (RowsRemaining > 0) {
-        auto RowsHandled = GetMlasPlatform().GemmFloatKernel(
-            a_blksum_row, b_blk_sum, c_blk, BlockCountK, RowsRemaining, CountN, BlockCountK, ldc, 1.f, false
+void MLASCALL
+MlasQ4Int8GemmKernelAmx(
+    size_t BlkLen,
+    const std::byte* QuantA,
+    const float* QuantAScale,
+    const std::byte* QuantBData,
+    const float* QuantBScale,
+    float* C,
+    size_t CountM,
+    size_t CountN,
+    size_t BlockCountK,
+    const float* Bias,
+    size_t ldc
+);
+
+//
+// The AMX kernel computes the tiles of 16 rows for blocks of 32 values or
+// more. The remaining rows and blocks of 16 values use the AVX512VNNI kernel.
+//
+static size_t
+SQ4BitGemmKernel_BlkSum_CompInt8_amx(
+    const size_t BlkLen,
+    const std::byte* QuantA,
+    const float* QuantAScale,
+    const std::byte* QuantBData,
+    const float* QuantBScale,
+    const std::byte* QuantBZeroPoint,
+    float* C,
+    size_t CountM,
+    size_t CountN,
+    size_t CountK,
+    size_t BlockCountK,
+    const float* Bias,
+    size_t ldc,
+    const float* ABlockSum,
+    const float* QuantBBlkSum
+)
+{
+    constexpr size_t TileM = 16;
+
+    const size_t CountMAmx = (BlkLen >= 32) ? (CountM / TileM) * TileM : 0;
+
+    if (CountMAmx > 0) {
+        MlasQ4Int8GemmKernelAmx(
+            BlkLen,
+            QuantA,
+            QuantAScale,
+            QuantBData,
+            QuantBScale,
+            C,
+            CountMAmx,
+            CountN,
+            BlockCountK,
+            Bias,
+            ldc
         );
+        QNBitGemmAccumulateBlkSum(ABlockSum, QuantBBlkSum, C, CountMAmx, CountN, BlockCountK, ldc);
+    }
 
-        c_blk += ldc * RowsHandled;
-        a_blksum_row += BlockCountK * RowsHandled;
-        RowsRemaining -= RowsHandled;
+    if (CountM > CountMAmx) {
+        const size_t lda = BlockCountK * BlkLen;
+        SQ4BitGemmKernel_BlkSum_CompInt8_avx512vnni(
+            BlkLen,
+            QuantA + CountMAmx * lda,
+            QuantAScale + CountMAmx * BlockCountK,
+            QuantBData,
+            QuantBScale,
+            QuantBZeroPoint,
+            C + CountMAmx * ldc,
+            CountM - CountMAmx,
+            CountN,
+            CountK,
+            BlockCountK,
+            Bias,
+            ldc,
+            ABlockSum + CountMAmx * BlockCountK,
+            QuantBBlkSum
+        );
     }
+
     return CountM;
 }
 
@@ -375,20 +477,7 @@ SQ8BitGemmKernel_BlkSum_CompInt8_avx512vnni(
         );
     }
 
-    float* c_blk = C;
-    const float* b_blk_sum = QuantBBlkSum;
-
-    size_t RowsRemaining = CountM;
-    const float* a_blksum_row = ABlockSum;
-    while (RowsRemaining > 0) {
-        auto RowsHandled = GetMlasPlatform().GemmFloatKernel(
-            a_blksum_row, b_blk_sum, c_blk, BlockCountK, RowsRemaining, CountN, BlockCountK, ldc, 1.f, false
-        );
-
-        c_blk += ldc * RowsHandled;
-        a_blksum_row += BlockCountK * RowsHandled;
-        RowsRemaining -= RowsHandled;
-    }
+    QNBitGemmAccumulateBlkSum(ABlockSum, QuantBBlkSum, C, CountM, CountN, BlockCountK, ldc);
     return CountM;
 }
 
@@ -457,7 +546,9 @@ SQ8BitGemmPackQuantBDataAndBlkSum512vnni(
 //
 // Kernel dispatch structure definition.
 //
-const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAvx512vnni = []() {
+static MLAS_QNBIT_GEMM_DISPATCH
+GetMlasSQNBitGemmDispatchAvx512vnni()
+{
     MLAS_QNBIT_GEMM_DISPATCH d;
 
     d.Q4BitGemmPackQuantBDataSize = QNBitGemmPackQuantBDataSize<4>;
@@ -476,5 +567,15 @@ const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAvx512vnni = []() {
     d.SQ8BitGemmKernel_BlkSum_CompInt8 = SQ8BitGemmKernel_BlkSum_CompInt8_avx512vnni;
     d.QuantizeARowComputeBlkSum_CompInt8 = QuantizeARow_CompInt8_avx512;
 
+    return d;
+}
+
+const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAvx512vnni = GetMlasSQNBitGemmDispatchAvx512vnni();
+
+const MLAS_QNBIT_GEMM_DISPATCH MlasSQNBitGemmDispatchAmx = []() {
+    MLAS_QNBIT_GEMM_DISPATCH d = GetMlasSQNBitGemmDispatchAvx512vnni();
+
+    d.SQ4BitGemmKernel_BlkSum_CompInt8 = SQ4BitGemmKernel_BlkSum_CompInt8_amx;
+
     return d;
 }();
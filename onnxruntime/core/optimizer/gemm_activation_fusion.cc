@@ -3,8 +3,11 @@
 
 #include "core/optimizer/initializer.h"
 #include "core/optimizer/gemm_activation_fusion.h"
+#include "core/framework/tensorprotoutils.h"
 #include "core/graph/graph_utils.h"
 
+#include <optional>
+
 using namespace ONNX_NAMESPACE;
 using namespace ::onnxruntime::common;
 namespace onnxruntime {
@@ -30,12 +33,79 @@ bool IsFusableActivation(const Node& node) {
          IsSupportedOptypeVersionAndDomain(node, "Softplus", {1}, kOnnxDomain) ||
          IsSupportedOptypeVersionAndDomain(node, "Softsign", {1}, kOnnxDomain) ||
          IsSupportedOptypeVersionAndDomain(node, "Tanh", {6, 13}, kOnnxDomain) ||
+         IsSupportedOptypeVersionAndDomain(node, "Gelu", {20}, kOnnxDomain) ||
 #ifndef DISABLE_CONTRIB_OPS
          IsSupportedOptypeVersionAndDomain(node, "ScaledTanh", {1}, kOnnxDomain) ||
          IsSupportedOptypeVersionAndDomain(node, "ParametricSoftplus", {1}, kOnnxDomain) ||
+         IsSupportedOptypeVersionAndDomain(node, "Gelu", {1}, kMSDomain) ||
+         IsSupportedOptypeVersionAndDomain(node, "QuickGelu", {1}, kMSDomain) ||
+         (IsSupportedOptypeVersionAndDomain(node, "FastGelu", {1}, kMSDomain) && node.InputDefs().size() == 1) ||
 #endif
          IsSupportedOptypeVersionAndDomain(node, "ThresholdedRelu", {1, 10}, kOnnxDomain);
 }
+
+// The ONNX Gelu is mapped to the FusedGemm activations Gelu and FastGelu, which take no attributes.
+bool IsOnnxGelu(const Node& node) {
+  return node.OpType() == "Gelu" && node.Domain() == kOnnxDomain;
+}
+
+std::string GetActivationName(const Node& node) {
+  if (IsOnnxGelu(node)) {
+    const auto* approximate = graph_utils::GetNodeAttribute(node, "approximate");
+    return approximate != nullptr && approximate->s() == "tanh" ? "FastGelu" : "Gelu";
+  }
+  return node.OpType();
+}
+
+bool HasSameShape(const NodeArg& a, const NodeArg& b) {
+  const auto* a_shape = a.Shape();
+  const auto* b_shape = b.Shape();
+  if (a_shape == nullptr || b_shape == nullptr || a_shape->dim_size() != b_shape->dim_size()) {
+    return false;
+  }
+  for (int i = 0; i < a_shape->dim_size(); ++i) {
+    const auto& a_dim = a_shape->dim(i);
+    const auto& b_dim = b_shape->dim(i);
+    if (utils::HasDimValue(a_dim) && utils::HasDimValue(b_dim)) {
+      if (a_dim.dim_value() != b_dim.dim_value()) {
+        return false;
+      }
+    } else if (!utils::HasDimParam(a_dim) || !utils::HasDimParam(b_dim) || a_dim.dim_param() != b_dim.dim_param()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the index of the residual input if add_node adds a tensor of the same shape to the output of node.
+std::optional<int> GetResidualInputIndex(const Node& add_node, const Node& node) {
+  if (!IsSupportedOptypeVersionAndDomain(add_node, "Add", {7, 13, 14}, kOnnxDomain)) {
+    return std::nullopt;
+  }
+  const auto& inputs = add_node.InputDefs();
+  const NodeArg* output = node.OutputDefs()[0];
+  if (inputs.size() != 2 || inputs[0] == inputs[1] || (inputs[0] != output && inputs[1] != output)) {
+    return std::nullopt;
+  }
+  const int residual_index = inputs[0] == output ? 1 : 0;
+  const NodeArg& residual = *inputs[residual_index];
+  if (residual.TypeAsProto() == nullptr ||
+      residual.TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType_FLOAT ||
+      !HasSameShape(residual, *output)) {
+    return std::nullopt;
+  }
+  return residual_index;
+}
+
+// Returns the source of the input edge of node at input_index, if any.
+std::optional<std::pair<NodeIndex, int>> GetInputEdgeSource(const Node& node, int input_index) {
+  for (auto it = node.InputEdgesBegin(), end = node.InputEdgesEnd(); it != end; ++it) {
+    if (it->GetDstArgIndex() == input_index) {
+      return std::make_pair(it->GetNode().Index(), it->GetSrcArgIndex());
+    }
+  }
+  return std::nullopt;
+}
 }  // namespace
 
 Status GemmActivationFusion::ApplyImpl(Graph& graph, bool& modified, int graph_level,
@@ -63,38 +133,125 @@ Status GemmActivationFusion::ApplyImpl(Graph& graph, bool& modified, int graph_l
       continue;
     }
 
-    const Node& next_node = *(node.OutputNodesBegin());
-    if (!IsFusableActivation(next_node) || next_node.GetExecutionProviderType() != node.GetExecutionProviderType()) {
+    if (graph.NodeProducesGraphOutput(node)) {
       continue;
     }
 
-    if (graph.NodeProducesGraphOutput(node)) {
+    // Walk the chain of nodes that can be fused: an optional Reshape, an optional activation and an optional
+    // residual Add. Each node of the chain except the last one must only feed the next one.
+    const Node* current = &node;
+    auto get_next_node = [&]() -> const Node* {
+      if (current->GetOutputEdgesCount() != 1 || graph.NodeProducesGraphOutput(*current)) {
+        return nullptr;
+      }
+      const Node& next = *current->OutputNodesBegin();
+      return next.GetExecutionProviderType() == node.GetExecutionProviderType() ? &next : nullptr;
+    };
+
+    const Node* reshape_node = nullptr;
+    const Node* act_node = nullptr;
+    const Node* add_node = nullptr;
+    std::optional<int> residual_index;
+
+    const Node* next_node = get_next_node();
+    if (next_node != nullptr &&
+        graph_utils::IsSupportedOptypeVersionAndDomain(*next_node, "Reshape", {5, 13, 14, 19, 21}) &&
+        next_node->InputDefs()[0] == current->OutputDefs()[0]) {
+      reshape_node = next_node;
+      current = next_node;
+      next_node = get_next_node();
+    }
+    if (next_node != nullptr && IsFusableActivation(*next_node)) {
+      act_node = next_node;
+      current = next_node;
+      next_node = get_next_node();
+    }
+    if (next_node != nullptr && (residual_index = GetResidualInputIndex(*next_node, *current)).has_value()) {
+      add_node = next_node;
+    }
+
+    if (act_node == nullptr && add_node == nullptr) {
       continue;
     }
 
     Node& gemm_node = node;
-    Node& act_node = *graph.GetNode(next_node.Index());  // get mutable reference
+    InlinedVector<std::reference_wrapper<Node>> nodes_to_fuse{gemm_node};
+    for (const Node* fused : {reshape_node, act_node, add_node}) {
+      if (fused != nullptr) {
+        nodes_to_fuse.push_back(*graph.GetNode(fused->Index()));  // get mutable reference
+      }
+    }
+
+    // The residual becomes the optional fourth input of FusedGemm.
+    auto fused_gemm_input_defs = gemm_node.MutableInputDefs();
+    std::optional<std::pair<NodeIndex, int>> residual_source;
+    if (add_node != nullptr) {
+      fused_gemm_input_defs.resize(3, &graph.GetOrCreateNodeArg("", nullptr));
+      fused_gemm_input_defs.push_back(graph.GetNode(add_node->Index())->MutableInputDefs()[*residual_index]);
+      residual_source = GetInputEdgeSource(*add_node, *residual_index);
+    }
 
-    Node& fused_gemm = graph.AddNode(graph.GenerateNodeName("fused " + gemm_node.Name()), "FusedGemm",
-                                     "fused Gemm " + gemm_node.Name() + "with activation " + act_node.OpType(),
-                                     gemm_node.MutableInputDefs(), {}, &gemm_node.GetAttributes(), kMSDomain);
+    std::string description = "fused Gemm " + gemm_node.Name();
+    if (act_node != nullptr) {
+      description += " with activation " + act_node->OpType();
+    }
+    if (add_node != nullptr) {
+      description += " with residual Add";
+    }
 
-    // Add a new attribute to specify the activation type
-    fused_gemm.AddAttribute("activation", act_node.OpType());
+    // When there is a Reshape, the FusedGemm keeps the Gemm output and a new Reshape produces the final output.
+    std::vector<NodeArg*> fused_gemm_output_defs;
+    if (reshape_node != nullptr) {
+      fused_gemm_output_defs = gemm_node.MutableOutputDefs();
+    }
+    Node& fused_gemm = graph.AddNode(graph.GenerateNodeName("fused " + gemm_node.Name()), "FusedGemm", description,
+                                     fused_gemm_input_defs, fused_gemm_output_defs, &gemm_node.GetAttributes(),
+                                     kMSDomain);
 
     // Assign provider to this new node. Provider should be same as the provider for old node.
     fused_gemm.SetExecutionProviderType(gemm_node.GetExecutionProviderType());
 
-    // Add optional attributes for activations
-    const NodeAttributes& attrs = act_node.GetAttributes();
-    for (const auto& attr : attrs) {
-      AttributeProto fused_gemm_attr(attr.second);
-      fused_gemm_attr.set_name("activation_" + attr.first);
-      fused_gemm.AddAttributeProto(std::move(fused_gemm_attr));
+    if (act_node != nullptr) {
+      // Add a new attribute to specify the activation type
+      fused_gemm.AddAttribute("activation", GetActivationName(*act_node));
+
+      // Add optional attributes for activations
+      if (!IsOnnxGelu(*act_node)) {
+        const NodeAttributes& attrs = act_node->GetAttributes();
+        for (const auto& attr : attrs) {
+          AttributeProto fused_gemm_attr(attr.second);
+          fused_gemm_attr.set_name("activation_" + attr.first);
+          fused_gemm.AddAttributeProto(std::move(fused_gemm_attr));
+        }
+      }
     }
 
-    // move output definitions and edges from act_node to fused_gemm. delete gemm_node and act_node.
-    graph_utils::FinalizeNodeFusion(graph, {gemm_node, act_node}, fused_gemm);
+    Node* output_node = &fused_gemm;
+    std::optional<std::pair<NodeIndex, int>> shape_source;
+    if (reshape_node != nullptr) {
+      Node& old_reshape = *graph.GetNode(reshape_node->Index());
+      Node& new_reshape = graph.AddNode(graph.GenerateNodeName(old_reshape.Name()), "Reshape",
+                                        "Reshape for " + fused_gemm.Name(),
+                                        {gemm_node.MutableOutputDefs()[0], old_reshape.MutableInputDefs()[1]}, {},
+                                        &old_reshape.GetAttributes(), old_reshape.Domain());
+      new_reshape.SetExecutionProviderType(old_reshape.GetExecutionProviderType());
+      shape_source = GetInputEdgeSource(old_reshape, 1);
+      output_node = &new_reshape;
+    }
+
+    // move input edges from gemm_node to fused_gemm and output definitions and edges from the last node to
+    // output_node. delete the fused nodes.
+    graph_utils::FinalizeNodeFusion(graph, nodes_to_fuse, fused_gemm, *output_node);
+
+    if (residual_source.has_value()) {
+      graph.AddEdge(residual_source->first, fused_gemm.Index(), residual_source->second, 3);
+    }
+    if (output_node != &fused_gemm) {
+      graph.AddEdge(fused_gemm.Index(), output_node->Index(), 0, 0);
+      if (shape_source.has_value()) {
+        graph.AddEdge(shape_source->first, output_node->Index(), shape_source->second, 1);
+      }
+    }
 
     modified = true;
   }
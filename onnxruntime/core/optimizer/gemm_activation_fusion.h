@@ -7,6 +7,13 @@
 
 namespace onnxruntime {
 
+/**
+@Class GemmActivationFusion
+
+Fuses a float Gemm with the activation and the residual Add that follow it into a FusedGemm, which applies them in the
+epilogue of the GEMM. A Reshape between the Gemm and the fused nodes, as inserted by MatMulAddFusion for inputs with a
+rank above 2, is kept after the FusedGemm since the fused operations are element-wise.
+*/
 class GemmActivationFusion : public GraphTransformer {
  public:
   GemmActivationFusion(const InlinedHashSet<std::string_view>& compatible_execution_providers = {}) noexcept
@@ -3,6 +3,8 @@
 
 #include "core/optimizer/graph_transformer.h"
 
+#include "core/platform/threadpool.h"
+
 using namespace ::onnxruntime::common;
 
 namespace onnxruntime {
@@ -26,4 +28,47 @@ Status GraphTransformer::Apply(Graph& graph, bool& modified, const logging::Logg
   return status;
 }
 
+Status GraphTransformer::Recurse(Node& node, bool& modified, int graph_level, const logging::Logger& logger) const {
+  int subgraph_level = ++graph_level;
+  const auto& subgraph_map = node.GetAttributeNameToMutableSubgraphMap();
+  if (thread_pool_ == nullptr || subgraph_map.size() < 2) {
+    for (auto& entry : subgraph_map) {
+      auto& subgraph = *entry.second;
+      ORT_RETURN_IF_ERROR(ApplyImpl(subgraph, modified, subgraph_level, logger));
+    }
+
+    return Status::OK();
+  }
+
+  // the subgraphs of a node don't share any state the transformers modify, and the outer scope
+  // is left alone until all of them are done.
+  InlinedVector<Graph*> subgraphs;
+  subgraphs.reserve(subgraph_map.size());
+  for (auto& entry : subgraph_map) {
+    subgraphs.push_back(entry.second);
+  }
+
+  std::vector<Status> statuses(subgraphs.size());
+  std::unique_ptr<bool[]> subgraph_modified = std::make_unique<bool[]>(subgraphs.size());
+  concurrency::ThreadPool::TrySimpleParallelFor(
+      thread_pool_, static_cast<std::ptrdiff_t>(subgraphs.size()), [&](std::ptrdiff_t i) {
+        subgraph_modified[i] = false;
+        ORT_TRY {
+          statuses[i] = ApplyImpl(*subgraphs[i], subgraph_modified[i], subgraph_level, logger);
+        }
+        ORT_CATCH(const std::exception& ex) {
+          ORT_HANDLE_EXCEPTION([&]() {
+            statuses[i] = ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Exception applying ", Name(), ": ", ex.what());
+          });
+        }
+      });
+
+  for (size_t i = 0; i < subgraphs.size(); ++i) {
+    ORT_RETURN_IF_ERROR(statuses[i]);
+    modified = modified || subgraph_modified[i];
+  }
+
+  return Status::OK();
+}
+
 }  // namespace onnxruntime
@@ -49,6 +49,15 @@ common::Status GraphTransformerManager::ApplyTransformers(Graph& graph, Transfor
   return Status::OK();
 }
 
+void GraphTransformerManager::SetThreadPool(concurrency::ThreadPool* thread_pool) {
+  thread_pool_ = thread_pool;
+  for (auto& level_transformers : level_to_transformer_map_) {
+    for (auto& transformer : level_transformers.second) {
+      transformer->SetThreadPool(thread_pool);
+    }
+  }
+}
+
 const bool& GraphTransformerManager::IsGraphModified(void) const {
   return _is_graph_modified;
 }
@@ -64,6 +73,7 @@ common::Status GraphTransformerManager::Register(std::unique_ptr<GraphTransforme
     return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "This transformer is already registered " + name);
   }
 
+  transformer->SetThreadPool(thread_pool_);
   transformers_info_[name] = transformer.get();
   level_to_transformer_map_[level].push_back(std::move(transformer));
   return Status::OK();
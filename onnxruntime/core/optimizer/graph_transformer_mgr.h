@@ -34,6 +34,9 @@ class GraphTransformerManager {
     return check_load_cancellation_fn_ && check_load_cancellation_fn_();
   }
 
+  // Set the thread pool the registered transformers use to transform subgraphs concurrently. May be null.
+  void SetThreadPool(concurrency::ThreadPool* thread_pool);
+
   // Register a transformer with a level.
   common::Status Register(std::unique_ptr<GraphTransformer> transformer, TransformerLevel level);
 
@@ -54,6 +57,7 @@ class GraphTransformerManager {
   InlinedHashMap<TransformerLevel, InlinedVector<std::unique_ptr<GraphTransformer>>> level_to_transformer_map_;
   InlinedHashMap<std::string, GraphTransformer*> transformers_info_;
   CheckLoadCancellationFn check_load_cancellation_fn_;
+  concurrency::ThreadPool* thread_pool_ = nullptr;
   mutable bool _is_graph_modified = false;
 };
 }  // namespace onnxruntime
@@ -84,6 +84,11 @@ struct ThreadOptions {
   // The process that owns the thread may consider setting its affinity.
   std::vector<LogicalProcessors> affinities;
 
+  // NUMA node of each thread, indexed the same way as affinities (the first entry belongs to the main thread).
+  // If the threads span more than one node, the thread pool groups its workers per node and prefers to schedule
+  // and steal work within the node of the worker that is looking for it. Negative values mean "unknown".
+  std::vector<int> numa_nodes;
+
   // Set or unset denormal as zero.
   bool set_denormal_as_zero = false;
 
@@ -149,6 +154,15 @@ class Env {
 
   virtual int GetL2CacheSize() const = 0;
 
+  /// <summary>
+  /// Returns the NUMA node that the given logical processor belongs to.
+  /// </summary>
+  /// <param name="logical_processor_id">zero based logical processor id, as used in LogicalProcessors</param>
+  /// <returns>the node id, or -1 if it cannot be determined</returns>
+  virtual int GetNumaNodeId(int /*logical_processor_id*/) const {
+    return -1;
+  }
+
   /// \brief Returns the number of micro-seconds since the Unix epoch.
   virtual uint64_t NowMicros() const {
     return env_time_->NowMicros();
@@ -17,6 +17,8 @@ limitations under the License.
 #include "core/platform/env.h"
 
 #include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <ftw.h>
@@ -324,6 +326,27 @@ class PosixEnv : public Env {
 #endif
   }
 
+  int GetNumaNodeId(int logical_processor_id) const override {
+#if defined(__linux__)
+    // sysfs exposes the node of a cpu as a "node<N>" entry in its directory.
+    const std::string cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(logical_processor_id);
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(cpu_dir.c_str()), &closedir);
+    if (dir == nullptr) {
+      return -1;
+    }
+    while (const dirent* entry = readdir(dir.get())) {
+      const char* name = entry->d_name;
+      if (strncmp(name, "node", 4) == 0 && isdigit(static_cast<unsigned char>(name[4]))) {
+        return atoi(name + 4);
+      }
+    }
+    return -1;
+#else
+    ORT_UNUSED_PARAMETER(logical_processor_id);
+    return -1;
+#endif
+  }
+
   void SleepForMicroseconds(int64_t micros) const override {
     while (micros > 0) {
       timespec sleep_time;
@@ -308,6 +308,21 @@ int WindowsEnv::GetL2CacheSize() const {
   return l2_cache_size_;
 }
 
+int WindowsEnv::GetNumaNodeId(int logical_processor_id) const {
+  auto processor_info = GetProcessorAffinityMask(logical_processor_id);
+  if (processor_info.group_id < 0) {
+    return -1;
+  }
+  PROCESSOR_NUMBER processor_number = {};
+  processor_number.Group = static_cast<WORD>(processor_info.group_id);
+  processor_number.Number = static_cast<BYTE>(processor_info.local_processor_id);
+  USHORT node_number = 0;
+  if (!GetNumaProcessorNodeEx(&processor_number, &node_number) || node_number == MAXUSHORT) {
+    return -1;
+  }
+  return static_cast<int>(node_number);
+}
+
 WindowsEnv& WindowsEnv::Instance() {
   static WindowsEnv default_env;
   return default_env;
@@ -446,29 +461,29 @@ Status WindowsEnv::MapFileIntoMemory(_In_z_ const ORTCHAR_T* file_path,
   SYSTEM_INFO sysinfo;
   GetSystemInfo(&sysinfo);
 
-  static const DWORD page_size = sysinfo.dwPageSize;
+  // a view must start at a multiple of the allocation granularity, so map from the preceding multiple.
+  // external data is usually only aligned to a page or less.
   static const DWORD allocation_granularity = sysinfo.dwAllocationGranularity;
-  const FileOffsetType offset_to_page = offset % static_cast<FileOffsetType>(page_size);
-  const size_t mapped_length = length + static_cast<size_t>(offset_to_page);
-  const FileOffsetType mapped_offset = offset - offset_to_page;
-  if (mapped_offset % allocation_granularity != 0) {
-    const auto error_code = GetLastError();
-    return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL,
-                           "mapped offset must be a multiple of the allocation granularity",
-                           " , mapped_offset = ", mapped_offset,
-                           " , allocation_granularity = ", allocation_granularity,
-                           " , errcode = ", error_code,
-                           " - ", std::system_category().message(error_code));
-  }
+  const FileOffsetType offset_to_granularity = offset % static_cast<FileOffsetType>(allocation_granularity);
+  const size_t mapped_length = length + static_cast<size_t>(offset_to_granularity);
+  const FileOffsetType mapped_offset = offset - offset_to_granularity;
 
   void* const mapped_base = MapViewOfFile(file_mapping_handle.get(),
                                           FILE_MAP_READ,
                                           static_cast<DWORD>((mapped_offset >> 32) & 0xFFFFFFFF),
                                           static_cast<DWORD>(mapped_offset & 0xFFFFFFFF),
                                           mapped_length);
+  if (mapped_base == nullptr) {
+    const auto error_code = GetLastError();
+    return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL,
+                           "map view of file ", ToUTF8String(Basename(file_path)),
+                           " fail, mapped_offset = ", mapped_offset,
+                           " , errcode = ", error_code,
+                           " - ", std::system_category().message(error_code));
+  }
   GSL_SUPPRESS(r.11)
   mapped_memory =
-      MappedMemoryPtr{reinterpret_cast<char*>(mapped_base) + offset_to_page,
+      MappedMemoryPtr{reinterpret_cast<char*>(mapped_base) + offset_to_granularity,
                       OrtCallbackInvoker{OrtCallback{UnmapFile, new UnmapFileParam{mapped_base, mapped_length}}}};
 
   return Status::OK();
@@ -28,7 +28,13 @@ struct KernelRegistryAndStatus {
 
 namespace onnxruntime {
 CPUExecutionProvider::CPUExecutionProvider(const CPUExecutionProviderInfo& info)
-    : IExecutionProvider{onnxruntime::kCpuExecutionProvider}, info_{info} {}
+    : IExecutionProvider{onnxruntime::kCpuExecutionProvider},
+      info_{info},
+      tuning_context_{std::make_unique<CpuTuningContext>(this)} {}
+
+ITuningContext* CPUExecutionProvider::GetTuningContext() const {
+  return tuning_context_.get();
+}
 
 std::vector<AllocatorPtr> CPUExecutionProvider::CreatePreferredAllocators() {
   const bool create_arena = DoesCpuAllocatorSupportArenaUsage() ? info_.create_arena : false;
@@ -5,6 +5,7 @@
 
 #include "core/framework/execution_provider.h"
 #include "core/graph/constants.h"
+#include "core/providers/cpu/cpu_tuning_context.h"
 
 namespace onnxruntime {
 
@@ -32,9 +33,12 @@ class CPUExecutionProvider : public IExecutionProvider {
   std::unique_ptr<IDataTransfer> GetDataTransfer() const override;
   std::vector<AllocatorPtr> CreatePreferredAllocators() override;
 
+  ITuningContext* GetTuningContext() const override;
+
  private:
   CPUExecutionProviderInfo info_;
   std::vector<FuseRuleFn> fuse_rules_;
+  std::unique_ptr<CpuTuningContext> tuning_context_;
 };
 
 // Registers all available CPU kernels
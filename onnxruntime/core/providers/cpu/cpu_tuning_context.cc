@@ -0,0 +1,223 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/providers/cpu/cpu_tuning_context.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "core/common/cpuid_info.h"
+#include "core/common/logging/logging.h"
+#include "core/framework/tuning_context.h"
+#define TUNING_CONTEXT_IMPL
+#include "core/framework/tuning_context_impl.h"
+#undef TUNING_CONTEXT_IMPL
+#include "core/mlas/inc/mlas.h"
+#include "core/providers/cpu/cpu_execution_provider.h"
+
+namespace onnxruntime {
+
+namespace {
+
+constexpr const char* kMlasSgemmOpSignature = "MlasSgemm";
+constexpr const char* kMlasQgemmOpSignature = "MlasQgemm";
+
+// The tuned parameters are stored as the kernel id of a TuningResults entry: 12 bits for each thread count and 7 bits
+// for the N stride in units of 16 columns.
+constexpr size_t kThreadCountBits = 12;
+constexpr size_t kMaxThreadCount = (size_t{1} << kThreadCountBits) - 1;
+constexpr size_t kStrideNUnit = 16;
+constexpr size_t kMaxStrideN = 127 * kStrideNUnit;
+
+std::string MakeParamsSignature(const MLAS_GEMM_TUNING_RESULT& result) {
+  return MakeString("F", result.Flags, "_M", result.M, "_N", result.N, "_K", result.K,
+                    "_B", result.BatchN, "_T", result.MaximumThreadCount);
+}
+
+bool ParseParamsSignature(const std::string& signature, MLAS_GEMM_TUNING_RESULT& result) {
+  uint32_t flags;
+  uint64_t m, n, k, batch, threads;
+  int consumed = 0;
+  if (sscanf(signature.c_str(), "F%" SCNu32 "_M%" SCNu64 "_N%" SCNu64 "_K%" SCNu64 "_B%" SCNu64 "_T%" SCNu64 "%n",
+             &flags, &m, &n, &k, &batch, &threads, &consumed) != 6 ||
+      static_cast<size_t>(consumed) != signature.size()) {
+    return false;
+  }
+  result.Flags = flags;
+  result.M = static_cast<size_t>(m);
+  result.N = static_cast<size_t>(n);
+  result.K = static_cast<size_t>(k);
+  result.BatchN = static_cast<size_t>(batch);
+  result.MaximumThreadCount = static_cast<size_t>(threads);
+  return true;
+}
+
+bool EncodeParams(const MLAS_GEMM_TUNING_RESULT& result, int& id) {
+  if (result.ThreadCountM > kMaxThreadCount || result.ThreadCountN > kMaxThreadCount ||
+      result.StrideN > kMaxStrideN || result.StrideN % kStrideNUnit != 0) {
+    return false;
+  }
+  id = static_cast<int>(result.ThreadCountM | (result.ThreadCountN << kThreadCountBits) |
+                        ((result.StrideN / kStrideNUnit) << (2 * kThreadCountBits)));
+  return true;
+}
+
+void DecodeParams(int id, MLAS_GEMM_TUNING_RESULT& result) {
+  const auto value = static_cast<size_t>(id);
+  result.ThreadCountM = value & kMaxThreadCount;
+  result.ThreadCountN = (value >> kThreadCountBits) & kMaxThreadCount;
+  result.StrideN = (value >> (2 * kThreadCountBits)) * kStrideNUnit;
+}
+
+}  // namespace
+
+std::string CpuTuningResultsValidator::GetCpuModel() const {
+  const auto& cpuid_info = CPUIDInfo::GetCPUIDInfo();
+  auto model = cpuid_info.GetCPUModel();
+  return std::string{model.empty() ? cpuid_info.GetCPUVendor() : model};
+}
+
+Status CpuTuningResultsValidator::ValidateCpuModel(const std::string& value) const {
+  auto current = GetCpuModel();
+  ORT_RETURN_IF(current != value, "CPU model mismatch: tuning results produced with CPU ", value,
+                ", onnxruntime currently run with CPU ", current);
+  return Status::OK();
+}
+
+CpuTuningResultsValidator::CpuTuningResultsValidator() {
+  RegisterValidator(
+      "CPU_MODEL",
+      [this]() { return GetCpuModel(); },
+      [this](const std::string& value) { return ValidateCpuModel(value); });
+}
+
+CpuTuningContext::CpuTuningContext(CPUExecutionProvider* ep) : ITuningContext(ep) {}
+
+CpuTuningContext::~CpuTuningContext() {
+  ClearMlasTuningMode();
+}
+
+void CpuTuningContext::SetThreadPool(concurrency::ThreadPool* thread_pool) {
+  if (thread_pool != thread_pool_) {
+    ClearMlasTuningMode();
+    thread_pool_ = thread_pool;
+    UpdateMlasTuningMode();
+  }
+}
+
+void CpuTuningContext::EnableTunableOp() {
+  LOGS_DEFAULT(INFO) << "Enable TunableOp for CPU Execution Provider";
+  tunable_op_enable_ = true;
+  UpdateMlasTuningMode();
+}
+
+void CpuTuningContext::DisableTunableOp() {
+  LOGS_DEFAULT(INFO) << "Disable TunableOp for CPU Execution Provider";
+  tunable_op_enable_ = false;
+  UpdateMlasTuningMode();
+}
+
+bool CpuTuningContext::IsTunableOpEnabled() const {
+  return tunable_op_enable_;
+}
+
+void CpuTuningContext::EnableTuning() {
+  LOGS_DEFAULT(INFO) << "Enable TunableOp tuning for CPU Execution Provider";
+  tuning_enable_ = true;
+  UpdateMlasTuningMode();
+}
+
+void CpuTuningContext::DisableTuning() {
+  LOGS_DEFAULT(INFO) << "Disable TunableOp tuning for CPU Execution Provider";
+  tuning_enable_ = false;
+  UpdateMlasTuningMode();
+}
+
+bool CpuTuningContext::IsTuningEnabled() const {
+  return tuning_enable_;
+}
+
+void CpuTuningContext::SetMaxTuningDurationMs(int max_duration_ms) {
+  max_tuning_duration_ms_ = max_duration_ms;
+  UpdateMlasTuningMode();
+}
+
+int CpuTuningContext::GetMaxTuningDurationMs() const {
+  return max_tuning_duration_ms_ > 0 ? max_tuning_duration_ms_ : std::numeric_limits<int>::max();
+}
+
+TuningResultsManager& CpuTuningContext::GetTuningResultsManager() {
+  return manager_;
+}
+
+const TuningResultsManager& CpuTuningContext::GetTuningResultsManager() const {
+  return manager_;
+}
+
+const TuningResultsValidator& CpuTuningContext::GetTuningResultsValidator() const {
+  return validator_;
+}
+
+void CpuTuningContext::UpdateMlasTuningMode() {
+  // Without a thread pool the GEMMs of this session can not be told apart from those of the other single threaded
+  // sessions, so they are not tuned.
+  if (tunable_op_enable_ && thread_pool_ != nullptr) {
+    MlasGemmTuningSetMode(thread_pool_, this, true, tuning_enable_,
+                          static_cast<uint32_t>(std::max(max_tuning_duration_ms_, 0)));
+    mlas_mode_set_ = true;
+  } else {
+    ClearMlasTuningMode();
+  }
+}
+
+void CpuTuningContext::ClearMlasTuningMode() {
+  // Only remove the mode set by this context, the thread pool may be shared with other sessions that enabled tuning.
+  if (mlas_mode_set_) {
+    MlasGemmTuningSetMode(thread_pool_, this, false, false, 0);
+    mlas_mode_set_ = false;
+  }
+}
+
+TuningResults CpuTuningContext::GetTuningResults() const {
+  // The results live in the MLAS tuning cache, copy them to the manager so they are exported with the validators.
+  std::vector<MLAS_GEMM_TUNING_RESULT> results(MlasGemmTuningGetResults(nullptr, 0));
+  results.resize(std::min(results.size(), MlasGemmTuningGetResults(results.data(), results.size())));
+
+  for (const auto& result : results) {
+    int id;
+    if (!EncodeParams(result, id)) {
+      continue;
+    }
+    const char* op_signature = result.Kind == MlasGemmTuningSgemm ? kMlasSgemmOpSignature : kMlasQgemmOpSignature;
+    const auto params_signature = MakeParamsSignature(result);
+    manager_.Delete(op_signature, params_signature);
+    manager_.Add(op_signature, params_signature, id);
+  }
+
+  return ITuningContext::GetTuningResults();
+}
+
+Status CpuTuningContext::LoadTuningResults(const TuningResults& tr) {
+  ORT_RETURN_IF_ERROR(ITuningContext::LoadTuningResults(tr));
+
+  for (const auto kind : {MlasGemmTuningSgemm, MlasGemmTuningQgemm}) {
+    const char* op_signature = kind == MlasGemmTuningSgemm ? kMlasSgemmOpSignature : kMlasQgemmOpSignature;
+    for (const auto& [params_signature, id] : manager_.Lookup(op_signature)) {
+      MLAS_GEMM_TUNING_RESULT result;
+      result.Kind = kind;
+      if (id < 0 || !ParseParamsSignature(params_signature, result)) {
+        LOGS_DEFAULT(WARNING) << "Ignoring malformed tuning result " << op_signature << " " << params_signature;
+        continue;
+      }
+      DecodeParams(id, result);
+      MlasGemmTuningAddResult(result);
+    }
+  }
+
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
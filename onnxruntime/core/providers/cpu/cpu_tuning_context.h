@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <string>
+
+#include "core/framework/tuning_context.h"
+#include "core/platform/threadpool.h"
+
+namespace onnxruntime {
+
+class CPUExecutionProvider;
+
+class CpuTuningResultsValidator : public TuningResultsValidator {
+ public:
+  CpuTuningResultsValidator();
+
+ protected:
+  std::string GetCpuModel() const;
+  Status ValidateCpuModel(const std::string& value) const;
+};
+
+// Tuning context of the CPU EP. The tunable operations are the MLAS SGEMM and QGEMM batch routines, whose thread
+// partition and blocking are selected per GEMM shape. The MLAS tuning mode is set for the thread pool of the session,
+// so only the GEMMs run on that thread pool use or produce tuned results. MLAS keeps a single process wide cache of
+// the results, so results tuned by one session are visible to the other sessions that enable tuning.
+class CpuTuningContext : public ITuningContext {
+ public:
+  explicit CpuTuningContext(CPUExecutionProvider* ep);
+  ~CpuTuningContext() override;
+
+  // Sets the thread pool whose GEMMs are tuned. The mode of a previous thread pool is removed. The GEMMs of a
+  // session without an intra-op thread pool are not tuned.
+  void SetThreadPool(concurrency::ThreadPool* thread_pool);
+
+  void EnableTunableOp() override;
+  void DisableTunableOp() override;
+  bool IsTunableOpEnabled() const override;
+
+  void EnableTuning() override;
+  void DisableTuning() override;
+  bool IsTuningEnabled() const override;
+
+  void SetMaxTuningDurationMs(int max_duration_ms) override;
+  int GetMaxTuningDurationMs() const override;
+
+  TuningResultsManager& GetTuningResultsManager() override;
+  const TuningResultsManager& GetTuningResultsManager() const override;
+
+  const TuningResultsValidator& GetTuningResultsValidator() const override;
+
+  TuningResults GetTuningResults() const override;
+  Status LoadTuningResults(const TuningResults& tr) override;
+
+ private:
+  void UpdateMlasTuningMode();
+  void ClearMlasTuningMode();
+
+  concurrency::ThreadPool* thread_pool_{nullptr};
+  bool mlas_mode_set_{false};
+  bool tunable_op_enable_{false};
+  bool tuning_enable_{false};
+  int max_tuning_duration_ms_{0};
+  mutable TuningResultsManager manager_;
+  CpuTuningResultsValidator validator_;
+};
+
+}  // namespace onnxruntime
@@ -3,6 +3,10 @@
 
 #include "einsum_auxiliary_ops.h"
 
+#include <type_traits>
+
+#include "core/mlas/inc/mlas.h"
+
 using namespace onnxruntime::common;
 
 namespace onnxruntime {
@@ -34,14 +38,28 @@ Status MatMul(const T* input_1_data, const T* input_2_data, T* output_data,
               size_t left_stride, size_t right_stride, size_t output_stride,
               size_t num_batches, size_t M, size_t K, size_t N, concurrency::ThreadPool* tp,
               void* /*einsum_cuda_assets*/) {
-  for (size_t i = 0; i < num_batches; ++i) {
-    math::MatMul<T>(
-        static_cast<int>(M),
-        static_cast<int>(N),
-        static_cast<int>(K),
-        input_1_data + i * left_stride,
-        input_2_data + i * right_stride,
-        output_data + i * output_stride, tp);
+  // Batches of float matrices are partitioned across threads at the batch level,
+  // which suits the many small contractions that Einsum typically produces.
+  if constexpr (std::is_same_v<T, float>) {
+    MLAS_SGEMM_DATA_PARAMS data;
+    data.A = input_1_data;
+    data.lda = K;
+    data.B = input_2_data;
+    data.ldb = N;
+    data.C = output_data;
+    data.ldc = N;
+    MlasGemmStridedBatch(CblasNoTrans, CblasNoTrans, M, N, K, data, left_stride, right_stride, output_stride,
+                         num_batches, tp);
+  } else {
+    for (size_t i = 0; i < num_batches; ++i) {
+      math::MatMul<T>(
+          static_cast<int>(M),
+          static_cast<int>(N),
+          static_cast<int>(K),
+          input_1_data + i * left_stride,
+          input_2_data + i * right_stride,
+          output_data + i * output_stride, tp);
+    }
   }
 
   return Status::OK();
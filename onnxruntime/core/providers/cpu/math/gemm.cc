@@ -223,9 +223,17 @@ void Gemm<MLFloat16>::ComputeGemm(CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans
     return;
   }
 #endif
-  // Fallback to Eigen
   // Broadcast the bias as needed if bias is given
   GemmBroadcastBias(M, N, beta, c_data, c_shape, y_data);
+
+  if (MlasHGemmSupported(trans_a, trans_b)) {
+    MlasGemm(trans_a, trans_b, static_cast<size_t>(M), static_cast<size_t>(N), static_cast<size_t>(K),
+             a_data, static_cast<size_t>(K), b_data, static_cast<size_t>(trans_b == CblasNoTrans ? N : K),
+             y_data, static_cast<size_t>(N), alpha.val, beta.val, thread_pool);
+    return;
+  }
+
+  // Fallback to Eigen
 #if defined(__GNUC__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
@@ -395,6 +403,8 @@ Status Gemm<float>::Compute(OpKernelContext* context) const {
   const auto* A = context->Input<Tensor>(0);
   const auto* B = packed_b_ ? nullptr : context->Input<Tensor>(1);
   const auto* C = context->Input<Tensor>(2);
+  // Optional residual of FusedGemm, added after the activation.
+  const auto* R = context->Input<Tensor>(3);
 
   // Bias could be missing. Treat as scalar 0 if that is the case.
   GemmHelper helper(A->Shape(), trans_A_ != CblasNoTrans, B ? B->Shape() : b_shape_, trans_B_ != CblasNoTrans,
@@ -407,6 +417,11 @@ Status Gemm<float>::Compute(OpKernelContext* context) const {
   ptrdiff_t N = helper.N();
   ptrdiff_t K = helper.K();
 
+  if (R != nullptr && R->Shape().Size() != SafeInt<int64_t>(M) * N) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Residual input R has shape ", R->Shape(),
+                           " but the output has ", M, " x ", N, " elements");
+  }
+
   auto Y = context->Output(0, {M, N});
 
   // if input is empty tensor, return as nothing need to be calculated and we've set the shape for the output
@@ -417,34 +432,81 @@ Status Gemm<float>::Compute(OpKernelContext* context) const {
 
   const float* c_data = C != nullptr ? C->Data<float>() : nullptr;
   const TensorShape* c_shape = C != nullptr ? &C->Shape() : nullptr;
+  const float* r_data = R != nullptr ? R->Data<float>() : nullptr;
+
+  if (K > 0) {
+    // Apply the bias, the activation and the residual in the epilogue of the MLAS GEMM so that each output tile is
+    // finalized while it is in the cache. Biases that are not a row vector or a full matrix are still broadcast to
+    // the output first, and an activation without an MLAS implementation runs as a separate pass.
+    MLAS_GEMM_EPILOGUE_PROCESSOR epilogue;
+    float gemm_beta = 0.0f;
+
+    if (c_data != nullptr && beta_ != 0.0f) {
+      // A scalar C has no dimensions to inspect and is broadcast to the output like any other C that is
+      // neither a row vector nor a full matrix.
+      const bool c_is_scalar = c_shape->NumDimensions() == 0;
+      const bool c_is_row = !c_is_scalar && c_shape->Size() == N &&
+                            (c_shape->NumDimensions() == 1 || (*c_shape)[0] == 1);
+      const bool c_is_matrix = c_shape->NumDimensions() == 2 && (*c_shape)[0] == M && (*c_shape)[1] == N;
+      if (c_is_row) {
+        epilogue.AddBias(c_data, beta_);
+      } else if (c_is_matrix) {
+        epilogue.AddResidual(c_data, static_cast<size_t>(N), beta_);
+      } else {
+        GemmBroadcastBias(M, N, beta_, c_data, c_shape, y_data);
+        gemm_beta = beta_;
+      }
+    }
 
-  if (B) {
-    ComputeGemm(trans_A_, trans_B_, M, N, K, alpha_, A->Data<float>(), B->Data<float>(), beta_,
-                c_data, c_shape, y_data, thread_pool);
+    if (!activation_) {
+      if (epilogue_activation_.has_value()) {
+        epilogue.AddOp(*epilogue_activation_);
+      }
+      if (r_data != nullptr) {
+        epilogue.AddResidual(r_data, static_cast<size_t>(N));
+        r_data = nullptr;
+      }
+    }
+
+    MLAS_SGEMM_DATA_PARAMS data;
+    data.A = A->Data<float>();
+    data.lda = static_cast<size_t>(trans_A_ != CblasNoTrans ? M : K);
+    if (B) {
+      data.B = B->Data<float>();
+      data.ldb = static_cast<size_t>(trans_B_ != CblasNoTrans ? K : N);
+    } else {
+      data.B = static_cast<const float*>(packed_b_.get());
+      data.BIsPacked = true;
+    }
+    data.C = y_data;
+    data.ldc = static_cast<size_t>(N);
+    data.alpha = alpha_;
+    data.beta = gemm_beta;
+    data.OutputProcessor = epilogue.IsEmpty() ? nullptr : &epilogue;
+
+    // The transpose of B does not matter when B is packed.
+    MlasGemm(trans_A_, B ? trans_B_ : CblasTrans, static_cast<size_t>(M), static_cast<size_t>(N),
+             static_cast<size_t>(K), data, thread_pool);
   } else {
     GemmBroadcastBias(M, N, beta_, c_data, c_shape, y_data);
-    if (K > 0) {
-      MlasGemm(
-          trans_A_,
-          static_cast<size_t>(M),
-          static_cast<size_t>(N),
-          static_cast<size_t>(K),
-          alpha_,
-          A->Data<float>(),
-          static_cast<size_t>(trans_A_ != CblasNoTrans ? M : K),
-          packed_b_.get(),
-          c_data != nullptr ? beta_ : 0.0f,
-          y_data,
-          static_cast<size_t>(N),
-          thread_pool);
-    } else if (beta_ == 0 || c_data == nullptr) {
+    if (beta_ == 0 || c_data == nullptr) {
       EigenMatrixMapRowMajor<float> dest(y_data, narrow<Eigen::Index>(M), narrow<Eigen::Index>(N));
       dest.setZero();
     }
+    if (!activation_ && epilogue_activation_.has_value()) {
+      MLAS_GEMM_EPILOGUE_PROCESSOR epilogue;
+      epilogue.AddOp(*epilogue_activation_);
+      epilogue.Process(y_data, 0, 0, static_cast<size_t>(M), static_cast<size_t>(N), static_cast<size_t>(N));
+    }
   }
 
   ComputeActivation(y_data, SafeInt<size_t>(M) * N, thread_pool);
 
+  if (r_data != nullptr) {
+    const auto y_size = narrow<Eigen::Index>(SafeInt<size_t>(M) * N);
+    EigenVectorArrayMap<float>(y_data, y_size) += ConstEigenVectorArrayMap<float>(r_data, y_size);
+  }
+
   return Status::OK();
 }
 
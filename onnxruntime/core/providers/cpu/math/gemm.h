@@ -3,10 +3,13 @@
 
 #pragma once
 
+#include <optional>
+
 #include "gemm_base.h"
 
 #include "core/framework/op_kernel.h"
 #include "core/common/common.h"
+#include "core/mlas/inc/mlas.h"
 #include "core/util/math.h"
 #include "core/providers/cpu/activation/activations.h"
 
@@ -44,6 +47,9 @@ class Gemm : protected GemmBase, public OpKernel {
   // For fused gemm + activation
   std::unique_ptr<functors::ElementWiseRangedTransform<T>> activation_;
 
+  // For fused gemm + activation that is applied by the MLAS GEMM epilogue instead of activation_
+  std::optional<MLAS_GEMM_EPILOGUE_OP> epilogue_activation_;
+
   void ComputeActivation(_Inout_updates_(y_size) T* y_data, ptrdiff_t y_size, _Inout_opt_ concurrency::ThreadPool* thread_pool) const;
 };
 
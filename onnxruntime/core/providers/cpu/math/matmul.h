@@ -30,9 +30,15 @@ class MatMul<float> final : public OpKernel {
     trans_batch_a_ = trans_batch_a_attr != 0;
     trans_batch_b_ = trans_batch_b_attr != 0;
 
-#if defined(__aarch64__) && defined(__linux__)
+#if defined(MLAS_SBGEMM_SUPPORTED)
+#if defined(MLAS_TARGET_AMD64)
+    auto config_ops = info.GetConfigOptions().GetConfigEntry(kOrtSessionOptionsMlasGemmFastMathX64Bfloat16);
+#else
     auto config_ops = info.GetConfigOptions().GetConfigEntry(kOrtSessionOptionsMlasGemmFastMathArm64Bfloat16);
-    use_fastmath_mode_ = (config_ops == "1") && MlasBf16AccelerationSupported();
+#endif
+    // the sbgemm kernels compute A * B, without the transposition or scaling of A of FusedMatMul
+    use_fastmath_mode_ = (config_ops == "1") && MlasBf16AccelerationSupported() &&
+                         trans_a_attr_ == 0 && !trans_batch_a_ && alpha_attr_ == 1.0f;
 #endif
   }
 
@@ -56,10 +62,10 @@ class MatMul<float> final : public OpKernel {
   bool trans_batch_a_;
   bool trans_batch_b_;
 
-#if defined(__aarch64__) && defined(__linux__)
+#if defined(MLAS_SBGEMM_SUPPORTED)
   // fastmath mode state
   bool use_fastmath_mode_;
-  // sbgemm kernel is implemented as 8x8 blocks with weights pre-packed to 4 blocks of 4x2
+  // the arm64 sbgemm kernel is implemented as 8x8 blocks with weights pre-packed to 4 blocks of 4x2
   // so a minimum of 32 elements is defined to outweigh the additional prepacking overhead
   const size_t kFastMathModeKernelsizeThreshold = 32;
 #endif
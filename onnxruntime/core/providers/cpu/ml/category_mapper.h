@@ -5,6 +5,7 @@
 
 #include "core/common/common.h"
 #include "core/framework/op_kernel.h"
+#include "core/providers/cpu/ml/lookup_table.h"
 #include "core/providers/cpu/ml/ml_common.h"
 
 namespace onnxruntime {
@@ -26,23 +27,20 @@ class CategoryMapper final : public OpKernel {
 
     ORT_ENFORCE(num_entries == int_categories.size());
 
-    string_to_int_map_.reserve(num_entries);
-    int_to_string_map_.reserve(num_entries);
-
     for (size_t i = 0; i < num_entries; ++i) {
       const std::string& str = string_categories[i];
       int64_t index = int_categories[i];
 
-      string_to_int_map_[str] = index;
-      int_to_string_map_[index] = str;
+      string_to_int_map_.InsertOrAssign(str, index);
+      int_to_string_map_.InsertOrAssign(index, str);
     }
   }
 
   Status Compute(OpKernelContext* context) const override;
 
  private:
-  std::unordered_map<std::string, int64_t> string_to_int_map_;
-  std::unordered_map<int64_t, std::string> int_to_string_map_;
+  LookupTable<std::string, int64_t> string_to_int_map_;
+  LookupTable<int64_t, std::string> int_to_string_map_;
 
   std::string default_string_;
   int64_t default_int_;
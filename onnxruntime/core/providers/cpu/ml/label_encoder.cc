@@ -2,7 +2,6 @@
 // Licensed under the MIT License.
 
 #include "core/providers/cpu/ml/label_encoder.h"
-#include <algorithm>
 #include <gsl/gsl>
 using namespace ::onnxruntime::common;
 
@@ -32,31 +31,27 @@ Status LabelEncoder::Compute(OpKernelContext* context) const {
 
     auto input = gsl::make_span(X.Data<std::string>(), onnxruntime::narrow<size_t>(shape.Size()));
     auto output = gsl::make_span(Y.MutableData<int64_t>(), onnxruntime::narrow<size_t>(shape.Size()));
-    auto out = output.begin();
 
-    // map isn't going to change so get end() once instead of calling inside the for_each loop
-    const auto map_end = string_to_int_map_.end();
-
-    std::for_each(input.begin(), input.end(), [&out, &map_end, this](const std::string& value) {
-      auto map_to = string_to_int_map_.find(value);
-      *out = map_to == map_end ? default_int_ : map_to->second;
-      ++out;
-    });
+    string_to_int_map_.FindAll(input, output, default_int_, context->GetOperatorThreadPool());
   } else {
     if (!Y.IsDataTypeString())
       return Status(ONNXRUNTIME, FAIL, "Input of tensor(int64) must have output of tensor(string)");
 
     auto input = gsl::make_span(X.Data<int64_t>(), onnxruntime::narrow<size_t>(shape.Size()));
     auto output = gsl::make_span(Y.MutableData<std::string>(), onnxruntime::narrow<size_t>(shape.Size()));
-    auto out = output.begin();
-
-    const auto map_end = int_to_string_map_.end();
-
-    std::for_each(input.begin(), input.end(), [&out, &map_end, this](const int64_t& value) {
-      auto map_to = int_to_string_map_.find(value);
-      *out = map_to == map_end ? default_string_ : map_to->second;
-      ++out;
-    });
+    const auto num_classes = static_cast<int64_t>(int_to_string_.size());
+
+    const TensorOpCost cost{static_cast<double>(sizeof(int64_t)), static_cast<double>(sizeof(std::string)), 8.0};
+    concurrency::ThreadPool::TryParallelFor(
+        context->GetOperatorThreadPool(), static_cast<std::ptrdiff_t>(input.size()), cost,
+        [this, input, output, num_classes](std::ptrdiff_t first, std::ptrdiff_t last) {
+          for (std::ptrdiff_t i = first; i < last; ++i) {
+            const int64_t value = input[static_cast<size_t>(i)];
+            output[static_cast<size_t>(i)] = value >= 0 && value < num_classes
+                                                 ? int_to_string_[static_cast<size_t>(value)]
+                                                 : default_string_;
+          }
+        });
   }
 
   return Status::OK();
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include "core/common/common.h"
 #include "core/framework/op_kernel.h"
+#include "core/providers/cpu/ml/lookup_table.h"
 #include "core/providers/cpu/ml/ml_common.h"
 #include "core/framework/tensorprotoutils.h"
 #include "core/common/safeint.h"
@@ -24,22 +25,19 @@ class LabelEncoder final : public OpKernel {
 
     auto num_entries = string_classes.size();
 
-    string_to_int_map_.reserve(num_entries);
-    int_to_string_map_.reserve(num_entries);
-
     for (size_t i = 0; i < num_entries; ++i) {
-      const std::string& str = string_classes[i];
-
-      string_to_int_map_[str] = i;
-      int_to_string_map_[i] = str;
+      string_to_int_map_.InsertOrAssign(string_classes[i], static_cast<int64_t>(i));
     }
+
+    // the classes are numbered from 0 so the int64 to string direction is a plain index into them
+    int_to_string_ = std::move(string_classes);
   }
 
   Status Compute(OpKernelContext* context) const override;
 
  private:
-  std::unordered_map<std::string, int64_t> string_to_int_map_;
-  std::unordered_map<int64_t, std::string> int_to_string_map_;
+  LookupTable<std::string, int64_t> string_to_int_map_;
+  std::vector<std::string> int_to_string_;
 
   std::string default_string_;
   int64_t default_int_;
@@ -63,8 +61,7 @@ class LabelEncoder_2 final : public OpKernel {
     ORT_ENFORCE(num_keys == num_values, "The ", key_field_name_, " and ", value_field_name_,
                 " attributes in LabelEncoder ", "(name: ", info.node().Name(), ") must have the same length. ",
                 "However, the number of key is ", num_keys, " and the number of ", "values is ", num_values, ".");
-    map_.reserve(num_keys);
-    for (size_t i = 0; i < num_keys; ++i) map_.emplace(keys[i], values[i]);
+    for (size_t i = 0; i < num_keys; ++i) map_.Emplace(keys[i], values[i]);
   }
 
   Status Compute(OpKernelContext* context) const override {
@@ -72,16 +69,8 @@ class LabelEncoder_2 final : public OpKernel {
     const TensorShape& shape = X->Shape();
     auto* Y = context->Output(0, shape);
 
-    auto input = X->template DataAsSpan<TKey>();
-    auto output = Y->template MutableDataAsSpan<TValue>();
-    auto input_iter = input.begin();
-    auto output_iter = output.begin();
-    while (input_iter != input.end()) {
-      const auto found = map_.find(*input_iter);
-      *output_iter = found == map_.end() ? default_value_ : found->second;
-      ++output_iter;
-      ++input_iter;
-    }
+    map_.FindAll(X->template DataAsSpan<TKey>(), Y->template MutableDataAsSpan<TValue>(), default_value_,
+                 context->GetOperatorThreadPool());
     return Status::OK();
   }
 
@@ -94,7 +83,7 @@ class LabelEncoder_2 final : public OpKernel {
   // A collection of key-value pairs. Each (a_key, a_value) pair
   // means that the "a_key" in the input would be mapped to "a_value".
   // If map_ doesn't contain "a_key", we use default_value_ as its output.
-  InlinedHashMap<TKey, TValue> map_;
+  LookupTable<TKey, TValue> map_;
   TValue default_value_;
   // ONNX attribute name to load keys.
   std::string key_field_name_;
@@ -147,29 +136,7 @@ T GetDefault(const OpKernelInfo& info, const std::string& attr_name, const T& ba
   return backup;
 }
 
-// We don't make use of InlinedHashMap since we make use of a custom hash and equality function.
-// Introducing new template parameters in inlined_containers_fwd.h creates compilation errors
-// (see https://github.com/microsoft/onnxruntime/pull/17977#discussion_r1446510961).
-#ifndef DISABLE_ABSEIL
-template <typename T>
-using HashFunc = absl::container_internal::hash_default_hash<T>;
-
-template <typename T>
-using EqualFunc = absl::container_internal::hash_default_eq<T>;
-
-template <typename K, typename V, typename Hash, typename Equal>
-using HashMap = absl::flat_hash_map<K, V, Hash, Equal>;
-#else
-template <typename T>
-using HashFunc = std::hash<T>;
-
-template <typename T>
-using EqualFunc = std::equal_to<T>;
-
-template <typename K, typename V, typename Hash, typename Equal>
-using HashMap = std::unordered_map<K, V, Hash, Equal>;
-#endif  // DISABLE_ABSEIL
-
+// LabelEncoder from opset 4 matches NaN keys with NaN inputs.
 template <typename T>
 struct NaNHash {
   size_t operator()(const T& value) const {
@@ -203,7 +170,7 @@ class LabelEncoder_4 final : public OpKernel {
     auto values = GetAttribute<TValue>(kernel_info, value_field_name_, "values_tensor");
     ORT_ENFORCE(keys.size() == values.size(), "Keys and values must have the same length.");
     for (size_t i = 0; i < keys.size(); ++i) {
-      map_.emplace(keys[i], values[i]);
+      map_.Emplace(keys[i], values[i]);
     }
   }
   Status Compute(OpKernelContext* context) const override {
@@ -211,22 +178,14 @@ class LabelEncoder_4 final : public OpKernel {
     const TensorShape& shape = X->Shape();
     auto* Y = context->Output(0, shape);
 
-    auto input = X->template DataAsSpan<TKey>();
-    auto output = Y->template MutableDataAsSpan<TValue>();
-    auto input_iter = input.begin();
-    auto output_iter = output.begin();
-    while (input_iter != input.end()) {
-      const auto found = map_.find(*input_iter);
-      *output_iter = found == map_.end() ? default_value_ : found->second;
-      ++output_iter;
-      ++input_iter;
-    }
+    map_.FindAll(X->template DataAsSpan<TKey>(), Y->template MutableDataAsSpan<TValue>(), default_value_,
+                 context->GetOperatorThreadPool());
     return Status::OK();
   }
 
  private:
   void InitializeAttrFields(const OpKernelInfo& kernel_info);
-  HashMap<TKey, TValue, NaNHash<TKey>, NaNEqual<TKey>> map_;
+  LookupTable<TKey, TValue, NaNHash<LookupKey<TKey>>, NaNEqual<LookupKey<TKey>>> map_;
   TValue default_value_;
   std::string key_field_name_;
   std::string value_field_name_;
@@ -0,0 +1,197 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <gsl/gsl>
+
+#include "core/common/common.h"
+#include "core/common/inlined_containers.h"
+#include "core/platform/threadpool.h"
+
+namespace onnxruntime {
+namespace ml {
+
+#ifndef DISABLE_ABSEIL
+template <typename T>
+using HashFunc = absl::container_internal::hash_default_hash<T>;
+
+template <typename T>
+using EqualFunc = absl::container_internal::hash_default_eq<T>;
+#else
+template <typename T>
+using HashFunc = std::hash<T>;
+
+template <typename T>
+using EqualFunc = std::equal_to<T>;
+#endif  // DISABLE_ABSEIL
+
+// String keys are hashed and compared as views so that they can be stored in a single buffer.
+template <typename T>
+using LookupKey = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, T>;
+
+// Immutable hash table for the categories of the featurization kernels (LabelEncoder, CategoryMapper and
+// OneHotEncoder). It is filled when the kernel is constructed and only read by Compute, so lookups from
+// several threads need no synchronization.
+//
+// The table uses open addressing with linear probing and a load factor of at most one half. Each slot holds
+// 32 bits of the hash of its key next to the index of the entry, so a probe only reads the keys of candidates
+// whose hash matches, and string keys are stored back to back in one buffer instead of one allocation each.
+// Hash and Equal operate on LookupKey<TKey>.
+template <typename TKey, typename TValue,
+          typename Hash = HashFunc<LookupKey<TKey>>, typename Equal = EqualFunc<LookupKey<TKey>>>
+class LookupTable {
+ public:
+  using KeyType = LookupKey<TKey>;
+
+  size_t size() const { return values_.size(); }
+
+  // Adds the entry if the key is not present yet, like emplace. Returns false if the key was already present.
+  bool Emplace(const KeyType& key, const TValue& value) {
+    return Insert(key, value, false);
+  }
+
+  // Adds the entry, replacing the value if the key is already present, like operator[].
+  void InsertOrAssign(const KeyType& key, const TValue& value) {
+    Insert(key, value, true);
+  }
+
+  // Returns the value for the key, or nullptr if the key is not present.
+  const TValue* Find(const KeyType& key) const {
+    if (values_.empty()) {
+      return nullptr;
+    }
+
+    const uint64_t hash = MixHash(key);
+    const uint32_t tag = static_cast<uint32_t>(hash);
+
+    for (size_t index = static_cast<size_t>(hash >> shift_);; index = (index + 1) & (slots_.size() - 1)) {
+      const Slot& slot = slots_[index];
+      if (slot.entry == 0) {
+        return nullptr;
+      }
+      if (slot.tag == tag && Equal{}(GetKey(slot.entry - 1), key)) {
+        return &values_[slot.entry - 1];
+      }
+    }
+  }
+
+  // Writes the value for each input to output, or default_value for the inputs that are not present.
+  // The inputs are spread across the thread pool.
+  void FindAll(gsl::span<const TKey> input, gsl::span<TValue> output, const TValue& default_value,
+               concurrency::ThreadPool* threadpool) const {
+    ORT_ENFORCE(input.size() == output.size());
+
+    const TensorOpCost cost{static_cast<double>(sizeof(TKey)), static_cast<double>(sizeof(TValue)), 32.0};
+    concurrency::ThreadPool::TryParallelFor(
+        threadpool, static_cast<std::ptrdiff_t>(input.size()), cost,
+        [this, input, output, &default_value](std::ptrdiff_t first, std::ptrdiff_t last) {
+          for (std::ptrdiff_t i = first; i < last; ++i) {
+            const TValue* value = Find(input[static_cast<size_t>(i)]);
+            output[static_cast<size_t>(i)] = value != nullptr ? *value : default_value;
+          }
+        });
+  }
+
+ private:
+  static constexpr bool kStringKeys = std::is_same_v<TKey, std::string>;
+  static constexpr size_t kMinSlots = 16;
+
+  struct Slot {
+    uint32_t tag;    // low bits of the mixed hash of the key
+    uint32_t entry;  // index of the entry plus one, 0 for an empty slot
+  };
+
+  static uint64_t MixHash(const KeyType& key) {
+    // Fibonacci hashing spreads the bits of weak hashes, such as the identity hash of integers, into the high
+    // bits used to pick the slot.
+    return static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+  }
+
+  KeyType GetKey(size_t entry) const {
+    if constexpr (kStringKeys) {
+      const size_t begin = entry == 0 ? 0 : keys_[entry - 1];
+      return KeyType(key_buffer_.data() + begin, keys_[entry] - begin);
+    } else {
+      return keys_[entry];
+    }
+  }
+
+  void Place(uint64_t hash, uint32_t entry) {
+    size_t index = static_cast<size_t>(hash >> shift_);
+    while (slots_[index].entry != 0) {
+      index = (index + 1) & (slots_.size() - 1);
+    }
+    slots_[index] = Slot{static_cast<uint32_t>(hash), entry};
+  }
+
+  void Resize(size_t num_slots) {
+    slots_.assign(num_slots, Slot{0, 0});
+    shift_ = 64;
+    for (size_t n = num_slots; n > 1; n >>= 1) {
+      --shift_;
+    }
+
+    for (size_t entry = 0; entry < values_.size(); ++entry) {
+      Place(MixHash(GetKey(entry)), static_cast<uint32_t>(entry + 1));
+    }
+  }
+
+  bool Insert(const KeyType& key, const TValue& value, bool assign) {
+    if (!values_.empty()) {
+      const uint64_t hash = MixHash(key);
+      const uint32_t tag = static_cast<uint32_t>(hash);
+
+      for (size_t index = static_cast<size_t>(hash >> shift_);; index = (index + 1) & (slots_.size() - 1)) {
+        const Slot& slot = slots_[index];
+        if (slot.entry == 0) {
+          break;
+        }
+        if (slot.tag == tag && Equal{}(GetKey(slot.entry - 1), key)) {
+          if (assign) {
+            values_[slot.entry - 1] = value;
+          }
+          return false;
+        }
+      }
+    }
+
+    ORT_ENFORCE(values_.size() < std::numeric_limits<uint32_t>::max(), "Too many entries in lookup table.");
+
+    if constexpr (kStringKeys) {
+      key_buffer_.append(key);
+      keys_.push_back(key_buffer_.size());
+    } else {
+      keys_.push_back(key);
+    }
+    values_.push_back(value);
+
+    if (values_.size() * 2 > slots_.size()) {
+      Resize(std::max(kMinSlots, slots_.size() * 2));
+    } else {
+      Place(MixHash(key), static_cast<uint32_t>(values_.size()));
+    }
+
+    return true;
+  }
+
+  std::vector<Slot> slots_;
+  // right shift that takes the high bits of a mixed hash as the index of a slot
+  int shift_{64};
+
+  // for string keys, the end offset of each key in key_buffer_. a key starts at the end of the previous one.
+  std::vector<std::conditional_t<kStringKeys, size_t, TKey>> keys_;
+  std::string key_buffer_;
+  std::vector<TValue> values_;
+};
+
+}  // namespace ml
+}  // namespace onnxruntime
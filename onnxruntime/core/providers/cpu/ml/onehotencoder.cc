@@ -2,6 +2,8 @@
 // Licensed under the MIT License.
 
 #include "core/providers/cpu/ml/onehotencoder.h"
+#include <algorithm>
+#include <atomic>
 /**
 https://github.com/onnx/onnx/blob/main/onnx/defs/traditionalml/defs.cc
 ONNX_OPERATOR_SCHEMA(OneHotEncoder)
@@ -57,12 +59,12 @@ OneHotEncoderOp<T>::OneHotEncoderOp(const OpKernelInfo& info) : OpKernel(info),
   if (!tmp_cats_int64s.empty()) {
     num_categories_ = tmp_cats_int64s.size();
     for (size_t idx = 0, end = tmp_cats_int64s.size(); idx < end; ++idx) {
-      cats_int64s_[tmp_cats_int64s[idx]] = idx;
+      cats_int64s_.InsertOrAssign(tmp_cats_int64s[idx], idx);
     }
   } else {
     num_categories_ = tmp_cats_strings.size();
     for (size_t idx = 0, end = tmp_cats_strings.size(); idx < end; ++idx) {
-      cats_strings_[tmp_cats_strings[idx]] = idx;
+      cats_strings_.InsertOrAssign(tmp_cats_strings[idx], idx);
     }
   }
   ORT_ENFORCE(num_categories_ > 0);
@@ -78,18 +80,29 @@ common::Status OneHotEncoderOp<T>::Compute(OpKernelContext* context) const {
 
   Tensor* Y = context->Output(0, TensorShape(output_shape));
   auto* y_data = Y->MutableData<float>();
-  std::fill_n(y_data, Y->Shape().Size(), 0.0f);
 
   const auto* x_data = X->Data<T>();
   const auto x_size = input_shape.Size();
-  std::unordered_map<int64_t, size_t>::const_iterator idx;
-  for (int64_t i = 0; i < x_size; ++i) {
-    auto int_idx = cats_int64s_.find(static_cast<int64_t>(x_data[i]));
-    if (int_idx != cats_int64s_.cend())
-      y_data[i * num_categories_ + int_idx->second] = 1.0f;
-    else if (!zeros_)
-      return Status(ONNXRUNTIME, FAIL, "Unknown Category and zeros = 0.");
-  }
+  std::atomic<bool> unknown_category{false};
+
+  // each input writes its own row of the output, so the inputs are encoded in parallel
+  const TensorOpCost cost{static_cast<double>(sizeof(T)), static_cast<double>(num_categories_ * sizeof(float)),
+                          static_cast<double>(num_categories_ + 16)};
+  concurrency::ThreadPool::TryParallelFor(
+      context->GetOperatorThreadPool(), x_size, cost,
+      [this, x_data, y_data, &unknown_category](std::ptrdiff_t first, std::ptrdiff_t last) {
+        std::fill(y_data + first * num_categories_, y_data + last * num_categories_, 0.0f);
+        for (std::ptrdiff_t i = first; i < last; ++i) {
+          const size_t* int_idx = cats_int64s_.Find(static_cast<int64_t>(x_data[i]));
+          if (int_idx != nullptr)
+            y_data[i * num_categories_ + *int_idx] = 1.0f;
+          else if (!zeros_)
+            unknown_category = true;
+        }
+      });
+
+  if (unknown_category)
+    return Status(ONNXRUNTIME, FAIL, "Unknown Category and zeros = 0.");
   return Status::OK();
 }
 
@@ -103,17 +116,29 @@ common::Status OneHotEncoderOp<std::string>::Compute(OpKernelContext* context) c
 
   Tensor* Y = context->Output(0, TensorShape(output_shape));
   auto* y_data = Y->MutableData<float>();
-  std::fill_n(y_data, Y->Shape().Size(), 0.0f);
 
   const auto* x_data = X->Data<std::string>();
   const auto x_size = input_shape.Size();
-  for (int64_t i = 0; i < x_size; ++i) {
-    auto str_idx = cats_strings_.find(x_data[i]);
-    if (str_idx != cats_strings_.cend())
-      y_data[i * num_categories_ + str_idx->second] = 1.0f;
-    else if (!zeros_)
-      return Status(ONNXRUNTIME, FAIL, "Unknown Category and zeros = 0.");
-  }
+  std::atomic<bool> unknown_category{false};
+
+  const TensorOpCost cost{static_cast<double>(sizeof(std::string)),
+                          static_cast<double>(num_categories_ * sizeof(float)),
+                          static_cast<double>(num_categories_ + 32)};
+  concurrency::ThreadPool::TryParallelFor(
+      context->GetOperatorThreadPool(), x_size, cost,
+      [this, x_data, y_data, &unknown_category](std::ptrdiff_t first, std::ptrdiff_t last) {
+        std::fill(y_data + first * num_categories_, y_data + last * num_categories_, 0.0f);
+        for (std::ptrdiff_t i = first; i < last; ++i) {
+          const size_t* str_idx = cats_strings_.Find(x_data[i]);
+          if (str_idx != nullptr)
+            y_data[i * num_categories_ + *str_idx] = 1.0f;
+          else if (!zeros_)
+            unknown_category = true;
+        }
+      });
+
+  if (unknown_category)
+    return Status(ONNXRUNTIME, FAIL, "Unknown Category and zeros = 0.");
   return Status::OK();
 }
 
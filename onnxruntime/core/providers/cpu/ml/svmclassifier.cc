@@ -74,6 +74,10 @@ SVMClassifier::SVMClassifier(const OpKernelInfo& info)
   ORT_ENFORCE(coefficients_.size() > 0);
   weights_are_all_positive_ = std::all_of(coefficients_.cbegin(), coefficients_.cend(),
                                           [](float value) { return value >= 0.f; });
+
+  if (mode_ == SVM_TYPE::SVM_SVC) {
+    init_support_vectors(support_vectors_, vector_count_, feature_count_);
+  }
 }
 
 template <typename LabelType>
@@ -247,64 +251,71 @@ Status SVMClassifier::ComputeImpl(OpKernelContext& ctx,
     batched_kernel_dot<float>(x_data, support_vectors_, num_batches, vector_count_, feature_count_, 0.f, kernels_span,
                               threadpool);
 
-    for (int64_t n = 0; n < num_batches; n++) {
-      // reduce scores from kernels using coefficients, taking into account the varying number of support vectors
-      // per class.
-      // coefficients: [num_classes - 1, vector_count_]
-      //
-      // e.g. say you have 3 classes, with 3 x 3 coefficients
-      //
-      // AA AB AC
-      // BA BB BC
-      // CA CB CC
-      //
-      // you can remove the diagonal line of items comparing a class with itself leaving one less row.
-      //
-      // BA AB AC
-      // CA CB BC
-      //
-      // for each class there is a coefficient per support vector, and a class has one or more support vectors.
-      //
-      // Combine the scores for the two combinations for two classes with their coefficient.
-      // e.g. AB combines with BA.
-      // If A has 3 support vectors and B has 2, there's a 3x2 block for AB and a 2x3 block for BA to combine
-
-      auto cur_kernels = kernels_span.subspan(n * SafeInt<size_t>(vector_count_), onnxruntime::narrow<size_t>(vector_count_));
-      auto cur_scores = classifier_scores.subspan(n * SafeInt<size_t>(num_slots_per_iteration), onnxruntime::narrow<size_t>(num_classifiers));
-      auto cur_votes = votes_span.subspan(n * SafeInt<size_t>(class_count_), onnxruntime::narrow<size_t>(class_count_));
-      auto scores_iter = cur_scores.begin();
-
-      size_t classifier_idx = 0;
-      for (int64_t i = 0; i < class_count_ - 1; i++) {
-        int64_t start_index_i = starting_vector_[onnxruntime::narrow<size_t>(i)];  // start of support vectors for class i
-        int64_t class_i_support_count = vectors_per_class_[onnxruntime::narrow<size_t>(i)];
-        int64_t i_coeff_row_offset = vector_count_ * i;
-
-        for (int64_t j = i + 1; j < class_count_; j++) {
-          int64_t start_index_j = starting_vector_[onnxruntime::narrow<size_t>(j)];  // start of support vectors for class j
-          int64_t class_j_support_count = vectors_per_class_[onnxruntime::narrow<size_t>(j)];
-          int64_t j_coeff_row_offset = vector_count_ * (j - 1);
-
-          double sum = 0;
-
-          const float* val1 = &(coefficients_[j_coeff_row_offset + SafeInt<size_t>(start_index_i)]);
-          const float* val2 = &(cur_kernels[onnxruntime::narrow<size_t>(start_index_i)]);
-          for (int64_t m = 0; m < class_i_support_count; ++m, ++val1, ++val2)
-            sum += *val1 * *val2;
-
-          val1 = &(coefficients_[i_coeff_row_offset + SafeInt<size_t>(start_index_j)]);
-          val2 = &(cur_kernels[onnxruntime::narrow<size_t>(start_index_j)]);
-
-          for (int64_t m = 0; m < class_j_support_count; ++m, ++val1, ++val2)
-            sum += *val1 * *val2;
-
-          sum += rho_[classifier_idx++];
-
-          *scores_iter++ = static_cast<float>(sum);
-          ++(cur_votes[onnxruntime::narrow<size_t>(sum > 0 ? i : j)]);
+    // reduce scores from kernels using coefficients, taking into account the varying number of support vectors
+    // per class.
+    // coefficients: [num_classes - 1, vector_count_]
+    //
+    // e.g. say you have 3 classes, with 3 x 3 coefficients
+    //
+    // AA AB AC
+    // BA BB BC
+    // CA CB CC
+    //
+    // you can remove the diagonal line of items comparing a class with itself leaving one less row.
+    //
+    // BA AB AC
+    // CA CB BC
+    //
+    // for each class there is a coefficient per support vector, and a class has one or more support vectors.
+    //
+    // Combine the scores for the two combinations for two classes with their coefficient.
+    // e.g. AB combines with BA.
+    // If A has 3 support vectors and B has 2, there's a 3x2 block for AB and a 2x3 block for BA to combine
+    //
+    // Each block is a contiguous dot product, and the batches are independent so are processed in parallel.
+    auto reduce_batches = [&](ptrdiff_t first, ptrdiff_t last) {
+      for (ptrdiff_t n = first; n < last; n++) {
+        auto cur_kernels = kernels_span.subspan(n * SafeInt<size_t>(vector_count_), onnxruntime::narrow<size_t>(vector_count_));
+        auto cur_scores = classifier_scores.subspan(n * SafeInt<size_t>(num_slots_per_iteration), onnxruntime::narrow<size_t>(num_classifiers));
+        auto cur_votes = votes_span.subspan(n * SafeInt<size_t>(class_count_), onnxruntime::narrow<size_t>(class_count_));
+        auto scores_iter = cur_scores.begin();
+
+        size_t classifier_idx = 0;
+        for (int64_t i = 0; i < class_count_ - 1; i++) {
+          int64_t start_index_i = starting_vector_[onnxruntime::narrow<size_t>(i)];  // start of support vectors for class i
+          int64_t class_i_support_count = vectors_per_class_[onnxruntime::narrow<size_t>(i)];
+          int64_t i_coeff_row_offset = vector_count_ * i;
+
+          auto kernels_i = ConstEigenVectorMap<float>(&cur_kernels[onnxruntime::narrow<size_t>(start_index_i)],
+                                                      class_i_support_count);
+
+          for (int64_t j = i + 1; j < class_count_; j++) {
+            int64_t start_index_j = starting_vector_[onnxruntime::narrow<size_t>(j)];  // start of support vectors for class j
+            int64_t class_j_support_count = vectors_per_class_[onnxruntime::narrow<size_t>(j)];
+            int64_t j_coeff_row_offset = vector_count_ * (j - 1);
+
+            auto coeffs_i = ConstEigenVectorMap<float>(&coefficients_[j_coeff_row_offset + SafeInt<size_t>(start_index_i)],
+                                                       class_i_support_count);
+            auto coeffs_j = ConstEigenVectorMap<float>(&coefficients_[i_coeff_row_offset + SafeInt<size_t>(start_index_j)],
+                                                       class_j_support_count);
+            auto kernels_j = ConstEigenVectorMap<float>(&cur_kernels[onnxruntime::narrow<size_t>(start_index_j)],
+                                                        class_j_support_count);
+
+            double sum = coeffs_i.cast<double>().dot(kernels_i.cast<double>()) +
+                         coeffs_j.cast<double>().dot(kernels_j.cast<double>());
+            sum += rho_[classifier_idx++];
+
+            *scores_iter++ = static_cast<float>(sum);
+            ++(cur_votes[onnxruntime::narrow<size_t>(sum > 0 ? i : j)]);
+          }
         }
       }
-    }
+    };
+
+    const TensorOpCost cost{static_cast<double>(vector_count_ * (class_count_ - 1) * sizeof(float)),
+                            static_cast<double>(num_classifiers * sizeof(float)),
+                            static_cast<double>(vector_count_ * (class_count_ - 1) * 2)};
+    concurrency::ThreadPool::TryParallelFor(threadpool, num_batches, cost, reduce_batches);
   }
 
   auto finalize_batch = [this, &final_scores, final_scores_per_batch,
@@ -375,7 +386,9 @@ Status SVMClassifier::ComputeImpl(OpKernelContext& ctx,
   };
 
   // TODO: Refine this rough metric to choose when to parallelize.
-  if (num_batches > 512) {
+  // Estimating the probabilities iterates over all the pairs of classes for each batch, so is always worth
+  // spreading across the batches.
+  if (num_batches > 512 || (mode_ == SVM_TYPE::SVM_SVC && have_proba && class_count_ > 2)) {
     concurrency::ThreadPool::TryBatchParallelFor(threadpool, num_batches, finalize_batch, -1);
   } else {
     {
@@ -5,6 +5,7 @@
 
 #include "core/common/common.h"
 #include "core/framework/op_kernel.h"
+#include "core/platform/threadpool.h"
 #include "core/util/math_cpuonly.h"
 #include "ml_common.h"
 #include "core/providers/cpu/math/gemm.h"
@@ -30,6 +31,23 @@ class SVMCommon {
   void set_kernel_type(KERNEL new_kernel_type) { kernel_type_ = new_kernel_type; }
   KERNEL get_kernel_type() const { return kernel_type_; }
 
+  // Precomputes what the RBF kernel needs from the support vectors [vector_count, feature_count], so that
+  // Compute only processes the inputs. Must be called with the support vectors later passed to batched_kernel_dot.
+  void init_support_vectors(gsl::span<const float> support_vectors, ptrdiff_t vector_count, ptrdiff_t feature_count) {
+    if (kernel_type_ != KERNEL::RBF || vector_count == 0) {
+      return;
+    }
+
+    auto map_sv = ConstEigenMatrixMapRowMajor<float>(support_vectors.data(), vector_count, feature_count);
+    sv_mean_ = map_sv.colwise().mean();
+    centered_sv_.resize(SafeInt<size_t>(vector_count) * feature_count);
+    sv_norms_.resize(onnxruntime::narrow<size_t>(vector_count));
+    auto map_centered_sv = EigenMatrixMapRowMajor<float>(centered_sv_.data(), vector_count, feature_count);
+    map_centered_sv = map_sv.rowwise() - sv_mean_;
+    EigenVectorMap<float>(sv_norms_.data(), vector_count) = map_centered_sv.rowwise().squaredNorm();
+  }
+
+  // b holds the coefficients for a LINEAR kernel in liblinear mode, and the support vectors otherwise.
   template <typename T>
   void batched_kernel_dot(const gsl::span<const T> a, const gsl::span<const T> b,
                           ptrdiff_t m, ptrdiff_t n, ptrdiff_t k,
@@ -39,28 +57,7 @@ class SVMCommon {
     assert(a.size() == size_t(m * k) && b.size() == size_t(k * n) && out.size() == size_t(m * n));
 
     if (kernel_type_ == KERNEL::RBF) {
-      T* cur_out = out.data();
-      const T* cur_batch = a.data();
-
-      // each batch has 'k' features
-      for (int64_t batch = 0; batch < m; ++batch) {
-        const T* cur_support_vector = b.data();
-
-        // broadcast the support vectors against the k features in each batch. output is one value per support vector
-        for (int64_t support_vector = 0; support_vector < n; ++support_vector) {
-          T sum = 0.f;
-          const T* cur_input = cur_batch;
-
-          for (int64_t feature = 0; feature < k; ++feature) {
-            T val = *cur_input++ - *cur_support_vector++;
-            sum += val * val;
-          }
-
-          *cur_out++ = std::exp(-gamma_ * sum);
-        }
-
-        cur_batch += k;  // move to start of next batch
-      }
+      batched_rbf_kernel(a, b, m, n, k, out, threadpool);
     } else {
       float alpha = 1.f;
       float beta = 1.f;
@@ -96,15 +93,78 @@ class SVMCommon {
   }
 
  private:
+  // The squared distance between a batch and a support vector is expanded to ||a||^2 + ||b||^2 - 2 a.b so that the
+  // cross terms, which dominate the cost when there are many support vectors, are computed by a single GEMM.
+  // Both sides are centered on the mean support vector first to limit the cancellation in the expansion, and the
+  // distance is computed directly for the pairs that are still too close relative to their norms.
+  // The centered support vectors and their norms come from init_support_vectors, b is only read for those pairs.
+  void batched_rbf_kernel(const gsl::span<const float> a, const gsl::span<const float> b,
+                          ptrdiff_t m, ptrdiff_t n, ptrdiff_t k,
+                          const gsl::span<float> out,
+                          concurrency::ThreadPool* threadpool) const {
+    constexpr float kExactDistanceRatio = 1.f / 16.f;
+    assert(centered_sv_.size() == b.size() && sv_norms_.size() == size_t(n));
+
+    std::vector<float> centered_a(a.size());
+    std::vector<float> a_norms(onnxruntime::narrow<size_t>(m));
+    auto map_centered_a = EigenMatrixMapRowMajor<float>(centered_a.data(), m, k);
+    map_centered_a = ConstEigenMatrixMapRowMajor<float>(a.data(), m, k).rowwise() - sv_mean_;
+    EigenVectorMap<float>(a_norms.data(), m) = map_centered_a.rowwise().squaredNorm();
+
+    const float* b_norms = sv_norms_.data();
+    onnxruntime::Gemm<float>::ComputeGemm(CBLAS_TRANSPOSE::CblasNoTrans, CBLAS_TRANSPOSE::CblasTrans,
+                                          m, n, k,
+                                          -2.f, centered_a.data(), centered_sv_.data(), 0.f,
+                                          nullptr, nullptr,
+                                          out.data(),
+                                          threadpool);
+
+    const TensorOpCost cost{static_cast<double>(n * sizeof(float)), static_cast<double>(n * sizeof(float)),
+                            static_cast<double>(n * 8)};
+    concurrency::ThreadPool::TryParallelFor(threadpool, m, cost, [&](ptrdiff_t first, ptrdiff_t last) {
+      for (ptrdiff_t batch = first; batch < last; ++batch) {
+        float* cur_out = out.data() + batch * n;
+        const float a_norm = a_norms[batch];
+
+        for (ptrdiff_t support_vector = 0; support_vector < n; ++support_vector) {
+          const float b_norm = b_norms[support_vector];
+          float sum = cur_out[support_vector] + a_norm + b_norm;
+
+          if (sum < (a_norm + b_norm) * kExactDistanceRatio) {
+            const float* cur_input = a.data() + batch * k;
+            const float* cur_support_vector = b.data() + support_vector * k;
+            sum = 0.f;
+
+            for (ptrdiff_t feature = 0; feature < k; ++feature) {
+              float val = cur_input[feature] - cur_support_vector[feature];
+              sum += val * val;
+            }
+          }
+
+          cur_out[support_vector] = -gamma_ * sum;
+        }
+
+        MlasComputeExp(cur_out, cur_out, onnxruntime::narrow<size_t>(n));
+      }
+    });
+  }
+
   KERNEL kernel_type_;
   float gamma_{0.f};
   float coef0_{0.f};
   float degree_{0.f};
+
+  // set by init_support_vectors for the RBF kernel: the mean support vector, the support vectors centered on it
+  // and their squared norms
+  Eigen::Matrix<float, 1, Eigen::Dynamic> sv_mean_;
+  std::vector<float> centered_sv_;
+  std::vector<float> sv_norms_;
 };
 
 class SVMClassifier final : public OpKernel, private SVMCommon {
   using SVMCommon::batched_kernel_dot;
   using SVMCommon::get_kernel_type;
+  using SVMCommon::init_support_vectors;
   using SVMCommon::set_kernel_type;
 
  public:
@@ -16,6 +16,7 @@ template <typename T>
 class SVMRegressor final : public OpKernel, private SVMCommon {
   using SVMCommon::batched_kernel_dot;
   using SVMCommon::get_kernel_type;
+  using SVMCommon::init_support_vectors;
   using SVMCommon::set_kernel_type;
 
  public:
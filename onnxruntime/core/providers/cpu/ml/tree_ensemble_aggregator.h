@@ -185,6 +185,28 @@ struct TreeNodeElement {
 #endif
 };
 
+// Compact copy of a TreeNodeElement, 8 bytes instead of 24 for a float threshold.
+// The nodes are stored in the same order as `TreeEnsembleCommon::nodes_`, the false branch is the next node.
+// The threshold is replaced by its rank among the sorted thresholds of the same feature,
+// the inputs are binned the same way before walking the trees (see TreeEnsembleEngine::kCompact).
+struct TreeNodeCompact {
+  // Index of the true child, the highest bit is set if missing values follow the true branch.
+  uint32_t truenode;
+  // Index of the feature among the features used by the ensemble, kLeaf if the node is a leaf.
+  uint16_t feature_id;
+  // Rank of the threshold, the node is true if the bin of the input is lower or equal.
+  uint16_t bin;
+
+  static constexpr uint32_t kMissingTrackTrue = 0x80000000;
+  static constexpr uint16_t kLeaf = 0xFFFF;
+  // Bin of a missing value, greater than any rank.
+  static constexpr uint16_t kMissingBin = 0xFFFF;
+
+  inline bool is_not_leaf() const { return feature_id != kLeaf; }
+  inline bool is_missing_track_true() const { return (truenode & kMissingTrackTrue) != 0; }
+  inline uint32_t truenode_id() const { return truenode & ~kMissingTrackTrue; }
+};
+
 template <typename InputType, typename ThresholdType, typename OutputType>
 class TreeAggregator {
  protected:
@@ -3,8 +3,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <mutex>
 #include "core/platform/threadpool.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
 #include "tree_ensemble_helper.h"
 #include "tree_ensemble_attribute.h"
 #include "tree_ensemble_aggregator.h"
@@ -13,6 +15,42 @@ namespace onnxruntime {
 namespace ml {
 namespace detail {
 
+/**
+ * Strategies to evaluate the trees on a batch of rows. The strategy is selected in Init
+ * based on the structure of the ensemble.
+ */
+enum class TreeEnsembleEngine {
+  // Walks the trees one row at a time, see ProcessTreeNodeLeave.
+  kTraversal,
+  // Walks every tree for a block of rows at once, see ProcessTreeNodeLeaveBlock.
+  // The traversals of the rows are interleaved so that the node loads of different rows
+  // overlap instead of each comparison waiting for the node loaded by the previous one.
+  kInterleaved,
+  // Walks compact copies of the nodes (see TreeNodeCompact) on inputs binned once per row.
+  // Large ensembles do not fit in the caches and their evaluation is bound by the memory bandwidth,
+  // smaller nodes reduce the amount of memory read for every row.
+  kCompact,
+  // Evaluates every tree on a batch of rows with matrix multiplications instead of walking the nodes:
+  // the conditions of all internal nodes are computed for every row, then multiplied by a matrix
+  // describing the path to every leaf. The leaf of a row is the one whose path matches all the conditions.
+  // Short batches use the other engines. Only selected if enabled with kOrtSessionOptionsTreeEnsembleGemm.
+  kGemm,
+};
+
+// Number of rows evaluated at once by TreeEnsembleEngine::kInterleaved.
+constexpr int64_t kTreeEnsembleBlockRows = 8;
+
+// Minimum number of nodes to switch to TreeEnsembleEngine::kCompact. Below that size,
+// the nodes hold in the caches and binning the inputs costs more than it saves.
+constexpr size_t kTreeEnsembleCompactMinNodes = 1 << 17;
+
+// TreeEnsembleEngine::kGemm costs (internal nodes x leaves) multiply-adds per tree and row while the traversal
+// only visits one node per level. It is selected if every tree is shallow enough to keep that cost low,
+// and used for batches of at least kTreeEnsembleGemmMinRows rows.
+constexpr int64_t kTreeEnsembleGemmMaxDepth = 8;
+constexpr size_t kTreeEnsembleGemmMaxCost = 1024;
+constexpr int64_t kTreeEnsembleGemmMinRows = 32;
+
 /**
  * These attributes are the kernel attributes. They are different from the onnx operator attributes
  * to improve the computation efficiency. The initialization consists in moving the onnx attributes
@@ -35,6 +73,7 @@ class TreeEnsembleCommonAttributes {
   int64_t n_trees_;
   bool same_mode_;
   bool has_missing_tracks_;
+  TreeEnsembleEngine engine_;
   int parallel_tree_;    // starts parallelizing the computing by trees if n_tree >= parallel_tree_
   int parallel_tree_N_;  // batch size if parallelizing by trees
   int parallel_N_;       // starts parallelizing the computing by rows if n_rows <= parallel_N_
@@ -53,6 +92,27 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
   // `ThresholdType` is used as well for output type (double as well for lightgbm) and not `OutputType`.
   std::vector<SparseValue<ThresholdType>> weights_;
   std::vector<TreeNodeElement<ThresholdType>*> roots_;
+  // Compact copy of nodes_ used by TreeEnsembleEngine::kCompact, compact_features_ maps the compact feature ids
+  // to the input columns and compact_thresholds_ holds the sorted thresholds of every compact feature.
+  std::vector<TreeNodeCompact> compact_nodes_;
+  std::vector<int64_t> compact_features_;
+  std::vector<std::vector<ThresholdType>> compact_thresholds_;
+  NODE_MODE_ORT compact_mode_;
+  // Matrices used by TreeEnsembleEngine::kGemm, every tree is padded to gemm_nodes_ internal nodes and
+  // gemm_leaves_ leaves. gemm_conditions_ holds the internal nodes of every tree, gemm_paths_ the packed matrices
+  // (internal nodes x leaves) holding 1 if a leaf is in the true subtree of a node and -1 if it is in the false
+  // subtree, gemm_path_lengths_ the number of true branches on the path to every leaf, gemm_leaf_nodes_ the leaves.
+  size_t gemm_nodes_;
+  size_t gemm_leaves_;
+  size_t gemm_paths_stride_;
+  std::vector<size_t> gemm_tree_nodes_;
+  std::vector<size_t> gemm_tree_leaves_;
+  std::vector<const TreeNodeElement<ThresholdType>*> gemm_conditions_;
+  std::vector<float> gemm_paths_;
+  std::vector<float> gemm_path_lengths_;
+  std::vector<const TreeNodeElement<ThresholdType>*> gemm_leaf_nodes_;
+  // set by Init(const OpKernelInfo&) from the session option kOrtSessionOptionsTreeEnsembleGemm
+  bool gemm_enabled_ = false;
 
  public:
   TreeEnsembleCommon() {}
@@ -69,9 +129,54 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
   TreeNodeElement<ThresholdType>* ProcessTreeNodeLeave(TreeNodeElement<ThresholdType>* root,
                                                        const InputType* x_data) const;
 
+  void ProcessTreeNodeLeaveBlock(TreeNodeElement<ThresholdType>* root, const InputType* x_data, int64_t stride,
+                                 size_t n_rows, TreeNodeElement<ThresholdType>** leaves) const;
+
+  template <typename Compare>
+  void ProcessTreeNodeLeaveBlock(TreeNodeElement<ThresholdType>* root, const InputType* x_data, int64_t stride,
+                                 size_t n_rows, TreeNodeElement<ThresholdType>** leaves, Compare compare) const;
+
+  const TreeNodeElement<ThresholdType>* ProcessTreeNodeLeaveCompact(const TreeNodeElement<ThresholdType>* root,
+                                                                    const uint16_t* bins) const;
+
+  // Bins rows [begin, end) for TreeEnsembleEngine::kCompact, bins receives compact_features_.size() values per row.
+  void BinRows(const InputType* x_data, int64_t stride, int64_t begin, int64_t end, uint16_t* bins) const;
+
+  template <typename Compare>
+  void BinRows(const InputType* x_data, int64_t stride, int64_t begin, int64_t end, uint16_t* bins,
+               Compare compare) const;
+
+  // Evaluates tree j on rows [begin, end) with the selected engine and calls fct(row, leaf) for every row.
+  // bins holds the binned rows starting at row begin if the engine is TreeEnsembleEngine::kCompact.
+  // gemm_buffer holds GemmBufferSize(end - begin) floats if the engine is TreeEnsembleEngine::kGemm.
+  template <typename Fct>
+  void ProcessTreeNodeLeaveRows(size_t j, const InputType* x_data, int64_t stride,
+                                int64_t begin, int64_t end, const uint16_t* bins, float* gemm_buffer,
+                                Fct&& fct) const;
+
+  template <typename Fct>
+  void ProcessTreeNodeLeaveGemm(size_t j, const InputType* x_data, int64_t stride,
+                                int64_t begin, int64_t end, float* gemm_buffer, Fct&& fct) const;
+
+  // Number of floats ProcessTreeNodeLeaveRows needs in gemm_buffer to evaluate a tree on n_rows rows,
+  // the buffer is reused for all the trees.
+  size_t GemmBufferSize(int64_t n_rows) const {
+    return engine_ == TreeEnsembleEngine::kGemm ? SafeInt<size_t>(n_rows) * (gemm_nodes_ + gemm_leaves_) : 0;
+  }
+
   template <typename AGG>
   void ComputeAgg(concurrency::ThreadPool* ttp, const Tensor* X, Tensor* Y, Tensor* label, const AGG& agg) const;
 
+  // Computes the predictions of rows [begin, end) for one output (ComputeAggRows1) or
+  // several outputs (ComputeAggRows), evaluating all trees on batches of parallel_tree_N_ rows.
+  template <typename AGG>
+  void ComputeAggRows1(const AGG& agg, const InputType* x_data, int64_t stride, int64_t begin, int64_t end,
+                       OutputType* z_data, int64_t* label_data) const;
+
+  template <typename AGG>
+  void ComputeAggRows(const AGG& agg, const InputType* x_data, int64_t stride, int64_t begin, int64_t end,
+                      OutputType* z_data, int64_t* label_data) const;
+
  private:
   bool CheckIfSubtreesAreEqual(const size_t left_id, const size_t right_id, const int64_t tree_id, const InlinedVector<NODE_MODE_ONNX>& cmodes,
                                const InlinedVector<size_t>& truenode_ids, const InlinedVector<size_t>& falsenode_ids, gsl::span<const int64_t> nodes_featureids,
@@ -84,6 +189,12 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
                   gsl::span<const int64_t> nodes_missing_value_tracks_true, std::vector<size_t>& updated_mapping,
                   int64_t tree_id, const InlinedVector<TreeNodeElementId>& node_tree_ids, gsl::span<const float> target_class_weights,
                   gsl::span<const ThresholdType> target_class_weights_as_tensor, InlinedVector<std::pair<TreeNodeElementId, uint32_t>>& indices);
+  bool BuildCompactNodes();
+  bool BuildGemmTrees();
+  bool GetGemmTreeSize(const TreeNodeElement<ThresholdType>* node, int64_t depth, size_t& n_nodes,
+                       size_t& n_leaves) const;
+  void AddGemmTree(size_t j, const TreeNodeElement<ThresholdType>* node, InlinedVector<std::pair<size_t, float>>& path,
+                   float* paths, size_t& n_nodes, size_t& n_leaves);
 };
 
 // Below is simple implementation of `bit_cast` as it is supported from c++20 and the current supported version is c++17
@@ -118,6 +229,7 @@ std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t> bit_cast_i
 template <typename InputType, typename ThresholdType, typename OutputType>
 Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(const OpKernelInfo& info) {
   TreeEnsembleAttributesV3<ThresholdType> attributes(info, false);
+  gemm_enabled_ = info.GetConfigOptions().GetConfigOrDefault(kOrtSessionOptionsTreeEnsembleGemm, "0") == "1";
   return Init(80, 128, 50, attributes);
 }
 
@@ -308,6 +420,16 @@ Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(
     }
   }
 
+  // The interleaved engine relies on all nodes sharing the same comparison to keep the
+  // traversal of every row branch free.
+  engine_ = same_mode_ ? TreeEnsembleEngine::kInterleaved : TreeEnsembleEngine::kTraversal;
+  if (engine_ == TreeEnsembleEngine::kInterleaved && nodes_.size() >= kTreeEnsembleCompactMinNodes &&
+      BuildCompactNodes()) {
+    engine_ = TreeEnsembleEngine::kCompact;
+  } else if (gemm_enabled_ && BuildGemmTrees()) {
+    engine_ = TreeEnsembleEngine::kGemm;
+  }
+
 #if defined(_TREE_DEBUG)
   std::cout << "TreeEnsemble:same_mode_=" << (same_mode_ ? 1 : 0) << "\n";
   for (auto& node : nodes_) {
@@ -317,6 +439,170 @@ Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(
   return Status::OK();
 }
 
+template <typename InputType, typename ThresholdType, typename OutputType>
+bool TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BuildCompactNodes() {
+  // All nodes share the same mode (see engine_). Replacing a threshold by its rank only preserves
+  // the comparisons which are monotonic with the threshold.
+  auto first = std::find_if(nodes_.begin(), nodes_.end(),
+                            [](const TreeNodeElement<ThresholdType>& node) { return node.is_not_leaf(); });
+  if (first == nodes_.end() || nodes_.size() > TreeNodeCompact::kMissingTrackTrue) {
+    return false;
+  }
+  bool ascending;
+  switch (first->mode()) {
+    case NODE_MODE_ORT::BRANCH_LEQ:
+    case NODE_MODE_ORT::BRANCH_LT:
+      ascending = true;
+      break;
+    case NODE_MODE_ORT::BRANCH_GTE:
+    case NODE_MODE_ORT::BRANCH_GT:
+      ascending = false;
+      break;
+    default:
+      return false;
+  }
+
+  std::unordered_map<int, uint16_t> feature_map;
+  std::vector<int64_t> features;
+  std::vector<std::vector<ThresholdType>> thresholds;
+  for (const auto& node : nodes_) {
+    if (!node.is_not_leaf()) {
+      continue;
+    }
+    if (_isnan_(node.value_or_unique_weight)) {
+      return false;
+    }
+    auto it = feature_map.find(node.feature_id);
+    if (it == feature_map.end()) {
+      if (features.size() >= TreeNodeCompact::kLeaf) {
+        return false;
+      }
+      it = feature_map.emplace(node.feature_id, static_cast<uint16_t>(features.size())).first;
+      features.push_back(node.feature_id);
+      thresholds.emplace_back();
+    }
+    thresholds[it->second].push_back(node.value_or_unique_weight);
+  }
+
+  // The thresholds are sorted so that the comparison is false for the lowest ranks and true for the highest ones.
+  for (auto& values : thresholds) {
+    if (ascending) {
+      std::sort(values.begin(), values.end());
+    } else {
+      std::sort(values.begin(), values.end(), std::greater<ThresholdType>());
+    }
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    if (values.size() >= TreeNodeCompact::kMissingBin) {
+      return false;
+    }
+  }
+
+  std::vector<TreeNodeCompact> compact_nodes(nodes_.size());
+  for (size_t i = 0, limit = nodes_.size(); i < limit; ++i) {
+    const auto& node = nodes_[i];
+    if (!node.is_not_leaf()) {
+      compact_nodes[i] = {0, TreeNodeCompact::kLeaf, 0};
+      continue;
+    }
+    const uint16_t feature_id = feature_map.find(node.feature_id)->second;
+    const auto& values = thresholds[feature_id];
+    auto rank = ascending ? std::lower_bound(values.begin(), values.end(), node.value_or_unique_weight)
+                          : std::lower_bound(values.begin(), values.end(), node.value_or_unique_weight,
+                                             std::greater<ThresholdType>());
+    compact_nodes[i].truenode = static_cast<uint32_t>(node.truenode_or_weight.ptr - nodes_.data()) |
+                                (node.is_missing_track_true() ? TreeNodeCompact::kMissingTrackTrue : 0);
+    compact_nodes[i].feature_id = feature_id;
+    compact_nodes[i].bin = static_cast<uint16_t>(rank - values.begin());
+  }
+
+  compact_nodes_ = std::move(compact_nodes);
+  compact_features_ = std::move(features);
+  compact_thresholds_ = std::move(thresholds);
+  compact_mode_ = first->mode();
+  return true;
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+bool TreeEnsembleCommon<InputType, ThresholdType, OutputType>::GetGemmTreeSize(
+    const TreeNodeElement<ThresholdType>* node, int64_t depth, size_t& n_nodes, size_t& n_leaves) const {
+  if (!node->is_not_leaf()) {
+    ++n_leaves;
+    return true;
+  }
+  if (depth >= kTreeEnsembleGemmMaxDepth) {
+    return false;
+  }
+  ++n_nodes;
+  return GetGemmTreeSize(node->truenode_or_weight.ptr, depth + 1, n_nodes, n_leaves) &&
+         GetGemmTreeSize(node + 1, depth + 1, n_nodes, n_leaves);
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::AddGemmTree(
+    size_t j, const TreeNodeElement<ThresholdType>* node, InlinedVector<std::pair<size_t, float>>& path,
+    float* paths, size_t& n_nodes, size_t& n_leaves) {
+  if (!node->is_not_leaf()) {
+    const size_t leaf = n_leaves++;
+    float length = 0;
+    for (const auto& step : path) {
+      paths[step.first * gemm_leaves_ + leaf] = step.second;
+      length += step.second > 0 ? 1.f : 0.f;
+    }
+    gemm_path_lengths_[j * gemm_leaves_ + leaf] = length;
+    gemm_leaf_nodes_[j * gemm_leaves_ + leaf] = node;
+    return;
+  }
+  const size_t k = n_nodes++;
+  gemm_conditions_[j * gemm_nodes_ + k] = node;
+  path.push_back({k, 1.f});
+  AddGemmTree(j, node->truenode_or_weight.ptr, path, paths, n_nodes, n_leaves);
+  path.back().second = -1.f;
+  AddGemmTree(j, node + 1, path, paths, n_nodes, n_leaves);
+  path.pop_back();
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+bool TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BuildGemmTrees() {
+  // Every tree must be shallow enough to keep the multiplication cheap.
+  const size_t n_trees = roots_.size();
+  std::vector<size_t> tree_nodes(n_trees, 0);
+  std::vector<size_t> tree_leaves(n_trees, 0);
+  size_t max_nodes = 0, max_leaves = 0;
+  for (size_t j = 0; j < n_trees; ++j) {
+    if (!GetGemmTreeSize(roots_[j], 0, tree_nodes[j], tree_leaves[j])) {
+      return false;
+    }
+    max_nodes = std::max(max_nodes, tree_nodes[j]);
+    max_leaves = std::max(max_leaves, tree_leaves[j]);
+  }
+  if (max_nodes == 0 || max_nodes * max_leaves > kTreeEnsembleGemmMaxCost) {
+    return false;
+  }
+
+  gemm_nodes_ = max_nodes;
+  gemm_leaves_ = max_leaves;
+  gemm_tree_nodes_ = std::move(tree_nodes);
+  gemm_tree_leaves_ = std::move(tree_leaves);
+  // The packed buffers keep the alignment MLAS prefers if every one of them starts at a multiple of their size.
+  gemm_paths_stride_ = MlasGemmPackBSize(gemm_leaves_, gemm_nodes_) / sizeof(float);
+  gemm_conditions_.assign(n_trees * gemm_nodes_, nullptr);
+  gemm_paths_.assign(n_trees * gemm_paths_stride_, 0.f);
+  // The padding leaves never match: the product of their column is always 0.
+  gemm_path_lengths_.assign(n_trees * gemm_leaves_, -1.f);
+  gemm_leaf_nodes_.assign(n_trees * gemm_leaves_, nullptr);
+
+  std::vector<float> paths(gemm_nodes_ * gemm_leaves_);
+  InlinedVector<std::pair<size_t, float>> path;
+  for (size_t j = 0; j < n_trees; ++j) {
+    std::fill(paths.begin(), paths.end(), 0.f);
+    size_t n_nodes = 0, n_leaves = 0;
+    AddGemmTree(j, roots_[j], path, paths.data(), n_nodes, n_leaves);
+    MlasGemmPackB(CblasNoTrans, gemm_leaves_, gemm_nodes_, paths.data(), gemm_leaves_,
+                  gemm_paths_.data() + j * gemm_paths_stride_);
+  }
+  return true;
+}
+
 template <typename InputType, typename ThresholdType, typename OutputType>
 bool TreeEnsembleCommon<InputType, ThresholdType, OutputType>::CheckIfSubtreesAreEqual(
     const size_t left_id, const size_t right_id, const int64_t tree_id, const InlinedVector<NODE_MODE_ONNX>& cmodes,
@@ -540,44 +826,34 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
       // In that case, looping first on tree or on data is almost the same. That's why the first loop
       // split into batch so that every batch holds on caches, then loop on trees and finally loop
       // on the batch rows.
-      std::vector<ScoreValue<ThresholdType>> scores(parallel_tree_N_);
-      size_t j;
-      int64_t i, batch, batch_end;
-
-      for (batch = 0; batch < N; batch += parallel_tree_N_) {
-        batch_end = std::min(N, batch + parallel_tree_N_);
-        for (i = batch; i < batch_end; ++i) {
-          scores[SafeInt<ptrdiff_t>(i - batch)] = {0, 0};
-        }
-        for (j = 0; j < static_cast<size_t>(n_trees_); ++j) {
-          for (i = batch; i < batch_end; ++i) {
-            agg.ProcessTreeNodePrediction1(scores[SafeInt<ptrdiff_t>(i - batch)], *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
-          }
-        }
-        for (i = batch; i < batch_end; ++i) {
-          agg.FinalizeScores1(z_data + i, scores[SafeInt<ptrdiff_t>(i - batch)],
-                              label_data == nullptr ? nullptr : (label_data + i));
-        }
-      }
+      ComputeAggRows1(agg, x_data, stride, 0, N, z_data, label_data);
     } else if (n_trees_ > max_num_threads) { /* section D: 1 output, 2+ rows and enough trees to parallelize */
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(n_trees_));
       std::vector<ScoreValue<ThresholdType>> scores(SafeInt<size_t>(num_threads) * N);
+      std::vector<uint16_t> bins;
+      if (engine_ == TreeEnsembleEngine::kCompact) {
+        bins.resize(SafeInt<size_t>(parallel_tree_N_) * compact_features_.size());
+      }
+      std::vector<std::vector<float>> gemm_buffers(num_threads, std::vector<float>(GemmBufferSize(parallel_tree_N_)));
       int64_t end_n, begin_n = 0;
       while (begin_n < N) {
         end_n = std::min(N, begin_n + parallel_tree_N_);
+        if (engine_ == TreeEnsembleEngine::kCompact) {
+          BinRows(x_data, stride, begin_n, end_n, bins.data());
+        }
         concurrency::ThreadPool::TrySimpleParallelFor(
             ttp,
             num_threads,
-            [this, &agg, &scores, num_threads, x_data, N, begin_n, end_n, stride](ptrdiff_t batch_num) {
+            [this, &agg, &scores, &bins, &gemm_buffers, num_threads, x_data, N, begin_n, end_n, stride](ptrdiff_t batch_num) {
               auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, onnxruntime::narrow<size_t>(this->n_trees_));
               for (int64_t i = begin_n; i < end_n; ++i) {
                 scores[batch_num * SafeInt<ptrdiff_t>(N) + i] = {0, 0};
               }
               for (auto j = work.start; j < work.end; ++j) {
-                for (int64_t i = begin_n; i < end_n; ++i) {
-                  agg.ProcessTreeNodePrediction1(scores[batch_num * SafeInt<ptrdiff_t>(N) + i],
-                                                 *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
-                }
+                ProcessTreeNodeLeaveRows(j, x_data, stride, begin_n, end_n, bins.data(), gemm_buffers[batch_num].data(),
+                                         [&](int64_t i, const TreeNodeElement<ThresholdType>& leaf) {
+                                           agg.ProcessTreeNodePrediction1(scores[batch_num * SafeInt<ptrdiff_t>(N) + i], leaf);
+                                         });
               }
             });
         begin_n = end_n;
@@ -595,6 +871,16 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
                                   label_data == nullptr ? nullptr : (label_data + i));
             }
           });
+    } else if (engine_ != TreeEnsembleEngine::kTraversal) { /* section E: 1 output, 2+ rows, parallelization by rows */
+      // Every thread evaluates the trees on blocks of its rows.
+      auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>((N + kTreeEnsembleBlockRows - 1) / kTreeEnsembleBlockRows));
+      concurrency::ThreadPool::TrySimpleParallelFor(
+          ttp,
+          num_threads,
+          [this, &agg, num_threads, x_data, z_data, label_data, N, stride](ptrdiff_t batch_num) {
+            auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, onnxruntime::narrow<ptrdiff_t>(N));
+            ComputeAggRows1(agg, x_data, stride, work.start, work.end, z_data, label_data);
+          });
     } else { /* section E: 1 output, 2+ rows, parallelization by rows */
       concurrency::ThreadPool::TryBatchParallelFor(
           ttp,
@@ -637,48 +923,34 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
         agg.FinalizeScores(scores[0], z_data, -1, label_data);
       }
     } else if (N <= parallel_N_ || max_num_threads == 1) { /* section C2: 2+ outputs, 2+ rows, not enough rows to parallelize */
-      std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(parallel_tree_N_);
-      size_t j, limit;
-      int64_t i, batch, batch_end;
-      batch_end = std::min(N, static_cast<int64_t>(parallel_tree_N_));
-      for (i = 0; i < batch_end; ++i) {
-        scores[SafeInt<ptrdiff_t>(i)].resize(onnxruntime::narrow<size_t>(n_targets_or_classes_));
-      }
-      for (batch = 0; batch < N; batch += parallel_tree_N_) {
-        batch_end = std::min(N, batch + parallel_tree_N_);
-        for (i = batch; i < batch_end; ++i) {
-          std::fill(scores[SafeInt<ptrdiff_t>(i - batch)].begin(), scores[SafeInt<ptrdiff_t>(i - batch)].end(), ScoreValue<ThresholdType>({0, 0}));
-        }
-        for (j = 0, limit = roots_.size(); j < limit; ++j) {
-          for (i = batch; i < batch_end; ++i) {
-            agg.ProcessTreeNodePrediction(scores[SafeInt<ptrdiff_t>(i - batch)], *ProcessTreeNodeLeave(roots_[j], x_data + i * stride), weights_);
-          }
-        }
-        for (i = batch; i < batch_end; ++i) {
-          agg.FinalizeScores(scores[SafeInt<ptrdiff_t>(i - batch)], z_data + i * n_targets_or_classes_, -1,
-                             label_data == nullptr ? nullptr : (label_data + i));
-        }
-      }
-
+      ComputeAggRows(agg, x_data, stride, 0, N, z_data, label_data);
     } else if (n_trees_ >= max_num_threads) { /* section: D2: 2+ outputs, 2+ rows, enough trees to parallelize*/
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(n_trees_));
       std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(SafeInt<size_t>(num_threads) * N);
+      std::vector<uint16_t> bins;
+      if (engine_ == TreeEnsembleEngine::kCompact) {
+        bins.resize(SafeInt<size_t>(parallel_tree_N_) * compact_features_.size());
+      }
+      std::vector<std::vector<float>> gemm_buffers(num_threads, std::vector<float>(GemmBufferSize(parallel_tree_N_)));
       int64_t end_n, begin_n = 0;
       while (begin_n < N) {
         end_n = std::min(N, begin_n + parallel_tree_N_);
+        if (engine_ == TreeEnsembleEngine::kCompact) {
+          BinRows(x_data, stride, begin_n, end_n, bins.data());
+        }
         concurrency::ThreadPool::TrySimpleParallelFor(
             ttp,
             num_threads,
-            [this, &agg, &scores, num_threads, x_data, N, stride, begin_n, end_n](ptrdiff_t batch_num) {
+            [this, &agg, &scores, &bins, &gemm_buffers, num_threads, x_data, N, stride, begin_n, end_n](ptrdiff_t batch_num) {
               auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, onnxruntime::narrow<size_t>(this->n_trees_));
               for (int64_t i = begin_n; i < end_n; ++i) {
                 scores[batch_num * SafeInt<ptrdiff_t>(N) + i].resize(onnxruntime::narrow<size_t>(n_targets_or_classes_), {0, 0});
               }
               for (auto j = work.start; j < work.end; ++j) {
-                for (int64_t i = begin_n; i < end_n; ++i) {
-                  agg.ProcessTreeNodePrediction(scores[batch_num * SafeInt<ptrdiff_t>(N) + i],
-                                                *ProcessTreeNodeLeave(roots_[j], x_data + i * stride), weights_);
-                }
+                ProcessTreeNodeLeaveRows(j, x_data, stride, begin_n, end_n, bins.data(), gemm_buffers[batch_num].data(),
+                                         [&](int64_t i, const TreeNodeElement<ThresholdType>& leaf) {
+                                           agg.ProcessTreeNodePrediction(scores[batch_num * SafeInt<ptrdiff_t>(N) + i], leaf, weights_);
+                                         });
               }
             });
         begin_n = end_n;
@@ -696,6 +968,16 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
                                  label_data == nullptr ? nullptr : (label_data + i));
             }
           });
+    } else if (engine_ != TreeEnsembleEngine::kTraversal) { /* section E2: 2+ outputs, 2+ rows, parallelization by rows */
+      // Every thread evaluates the trees on blocks of its rows.
+      auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>((N + kTreeEnsembleBlockRows - 1) / kTreeEnsembleBlockRows));
+      concurrency::ThreadPool::TrySimpleParallelFor(
+          ttp,
+          num_threads,
+          [this, &agg, num_threads, x_data, z_data, label_data, N, stride](ptrdiff_t batch_num) {
+            auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, onnxruntime::narrow<ptrdiff_t>(N));
+            ComputeAggRows(agg, x_data, stride, work.start, work.end, z_data, label_data);
+          });
     } else { /* section E2: 2+ outputs, 2+ rows, parallelization by rows */
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(N));
       concurrency::ThreadPool::TrySimpleParallelFor(
@@ -840,6 +1122,314 @@ TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeave(
   return root;
 }
 
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename Compare>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaveBlock(
+    TreeNodeElement<ThresholdType>* root, const InputType* x_data, int64_t stride, size_t n_rows,
+    TreeNodeElement<ThresholdType>** leaves, Compare compare) const {
+  for (size_t r = 0; r < n_rows; ++r) {
+    leaves[r] = root;
+  }
+  // Every pass moves each row one level down its path, the rows which reached a leaf stay there.
+  // The rows are independent, so the processor overlaps the loads of their next nodes.
+  bool active = root->is_not_leaf();
+  while (active) {
+    active = false;
+    for (size_t r = 0; r < n_rows; ++r) {
+      TreeNodeElement<ThresholdType>* node = leaves[r];
+      if (node->is_not_leaf()) {
+        const InputType val = x_data[static_cast<int64_t>(r) * stride + node->feature_id];
+        leaves[r] = (compare(val, node->value_or_unique_weight) ||
+                     (has_missing_tracks_ && node->is_missing_track_true() && _isnan_(val)))
+                        ? node->truenode_or_weight.ptr
+                        : node + 1;
+        active = true;
+      }
+    }
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaveBlock(
+    TreeNodeElement<ThresholdType>* root, const InputType* x_data, int64_t stride, size_t n_rows,
+    TreeNodeElement<ThresholdType>** leaves) const {
+  // All nodes share the same mode (see engine_), the one of the root is used.
+  switch (root->mode()) {
+    case NODE_MODE_ORT::BRANCH_LEQ:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType threshold) { return val <= threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_LT:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType threshold) { return val < threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_GTE:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType threshold) { return val >= threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_GT:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType threshold) { return val > threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_EQ:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType threshold) { return val == threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_NEQ:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType threshold) { return val != threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_MEMBER:
+      ProcessTreeNodeLeaveBlock(root, x_data, stride, n_rows, leaves,
+                                [](InputType val, ThresholdType mask) { return SetMembershipCheck(val, mask); });
+      break;
+    case NODE_MODE_ORT::LEAF:
+      for (size_t r = 0; r < n_rows; ++r) {
+        leaves[r] = root;
+      }
+      break;
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+const TreeNodeElement<ThresholdType>*
+TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaveCompact(
+    const TreeNodeElement<ThresholdType>* root, const uint16_t* bins) const {
+  const TreeNodeCompact* nodes = compact_nodes_.data();
+  const TreeNodeCompact* node = nodes + (root - nodes_.data());
+  uint16_t bin;
+  while (node->is_not_leaf()) {
+    bin = bins[node->feature_id];
+    node = (bin <= node->bin || (bin == TreeNodeCompact::kMissingBin && node->is_missing_track_true()))
+               ? nodes + node->truenode_id()
+               : node + 1;
+  }
+  return &nodes_[node - nodes];
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename Compare>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BinRows(
+    const InputType* x_data, int64_t stride, int64_t begin, int64_t end, uint16_t* bins, Compare compare) const {
+  const size_t n_features = compact_features_.size();
+  for (int64_t i = begin; i < end; ++i, bins += n_features) {
+    const InputType* x = x_data + i * stride;
+    for (size_t f = 0; f < n_features; ++f) {
+      const InputType val = x[compact_features_[f]];
+      if (_isnan_(val)) {
+        bins[f] = TreeNodeCompact::kMissingBin;
+        continue;
+      }
+      // The thresholds are sorted so that the comparison is false for the first ones and true for the others,
+      // the bin is the rank of the first threshold the comparison is true for.
+      const auto& thresholds = compact_thresholds_[f];
+      bins[f] = static_cast<uint16_t>(
+          std::partition_point(thresholds.begin(), thresholds.end(),
+                               [&](ThresholdType threshold) { return !compare(val, threshold); }) -
+          thresholds.begin());
+    }
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BinRows(
+    const InputType* x_data, int64_t stride, int64_t begin, int64_t end, uint16_t* bins) const {
+  // BuildCompactNodes only accepts these modes.
+  switch (compact_mode_) {
+    case NODE_MODE_ORT::BRANCH_LEQ:
+      BinRows(x_data, stride, begin, end, bins,
+              [](InputType val, ThresholdType threshold) { return val <= threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_LT:
+      BinRows(x_data, stride, begin, end, bins,
+              [](InputType val, ThresholdType threshold) { return val < threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_GTE:
+      BinRows(x_data, stride, begin, end, bins,
+              [](InputType val, ThresholdType threshold) { return val >= threshold; });
+      break;
+    case NODE_MODE_ORT::BRANCH_GT:
+      BinRows(x_data, stride, begin, end, bins,
+              [](InputType val, ThresholdType threshold) { return val > threshold; });
+      break;
+    default:
+      ORT_THROW("Unexpected node mode for the compact tree ensemble.");
+  }
+}
+
+// Returns true if the value follows the true branch of the node.
+template <typename InputType, typename ThresholdType>
+inline bool IsTreeNodeConditionTrue(const TreeNodeElement<ThresholdType>& node, InputType val) {
+  if (node.is_missing_track_true() && _isnan_(val)) {
+    return true;
+  }
+  switch (node.mode()) {
+    case NODE_MODE_ORT::BRANCH_LEQ:
+      return val <= node.value_or_unique_weight;
+    case NODE_MODE_ORT::BRANCH_LT:
+      return val < node.value_or_unique_weight;
+    case NODE_MODE_ORT::BRANCH_GTE:
+      return val >= node.value_or_unique_weight;
+    case NODE_MODE_ORT::BRANCH_GT:
+      return val > node.value_or_unique_weight;
+    case NODE_MODE_ORT::BRANCH_EQ:
+      return val == node.value_or_unique_weight;
+    case NODE_MODE_ORT::BRANCH_NEQ:
+      return val != node.value_or_unique_weight;
+    case NODE_MODE_ORT::BRANCH_MEMBER:
+      return SetMembershipCheck(val, node.value_or_unique_weight);
+    default:
+      return false;
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename Fct>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaveGemm(
+    size_t j, const InputType* x_data, int64_t stride, int64_t begin, int64_t end, float* gemm_buffer,
+    Fct&& fct) const {
+  const size_t n_rows = onnxruntime::narrow<size_t>(end - begin);
+  const size_t n_nodes = gemm_tree_nodes_[j];
+  const size_t n_leaves = gemm_tree_leaves_[j];
+  const TreeNodeElement<ThresholdType>* const* nodes = gemm_conditions_.data() + j * gemm_nodes_;
+  float* conditions = gemm_buffer;
+  float* matches = gemm_buffer + n_rows * gemm_nodes_;
+
+  // conditions[r, k] is 1 if row r follows the true branch of node k, the padding nodes are 0.
+  for (size_t r = 0; r < n_rows; ++r) {
+    const InputType* x = x_data + (begin + static_cast<int64_t>(r)) * stride;
+    float* row_conditions = conditions + r * gemm_nodes_;
+    for (size_t k = 0; k < n_nodes; ++k) {
+      row_conditions[k] = IsTreeNodeConditionTrue(*nodes[k], x[nodes[k]->feature_id]) ? 1.f : 0.f;
+    }
+    std::fill(row_conditions + n_nodes, row_conditions + gemm_nodes_, 0.f);
+  }
+
+  // matches[r, l] counts the true conditions on the path to leaf l minus the true conditions on the false branches,
+  // it is equal to the number of true branches on the path only for the leaf row r falls into.
+  // The values are small integers, the multiplication is exact.
+  MLAS_SGEMM_DATA_PARAMS data;
+  data.A = conditions;
+  data.lda = gemm_nodes_;
+  data.B = gemm_paths_.data() + j * gemm_paths_stride_;
+  data.ldb = gemm_leaves_;
+  data.BIsPacked = true;
+  data.C = matches;
+  data.ldc = gemm_leaves_;
+  data.alpha = 1.f;
+  data.beta = 0.f;
+  MlasGemm(CblasNoTrans, CblasNoTrans, n_rows, gemm_leaves_, gemm_nodes_, data, nullptr);
+
+  const float* lengths = gemm_path_lengths_.data() + j * gemm_leaves_;
+  const TreeNodeElement<ThresholdType>* const* leaves = gemm_leaf_nodes_.data() + j * gemm_leaves_;
+  for (size_t r = 0; r < n_rows; ++r) {
+    const float* row_matches = matches + r * gemm_leaves_;
+    size_t l = 0;
+    while (l + 1 < n_leaves && row_matches[l] != lengths[l]) {
+      ++l;
+    }
+    fct(begin + static_cast<int64_t>(r), *leaves[l]);
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename Fct>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaveRows(
+    size_t j, const InputType* x_data, int64_t stride, int64_t begin, int64_t end,
+    const uint16_t* bins, float* gemm_buffer, Fct&& fct) const {
+  TreeNodeElement<ThresholdType>* root = roots_[j];
+  if (engine_ == TreeEnsembleEngine::kCompact) {
+    const size_t n_features = compact_features_.size();
+    for (int64_t i = begin; i < end; ++i) {
+      fct(i, *ProcessTreeNodeLeaveCompact(root, bins + SafeInt<size_t>(i - begin) * n_features));
+    }
+  } else if (engine_ == TreeEnsembleEngine::kGemm && end - begin >= kTreeEnsembleGemmMinRows) {
+    ProcessTreeNodeLeaveGemm(j, x_data, stride, begin, end, gemm_buffer, std::forward<Fct>(fct));
+  } else if (engine_ == TreeEnsembleEngine::kInterleaved || (engine_ == TreeEnsembleEngine::kGemm && same_mode_)) {
+    TreeNodeElement<ThresholdType>* leaves[kTreeEnsembleBlockRows];
+    for (int64_t i = begin; i < end; i += kTreeEnsembleBlockRows) {
+      const size_t n_rows = static_cast<size_t>(std::min(kTreeEnsembleBlockRows, end - i));
+      ProcessTreeNodeLeaveBlock(root, x_data + i * stride, stride, n_rows, leaves);
+      for (size_t r = 0; r < n_rows; ++r) {
+        fct(i + static_cast<int64_t>(r), *leaves[r]);
+      }
+    }
+  } else {
+    for (int64_t i = begin; i < end; ++i) {
+      fct(i, *ProcessTreeNodeLeave(root, x_data + i * stride));
+    }
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename AGG>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAggRows1(
+    const AGG& agg, const InputType* x_data, int64_t stride, int64_t begin, int64_t end,
+    OutputType* z_data, int64_t* label_data) const {
+  std::vector<ScoreValue<ThresholdType>> scores(parallel_tree_N_);
+  std::vector<uint16_t> bins;
+  if (engine_ == TreeEnsembleEngine::kCompact) {
+    bins.resize(SafeInt<size_t>(parallel_tree_N_) * compact_features_.size());
+  }
+  std::vector<float> gemm_buffer(GemmBufferSize(parallel_tree_N_));
+  int64_t i, batch, batch_end;
+
+  for (batch = begin; batch < end; batch += parallel_tree_N_) {
+    batch_end = std::min(end, batch + parallel_tree_N_);
+    if (engine_ == TreeEnsembleEngine::kCompact) {
+      BinRows(x_data, stride, batch, batch_end, bins.data());
+    }
+    for (i = batch; i < batch_end; ++i) {
+      scores[SafeInt<ptrdiff_t>(i - batch)] = {0, 0};
+    }
+    for (size_t j = 0; j < static_cast<size_t>(n_trees_); ++j) {
+      ProcessTreeNodeLeaveRows(j, x_data, stride, batch, batch_end, bins.data(), gemm_buffer.data(),
+                               [&](int64_t row, const TreeNodeElement<ThresholdType>& leaf) {
+                                 agg.ProcessTreeNodePrediction1(scores[SafeInt<ptrdiff_t>(row - batch)], leaf);
+                               });
+    }
+    for (i = batch; i < batch_end; ++i) {
+      agg.FinalizeScores1(z_data + i, scores[SafeInt<ptrdiff_t>(i - batch)],
+                          label_data == nullptr ? nullptr : (label_data + i));
+    }
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename AGG>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAggRows(
+    const AGG& agg, const InputType* x_data, int64_t stride, int64_t begin, int64_t end,
+    OutputType* z_data, int64_t* label_data) const {
+  std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(parallel_tree_N_);
+  std::vector<uint16_t> bins;
+  if (engine_ == TreeEnsembleEngine::kCompact) {
+    bins.resize(SafeInt<size_t>(parallel_tree_N_) * compact_features_.size());
+  }
+  std::vector<float> gemm_buffer(GemmBufferSize(parallel_tree_N_));
+  int64_t i, batch, batch_end;
+
+  for (batch = begin; batch < end; batch += parallel_tree_N_) {
+    batch_end = std::min(end, batch + parallel_tree_N_);
+    if (engine_ == TreeEnsembleEngine::kCompact) {
+      BinRows(x_data, stride, batch, batch_end, bins.data());
+    }
+    for (i = batch; i < batch_end; ++i) {
+      scores[SafeInt<ptrdiff_t>(i - batch)].assign(onnxruntime::narrow<size_t>(n_targets_or_classes_),
+                                                   ScoreValue<ThresholdType>({0, 0}));
+    }
+    for (size_t j = 0, limit = roots_.size(); j < limit; ++j) {
+      ProcessTreeNodeLeaveRows(j, x_data, stride, batch, batch_end, bins.data(), gemm_buffer.data(),
+                               [&](int64_t row, const TreeNodeElement<ThresholdType>& leaf) {
+                                 agg.ProcessTreeNodePrediction(scores[SafeInt<ptrdiff_t>(row - batch)], leaf, weights_);
+                               });
+    }
+    for (i = batch; i < batch_end; ++i) {
+      agg.FinalizeScores(scores[SafeInt<ptrdiff_t>(i - batch)], z_data + i * n_targets_or_classes_, -1,
+                         label_data == nullptr ? nullptr : (label_data + i));
+    }
+  }
+}
+
 // TI: input type
 // TH: threshold type, double if T==double, float otherwise
 // TO: output type
@@ -865,6 +1455,7 @@ class TreeEnsembleCommonClassifier : public TreeEnsembleCommon<InputType, Thresh
 template <typename InputType, typename ThresholdType, typename OutputType>
 Status TreeEnsembleCommonClassifier<InputType, ThresholdType, OutputType>::Init(const OpKernelInfo& info) {
   TreeEnsembleAttributesV3<ThresholdType> attributes(info, true);
+  this->gemm_enabled_ = info.GetConfigOptions().GetConfigOrDefault(kOrtSessionOptionsTreeEnsembleGemm, "0") == "1";
   return Init(80, 128, 50, attributes);
 }
 
@@ -945,6 +1536,7 @@ class TreeEnsembleCommonV5 : public TreeEnsembleCommon<IOType, ThresholdType, IO
 template <typename IOType, typename ThresholdType>
 Status TreeEnsembleCommonV5<IOType, ThresholdType>::Init(const OpKernelInfo& info) {
   TreeEnsembleAttributesV5<ThresholdType> attributes(info);
+  this->gemm_enabled_ = info.GetConfigOptions().GetConfigOrDefault(kOrtSessionOptionsTreeEnsembleGemm, "0") == "1";
   return Init(80, 128, 50, attributes);
 }
 
@@ -335,6 +335,8 @@ void UniDirectionalLstm<T>::ComputeImpl(const gsl::span<const T>& inputs_arg,
 
       // calculate Xt*(W[iofc]^T) + Ht-t*R[iofc]
       // Do it sequentially to avoid nested parallelism
+      // Each step depends on the previous one, so there is no batch of independent GEMMs. For one or two rows
+      // MLAS reads the unpacked weights in place.
       ComputeGemm(num_seq_to_compute_adjusted, hidden_size_x4, hidden_size_, alpha,
                   gsl::span<const T>(&*previous_state, previous_state_end - previous_state),  // Ht-1
                   recurrent_weights,                                                          // R[iofc]
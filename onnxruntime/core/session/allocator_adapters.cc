@@ -71,6 +71,9 @@ std::unordered_map<std::string, std::string> OrtAllocatorImplWrappingIAllocator:
     entries.insert_or_assign("NumArenaExtensions", std::to_string(stats.num_arena_extensions));
     entries.insert_or_assign("NumArenaShrinkages", std::to_string(stats.num_arena_shrinkages));
     entries.insert_or_assign("MaxAllocSize", std::to_string(stats.max_alloc_size));
+    entries.insert_or_assign("NumCacheHits", std::to_string(stats.num_cache_hits));
+    entries.insert_or_assign("NumCacheMisses", std::to_string(stats.num_cache_misses));
+    entries.insert_or_assign("InCache", std::to_string(stats.bytes_in_cache));
   }
   return entries;
 }
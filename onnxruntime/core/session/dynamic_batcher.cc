@@ -0,0 +1,458 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/session/dynamic_batcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <gsl/gsl>
+
+#include "core/common/narrow.h"
+#include "core/common/safeint.h"
+#include "core/framework/error_code_helper.h"
+#include "core/framework/tensor.h"
+#include "core/graph/node_arg.h"
+
+namespace onnxruntime {
+
+void DynamicBatcher::SetBatchedValues(gsl::span<const NodeArg* const> inputs, gsl::span<const NodeArg* const> outputs,
+                                      Config& config) {
+  // the symbolic dimension at batch_dim of a declared shape, or nullptr if there is none
+  auto get_batch_dim_param = [&config](const NodeArg& node_arg) -> const std::string* {
+    const auto* shape = node_arg.Shape();
+    if (shape == nullptr || shape->dim_size() <= static_cast<int>(config.batch_dim)) {
+      return nullptr;
+    }
+    const auto& dim = shape->dim(static_cast<int>(config.batch_dim));
+    return dim.has_dim_param() && !dim.dim_param().empty() ? &dim.dim_param() : nullptr;
+  };
+
+  config.batched_inputs.clear();
+  config.batched_outputs.clear();
+
+  const std::string* batch_dim_param = nullptr;
+  for (const NodeArg* input : inputs) {
+    const std::string* dim_param = get_batch_dim_param(*input);
+    if (dim_param != nullptr && (batch_dim_param == nullptr || *dim_param == *batch_dim_param)) {
+      batch_dim_param = dim_param;
+      config.batched_inputs.insert(input->Name());
+    }
+  }
+  if (batch_dim_param == nullptr) {
+    return;
+  }
+
+  for (const NodeArg* output : outputs) {
+    const std::string* dim_param = get_batch_dim_param(*output);
+    if (dim_param != nullptr && *dim_param == *batch_dim_param) {
+      config.batched_outputs.insert(output->Name());
+    }
+  }
+}
+
+DynamicBatcher::DynamicBatcher(const Config& config, RunFn run_fn, AllocatorPtr cpu_allocator,
+                               concurrency::ThreadPool* thread_pool, profiling::Profiler& profiler,
+                               const logging::Logger& logger)
+    : config_(config),
+      run_fn_(std::move(run_fn)),
+      cpu_allocator_(std::move(cpu_allocator)),
+      thread_pool_(thread_pool != nullptr && concurrency::ThreadPool::DegreeOfParallelism(thread_pool) >= 2
+                       ? thread_pool
+                       : nullptr),
+      profiler_(profiler),
+      logger_(logger) {
+  ORT_ENFORCE(config_.max_batch_size > 0, "max_batch_size must be positive");
+  ORT_ENFORCE(cpu_allocator_ != nullptr);
+  dispatcher_ = std::thread([this]() { DispatchLoop(); });
+}
+
+DynamicBatcher::~DynamicBatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  dispatcher_.join();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  batches_done_cv_.wait(lock, [this]() { return running_batches_ == 0; });
+
+  if (stats_.num_requests > 0) {
+    LOGS(logger_, INFO) << "Dynamic batching ran " << stats_.num_requests << " requests in " << stats_.num_batches
+                        << " runs, mean queue delay " << stats_.total_queue_delay_us / stats_.num_requests
+                        << "us, max queue delay " << stats_.max_queue_delay_us << "us";
+  }
+}
+
+bool DynamicBatcher::TryEnqueue(const RunOptions* run_options,
+                                gsl::span<const char* const> feed_names,
+                                gsl::span<const OrtValue* const> feeds,
+                                gsl::span<const char* const> fetch_names,
+                                gsl::span<OrtValue*> fetches,
+                                RunAsyncCallbackFn callback,
+                                void* user_data) {
+  // a request that is already terminated runs directly and fails there
+  if (feeds.empty() || (run_options != nullptr && run_options->terminate) ||
+      std::any_of(fetches.begin(), fetches.end(), [](const OrtValue* fetch) { return fetch != nullptr; })) {
+    return false;
+  }
+
+  auto request = std::make_unique<Request>();
+  request->batch_size = -1;
+  for (size_t i = 0, end = feeds.size(); i < end; ++i) {
+    if (feed_names[i] == nullptr || feeds[i] == nullptr || !feeds[i]->IsTensor() ||
+        config_.batched_inputs.count(feed_names[i]) == 0) {
+      return false;
+    }
+    const auto& tensor = feeds[i]->Get<Tensor>();
+    const auto& shape = tensor.Shape();
+    if (tensor.IsDataTypeString() || tensor.Location().device.Type() != OrtDevice::CPU ||
+        shape.NumDimensions() <= config_.batch_dim) {
+      return false;
+    }
+    if (request->batch_size == -1) {
+      request->batch_size = shape[config_.batch_dim];
+    } else if (shape[config_.batch_dim] != request->batch_size) {
+      return false;
+    }
+    request->feed_names.emplace_back(feed_names[i]);
+    request->feeds.push_back(*feeds[i]);
+  }
+  for (const char* fetch_name : fetch_names) {
+    if (fetch_name == nullptr || config_.batched_outputs.count(fetch_name) == 0) {
+      return false;
+    }
+    request->fetch_names.emplace_back(fetch_name);
+  }
+  request->run_options = run_options;
+  request->fetches = fetches;
+  request->callback = callback;
+  request->user_data = user_data;
+  request->enqueue_time = std::chrono::steady_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (shutdown_) {
+      return false;
+    }
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+DynamicBatcher::Stats DynamicBatcher::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+bool DynamicBatcher::HaveSameSettings(const RunOptions* first, const RunOptions* other) {
+  if (first == other) {
+    return true;
+  }
+  static const RunOptions default_run_options;
+  const RunOptions& a = first != nullptr ? *first : default_run_options;
+  const RunOptions& b = other != nullptr ? *other : default_run_options;
+  return a.run_log_severity_level == b.run_log_severity_level &&
+         a.run_log_verbosity_level == b.run_log_verbosity_level &&
+         a.run_tag == b.run_tag &&
+         !a.terminate && !b.terminate &&
+         a.only_execute_path_to_fetches == b.only_execute_path_to_fetches &&
+#ifdef ENABLE_TRAINING
+         a.training_mode == b.training_mode &&
+#endif
+         a.config_options.GetConfigOptionsMap() == b.config_options.GetConfigOptionsMap() &&
+         a.active_adapters == b.active_adapters;
+}
+
+bool DynamicBatcher::CanBatch(const Request& first, const Request& other) const {
+  if (first.feed_names != other.feed_names || first.fetch_names != other.fetch_names ||
+      !HaveSameSettings(first.run_options, other.run_options)) {
+    return false;
+  }
+  for (size_t i = 0, end = first.feeds.size(); i < end; ++i) {
+    const auto& first_tensor = first.feeds[i].Get<Tensor>();
+    const auto& other_tensor = other.feeds[i].Get<Tensor>();
+    if (first_tensor.DataType() != other_tensor.DataType()) {
+      return false;
+    }
+    const auto first_dims = first_tensor.Shape().GetDims();
+    const auto other_dims = other_tensor.Shape().GetDims();
+    if (first_dims.size() != other_dims.size()) {
+      return false;
+    }
+    for (size_t d = 0; d < first_dims.size(); ++d) {
+      if (d != config_.batch_dim && first_dims[d] != other_dims[d]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int64_t DynamicBatcher::QueuedBatchSize() const {
+  const auto& first = *queue_.front();
+  int64_t batch_size = 0;
+  for (const auto& request : queue_) {
+    if (request.get() == &first || CanBatch(first, *request)) {
+      batch_size += request->batch_size;
+    }
+  }
+  return batch_size;
+}
+
+void DynamicBatcher::TakeBatch(std::vector<std::unique_ptr<Request>>& batch) {
+  int64_t batch_size = 0;
+  for (auto it = queue_.begin(); it != queue_.end();) {
+    if (batch.empty() ||
+        (batch_size + (*it)->batch_size <= config_.max_batch_size && CanBatch(*batch.front(), **it))) {
+      batch_size += (*it)->batch_size;
+      batch.push_back(std::move(*it));
+      it = queue_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  stats_.num_requests += batch.size();
+  stats_.num_batches += 1;
+  stats_.max_requests_per_batch = std::max<uint64_t>(stats_.max_requests_per_batch, batch.size());
+  for (const auto& request : batch) {
+    request->dispatch_time = now;
+    const auto queue_delay_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - request->enqueue_time).count());
+    stats_.total_queue_delay_us += queue_delay_us;
+    stats_.max_queue_delay_us = std::max(stats_.max_queue_delay_us, queue_delay_us);
+  }
+}
+
+void DynamicBatcher::DispatchLoop() {
+  for (;;) {
+    auto batch = std::make_shared<std::vector<std::unique_ptr<Request>>>();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+
+      // give concurrent requests a chance to join the oldest one
+      const auto deadline = queue_.front()->enqueue_time + config_.max_delay;
+      while (!shutdown_ && QueuedBatchSize() < config_.max_batch_size &&
+             cv_.wait_until(lock, deadline) == std::cv_status::no_timeout) {
+      }
+      TakeBatch(*batch);
+
+      if (thread_pool_ != nullptr) {
+        ++running_batches_;
+      }
+    }
+
+    if (thread_pool_ == nullptr) {
+      RunBatch(*batch);
+      continue;
+    }
+
+    // run the batch like RunAsync runs a request, the dispatcher goes on with the next batch
+    concurrency::ThreadPool::Schedule(thread_pool_, [this, batch]() {
+      auto done = gsl::finally([this]() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          --running_batches_;
+        }
+        batches_done_cv_.notify_all();
+      });
+      RunBatch(*batch);
+      batch->clear();
+    });
+  }
+}
+
+static Status InvokeRun(const DynamicBatcher::RunFn& run_fn, const RunOptions* run_options,
+                        gsl::span<const std::string> feed_names, gsl::span<const OrtValue> feeds,
+                        gsl::span<const std::string> fetch_names, std::vector<OrtValue>& fetches) {
+  Status status;
+  ORT_TRY {
+    if (run_options) {
+      status = run_fn(*run_options, feed_names, feeds, fetch_names, fetches);
+    } else {
+      RunOptions default_run_options;
+      status = run_fn(default_run_options, feed_names, feeds, fetch_names, fetches);
+    }
+  }
+  ORT_CATCH(const std::exception& ex) {
+    ORT_HANDLE_EXCEPTION([&]() {
+      status = ORT_MAKE_STATUS(ONNXRUNTIME, RUNTIME_EXCEPTION, ex.what());
+    });
+  }
+  ORT_CATCH(...) {
+    status = ORT_MAKE_STATUS(ONNXRUNTIME, RUNTIME_EXCEPTION, "unknown exception");
+  }
+  return status;
+}
+
+void DynamicBatcher::RecordRun(gsl::span<const std::unique_ptr<Request>> batch, int64_t batch_size,
+                               const TimePoint& start_time) const {
+  uint64_t max_queue_delay_us = 0;
+  for (const auto& request : batch) {
+    max_queue_delay_us = std::max(max_queue_delay_us, static_cast<uint64_t>(
+                                                          std::chrono::duration_cast<std::chrono::microseconds>(
+                                                              request->dispatch_time - request->enqueue_time)
+                                                              .count()));
+  }
+  profiler_.EndTimeAndRecordEvent(profiling::SESSION_EVENT, "dynamic_batch_run", start_time,
+                                  {{"num_requests", std::to_string(batch.size())},
+                                   {"batch_size", std::to_string(batch_size)},
+                                   {"max_queue_delay_us", std::to_string(max_queue_delay_us)}});
+}
+
+void DynamicBatcher::RunBatch(std::vector<std::unique_ptr<Request>>& batch) {
+  TimePoint start_time;
+  if (profiler_.IsEnabled()) {
+    start_time = profiler_.Start();
+  }
+
+  if (batch.size() == 1) {
+    RunSingle(batch, &start_time);
+    return;
+  }
+
+  const auto& first = *batch.front();
+  std::vector<OrtValue> feeds;
+  std::vector<OrtValue> fetches;
+  std::vector<std::vector<OrtValue>> request_fetches;
+  Status status = ConcatFeeds(batch, feeds);
+  if (status.IsOK()) {
+    LOGS(logger_, VERBOSE) << "Running " << batch.size() << " requests with "
+                           << feeds.front().Get<Tensor>().Shape()[config_.batch_dim] << " samples as one batch";
+    status = InvokeRun(run_fn_, first.run_options, first.feed_names, feeds, first.fetch_names, fetches);
+  }
+  if (status.IsOK()) {
+    status = SplitFetches(batch, fetches, request_fetches);
+  }
+
+  if (!status.IsOK()) {
+    // only the requests of this batch fall back, later requests are still batched
+    LOGS(logger_, WARNING) << "Batched run of " << batch.size() << " requests failed, running them one by one. "
+                           << status.ErrorMessage();
+    for (size_t i = 0; i < batch.size(); ++i) {
+      RunSingle(gsl::make_span(batch).subspan(i, 1), nullptr);
+    }
+    return;
+  }
+
+  if (profiler_.IsEnabled()) {
+    RecordRun(batch, feeds.front().Get<Tensor>().Shape()[config_.batch_dim], start_time);
+  }
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    Complete(*batch[i], request_fetches[i], Status::OK());
+  }
+}
+
+void DynamicBatcher::RunSingle(gsl::span<const std::unique_ptr<Request>> batch, const TimePoint* start_time) {
+  Request& request = *batch.front();
+  std::vector<OrtValue> fetches;
+  Status status = InvokeRun(run_fn_, request.run_options, request.feed_names, request.feeds, request.fetch_names,
+                            fetches);
+  if (start_time != nullptr && profiler_.IsEnabled()) {
+    RecordRun(batch, request.batch_size, *start_time);
+  }
+  Complete(request, fetches, status);
+}
+
+Status DynamicBatcher::ConcatFeeds(gsl::span<const std::unique_ptr<Request>> batch,
+                                   std::vector<OrtValue>& feeds) const {
+  const auto& first = *batch.front();
+  int64_t batch_size = 0;
+  for (const auto& request : batch) {
+    batch_size += request->batch_size;
+  }
+
+  feeds.reserve(first.feeds.size());
+  for (size_t i = 0, end = first.feeds.size(); i < end; ++i) {
+    const auto& first_tensor = first.feeds[i].Get<Tensor>();
+    const auto& first_shape = first_tensor.Shape();
+    TensorShapeVector dims = first_shape.AsShapeVector();
+    dims[config_.batch_dim] = batch_size;
+
+    OrtValue& feed = feeds.emplace_back();
+    Tensor::InitOrtValue(first_tensor.DataType(), TensorShape(dims), cpu_allocator_, feed);
+    auto* dst = static_cast<uint8_t*>(feed.GetMutable<Tensor>()->MutableDataRaw());
+
+    // the slices of the requests alternate for every index of the dimensions outside of the batch dimension
+    const size_t outer_size = narrow<size_t>(first_shape.SizeToDimension(config_.batch_dim));
+    const size_t sample_bytes = SafeInt<size_t>(first_shape.SizeFromDimension(config_.batch_dim + 1)) *
+                                first_tensor.DataType()->Size();
+    for (size_t outer = 0; outer < outer_size; ++outer) {
+      for (const auto& request : batch) {
+        const size_t bytes = SafeInt<size_t>(request->batch_size) * sample_bytes;
+        const auto* src = static_cast<const uint8_t*>(request->feeds[i].Get<Tensor>().DataRaw());
+        memcpy(dst, src + outer * bytes, bytes);
+        dst += bytes;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status DynamicBatcher::SplitFetches(gsl::span<const std::unique_ptr<Request>> batch,
+                                    gsl::span<const OrtValue> fetches,
+                                    std::vector<std::vector<OrtValue>>& request_fetches) const {
+  const auto& first = *batch.front();
+  int64_t batch_size = 0;
+  for (const auto& request : batch) {
+    batch_size += request->batch_size;
+  }
+
+  request_fetches.resize(batch.size());
+  for (auto& values : request_fetches) {
+    values.reserve(fetches.size());
+  }
+  for (size_t i = 0, end = fetches.size(); i < end; ++i) {
+    const auto& fetch = fetches[i];
+    ORT_RETURN_IF_NOT(fetch.IsTensor(), "Output ", first.fetch_names[i], " is not a tensor.");
+    const auto& tensor = fetch.Get<Tensor>();
+    const auto& shape = tensor.Shape();
+    ORT_RETURN_IF(tensor.IsDataTypeString() || tensor.Location().device.Type() != OrtDevice::CPU,
+                  "Output ", first.fetch_names[i], " is not a numeric CPU tensor.");
+    ORT_RETURN_IF_NOT(shape.NumDimensions() > config_.batch_dim && shape[config_.batch_dim] == batch_size,
+                      "Output ", first.fetch_names[i], " with shape ", shape, " can't be split into ", batch.size(),
+                      " requests along dimension ", config_.batch_dim);
+
+    TensorShapeVector dims = shape.AsShapeVector();
+    InlinedVector<uint8_t*> dsts;
+    dsts.reserve(batch.size());
+    for (size_t r = 0; r < batch.size(); ++r) {
+      dims[config_.batch_dim] = batch[r]->batch_size;
+      OrtValue& value = request_fetches[r].emplace_back();
+      Tensor::InitOrtValue(tensor.DataType(), TensorShape(dims), cpu_allocator_, value);
+      dsts.push_back(static_cast<uint8_t*>(value.GetMutable<Tensor>()->MutableDataRaw()));
+    }
+
+    const size_t outer_size = narrow<size_t>(shape.SizeToDimension(config_.batch_dim));
+    const size_t sample_bytes = SafeInt<size_t>(shape.SizeFromDimension(config_.batch_dim + 1)) *
+                                tensor.DataType()->Size();
+    const auto* src = static_cast<const uint8_t*>(tensor.DataRaw());
+    for (size_t outer = 0; outer < outer_size; ++outer) {
+      for (size_t r = 0; r < batch.size(); ++r) {
+        const size_t bytes = SafeInt<size_t>(batch[r]->batch_size) * sample_bytes;
+        memcpy(dsts[r] + outer * bytes, src, bytes);
+        src += bytes;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+void DynamicBatcher::Complete(Request& request, std::vector<OrtValue>& fetches, const Status& status) {
+  const size_t num_fetches = status.IsOK() ? request.fetches.size() : 0;
+  for (size_t i = 0; i < num_fetches; ++i) {
+    request.fetches[i] = new OrtValue(std::move(fetches[i]));
+  }
+  request.callback(request.user_data, request.fetches.data(), num_fetches, ToOrtStatus(status));
+}
+
+}  // namespace onnxruntime
@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/common/inlined_containers.h"
+#include "core/common/logging/logging.h"
+#include "core/common/profiler.h"
+#include "core/framework/allocator.h"
+#include "core/framework/ort_value.h"
+#include "core/framework/run_options.h"
+#include "core/platform/threadpool.h"
+#include "core/session/onnxruntime_c_api.h"
+
+namespace onnxruntime {
+
+class NodeArg;
+
+/**
+Coalesces concurrent RunAsync requests into batched runs.
+
+Requests are queued and a dispatcher thread combines the ones with the same feeds, fetches and run options into a
+single run, concatenating the feeds along the batch dimension. The outputs are then split along the same dimension
+and handed to the callback of each request. The dispatcher waits at most max_delay after the oldest queued request
+for the batch to fill up, and a batch never grows past max_batch_size samples unless a single request is larger.
+
+Only requests with CPU tensor feeds and no preallocated fetches are batched, and only if all of their feeds and
+fetches are declared with the batch dimension, the caller runs any other request directly. Requests are combined
+only if their RunOptions are the same object or have the same settings, the run uses the RunOptions of the first
+request. Setting terminate on the RunOptions of another request once the batch runs does not stop the run.
+If a batched run fails, or its outputs can't be split along the batch dimension, its requests are run one by one.
+
+The dispatcher hands the batches to the thread pool, so that the next batch is formed and run while the previous one
+is still running. Without a thread pool with at least two threads the batches run one at a time on the dispatcher
+thread.
+
+Each run is recorded as a dynamic_batch_run event when profiling is enabled.
+*/
+class DynamicBatcher {
+ public:
+  struct Config {
+    size_t batch_dim = 0;
+    int64_t max_batch_size = 0;
+    std::chrono::microseconds max_delay{1000};
+    // model inputs and outputs whose declared shape has the batch dimension, see SetBatchedValues
+    InlinedHashSet<std::string> batched_inputs;
+    InlinedHashSet<std::string> batched_outputs;
+  };
+
+  // Sets the batched inputs and outputs of config to the ones whose declared shape has the symbolic dimension of the
+  // first such input at batch_dim. Outputs are split only along a dimension that is declared as the batch dimension.
+  static void SetBatchedValues(gsl::span<const NodeArg* const> inputs, gsl::span<const NodeArg* const> outputs,
+                               Config& config);
+
+  struct Stats {
+    uint64_t num_requests = 0;
+    uint64_t num_batches = 0;
+    // largest number of requests that were combined into one run
+    uint64_t max_requests_per_batch = 0;
+    // time between queuing a request and the start of its run
+    uint64_t total_queue_delay_us = 0;
+    uint64_t max_queue_delay_us = 0;
+  };
+
+  using RunFn = std::function<Status(const RunOptions& run_options,
+                                     gsl::span<const std::string> feed_names, gsl::span<const OrtValue> feeds,
+                                     gsl::span<const std::string> fetch_names, std::vector<OrtValue>& fetches)>;
+
+  DynamicBatcher(const Config& config, RunFn run_fn, AllocatorPtr cpu_allocator, concurrency::ThreadPool* thread_pool,
+                 profiling::Profiler& profiler, const logging::Logger& logger);
+
+  // Runs the requests that are still queued and waits for the running batches before returning.
+  ~DynamicBatcher();
+
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(DynamicBatcher);
+
+  // Queues the request, the callback is invoked from the dispatcher thread or the thread pool once it has run.
+  // Returns false, without taking ownership of anything, if the request can't be batched.
+  bool TryEnqueue(const RunOptions* run_options,
+                  gsl::span<const char* const> feed_names,
+                  gsl::span<const OrtValue* const> feeds,
+                  gsl::span<const char* const> fetch_names,
+                  gsl::span<OrtValue*> fetches,
+                  RunAsyncCallbackFn callback,
+                  void* user_data);
+
+  Stats GetStats() const;
+
+ private:
+  struct Request {
+    const RunOptions* run_options;
+    std::vector<std::string> feed_names;
+    std::vector<OrtValue> feeds;
+    std::vector<std::string> fetch_names;
+    gsl::span<OrtValue*> fetches;
+    RunAsyncCallbackFn callback;
+    void* user_data;
+    int64_t batch_size;
+    std::chrono::steady_clock::time_point enqueue_time;
+    std::chrono::steady_clock::time_point dispatch_time;
+  };
+
+  static bool HaveSameSettings(const RunOptions* first, const RunOptions* other);
+  bool CanBatch(const Request& first, const Request& other) const;
+  // Moves the requests that fit into a batch with the oldest request from the queue into batch.
+  void TakeBatch(std::vector<std::unique_ptr<Request>>& batch);
+  int64_t QueuedBatchSize() const;
+
+  void DispatchLoop();
+  void RunBatch(std::vector<std::unique_ptr<Request>>& batch);
+  void RecordRun(gsl::span<const std::unique_ptr<Request>> batch, int64_t batch_size,
+                 const TimePoint& start_time) const;
+  // Runs the request of a batch of one. The run is recorded by the profiler if start_time is given.
+  void RunSingle(gsl::span<const std::unique_ptr<Request>> batch, const TimePoint* start_time);
+  Status ConcatFeeds(gsl::span<const std::unique_ptr<Request>> batch, std::vector<OrtValue>& feeds) const;
+  Status SplitFetches(gsl::span<const std::unique_ptr<Request>> batch, gsl::span<const OrtValue> fetches,
+                      std::vector<std::vector<OrtValue>>& request_fetches) const;
+  static void Complete(Request& request, std::vector<OrtValue>& fetches, const Status& status);
+
+  const Config config_;
+  const RunFn run_fn_;
+  const AllocatorPtr cpu_allocator_;
+  concurrency::ThreadPool* const thread_pool_;
+  profiling::Profiler& profiler_;
+  const logging::Logger& logger_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<Request>> queue_;
+  bool shutdown_ = false;
+  // number of batches handed to the thread pool that have not completed yet
+  size_t running_batches_ = 0;
+  std::condition_variable batches_done_cv_;
+  Stats stats_;
+
+  std::thread dispatcher_;
+};
+
+}  // namespace onnxruntime
@@ -145,6 +145,7 @@ Status Environment::CreateAndRegisterAllocator(const OrtMemoryInfo& mem_info, co
     int max_dead_bytes_per_chunk = -1;
     int initial_growth_chunk_size_bytes = -1;
     int64_t max_power_of_two_extend_bytes = -1L;
+    int64_t size_class_cache_max_bytes = -1L;
 
     // override with values from the user supplied arena_cfg object
     if (arena_cfg) {
@@ -162,10 +163,12 @@ Status Environment::CreateAndRegisterAllocator(const OrtMemoryInfo& mem_info, co
       max_dead_bytes_per_chunk = arena_cfg->max_dead_bytes_per_chunk;
       initial_growth_chunk_size_bytes = arena_cfg->initial_growth_chunk_size_bytes;
       max_power_of_two_extend_bytes = arena_cfg->max_power_of_two_extend_bytes;
+      size_class_cache_max_bytes = arena_cfg->size_class_cache_max_bytes;
     }
 
     OrtArenaCfg l_arena_cfg{max_mem, arena_extend_strategy, initial_chunk_size_bytes, max_dead_bytes_per_chunk,
                             initial_growth_chunk_size_bytes, max_power_of_two_extend_bytes};
+    l_arena_cfg.size_class_cache_max_bytes = size_class_cache_max_bytes;
     AllocatorCreationInfo alloc_creation_info{
         [mem_info](int) { return std::make_unique<CPUAllocator>(mem_info); },
         0,
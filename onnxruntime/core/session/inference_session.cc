@@ -14,6 +14,7 @@
 #include "core/common/denormal.h"
 #include "core/common/logging/isink.h"
 #include "core/common/logging/logging.h"
+#include "core/common/narrow.h"
 #include "core/common/parse_string.h"
 #include "core/common/path_string.h"
 #include "core/common/string_utils.h"
@@ -445,6 +446,10 @@ void InferenceSession::ConstructorCommon(const SessionOptions& session_options,
         if (session_options_.config_options.TryGetConfigEntry(kOrtSessionOptionsConfigIntraOpThreadAffinities, to.affinity_str)) {
           ORT_ENFORCE(!to.affinity_str.empty(), "Affinity string must not be empty");
         }
+        if (session_options_.config_options.TryGetConfigEntry(kOrtSessionOptionsConfigIntraOpThreadNumaNodes,
+                                                              to.numa_node_str)) {
+          ORT_ENFORCE(!to.numa_node_str.empty(), "NUMA node string must not be empty");
+        }
         to.auto_set_affinity = to.thread_pool_size == 0 &&
                                session_options_.execution_mode == ExecutionMode::ORT_SEQUENTIAL &&
                                to.affinity_str.empty();
@@ -673,6 +678,8 @@ InferenceSession::InferenceSession(const SessionOptions& session_options, const
 #endif  // !defined(ORT_MINIMAL_BUILD)
 
 InferenceSession::~InferenceSession() {
+  dynamic_batcher_.reset();
+
   if (session_options_.enable_profiling) {
     ORT_TRY {
       EndProfiling();
@@ -1240,6 +1247,11 @@ common::Status InferenceSession::TransformGraph(onnxruntime::Graph& graph, bool
   GraphPartitioner partitioner(kernel_registry_manager_, execution_providers_, std::move(graph_optimizer_registry),
                                check_load_cancellation_fn_);
 
+  if (session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsParallelGraphTransformation, "0") == "1") {
+    auto* thread_pool = GetInterOpThreadPoolToUse();
+    graph_transformer_mgr_.SetThreadPool(thread_pool != nullptr ? thread_pool : GetIntraOpThreadPoolToUse());
+  }
+
   // Run Ahead Of time function inlining
   if (const bool disable_aot_function_inlining =
           session_options_.config_options.GetConfigOrDefault(
@@ -1780,6 +1792,31 @@ static void ResolveMemoryPatternFlags(SessionState& session_state) {
   }
 }
 
+// Register the nodes of the main graph and all subgraphs with a SamplingProfiler. The nodes of subgraphs are named
+// after the path of control flow nodes and attributes that leads to them, e.g. "loop/body/add".
+static void CollectSampledNodes(SessionState& session_state, const std::string& name_prefix,
+                                std::vector<profiling::SamplingProfiler::NodeInfo>& nodes) {
+  const auto& graph_viewer = session_state.GetGraphViewer();
+  const size_t offset = nodes.size();
+  session_state.SetSamplingProfilerNodeOffset(offset);
+  nodes.resize(offset + narrow<size_t>(graph_viewer.MaxNodeIndex()));
+
+  auto node_name = [&name_prefix](const Node& node) {
+    return name_prefix + (node.Name().empty() ? MakeString(node.OpType(), "_", node.Index()) : node.Name());
+  };
+  for (const auto& node : graph_viewer.Nodes()) {
+    nodes[offset + node.Index()] = {node_name(node), node.OpType()};
+  }
+
+  for (const auto& entry : session_state.GetSubgraphSessionStateMap()) {
+    const Node* node = graph_viewer.GetNode(entry.first);
+    for (const auto& name_to_subgraph_session_state : entry.second) {
+      CollectSampledNodes(*name_to_subgraph_session_state.second,
+                          MakeString(node_name(*node), "/", name_to_subgraph_session_state.first, "/"), nodes);
+    }
+  }
+}
+
 // This function is called when the session is being initialized.
 // For now, this function only checks for invalid combination of DML EP with other EPs.
 // TODO: extend this function to check for other invalid combinations of EPs.
@@ -1912,6 +1949,24 @@ common::Status InferenceSession::Initialize() {
       }
     }
 
+    if (auto* cpu_ep = execution_providers_.Get(kCpuExecutionProvider); cpu_ep != nullptr) {
+      auto* tuning_ctx = static_cast<CpuTuningContext*>(cpu_ep->GetTuningContext());
+      const auto& config_options = session_options_.config_options;
+      const bool enable_gemm_tuning = config_options.GetConfigOrDefault(kOrtSessionOptionsMlasGemmTuning, "0") == "1";
+      if (tuning_ctx != nullptr &&
+          (enable_gemm_tuning || config_options.GetConfigOrDefault(kOrtSessionOptionsMlasGemmTunableOp, "0") == "1")) {
+        // The MLAS tuning mode applies to the GEMMs run on the thread pool of this session only.
+        tuning_ctx->SetThreadPool(GetIntraOpThreadPoolToUse());
+        tuning_ctx->SetMaxTuningDurationMs(ParseStringWithClassicLocale<int>(
+            config_options.GetConfigOrDefault(kOrtSessionOptionsMlasGemmMaxTuningDurationMs, "0")));
+        if (enable_gemm_tuning) {
+          tuning_ctx->EnableTunableOpAndTuning();
+        } else {
+          tuning_ctx->EnableTunableOp();
+        }
+      }
+    }
+
 #if !defined(ORT_MINIMAL_BUILD)
     const std::string node_stats_file = session_options_.config_options.GetConfigOrDefault(
         kOrtSessionOptionsCollectNodeMemoryStatsToFile, "");
@@ -2256,6 +2311,52 @@ common::Status InferenceSession::Initialize() {
     // Resolve memory pattern flags of the main graph and subgraph session states
     ResolveMemoryPatternFlags(*session_state_);
 
+    const std::string mem_pattern_cache_file =
+        session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsMemoryPatternCacheFile, "");
+    if (!mem_pattern_cache_file.empty() && session_state_->GetEnableMemoryPattern()) {
+      std::filesystem::path mem_pattern_cache_path = mem_pattern_cache_file;
+      if (mem_pattern_cache_path.is_relative() && !model_location_.empty()) {
+        mem_pattern_cache_path = std::filesystem::path(model_location_).parent_path() / mem_pattern_cache_path;
+      }
+      ORT_RETURN_IF_ERROR_SESSIONID_(session_state_->LoadMemoryPatternCache(mem_pattern_cache_path));
+    }
+
+    const uint64_t profiling_sample_interval = ParseStringWithClassicLocale<uint64_t>(
+        session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsProfilingSampleInterval, "0"));
+    if (profiling_sample_interval > 0) {
+      const size_t ring_buffer_size = ParseStringWithClassicLocale<size_t>(
+          session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsProfilingRingBufferSize, "4096"));
+      const bool collect_node_stats =
+          session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsProfilingNodeStats, "0") == "1";
+      std::vector<profiling::SamplingProfiler::NodeInfo> nodes;
+      CollectSampledNodes(*session_state_, "", nodes);
+      sampling_profiler_ = std::make_unique<profiling::SamplingProfiler>(profiling_sample_interval, ring_buffer_size,
+                                                                         collect_node_stats, nodes);
+      session_state_->SetSamplingProfiler(sampling_profiler_.get());
+    }
+
+    const int64_t dynamic_batching_max_batch_size = ParseStringWithClassicLocale<int64_t>(
+        session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsDynamicBatchingMaxBatchSize, "0"));
+    if (dynamic_batching_max_batch_size > 1) {
+      DynamicBatcher::Config batcher_config;
+      batcher_config.max_batch_size = dynamic_batching_max_batch_size;
+      batcher_config.max_delay = std::chrono::microseconds(ParseStringWithClassicLocale<int64_t>(
+          session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsDynamicBatchingMaxDelayUs, "1000")));
+      batcher_config.batch_dim = ParseStringWithClassicLocale<size_t>(
+          session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsDynamicBatchingBatchDim, "0"));
+      DynamicBatcher::SetBatchedValues(model_->MainGraph().GetInputs(), model_->MainGraph().GetOutputs(),
+                                       batcher_config);
+      auto run_fn = [this](const RunOptions& run_options,
+                           gsl::span<const std::string> feed_names, gsl::span<const OrtValue> feeds,
+                           gsl::span<const std::string> fetch_names, std::vector<OrtValue>& fetches) {
+        return Run(run_options, feed_names, feeds, fetch_names, &fetches, nullptr);
+      };
+      dynamic_batcher_ = std::make_unique<DynamicBatcher>(batcher_config, std::move(run_fn),
+                                                          session_state_->GetAllocator(OrtDevice()),
+                                                          GetIntraOpThreadPoolToUse(), session_profiler_,
+                                                          *session_logger_);
+    }
+
     is_inited_ = true;
 
     if (!using_ort_model_bytes_for_initializers_) {
@@ -2966,6 +3067,11 @@ common::Status InferenceSession::RunAsync(const RunOptions* run_options,
                                           gsl::span<OrtValue*> fetches,
                                           RunAsyncCallbackFn callback,
                                           void* user_data) {
+  if (dynamic_batcher_ &&
+      dynamic_batcher_->TryEnqueue(run_options, feed_names, feeds, fetch_names, fetches, callback, user_data)) {
+    return Status::OK();
+  }
+
   size_t num_fetches = fetch_names.size();
   auto* tp = GetIntraOpThreadPoolToUse();
   if (!tp || concurrency::ThreadPool::DegreeOfParallelism(tp) < 2) {
@@ -3018,6 +3124,14 @@ common::Status InferenceSession::Run(const RunOptions& run_options, const NameML
   return Run(run_options, feed_names, feeds, output_names, p_fetches, nullptr);
 }
 
+bool InferenceSession::GetDynamicBatchingStats(DynamicBatcher::Stats& stats) const {
+  if (!dynamic_batcher_) {
+    return false;
+  }
+  stats = dynamic_batcher_->GetStats();
+  return true;
+}
+
 std::pair<common::Status, const ModelMetadata*> InferenceSession::GetModelMetadata() const {
   {
     std::lock_guard<std::mutex> l(session_mutex_);
@@ -14,6 +14,7 @@
 #include "core/common/logging/logging.h"
 #include "core/common/path_string.h"
 #include "core/common/profiler.h"
+#include "core/common/sampling_profiler.h"
 #include "core/common/status.h"
 #include "core/framework/execution_providers.h"
 #include "core/framework/framework_common.h"
@@ -30,6 +31,7 @@
 #include "core/optimizer/graph_transformer_level.h"
 #include "core/optimizer/graph_transformer_mgr.h"
 #include "core/optimizer/insert_cast_transformer.h"
+#include "core/session/dynamic_batcher.h"
 #include <mutex>
 #ifdef ENABLE_LANGUAGE_INTEROP_OPS
 #include "core/language_interop_ops/language_interop_ops.h"
@@ -522,6 +524,12 @@ class InferenceSession {
     */
   const profiling::Profiler& GetProfiling() const;
 
+  /**
+    * Return the continuous profiler enabled with kOrtSessionOptionsProfilingSampleInterval
+    @return the sampling profiler, or nullptr if continuous profiling is disabled
+    */
+  const profiling::SamplingProfiler* GetSamplingProfiler() const { return sampling_profiler_.get(); }
+
 #if !defined(ORT_MINIMAL_BUILD)
   /**
    * Get the TuningResults of TunableOp for every execution providers.
@@ -560,6 +568,12 @@ class InferenceSession {
    */
   const logging::Logger* GetLogger() const { return session_logger_; };
 
+  /**
+   * Gets the statistics of the batching of RunAsync requests.
+   * @return false if dynamic batching is not enabled for the session.
+   */
+  bool GetDynamicBatchingStats(DynamicBatcher::Stats& stats) const;
+
   const SessionState& GetSessionState() const {
     ORT_ENFORCE(session_state_ != nullptr, "Session must be initialized to create session state.");
     return *session_state_;
@@ -800,10 +814,18 @@ class InferenceSession {
   MemoryProfiler memory_profiler_;
 #endif
 
+  // Continuous profiling of sampled runs. Created at the end of Initialize when enabled, and referenced by
+  // session_state_ so it is declared before it.
+  std::unique_ptr<profiling::SamplingProfiler> sampling_profiler_;
+
   // Immutable state for each op in the model. Shared by all executors.
   // It has a dependency on execution_providers_.
   std::unique_ptr<SessionState> session_state_;
 
+  // Coalesces RunAsync requests when dynamic batching is enabled. Reset first on destruction as it runs the
+  // requests that are still queued.
+  std::unique_ptr<DynamicBatcher> dynamic_batcher_;
+
   // Threadpools per session. These are initialized and used for the entire duration of the session
   // when use_per_session_threads is true.
   std::basic_string<ORTCHAR_T> thread_pool_name_;
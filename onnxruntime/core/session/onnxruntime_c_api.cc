@@ -29,6 +29,7 @@
 #include "core/graph/graph.h"
 #include "core/graph/model_editor_api_types.h"
 #include "core/providers/get_execution_providers.h"
+#include "core/session/abi_key_value_pairs.h"
 #include "core/session/abi_session_options_impl.h"
 #include "core/session/allocator_adapters.h"
 #include "core/session/compile_api.h"
@@ -2225,6 +2226,42 @@ ORT_API_STATUS_IMPL(OrtApis::SessionGetProfilingStartTimeNs, _In_ const OrtSessi
   API_IMPL_END
 }
 
+ORT_API_STATUS_IMPL(OrtApis::SessionGetProfilingStats, _In_ const OrtSession* sess, _Outptr_ OrtKeyValuePairs** out) {
+  API_IMPL_BEGIN
+  const auto* session = reinterpret_cast<const ::onnxruntime::InferenceSession*>(sess);
+  std::unordered_map<std::string, std::string> stats;
+  if (const auto* sampling_profiler = session->GetSamplingProfiler(); sampling_profiler != nullptr) {
+    sampling_profiler->GetStats(stats);
+  }
+  auto kvp = std::make_unique<OrtKeyValuePairs>();
+  kvp->Copy(stats);
+  *out = reinterpret_cast<OrtKeyValuePairs*>(kvp.release());
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::SessionGetDynamicBatchingStats, _In_ const OrtSession* sess,
+                    _Outptr_ OrtKeyValuePairs** out) {
+  API_IMPL_BEGIN
+  const auto* session = reinterpret_cast<const ::onnxruntime::InferenceSession*>(sess);
+  std::unordered_map<std::string, std::string> stats;
+  ::onnxruntime::DynamicBatcher::Stats batching_stats;
+  if (session->GetDynamicBatchingStats(batching_stats)) {
+    const uint64_t mean_queue_delay_us =
+        batching_stats.num_requests == 0 ? 0 : batching_stats.total_queue_delay_us / batching_stats.num_requests;
+    stats["num_requests"] = std::to_string(batching_stats.num_requests);
+    stats["num_batches"] = std::to_string(batching_stats.num_batches);
+    stats["max_requests_per_batch"] = std::to_string(batching_stats.max_requests_per_batch);
+    stats["mean_queue_delay_us"] = std::to_string(mean_queue_delay_us);
+    stats["max_queue_delay_us"] = std::to_string(batching_stats.max_queue_delay_us);
+  }
+  auto kvp = std::make_unique<OrtKeyValuePairs>();
+  kvp->Copy(stats);
+  *out = reinterpret_cast<OrtKeyValuePairs*>(kvp.release());
+  return nullptr;
+  API_IMPL_END
+}
+
 // End support for non-tensor types
 
 ORT_API_STATUS_IMPL(OrtApis::CreateArenaCfg, _In_ size_t max_mem, int arena_extend_strategy, int initial_chunk_size_bytes,
@@ -2259,6 +2296,8 @@ ORT_API_STATUS_IMPL(OrtApis::CreateArenaCfgV2, _In_reads_(num_keys) const char*
       cfg->initial_growth_chunk_size_bytes = static_cast<int>(arena_config_values[i]);
     } else if (strcmp(arena_config_keys[i], "max_power_of_two_extend_bytes") == 0) {
       cfg->max_power_of_two_extend_bytes = static_cast<int64_t>(arena_config_values[i]);
+    } else if (strcmp(arena_config_keys[i], "size_class_cache_max_bytes") == 0) {
+      cfg->size_class_cache_max_bytes = static_cast<int64_t>(arena_config_values[i]);
     } else {
       std::ostringstream oss;
       oss << "Invalid key found: " << arena_config_keys[i];
@@ -3031,6 +3070,8 @@ static constexpr OrtApi ort_api_1_to_23 = {
     // End of Version 22 - DO NOT MODIFY ABOVE (see above text for more information)
     &OrtApis::GetTensorSizeInBytes,
     &OrtApis::AllocatorGetStats,
+    &OrtApis::SessionGetProfilingStats,
+    &OrtApis::SessionGetDynamicBatchingStats,
 };
 
 // OrtApiBase can never change as there is no way to know what version of OrtApiBase is returned by OrtGetApiBase.
@@ -22,6 +22,7 @@ std::ostream& operator<<(std::ostream& os, const OrtThreadPoolParams& params) {
   os << " dynamic_block_base_: " << params.dynamic_block_base_;
   os << " stack_size: " << params.stack_size;
   os << " affinity_str: " << params.affinity_str;
+  os << " numa_node_str: " << params.numa_node_str;
   // os << " name: " << (params.name ? params.name : L"nullptr");
   os << " set_denormal_as_zero: " << params.set_denormal_as_zero;
   // os << " custom_create_thread_fn: " << (params.custom_create_thread_fn ? "set" : "nullptr");
@@ -87,6 +88,40 @@ static std::vector<LogicalProcessors> ReadThreadAffinityConfig(const std::string
   }
   ORT_THROW("Failed to read affinities from affinity string");
 }
+
+// Extract the NUMA node of each thread from the numa node string.
+// Either "auto", in which case the node is looked up from the first logical processor of each affinity,
+// or a list of node ids in the same layout as the affinity string.
+// The returned vector has one entry per affinity, i.e. the main thread included.
+static std::vector<int> ReadThreadNumaNodeConfig(const Env& env, const std::string& numa_node_str,
+                                                 const std::vector<LogicalProcessors>& affinities,
+                                                 int thread_pool_size) {
+  std::vector<int> numa_nodes;
+  if (numa_node_str == "auto") {
+    if (affinities.empty()) {
+      LOGS_DEFAULT(WARNING) << "NUMA nodes cannot be inferred without thread affinities, "
+                            << "skip NUMA aware scheduling";
+      return numa_nodes;
+    }
+    numa_nodes.reserve(affinities.size());
+    for (const auto& affinity : affinities) {
+      numa_nodes.push_back(affinity.empty() ? -1 : env.GetNumaNodeId(affinity.front()));
+    }
+    return numa_nodes;
+  }
+
+  // placeholder for the main thread, matching the layout of the affinities
+  numa_nodes.push_back(-1);
+  for (const auto& node_str : utils::SplitString(numa_node_str, ";")) {
+    ORT_ENFORCE(!node_str.empty() && std::all_of(node_str.begin(), node_str.end(), ::isdigit),
+                std::string{"NUMA node id must consist of only digits: "} + std::string{node_str});
+    numa_nodes.push_back(std::stoi(std::string{node_str}));
+  }
+  ORT_ENFORCE(numa_nodes.size() == static_cast<size_t>(thread_pool_size),
+              "Number of NUMA nodes does not equal to thread_pool_size minus one, NUMA nodes: ",
+              numa_nodes.size() - 1, ", thread_pool_size: ", thread_pool_size);
+  return numa_nodes;
+}
 #endif
 
 static std::unique_ptr<ThreadPool>
@@ -145,6 +180,14 @@ CreateThreadPoolHelper(Env* env, OrtThreadPoolParams options) {
 #endif
   }
 
+  if (!options.numa_node_str.empty()) {
+#if defined(ORT_MINIMAL_BUILD) || defined(ORT_EXTENDED_MINIMAL_BUILD)
+    ORT_THROW("Setting thread NUMA nodes is not implemented in this build.");
+#else
+    to.numa_nodes = ReadThreadNumaNodeConfig(*env, options.numa_node_str, to.affinities, options.thread_pool_size);
+#endif
+  }
+
   to.set_denormal_as_zero = options.set_denormal_as_zero;
   // set custom thread management members
   to.custom_create_thread_fn = options.custom_create_thread_fn;
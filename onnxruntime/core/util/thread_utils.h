@@ -37,6 +37,13 @@ struct OrtThreadPoolParams {
   // meaning ith thread will be attached to first 8 logical processors
   std::string affinity_str;
 
+  // A utf-8 string describing the NUMA node of each thread, same layout as affinity_str:
+  // <1st_thread_numa_node>;<2nd_thread_numa_node>;...
+  // e.g. "0;0;0;1;1;1;1" for a pool of 8 threads (the main thread is not listed).
+  // "auto" asks the OS for the node of each thread's affinity, which requires affinities to be set.
+  // When the threads span more than one node, work is scheduled and stolen within a node first.
+  std::string numa_node_str;
+
   const ORTCHAR_T* name = nullptr;
 
   // Set or unset denormal as zero
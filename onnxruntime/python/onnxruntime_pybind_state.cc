@@ -2022,6 +2022,8 @@ for model inference.)pbdoc");
             ort_arena_cfg->initial_growth_chunk_size_bytes = kvp.second.cast<int>();
           } else if (key == "max_power_of_two_extend_bytes") {
             ort_arena_cfg->max_power_of_two_extend_bytes = kvp.second.cast<int>();
+          } else if (key == "size_class_cache_max_bytes") {
+            ort_arena_cfg->size_class_cache_max_bytes = kvp.second.cast<int64_t>();
           } else {
             ORT_THROW("Invalid OrtArenaCfg option: ", key);
           }
@@ -2033,7 +2035,8 @@ for model inference.)pbdoc");
       .def_readwrite("initial_chunk_size_bytes", &OrtArenaCfg::initial_chunk_size_bytes)
       .def_readwrite("max_dead_bytes_per_chunk", &OrtArenaCfg::max_dead_bytes_per_chunk)
       .def_readwrite("initial_growth_chunk_size_bytes", &OrtArenaCfg::initial_growth_chunk_size_bytes)
-      .def_readwrite("max_power_of_two_extend_bytes", &OrtArenaCfg::max_power_of_two_extend_bytes);
+      .def_readwrite("max_power_of_two_extend_bytes", &OrtArenaCfg::max_power_of_two_extend_bytes)
+      .def_readwrite("size_class_cache_max_bytes", &OrtArenaCfg::size_class_cache_max_bytes);
 
   py::class_<OrtMemoryInfo> ort_memory_info_binding(m, "OrtMemoryInfo");
   ort_memory_info_binding.def(py::init([](const char* name, OrtAllocatorType type, int id, OrtMemType mem_type) {
@@ -0,0 +1,193 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/common/sampling_profiler.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace profiling {
+namespace test {
+
+TEST(LatencyHistogramTest, BucketBoundaries) {
+  for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+    const size_t index = LatencyHistogram::BucketIndex(value);
+    ASSERT_LT(index, LatencyHistogram::kNumBuckets);
+    EXPECT_GE(LatencyHistogram::BucketUpperBound(index), value);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::BucketUpperBound(index - 1), value);
+    }
+  }
+  EXPECT_EQ(LatencyHistogram::BucketIndex(~0ull), LatencyHistogram::kNumBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.ValueAtPercentile(50.0), 0u);
+
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.Record(value * 1000);
+  }
+  EXPECT_EQ(histogram.Count(), 1000u);
+  EXPECT_EQ(histogram.Sum(), 500500u * 1000);
+  EXPECT_EQ(histogram.Max(), 1000000u);
+  EXPECT_EQ(histogram.ValueAtPercentile(100.0), 1000000u);
+
+  // the relative error is bounded by the width of a bucket
+  for (double percentile : {1.0, 50.0, 90.0, 99.0}) {
+    const double expected = percentile * 10000;
+    const auto value = static_cast<double>(histogram.ValueAtPercentile(percentile));
+    EXPECT_GE(value, expected);
+    EXPECT_LE(value, expected * (1.0 + 1.0 / LatencyHistogram::kSubBuckets));
+  }
+}
+
+static NodeExecutionMeasurement Measurement(std::chrono::nanoseconds duration) {
+  NodeExecutionMeasurement measurement;
+  measurement.start = std::chrono::steady_clock::now();
+  measurement.duration = duration;
+  return measurement;
+}
+
+TEST(SamplingProfilerTest, SampleInterval) {
+  SamplingProfiler profiler(3, 0, false, {{"matmul", "MatMul"}});
+  std::vector<bool> sampled;
+  for (int i = 0; i < 7; ++i) {
+    sampled.push_back(profiler.ShouldSampleRun());
+  }
+  EXPECT_EQ(sampled, (std::vector<bool>{true, false, false, true, false, false, true}));
+
+  std::unordered_map<std::string, std::string> stats;
+  profiler.GetStats(stats);
+  EXPECT_EQ(stats["sample_interval"], "3");
+  EXPECT_EQ(stats["sampled_runs"], "3");
+  EXPECT_EQ(stats["run.count"], "0");
+  EXPECT_EQ(stats.count("op.MatMul.count"), 0u) << "op types that were not executed are not reported";
+}
+
+TEST(SamplingProfilerTest, OpTypeStats) {
+  // position 2 does not hold a node, e.g. because it was removed from the graph
+  SamplingProfiler profiler(1, 16, false, {{"matmul_0", "MatMul"}, {"add", "Add"}, {"", ""}, {"matmul_1", "MatMul"}});
+  auto matmul_0 = Measurement(std::chrono::microseconds(10));
+  matmul_0.bytes_allocated = 100;
+  matmul_0.parallel_loops = 2;
+  matmul_0.requested_parallelism = 8;
+  matmul_0.achieved_parallelism = 6;
+  auto matmul_1 = Measurement(std::chrono::microseconds(30));
+  matmul_1.bytes_allocated = 300;
+  profiler.RecordNodeEvent(0, matmul_0);
+  profiler.RecordNodeEvent(3, matmul_1);
+  profiler.RecordNodeEvent(1, Measurement(std::chrono::microseconds(5)));
+  profiler.RecordRun(std::chrono::microseconds(50));
+
+  std::unordered_map<std::string, std::string> stats;
+  profiler.GetStats(stats);
+  EXPECT_EQ(stats["run.count"], "1");
+  EXPECT_EQ(std::stod(stats["run.max_us"]), 50.0);
+  EXPECT_EQ(stats["op.MatMul.count"], "2");
+  EXPECT_EQ(std::stod(stats["op.MatMul.mean_us"]), 20.0);
+  EXPECT_EQ(std::stod(stats["op.MatMul.max_us"]), 30.0);
+  EXPECT_EQ(stats["op.MatMul.mean_bytes_allocated"], "200");
+  EXPECT_EQ(stats["op.MatMul.parallel_loops"], "2");
+  EXPECT_EQ(std::stod(stats["op.MatMul.mean_requested_parallelism"]), 4.0);
+  EXPECT_EQ(std::stod(stats["op.MatMul.mean_achieved_parallelism"]), 3.0);
+  EXPECT_EQ(stats["op.Add.count"], "1");
+  EXPECT_EQ(stats["op.Add.parallel_loops"], "0");
+  EXPECT_EQ(stats.count("op.Add.mean_achieved_parallelism"), 0u);
+  EXPECT_EQ(stats.count("node.matmul_0.count"), 0u) << "node stats are not collected";
+
+  const auto events = profiler.GetRecentEvents();
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[0].node_name, "matmul_0");
+  EXPECT_EQ(events[0].op_type, "MatMul");
+  EXPECT_EQ(events[1].node_name, "matmul_1");
+  EXPECT_EQ(events[1].duration_ns, 30000);
+  EXPECT_EQ(events[2].op_type, "Add");
+}
+
+TEST(SamplingProfilerTest, NodeStats) {
+  SamplingProfiler profiler(1, 0, true, {{"matmul_0", "MatMul"}, {"matmul_1", "MatMul"}, {"loop/body/add", "Add"}});
+  EXPECT_TRUE(profiler.CollectsNodeStats());
+  auto matmul_0 = Measurement(std::chrono::microseconds(10));
+  matmul_0.bytes_allocated = 64;
+  profiler.RecordNodeEvent(0, matmul_0);
+  profiler.RecordNodeEvent(0, matmul_0);
+  profiler.RecordNodeEvent(1, Measurement(std::chrono::microseconds(40)));
+
+  std::unordered_map<std::string, std::string> stats;
+  profiler.GetStats(stats);
+  EXPECT_EQ(stats["op.MatMul.count"], "3");
+  EXPECT_EQ(stats["node.matmul_0.count"], "2");
+  EXPECT_EQ(std::stod(stats["node.matmul_0.p99_us"]), 10.0);
+  EXPECT_EQ(stats["node.matmul_0.mean_bytes_allocated"], "64");
+  EXPECT_EQ(stats["node.matmul_1.count"], "1");
+  EXPECT_EQ(stats["node.matmul_1.mean_bytes_allocated"], "0");
+  EXPECT_EQ(stats.count("node.loop/body/add.count"), 0u) << "nodes that were not executed are not reported";
+  EXPECT_TRUE(profiler.GetRecentEvents().empty());
+}
+
+TEST(SamplingProfilerTest, RingBufferWrapsAround) {
+  std::vector<SamplingProfiler::NodeInfo> nodes;
+  for (int i = 0; i < 10; ++i) {
+    nodes.push_back({"relu_" + std::to_string(i), "Relu"});
+  }
+  SamplingProfiler profiler(1, 4, false, nodes);
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    profiler.RecordNodeEvent(i, Measurement(std::chrono::nanoseconds(i)));
+  }
+
+  const auto events = profiler.GetRecentEvents();
+  ASSERT_EQ(events.size(), 4u);
+  for (size_t i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(events[i].node_name, nodes[6 + i].name);
+  }
+
+  std::unordered_map<std::string, std::string> stats;
+  profiler.GetStats(stats);
+  EXPECT_EQ(stats["op.Relu.count"], "10") << "the histograms aggregate all events";
+}
+
+TEST(SamplingProfilerTest, ConcurrentRecording) {
+  constexpr size_t kNumThreads = 4;
+  constexpr size_t kNumEvents = 10000;
+  std::vector<SamplingProfiler::NodeInfo> nodes;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    nodes.push_back({"conv_" + std::to_string(t), "Conv"});
+  }
+  SamplingProfiler profiler(1, 64, true, nodes);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&profiler, t]() {
+      const auto measurement = Measurement(std::chrono::nanoseconds(100));
+      for (size_t i = 0; i < kNumEvents; ++i) {
+        profiler.RecordNodeEvent(t, measurement);
+      }
+    });
+  }
+  // reading while the threads record must not return torn events
+  for (int i = 0; i < 100; ++i) {
+    for (const auto& event : profiler.GetRecentEvents()) {
+      ASSERT_EQ(event.op_type, "Conv");
+      ASSERT_EQ(event.duration_ns, 100);
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::unordered_map<std::string, std::string> stats;
+  profiler.GetStats(stats);
+  EXPECT_EQ(stats["op.Conv.count"], std::to_string(kNumThreads * kNumEvents));
+  EXPECT_EQ(stats["node.conv_0.count"], std::to_string(kNumEvents));
+  EXPECT_EQ(profiler.GetRecentEvents().size(), 64u);
+}
+
+}  // namespace test
+}  // namespace profiling
+}  // namespace onnxruntime
@@ -0,0 +1,463 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "test/common/tensor_op_test_utils.h"
+#include "test/providers/provider_test_utils.h"
+#include "test/util/include/default_providers.h"
+
+namespace onnxruntime {
+namespace test {
+
+// Quantizes a value of the k-v cache as MlasQuantizeKVCache does.
+static int QuantizeKVCacheValue(float value, float scale, int bit_width) {
+  const float maximum = bit_width == 4 ? 7.f : 127.f;
+  return static_cast<int>(std::clamp(std::nearbyint(value / scale), -maximum - 1.f, maximum));
+}
+
+// Causal attention of the new tokens, the last sequence_length positions of the k-v cache, over the cache.
+// query is (batch_size, sequence_length, num_heads * head_size), the caches are dequantized and
+// (batch_size, kv_num_heads, total_sequence_length, head_size).
+static std::vector<float> ReferenceGroupQueryAttention(const std::vector<float>& query,
+                                                       const std::vector<float>& key_cache,
+                                                       const std::vector<float>& value_cache,
+                                                       int batch_size, int sequence_length, int total_sequence_length,
+                                                       int num_heads, int kv_num_heads, int head_size) {
+  const int hidden_size = num_heads * head_size;
+  const int past_sequence_length = total_sequence_length - sequence_length;
+  const float scale = 1.f / std::sqrt(static_cast<float>(head_size));
+  std::vector<float> output(static_cast<size_t>(batch_size) * sequence_length * hidden_size, 0.f);
+  for (int b = 0; b < batch_size; ++b) {
+    for (int s = 0; s < sequence_length; ++s) {
+      for (int h = 0; h < num_heads; ++h) {
+        const int kv_head = h / (num_heads / kv_num_heads);
+        const size_t cache_offset = (static_cast<size_t>(b) * kv_num_heads + kv_head) * total_sequence_length *
+                                    head_size;
+        const float* q = query.data() + (static_cast<size_t>(b) * sequence_length + s) * hidden_size + h * head_size;
+        const int attended = past_sequence_length + s + 1;
+        std::vector<float> scores(attended);
+        float max_score = -INFINITY;
+        for (int t = 0; t < attended; ++t) {
+          const float* k = key_cache.data() + cache_offset + static_cast<size_t>(t) * head_size;
+          float dot = 0.f;
+          for (int d = 0; d < head_size; ++d) dot += q[d] * k[d];
+          scores[t] = dot * scale;
+          max_score = std::max(max_score, scores[t]);
+        }
+        float sum = 0.f;
+        for (float& score : scores) {
+          score = std::exp(score - max_score);
+          sum += score;
+        }
+        float* out = output.data() + (static_cast<size_t>(b) * sequence_length + s) * hidden_size + h * head_size;
+        for (int t = 0; t < attended; ++t) {
+          const float* v = value_cache.data() + cache_offset + static_cast<size_t>(t) * head_size;
+          for (int d = 0; d < head_size; ++d) out[d] += scores[t] / sum * v[d];
+        }
+      }
+    }
+  }
+  return output;
+}
+
+// A right padded prompt with a paged k-v cache. Only the tokens of each sequence are written to its pages, so
+// the pages that are not in use by the sequence, here page 0 which the block table of the second sequence
+// points to after its last used page, keep their content.
+TEST(GroupQueryAttentionTest, PagedKVCacheRightPaddedPrompt) {
+  constexpr int batch_size = 2;
+  constexpr int sequence_length = 4;
+  constexpr int num_heads = 2;
+  constexpr int kv_num_heads = 1;
+  constexpr int head_size = 4;
+  constexpr int page_size = 2;
+  constexpr int max_pages_per_sequence = 2;
+  constexpr int num_pages = 5;
+  constexpr int hidden_size = num_heads * head_size;
+  constexpr int kv_hidden_size = kv_num_heads * head_size;
+  constexpr int page_elements = kv_num_heads * page_size * head_size;
+
+  const std::vector<int32_t> seqlens_k = {3, 1};  // the second sequence has 2 tokens followed by 2 padding tokens
+  const std::vector<int32_t> block_table = {1, 2,
+                                            3, 0};
+
+  std::vector<float> query(batch_size * sequence_length * hidden_size);
+  std::vector<float> key(batch_size * sequence_length * kv_hidden_size);
+  std::vector<float> value(batch_size * sequence_length * kv_hidden_size);
+  for (size_t i = 0; i < query.size(); ++i) query[i] = std::sin(0.37f * static_cast<float>(i));
+  for (size_t i = 0; i < key.size(); ++i) key[i] = std::cos(0.53f * static_cast<float>(i));
+  for (size_t i = 0; i < value.size(); ++i) value[i] = std::sin(0.71f * static_cast<float>(i) + 1.f);
+
+  std::vector<float> past_key(num_pages * page_elements);
+  std::vector<float> past_value(num_pages * page_elements);
+  for (size_t i = 0; i < past_key.size(); ++i) {
+    past_key[i] = 100.f + static_cast<float>(i);
+    past_value[i] = -100.f - static_cast<float>(i);
+  }
+
+  // The expected pools hold the past pages with the tokens of each sequence written through its block table.
+  std::vector<float> present_key = past_key;
+  std::vector<float> present_value = past_value;
+  for (int b = 0; b < batch_size; ++b) {
+    for (int s = 0; s <= seqlens_k[b]; ++s) {
+      const int page = block_table[b * max_pages_per_sequence + s / page_size];
+      for (int d = 0; d < head_size; ++d) {
+        const size_t cache_index = (static_cast<size_t>(page) * page_size + s % page_size) * head_size + d;
+        const size_t input_index = (static_cast<size_t>(b) * sequence_length + s) * kv_hidden_size + d;
+        present_key[cache_index] = key[input_index];
+        present_value[cache_index] = value[input_index];
+      }
+    }
+  }
+
+  // Causal attention over the tokens of each sequence, for the rows that are not padding.
+  std::vector<float> expected_output(batch_size * sequence_length * hidden_size, 0.f);
+  const float scale = 1.f / std::sqrt(static_cast<float>(head_size));
+  for (int b = 0; b < batch_size; ++b) {
+    for (int s = 0; s <= seqlens_k[b]; ++s) {
+      for (int h = 0; h < num_heads; ++h) {
+        const float* q = query.data() + (static_cast<size_t>(b) * sequence_length + s) * hidden_size + h * head_size;
+        std::vector<float> scores(s + 1);
+        float max_score = -INFINITY;
+        for (int t = 0; t <= s; ++t) {
+          const float* k = key.data() + (static_cast<size_t>(b) * sequence_length + t) * kv_hidden_size;
+          float dot = 0.f;
+          for (int d = 0; d < head_size; ++d) dot += q[d] * k[d];
+          scores[t] = dot * scale;
+          max_score = std::max(max_score, scores[t]);
+        }
+        float sum = 0.f;
+        for (float& score : scores) {
+          score = std::exp(score - max_score);
+          sum += score;
+        }
+        float* out = expected_output.data() + (static_cast<size_t>(b) * sequence_length + s) * hidden_size +
+                     h * head_size;
+        for (int t = 0; t <= s; ++t) {
+          const float* v = value.data() + (static_cast<size_t>(b) * sequence_length + t) * kv_hidden_size;
+          for (int d = 0; d < head_size; ++d) out[d] += scores[t] / sum * v[d];
+        }
+      }
+    }
+  }
+
+  OpTester test("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<int64_t>("num_heads", num_heads);
+  test.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+
+  const std::vector<int64_t> pool_shape = {num_pages, kv_num_heads, page_size, head_size};
+  test.AddInput<float>("query", {batch_size, sequence_length, hidden_size}, query);
+  test.AddInput<float>("key", {batch_size, sequence_length, kv_hidden_size}, key);
+  test.AddInput<float>("value", {batch_size, sequence_length, kv_hidden_size}, value);
+  test.AddInput<float>("past_key", pool_shape, past_key);
+  test.AddInput<float>("past_value", pool_shape, past_value);
+  test.AddInput<int32_t>("seqlens_k", {batch_size}, seqlens_k);
+  test.AddInput<int32_t>("total_sequence_length", {1}, {sequence_length});
+  test.AddOptionalInputEdge<float>();    // cos_cache
+  test.AddOptionalInputEdge<float>();    // sin_cache
+  test.AddOptionalInputEdge<int64_t>();  // position_ids
+  test.AddOptionalInputEdge<float>();    // attention_bias
+  test.AddOptionalInputEdge<float>();    // k_scale
+  test.AddOptionalInputEdge<float>();    // v_scale
+  test.AddInput<int32_t>("block_table", {batch_size, max_pages_per_sequence}, block_table);
+
+  test.AddOutput<float>("output", {batch_size, sequence_length, hidden_size}, expected_output);
+  test.AddOutput<float>("present_key", pool_shape, present_key);
+  test.AddOutput<float>("present_value", pool_shape, present_value);
+
+  // The output rows of the padding tokens are unspecified, so only the rows of the tokens are compared.
+  test.SetCustomOutputVerifier([&](const std::vector<OrtValue>& fetches, const std::string& /*provider_type*/) {
+    ASSERT_EQ(fetches.size(), 3u);
+    const float* output = fetches[0].Get<Tensor>().Data<float>();
+    for (int b = 0; b < batch_size; ++b) {
+      for (int s = 0; s <= seqlens_k[b]; ++s) {
+        for (int i = 0; i < hidden_size; ++i) {
+          const size_t index = (static_cast<size_t>(b) * sequence_length + s) * hidden_size + i;
+          EXPECT_NEAR(output[index], expected_output[index], 1e-4f) << "batch " << b << " token " << s;
+        }
+      }
+    }
+
+    const float* key_pool = fetches[1].Get<Tensor>().Data<float>();
+    const float* value_pool = fetches[2].Get<Tensor>().Data<float>();
+    for (size_t i = 0; i < present_key.size(); ++i) {
+      EXPECT_EQ(key_pool[i], present_key[i]) << "present_key element " << i;
+      EXPECT_EQ(value_pool[i], present_value[i]) << "present_value element " << i;
+    }
+  });
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  test.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+}
+
+// Decoding a token with a past int8 cache. The new K and V are quantized when they are appended to the present
+// cache, and the whole cache is dequantized when it is read. K has a single scale and V a scale per channel.
+TEST(GroupQueryAttentionTest, QuantizedKVCacheInt8Decode) {
+  constexpr int batch_size = 2;
+  constexpr int sequence_length = 1;
+  constexpr int past_sequence_length = 3;
+  constexpr int total_sequence_length = past_sequence_length + sequence_length;
+  constexpr int num_heads = 4;
+  constexpr int kv_num_heads = 2;
+  constexpr int head_size = 8;
+  constexpr int hidden_size = num_heads * head_size;
+  constexpr int kv_hidden_size = kv_num_heads * head_size;
+
+  std::vector<float> query(batch_size * sequence_length * hidden_size);
+  std::vector<float> key(batch_size * sequence_length * kv_hidden_size);
+  std::vector<float> value(batch_size * sequence_length * kv_hidden_size);
+  for (size_t i = 0; i < query.size(); ++i) query[i] = std::sin(0.37f * static_cast<float>(i));
+  for (size_t i = 0; i < key.size(); ++i) key[i] = std::cos(0.53f * static_cast<float>(i));
+  for (size_t i = 0; i < value.size(); ++i) value[i] = std::sin(0.71f * static_cast<float>(i) + 1.f);
+
+  std::vector<int8_t> past_key(batch_size * kv_num_heads * past_sequence_length * head_size);
+  std::vector<int8_t> past_value(batch_size * kv_num_heads * past_sequence_length * head_size);
+  for (size_t i = 0; i < past_key.size(); ++i) {
+    past_key[i] = static_cast<int8_t>(static_cast<int>(i * 37 % 101) - 50);
+    past_value[i] = static_cast<int8_t>(static_cast<int>(i * 53 % 121) - 60);
+  }
+
+  const std::vector<float> k_scale = {0.02f};
+  std::vector<float> v_scale(kv_hidden_size);
+  for (int c = 0; c < kv_hidden_size; ++c) v_scale[c] = 0.01f + 0.001f * static_cast<float>(c);
+
+  // The present cache holds the past tokens followed by the quantized new token.
+  const size_t present_size = static_cast<size_t>(batch_size) * kv_num_heads * total_sequence_length * head_size;
+  std::vector<int8_t> present_key(present_size);
+  std::vector<int8_t> present_value(present_size);
+  std::vector<float> key_cache(present_size);
+  std::vector<float> value_cache(present_size);
+  for (int b = 0; b < batch_size; ++b) {
+    for (int n = 0; n < kv_num_heads; ++n) {
+      for (int t = 0; t < total_sequence_length; ++t) {
+        for (int d = 0; d < head_size; ++d) {
+          const int channel = n * head_size + d;
+          const size_t index = ((static_cast<size_t>(b) * kv_num_heads + n) * total_sequence_length + t) * head_size + d;
+          if (t < past_sequence_length) {
+            const size_t past_index =
+                ((static_cast<size_t>(b) * kv_num_heads + n) * past_sequence_length + t) * head_size + d;
+            present_key[index] = past_key[past_index];
+            present_value[index] = past_value[past_index];
+          } else {
+            const size_t input_index =
+                (static_cast<size_t>(b) * sequence_length + t - past_sequence_length) * kv_hidden_size + channel;
+            present_key[index] = static_cast<int8_t>(QuantizeKVCacheValue(key[input_index], k_scale[0], 8));
+            present_value[index] = static_cast<int8_t>(QuantizeKVCacheValue(value[input_index], v_scale[channel], 8));
+          }
+          key_cache[index] = static_cast<float>(present_key[index]) * k_scale[0];
+          value_cache[index] = static_cast<float>(present_value[index]) * v_scale[channel];
+        }
+      }
+    }
+  }
+
+  const std::vector<float> expected_output = ReferenceGroupQueryAttention(
+      query, key_cache, value_cache, batch_size, sequence_length, total_sequence_length, num_heads, kv_num_heads,
+      head_size);
+
+  OpTester test("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<int64_t>("num_heads", num_heads);
+  test.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+  test.AddAttribute<std::string>("k_quant_type", "PER_TENSOR");
+  test.AddAttribute<std::string>("v_quant_type", "PER_CHANNEL");
+  test.AddAttribute<int64_t>("kv_cache_bit_width", 8);
+
+  test.AddInput<float>("query", {batch_size, sequence_length, hidden_size}, query);
+  test.AddInput<float>("key", {batch_size, sequence_length, kv_hidden_size}, key);
+  test.AddInput<float>("value", {batch_size, sequence_length, kv_hidden_size}, value);
+  test.AddInput<int8_t>("past_key", {batch_size, kv_num_heads, past_sequence_length, head_size}, past_key);
+  test.AddInput<int8_t>("past_value", {batch_size, kv_num_heads, past_sequence_length, head_size}, past_value);
+  test.AddInput<int32_t>("seqlens_k", {batch_size}, {total_sequence_length - 1, total_sequence_length - 1});
+  test.AddInput<int32_t>("total_sequence_length", {1}, {total_sequence_length});
+  test.AddOptionalInputEdge<float>();    // cos_cache
+  test.AddOptionalInputEdge<float>();    // sin_cache
+  test.AddOptionalInputEdge<int64_t>();  // position_ids
+  test.AddOptionalInputEdge<float>();    // attention_bias
+  test.AddInput<float>("k_scale", {1}, k_scale);
+  test.AddInput<float>("v_scale", {kv_hidden_size}, v_scale);
+
+  test.AddOutput<float>("output", {batch_size, sequence_length, hidden_size}, expected_output, false, 0.f, 1e-4f);
+  test.AddOutput<int8_t>("present_key", {batch_size, kv_num_heads, total_sequence_length, head_size}, present_key);
+  test.AddOutput<int8_t>("present_value", {batch_size, kv_num_heads, total_sequence_length, head_size},
+                         present_value);
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  test.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+}
+
+// A prompt with an int4 cache and a scale per head. Two int4 values are packed in each byte of the present cache,
+// and values beyond the int4 range are clamped.
+TEST(GroupQueryAttentionTest, QuantizedKVCacheInt4Prompt) {
+  constexpr int batch_size = 1;
+  constexpr int sequence_length = 3;
+  constexpr int num_heads = 4;
+  constexpr int kv_num_heads = 2;
+  constexpr int head_size = 4;
+  constexpr int hidden_size = num_heads * head_size;
+  constexpr int kv_hidden_size = kv_num_heads * head_size;
+
+  std::vector<float> query(batch_size * sequence_length * hidden_size);
+  std::vector<float> key(batch_size * sequence_length * kv_hidden_size);
+  std::vector<float> value(batch_size * sequence_length * kv_hidden_size);
+  for (size_t i = 0; i < query.size(); ++i) query[i] = std::sin(0.37f * static_cast<float>(i));
+  for (size_t i = 0; i < key.size(); ++i) key[i] = std::cos(0.53f * static_cast<float>(i));
+  for (size_t i = 0; i < value.size(); ++i) value[i] = std::sin(0.71f * static_cast<float>(i) + 1.f);
+
+  const std::vector<float> k_scale = {0.15f, 0.2f};
+  const std::vector<float> v_scale = {0.12f, 0.25f};
+
+  const size_t present_size = static_cast<size_t>(batch_size) * kv_num_heads * sequence_length * head_size;
+  std::vector<uint8_t> present_key(present_size / 2);
+  std::vector<uint8_t> present_value(present_size / 2);
+  std::vector<float> key_cache(present_size);
+  std::vector<float> value_cache(present_size);
+  for (int n = 0; n < kv_num_heads; ++n) {
+    for (int t = 0; t < sequence_length; ++t) {
+      for (int d = 0; d < head_size; ++d) {
+        const size_t index = (static_cast<size_t>(n) * sequence_length + t) * head_size + d;
+        const size_t input_index = static_cast<size_t>(t) * kv_hidden_size + n * head_size + d;
+        const int quantized_key = QuantizeKVCacheValue(key[input_index], k_scale[n], 4);
+        const int quantized_value = QuantizeKVCacheValue(value[input_index], v_scale[n], 4);
+        // the even channel is in the low nibble
+        const int shift = (d % 2) * 4;
+        present_key[index / 2] |= static_cast<uint8_t>((quantized_key & 0x0F) << shift);
+        present_value[index / 2] |= static_cast<uint8_t>((quantized_value & 0x0F) << shift);
+        key_cache[index] = static_cast<float>(quantized_key) * k_scale[n];
+        value_cache[index] = static_cast<float>(quantized_value) * v_scale[n];
+      }
+    }
+  }
+
+  const std::vector<float> expected_output = ReferenceGroupQueryAttention(
+      query, key_cache, value_cache, batch_size, sequence_length, sequence_length, num_heads, kv_num_heads,
+      head_size);
+
+  OpTester test("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<int64_t>("num_heads", num_heads);
+  test.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+  test.AddAttribute<std::string>("k_quant_type", "PER_HEAD");
+  test.AddAttribute<std::string>("v_quant_type", "PER_HEAD");
+  test.AddAttribute<int64_t>("kv_cache_bit_width", 4);
+
+  test.AddInput<float>("query", {batch_size, sequence_length, hidden_size}, query);
+  test.AddInput<float>("key", {batch_size, sequence_length, kv_hidden_size}, key);
+  test.AddInput<float>("value", {batch_size, sequence_length, kv_hidden_size}, value);
+  test.AddOptionalInputEdge<uint8_t>();  // past_key
+  test.AddOptionalInputEdge<uint8_t>();  // past_value
+  test.AddInput<int32_t>("seqlens_k", {batch_size}, {sequence_length - 1});
+  test.AddInput<int32_t>("total_sequence_length", {1}, {sequence_length});
+  test.AddOptionalInputEdge<float>();    // cos_cache
+  test.AddOptionalInputEdge<float>();    // sin_cache
+  test.AddOptionalInputEdge<int64_t>();  // position_ids
+  test.AddOptionalInputEdge<float>();    // attention_bias
+  test.AddInput<float>("k_scale", {kv_num_heads}, k_scale);
+  test.AddInput<float>("v_scale", {kv_num_heads}, v_scale);
+
+  test.AddOutput<float>("output", {batch_size, sequence_length, hidden_size}, expected_output, false, 0.f, 1e-4f);
+  test.AddOutput<uint8_t>("present_key", {batch_size, kv_num_heads, sequence_length, head_size / 2}, present_key);
+  test.AddOutput<uint8_t>("present_value", {batch_size, kv_num_heads, sequence_length, head_size / 2},
+                          present_value);
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  test.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+}
+
+// The scales of a quantized cache are required and shall match the quantization type.
+TEST(GroupQueryAttentionTest, QuantizedKVCacheInvalidScales) {
+  constexpr int num_heads = 2;
+  constexpr int kv_num_heads = 2;
+  constexpr int head_size = 4;
+  constexpr int hidden_size = num_heads * head_size;
+  constexpr int kv_hidden_size = kv_num_heads * head_size;
+
+  const auto run = [&](const std::vector<float>& k_scale, const std::vector<float>* v_scale,
+                       const std::string& expected_failure) {
+    OpTester test("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+    test.AddAttribute<int64_t>("num_heads", num_heads);
+    test.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+    test.AddAttribute<std::string>("k_quant_type", "PER_TENSOR");
+    test.AddAttribute<std::string>("v_quant_type", "PER_TENSOR");
+    test.AddAttribute<int64_t>("kv_cache_bit_width", 8);
+
+    test.AddInput<float>("query", {1, 1, hidden_size}, std::vector<float>(hidden_size, 0.5f));
+    test.AddInput<float>("key", {1, 1, kv_hidden_size}, std::vector<float>(kv_hidden_size, 0.5f));
+    test.AddInput<float>("value", {1, 1, kv_hidden_size}, std::vector<float>(kv_hidden_size, 0.5f));
+    test.AddOptionalInputEdge<int8_t>();  // past_key
+    test.AddOptionalInputEdge<int8_t>();  // past_value
+    test.AddInput<int32_t>("seqlens_k", {1}, {0});
+    test.AddInput<int32_t>("total_sequence_length", {1}, {1});
+    test.AddOptionalInputEdge<float>();    // cos_cache
+    test.AddOptionalInputEdge<float>();    // sin_cache
+    test.AddOptionalInputEdge<int64_t>();  // position_ids
+    test.AddOptionalInputEdge<float>();    // attention_bias
+    test.AddInput<float>("k_scale", {static_cast<int64_t>(k_scale.size())}, k_scale);
+    if (v_scale != nullptr) {
+      test.AddInput<float>("v_scale", {static_cast<int64_t>(v_scale->size())}, *v_scale);
+    } else {
+      test.AddOptionalInputEdge<float>();
+    }
+
+    test.AddOutput<float>("output", {1, 1, hidden_size}, std::vector<float>(hidden_size, 0.f));
+    test.AddOutput<int8_t>("present_key", {1, kv_num_heads, 1, head_size}, std::vector<int8_t>(kv_hidden_size, 0));
+    test.AddOutput<int8_t>("present_value", {1, kv_num_heads, 1, head_size}, std::vector<int8_t>(kv_hidden_size, 0));
+
+    std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+    execution_providers.push_back(DefaultCpuExecutionProvider());
+    test.Run(OpTester::ExpectResult::kExpectFailure, expected_failure, {}, nullptr, &execution_providers);
+  };
+
+  const std::vector<float> scale = {0.1f};
+  run(scale, nullptr, "Input 'k_scale' and 'v_scale' shall be present when the k-v cache is quantized.");
+  run({0.1f, 0.1f, 0.1f}, &scale, "shall have 1, kv_num_heads or kv_num_heads * head_size elements, got 3");
+  run({0.1f, 0.1f}, &scale, "A PER_TENSOR k-v cache scale shall have 1 element, got 2");
+}
+
+// Only the float kernel reads a quantized cache, there is no fp16 kernel for an int8 cache.
+TEST(GroupQueryAttentionTest, QuantizedKVCacheRequiresFloat) {
+  constexpr int num_heads = 2;
+  constexpr int kv_num_heads = 2;
+  constexpr int head_size = 4;
+  constexpr int hidden_size = num_heads * head_size;
+  constexpr int kv_hidden_size = kv_num_heads * head_size;
+
+  OpTester test("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<int64_t>("num_heads", num_heads);
+  test.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+  test.AddAttribute<std::string>("k_quant_type", "PER_TENSOR");
+  test.AddAttribute<std::string>("v_quant_type", "PER_TENSOR");
+  test.AddAttribute<int64_t>("kv_cache_bit_width", 8);
+
+  test.AddInput<MLFloat16>("query", {1, 1, hidden_size}, ToFloat16(std::vector<float>(hidden_size, 0.5f)));
+  test.AddInput<MLFloat16>("key", {1, 1, kv_hidden_size}, ToFloat16(std::vector<float>(kv_hidden_size, 0.5f)));
+  test.AddInput<MLFloat16>("value", {1, 1, kv_hidden_size}, ToFloat16(std::vector<float>(kv_hidden_size, 0.5f)));
+  test.AddInput<int8_t>("past_key", {1, kv_num_heads, 1, head_size}, std::vector<int8_t>(kv_hidden_size, 1));
+  test.AddInput<int8_t>("past_value", {1, kv_num_heads, 1, head_size}, std::vector<int8_t>(kv_hidden_size, 1));
+  test.AddInput<int32_t>("seqlens_k", {1}, {1});
+  test.AddInput<int32_t>("total_sequence_length", {1}, {2});
+  test.AddOptionalInputEdge<MLFloat16>();  // cos_cache
+  test.AddOptionalInputEdge<MLFloat16>();  // sin_cache
+  test.AddOptionalInputEdge<int64_t>();    // position_ids
+  test.AddOptionalInputEdge<MLFloat16>();  // attention_bias
+  test.AddInput<float>("k_scale", {1}, {0.1f});
+  test.AddInput<float>("v_scale", {1}, {0.1f});
+
+  test.AddOutput<MLFloat16>("output", {1, 1, hidden_size}, ToFloat16(std::vector<float>(hidden_size, 0.f)));
+  test.AddOutput<int8_t>("present_key", {1, kv_num_heads, 2, head_size}, std::vector<int8_t>(2 * kv_hidden_size, 0));
+  test.AddOutput<int8_t>("present_value", {1, kv_num_heads, 2, head_size},
+                         std::vector<int8_t>(2 * kv_hidden_size, 0));
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  test.Run(OpTester::ExpectResult::kExpectFailure, "Could not find an implementation", {}, nullptr,
+           &execution_providers);
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -7,6 +7,8 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include <cstdlib>
+#include <cstring>
+#include <thread>
 #include "core/framework/stream_handles.h"
 
 namespace onnxruntime {
@@ -307,6 +309,141 @@ TEST(BFCArenaTest, TestShrink) {
   EXPECT_EQ(stats.total_allocated_bytes, 10 * 1024 * 1024) << "Expect 10M bytes but actually " << stats.total_allocated_bytes << " bytes";
 }
 
+TEST(BFCArenaTest, TestSizeClassCache) {
+  AllocatorStats stats;
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kSameAsRequested,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+
+  std::vector<void*> ptrs;
+  for (int iter = 0; iter < 10; ++iter) {
+    for (size_t size : {100, 1024, 3000, 60000}) {
+      void* p = a.Alloc(size);
+      ASSERT_NE(p, nullptr);
+      memset(p, 0xaa, size);
+      ptrs.push_back(p);
+    }
+    for (void* p : ptrs) {
+      a.Free(p);
+    }
+    ptrs.clear();
+  }
+
+  // sizes above the cache limit take the regular path
+  void* large = a.Alloc(1024 * 1024);
+  a.Free(large);
+
+  a.GetStats(&stats);
+  EXPECT_GT(stats.num_cache_hits, 0);
+  EXPECT_GT(stats.num_cache_misses, 0);
+  EXPECT_GT(stats.bytes_in_cache, 0);
+  EXPECT_EQ(stats.bytes_in_use, 0) << "Cached chunks should not count as in use";
+  EXPECT_EQ(stats.num_allocs, 41);
+
+  // Shrink returns the cached chunks to the bins first so the regions can be released
+  EXPECT_EQ(a.Shrink(), Status::OK());
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_cache, 0);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+  EXPECT_EQ(stats.total_allocated_bytes, 0);
+}
+
+TEST(BFCArenaTest, TestSizeClassCacheStats) {
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kSameAsRequested,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+
+  // the arena is empty, the first allocation extends it through the regular path
+  void* p = a.Alloc(1024);
+  a.Free(p);
+  CheckStats(&a, 1, 0, 1024, 1024);
+
+  // the cache takes a batch of chunks out of the bins, only the one that is handed out counts
+  p = a.Alloc(1024);
+  CheckStats(&a, 2, 1024, 1024, 1024);
+  a.Free(p);
+  CheckStats(&a, 2, 0, 1024, 1024);
+
+  // the chunks held by the cache do not count towards the peak, the chunks it hands out do
+  void* large = a.Alloc(128 * 1024);
+  CheckStats(&a, 3, 128 * 1024, 128 * 1024, 128 * 1024);
+  p = a.Alloc(1024);
+  CheckStats(&a, 4, 129 * 1024, 129 * 1024, 128 * 1024);
+  a.Free(p);
+  a.Free(large);
+  CheckStats(&a, 4, 0, 129 * 1024, 128 * 1024);
+}
+
+TEST(BFCArenaTest, TestSizeClassCacheFlushedOnOutOfMemory) {
+  constexpr size_t kLimit = 16 * 1024;
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), kLimit, ArenaExtendStrategy::kSameAsRequested,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+
+  // the arena can only hold a single region of the limit, the cache then keeps a batch of small chunks of it
+  void* p = a.Alloc(kLimit);
+  a.Free(p);
+  a.Free(a.Alloc(1024));
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  ASSERT_GT(stats.bytes_in_cache, 0);
+
+  // the full region is only available once the cached chunks are back in the bins
+  p = a.Alloc(kLimit);
+  ASSERT_NE(p, nullptr);
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_cache, 0);
+  EXPECT_EQ(stats.bytes_in_use, static_cast<int64_t>(kLimit));
+  a.Free(p);
+}
+
+TEST(BFCArenaTest, TestSizeClassCacheMultiThreaded) {
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kNextPowerOfTwo,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+
+  // Memory allocated on one thread is freed on another, so chunks move between cache shards.
+  constexpr int kNumThreads = 4;
+  constexpr int kNumIterations = 1000;
+  std::vector<std::vector<void*>> allocated(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&a, &allocated, t]() {
+      for (int i = 0; i < kNumIterations; ++i) {
+        size_t size = 64 + static_cast<size_t>((i * 7919 + t * 104729) % (64 * 1024));
+        void* p = a.Alloc(size);
+        *static_cast<int*>(p) = t;
+        allocated[t].push_back(p);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&a, &allocated, t]() {
+      for (void* p : allocated[(t + 1) % kNumThreads]) {
+        EXPECT_EQ(*static_cast<int*>(p), (t + 1) % kNumThreads);
+        a.Free(p);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+  EXPECT_EQ(stats.num_allocs, kNumThreads * kNumIterations);
+}
+
 class BadAllocator : public IAllocator {
  public:
   BadAllocator() : IAllocator(OrtMemoryInfo(CPU, OrtAllocatorType::OrtDeviceAllocator)) {}
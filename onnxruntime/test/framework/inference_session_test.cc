@@ -9,6 +9,7 @@
 #include <functional>
 #include <future>
 #include <iterator>
+#include <numeric>
 #include <thread>
 #include <fstream>
 #include <random>
@@ -18,8 +19,10 @@
 #include "core/common/logging/logging.h"
 #include "core/common/logging/sinks/clog_sink.h"
 #include "core/common/profiler.h"
+#include "core/common/span_utils.h"
 #include "core/framework/compute_capability.h"
 #include "core/framework/data_transfer_manager.h"
+#include "core/framework/error_code_helper.h"
 #include "core/framework/execution_provider.h"
 #include "core/framework/kernel_registry.h"
 #include "core/framework/op_kernel.h"
@@ -49,6 +52,7 @@
 #include "core/session/inference_session_utils.h"
 #include "core/session/onnxruntime_session_options_config_keys.h"
 #include "core/session/onnxruntime_run_options_config_keys.h"
+#include "core/session/ort_apis.h"
 #include "dummy_provider.h"
 #include "test_utils.h"
 #include "test/capturing_sink.h"
@@ -1485,6 +1489,322 @@ TEST(ExecutionProviderTest, OpKernelInfoCanReadConfigOptions) {
   ASSERT_STATUS_NOT_OK_AND_HAS_SUBSTR(session.Initialize(), "Test exception in ctor");
 }
 
+TEST(InferenceSessionTests, MemoryPatternShapeBuckets) {
+  SessionOptions so;
+  so.session_logid = "InferenceSessionTests.MemoryPatternShapeBuckets";
+  so.enable_mem_pattern = true;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsMemoryPatternShapeBuckets, "M:4,16"));
+
+  InferenceSessionWrapper session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(ORT_TSTR("testdata/matmul_with_dynamic_input_shape.onnx")));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  const auto& session_state = session.GetSessionState();
+  ASSERT_TRUE(session_state.GetEnableMemoryPattern());
+  ASSERT_TRUE(session_state.GetMemoryPatternDimBucketing());
+  int a_idx = -1;
+  ASSERT_STATUS_OK(session_state.GetOrtValueNameIdxMap().GetIdx("A", a_idx));
+
+  auto allocator = TestCPUExecutionProvider()->CreatePreferredAllocators()[0];
+  auto make_input = [&allocator](int64_t m) {
+    OrtValue value;
+    CreateMLValue<float>(allocator, {m, 2}, std::vector<float>(static_cast<size_t>(m * 2), 1.f), &value);
+    return value;
+  };
+  auto run = [&](int64_t m) {
+    NameMLValMap feeds{{"A", make_input(m)}};
+    std::vector<OrtValue> fetches;
+    ASSERT_STATUS_OK(session.Run(RunOptions{}, feeds, {"Y"}, &fetches));
+    ASSERT_EQ(fetches[0].Get<Tensor>().Shape(), TensorShape({m, 4}));
+  };
+  auto get_pattern = [&](int64_t m) {
+    OrtValue input = make_input(m);
+    const InlinedHashMap<int, TensorShape>* inferred_shapes = nullptr;
+    return session_state.GetMemoryPatternGroup(AsSpan({input}), AsSpan({a_idx}), inferred_shapes);
+  };
+
+  run(3);
+  const auto* bucket_4 = get_pattern(3);
+  ASSERT_NE(bucket_4, nullptr);
+  EXPECT_EQ(get_pattern(1), bucket_4) << "smaller inputs in the bucket share the pattern";
+  EXPECT_EQ(get_pattern(4), nullptr) << "larger inputs in the bucket are traced to grow the pattern";
+
+  run(4);
+  const auto* grown_bucket_4 = get_pattern(4);
+  ASSERT_NE(grown_bucket_4, nullptr);
+  EXPECT_EQ(get_pattern(3), grown_bucket_4);
+
+  EXPECT_EQ(get_pattern(5), nullptr) << "next bucket has no pattern yet";
+  run(16);
+  EXPECT_NE(get_pattern(5), nullptr);
+  EXPECT_NE(get_pattern(5), grown_bucket_4);
+
+  // above the largest bucket the patterns are per shape
+  run(17);
+  EXPECT_NE(get_pattern(17), nullptr);
+  EXPECT_EQ(get_pattern(18), nullptr);
+}
+
+TEST(InferenceSessionTests, MemoryPatternDimBucketing) {
+  SessionOptions so;
+  so.session_logid = "InferenceSessionTests.MemoryPatternDimBucketing";
+  so.enable_mem_pattern = true;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsMemoryPatternDimBucketing, "1"));
+
+  InferenceSessionWrapper session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(ORT_TSTR("testdata/matmul_with_dynamic_input_shape.onnx")));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  const auto& session_state = session.GetSessionState();
+  ASSERT_TRUE(session_state.GetMemoryPatternDimBucketing());
+  int a_idx = -1;
+  ASSERT_STATUS_OK(session_state.GetOrtValueNameIdxMap().GetIdx("A", a_idx));
+
+  auto allocator = TestCPUExecutionProvider()->CreatePreferredAllocators()[0];
+  auto make_input = [&allocator](int64_t m) {
+    OrtValue value;
+    CreateMLValue<float>(allocator, {m, 2}, std::vector<float>(static_cast<size_t>(m * 2), 1.f), &value);
+    return value;
+  };
+  auto run = [&](int64_t m) {
+    NameMLValMap feeds{{"A", make_input(m)}};
+    std::vector<OrtValue> fetches;
+    ASSERT_STATUS_OK(session.Run(RunOptions{}, feeds, {"Y"}, &fetches));
+    ASSERT_EQ(fetches[0].Get<Tensor>().Shape(), TensorShape({m, 4}));
+  };
+  auto get_pattern = [&](int64_t m) {
+    OrtValue input = make_input(m);
+    const InlinedHashMap<int, TensorShape>* inferred_shapes = nullptr;
+    return session_state.GetMemoryPatternGroup(AsSpan({input}), AsSpan({a_idx}), inferred_shapes);
+  };
+
+  run(5);
+  const auto* pattern_5 = get_pattern(5);
+  ASSERT_NE(pattern_5, nullptr);
+  EXPECT_EQ(get_pattern(6), nullptr) << "a pattern traced with smaller inputs must not be used for larger ones";
+  run(6);
+  EXPECT_NE(get_pattern(6), nullptr);
+  EXPECT_NE(get_pattern(6), pattern_5);
+  EXPECT_EQ(get_pattern(5), get_pattern(6)) << "smaller inputs share the largest pattern of their bucket";
+  EXPECT_EQ(get_pattern(9), nullptr) << "next power of two";
+}
+
+TEST(InferenceSessionTests, MemoryPatternShapeBucketsCompareEveryDimension) {
+  SessionOptions so;
+  so.session_logid = "InferenceSessionTests.MemoryPatternShapeBucketsCompareEveryDimension";
+  so.enable_mem_pattern = true;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsMemoryPatternShapeBuckets, "n:4;m:4"));
+
+  // C = Reshape(A, B) with A of shape [n, 2] and B of shape [m]
+  InferenceSessionWrapper session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(ORT_TSTR("testdata/capi_symbolic_dims.onnx")));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  const auto& session_state = session.GetSessionState();
+  int a_idx = -1;
+  int b_idx = -1;
+  ASSERT_STATUS_OK(session_state.GetOrtValueNameIdxMap().GetIdx("A", a_idx));
+  ASSERT_STATUS_OK(session_state.GetOrtValueNameIdxMap().GetIdx("B", b_idx));
+
+  auto allocator = TestCPUExecutionProvider()->CreatePreferredAllocators()[0];
+  // B reshapes the n x 2 values of A into a vector if m is 1, and keeps the shape of A if m is 2
+  auto make_inputs = [&allocator](int64_t n, int64_t m) {
+    std::vector<OrtValue> inputs(2);
+    CreateMLValue<float>(allocator, {n, 2}, std::vector<float>(static_cast<size_t>(n * 2), 1.f), &inputs[0]);
+    CreateMLValue<int64_t>(allocator, {m}, m == 1 ? std::vector<int64_t>{n * 2} : std::vector<int64_t>{n, 2},
+                           &inputs[1]);
+    return inputs;
+  };
+  auto run = [&](int64_t n, int64_t m) {
+    auto inputs = make_inputs(n, m);
+    NameMLValMap feeds{{"A", inputs[0]}, {"B", inputs[1]}};
+    std::vector<OrtValue> fetches;
+    ASSERT_STATUS_OK(session.Run(RunOptions{}, feeds, {"C"}, &fetches));
+    ASSERT_EQ(fetches[0].Get<Tensor>().Shape().Size(), n * 2);
+  };
+  auto get_pattern = [&](int64_t n, int64_t m) {
+    auto inputs = make_inputs(n, m);
+    const InlinedHashMap<int, TensorShape>* inferred_shapes = nullptr;
+    return session_state.GetMemoryPatternGroup(inputs, AsSpan({a_idx, b_idx}), inferred_shapes);
+  };
+
+  run(4, 1);
+  const auto* traced_4_1 = get_pattern(4, 1);
+  ASSERT_NE(traced_4_1, nullptr);
+  EXPECT_EQ(get_pattern(3, 1), traced_4_1);
+  EXPECT_EQ(get_pattern(3, 2), nullptr) << "B is larger than when the pattern was traced, even though the inputs "
+                                           "have fewer elements in total";
+
+  run(3, 2);
+  const auto* traced_3_2 = get_pattern(3, 2);
+  ASSERT_NE(traced_3_2, nullptr);
+  EXPECT_NE(traced_3_2, traced_4_1);
+  EXPECT_EQ(get_pattern(2, 2), traced_3_2);
+  EXPECT_EQ(get_pattern(4, 1), traced_4_1) << "the earlier pattern still serves the runs it covers";
+  EXPECT_EQ(get_pattern(4, 2), nullptr) << "no pattern covers both dimensions";
+}
+
+TEST(InferenceSessionTests, DynamicBatching) {
+  SessionOptions so;
+  so.session_logid = "InferenceSessionTests.DynamicBatching";
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsDynamicBatchingMaxBatchSize, "8"));
+  // only a full batch is dispatched before the test times out
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsDynamicBatchingMaxDelayUs, "60000000"));
+
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(ORT_TSTR("testdata/matmul_with_dynamic_input_shape.onnx")));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  struct Request {
+    OrtValue input;
+    OrtValue* output = nullptr;
+    std::promise<Status> done;
+  };
+  auto callback = [](void* user_data, OrtValue** /*outputs*/, size_t /*num_outputs*/, OrtStatusPtr ort_status) {
+    Status status = ToStatus(ort_status);
+    OrtApis::ReleaseStatus(ort_status);
+    static_cast<Request*>(user_data)->done.set_value(status);
+  };
+
+  // the requests add up to the maximum batch size
+  const std::vector<int64_t> batch_sizes{1, 2, 3, 2};
+  auto allocator = TestCPUExecutionProvider()->CreatePreferredAllocators()[0];
+  std::vector<Request> requests(batch_sizes.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const int64_t m = batch_sizes[i];
+    std::vector<float> values(static_cast<size_t>(m * 2));
+    std::iota(values.begin(), values.end(), static_cast<float>(i * 10));
+    CreateMLValue<float>(allocator, {m, 2}, values, &requests[i].input);
+  }
+
+  const char* input_name = "A";
+  const char* output_name = "Y";
+  for (auto& request : requests) {
+    const OrtValue* input = &request.input;
+    ASSERT_STATUS_OK(session.RunAsync(nullptr, AsSpan({input_name}), AsSpan({input}), AsSpan({output_name}),
+                                      gsl::make_span(&request.output, 1), callback, &request));
+  }
+
+  for (auto& request : requests) {
+    auto done = request.done.get_future();
+    ASSERT_EQ(done.wait_for(std::chrono::seconds(30)), std::future_status::ready);
+    ASSERT_STATUS_OK(done.get());
+    std::unique_ptr<OrtValue> output(request.output);
+    ASSERT_NE(output, nullptr);
+
+    NameMLValMap feeds{{"A", request.input}};
+    std::vector<OrtValue> expected;
+    ASSERT_STATUS_OK(session.Run(RunOptions{}, feeds, {"Y"}, &expected));
+    const auto& expected_tensor = expected[0].Get<Tensor>();
+    ASSERT_EQ(output->Get<Tensor>().Shape(), expected_tensor.Shape());
+    EXPECT_THAT(output->Get<Tensor>().DataAsSpan<float>(),
+                ::testing::ElementsAreArray(expected_tensor.DataAsSpan<float>()));
+  }
+
+  DynamicBatcher::Stats stats;
+  ASSERT_TRUE(session.GetDynamicBatchingStats(stats));
+  EXPECT_EQ(stats.num_requests, requests.size());
+  EXPECT_EQ(stats.num_batches, 1u);
+  EXPECT_EQ(stats.max_requests_per_batch, requests.size());
+}
+
+TEST(InferenceSessionTests, DynamicBatchingDifferentRunOptions) {
+  SessionOptions so;
+  so.session_logid = "InferenceSessionTests.DynamicBatchingDifferentRunOptions";
+  so.enable_profiling = true;
+  so.profile_file_prefix = ORT_TSTR("onnxprofile_dynamic_batching_test");
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsDynamicBatchingMaxBatchSize, "8"));
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsDynamicBatchingMaxDelayUs, "1000"));
+
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(ORT_TSTR("testdata/matmul_with_dynamic_input_shape.onnx")));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  struct Request {
+    RunOptions run_options;
+    OrtValue input;
+    OrtValue* output = nullptr;
+    std::promise<Status> done;
+  };
+  auto callback = [](void* user_data, OrtValue** /*outputs*/, size_t /*num_outputs*/, OrtStatusPtr ort_status) {
+    Status status = ToStatus(ort_status);
+    OrtApis::ReleaseStatus(ort_status);
+    static_cast<Request*>(user_data)->done.set_value(status);
+  };
+
+  // requests with different run tags are never combined into one run
+  auto allocator = TestCPUExecutionProvider()->CreatePreferredAllocators()[0];
+  std::vector<Request> requests(2);
+  for (size_t i = 0; i < requests.size(); ++i) {
+    requests[i].run_options.run_tag = "DynamicBatching" + std::to_string(i);
+    CreateMLValue<float>(allocator, {1, 2}, {1.f, 2.f}, &requests[i].input);
+  }
+
+  const char* input_name = "A";
+  const char* output_name = "Y";
+  for (auto& request : requests) {
+    const OrtValue* input = &request.input;
+    ASSERT_STATUS_OK(session.RunAsync(&request.run_options, AsSpan({input_name}), AsSpan({input}),
+                                      AsSpan({output_name}), gsl::make_span(&request.output, 1), callback, &request));
+  }
+
+  for (auto& request : requests) {
+    auto done = request.done.get_future();
+    ASSERT_EQ(done.wait_for(std::chrono::seconds(30)), std::future_status::ready);
+    ASSERT_STATUS_OK(done.get());
+    std::unique_ptr<OrtValue> output(request.output);
+    ASSERT_NE(output, nullptr);
+    EXPECT_THAT(output->Get<Tensor>().DataAsSpan<float>(), ::testing::ElementsAre(8.f, 11.f, 14.f, 17.f));
+  }
+
+  DynamicBatcher::Stats stats;
+  ASSERT_TRUE(session.GetDynamicBatchingStats(stats));
+  EXPECT_EQ(stats.num_requests, requests.size());
+  EXPECT_EQ(stats.num_batches, requests.size());
+  EXPECT_EQ(stats.max_requests_per_batch, 1u);
+
+  // the runs of the batcher are recorded by the session profiler
+  std::ifstream profile(session.EndProfiling());
+  ASSERT_TRUE(profile);
+  const std::string profile_content{std::istreambuf_iterator<char>(profile), std::istreambuf_iterator<char>()};
+  EXPECT_NE(profile_content.find("dynamic_batch_run"), std::string::npos);
+}
+
+TEST(InferenceSessionTests, SamplingProfiler) {
+  SessionOptions so;
+  so.session_logid = "InferenceSessionTests.SamplingProfiler";
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsProfilingSampleInterval, "2"));
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsProfilingRingBufferSize, "2"));
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsProfilingNodeStats, "1"));
+
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(MODEL_URI));
+  ASSERT_STATUS_OK(session.Initialize());
+  const auto* sampling_profiler = session.GetSamplingProfiler();
+  ASSERT_NE(sampling_profiler, nullptr);
+
+  RunOptions run_options;
+  for (int i = 0; i < 5; ++i) {
+    RunModel(session, run_options);
+  }
+
+  // runs 0, 2 and 4 are sampled
+  std::unordered_map<std::string, std::string> stats;
+  sampling_profiler->GetStats(stats);
+  EXPECT_EQ(stats["sampled_runs"], "3");
+  EXPECT_EQ(stats["run.count"], "3");
+  EXPECT_EQ(stats["op.Mul.count"], "3");
+  EXPECT_EQ(stats.count("op.Mul.p99_us"), 1u);
+  EXPECT_EQ(stats.count("op.Mul.mean_bytes_allocated"), 1u);
+  EXPECT_EQ(stats["node.mul_1.count"], "3");
+
+  // the ring buffer only keeps the latest events
+  const auto events = sampling_profiler->GetRecentEvents();
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].op_type, "Mul");
+  EXPECT_LE(events[0].start_ns, events[1].start_ns);
+}
+
 TEST(InferenceSessionTests, Test3LayerNestedSubgraph) {
   // The main graph contains a 'If' node: 'graph_0__if_0'
   // Inside the then-branch of 'graph_0__if_0', there is a nested 'If' node: 'graph_0__if_0__else__if_0'
@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "core/framework/mem_pattern_cache.h"
+#include "core/framework/mem_pattern_planner.h"
+#include "test/util/include/asserts.h"
+#include "test/util/include/temp_dir.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace test {
+
+static MemoryPatternGroup CreatePatternGroup() {
+  MemPatternPlanner planner{false};
+  planner.TraceAllocation(0, 1024);
+  planner.TraceAllocation(1, 256);
+  planner.TraceFree(0);
+  planner.TraceAllocation(2, 512);
+
+  MemoryPatternGroup group;
+  group.locations.push_back(OrtDevice());
+  group.patterns.push_back(planner.GenerateMemPattern());
+  return group;
+}
+
+TEST(MemoryPatternCacheTest, SaveAndLoad) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("mem_pattern_cache_test_save_and_load"));
+  const auto file_path = std::filesystem::path(tmp_dir.Path()) / "patterns.bin";
+  const std::vector<int> feed_idxs{3, 0};
+  const std::vector<TensorShapeVector> shapes{{1, 128}, {1, 128, 768}};
+
+  {
+    MemoryPatternCache cache(file_path, 42);
+    std::vector<MemoryPatternCache::Entry> entries;
+    ASSERT_STATUS_OK(cache.Load(entries));
+    EXPECT_TRUE(entries.empty()) << "file does not exist yet";
+    cache.Add(feed_idxs, shapes, CreatePatternGroup());
+    EXPECT_FALSE(std::filesystem::exists(file_path)) << "the file is only written by Flush";
+    ASSERT_STATUS_OK(cache.Flush());
+  }
+
+  {
+    MemoryPatternCache cache(file_path, 42);
+    std::vector<MemoryPatternCache::Entry> entries;
+    ASSERT_STATUS_OK(cache.Load(entries));
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].feed_ort_value_idxs, feed_idxs);
+    EXPECT_EQ(entries[0].feed_shapes, shapes);
+
+    const auto expected = CreatePatternGroup();
+    const auto& group = entries[0].patterns;
+    ASSERT_EQ(group.locations.size(), 1u);
+    EXPECT_EQ(group.locations[0], expected.locations[0]);
+    EXPECT_EQ(group.patterns[0].PeakSize(), expected.patterns[0].PeakSize());
+    for (int ort_value_idx = 0; ort_value_idx < 3; ++ort_value_idx) {
+      const auto* block = group.patterns[0].GetBlock(ort_value_idx);
+      const auto* expected_block = expected.patterns[0].GetBlock(ort_value_idx);
+      ASSERT_NE(block, nullptr);
+      EXPECT_EQ(block->offset_, expected_block->offset_);
+      EXPECT_EQ(block->size_, expected_block->size_);
+    }
+
+    // loaded entries are kept when the file is rewritten
+    cache.Add(std::vector<int>{0}, std::vector<TensorShapeVector>{{1, 64}}, CreatePatternGroup());
+    ASSERT_STATUS_OK(cache.Flush());
+    ASSERT_STATUS_OK(cache.Load(entries));
+    EXPECT_EQ(entries.size(), 2u);
+  }
+
+  {
+    MemoryPatternCache cache(file_path, 43);
+    std::vector<MemoryPatternCache::Entry> entries;
+    ASSERT_STATUS_OK(cache.Load(entries));
+    EXPECT_TRUE(entries.empty()) << "patterns of a different plan must be ignored";
+  }
+}
+
+TEST(MemoryPatternCacheTest, ConcurrentWritersMerge) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("mem_pattern_cache_test_concurrent_writers_merge"));
+  const auto file_path = std::filesystem::path(tmp_dir.Path()) / "patterns.bin";
+
+  // two sessions that loaded the file before either of them wrote it
+  MemoryPatternCache cache_1(file_path, 42);
+  MemoryPatternCache cache_2(file_path, 42);
+  std::vector<MemoryPatternCache::Entry> entries;
+  ASSERT_STATUS_OK(cache_1.Load(entries));
+  ASSERT_STATUS_OK(cache_2.Load(entries));
+
+  const std::vector<int> feed_idxs{0};
+  cache_1.Add(feed_idxs, std::vector<TensorShapeVector>{{1, 64}}, CreatePatternGroup());
+  cache_2.Add(feed_idxs, std::vector<TensorShapeVector>{{1, 128}}, CreatePatternGroup());
+  cache_2.Add(feed_idxs, std::vector<TensorShapeVector>{{1, 64}}, CreatePatternGroup());
+  ASSERT_STATUS_OK(cache_1.Flush());
+  ASSERT_STATUS_OK(cache_2.Flush());
+
+  MemoryPatternCache cache(file_path, 42);
+  ASSERT_STATUS_OK(cache.Load(entries));
+  ASSERT_EQ(entries.size(), 2u) << "the second writer keeps the entries of the first, without duplicates";
+  EXPECT_EQ(entries[0].feed_shapes, (std::vector<TensorShapeVector>{{1, 64}}));
+  EXPECT_EQ(entries[1].feed_shapes, (std::vector<TensorShapeVector>{{1, 128}}));
+
+  // the temporary files and the lock are gone
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator(tmp_dir.Path()),
+                          std::filesystem::directory_iterator()),
+            1);
+}
+
+TEST(MemoryPatternCacheTest, CorruptFile) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("mem_pattern_cache_test_corrupt_file"));
+  const auto file_path = std::filesystem::path(tmp_dir.Path()) / "patterns.bin";
+
+  {
+    MemoryPatternCache cache(file_path, 42);
+    cache.Add(std::vector<int>{0}, std::vector<TensorShapeVector>{{4, 4}}, CreatePatternGroup());
+    ASSERT_STATUS_OK(cache.Flush());
+  }
+  std::filesystem::resize_file(file_path, std::filesystem::file_size(file_path) - 8);
+
+  MemoryPatternCache cache(file_path, 42);
+  std::vector<MemoryPatternCache::Entry> entries;
+  EXPECT_FALSE(cache.Load(entries).IsOK());
+  EXPECT_TRUE(entries.empty());
+
+  {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    file << "not a memory pattern cache";
+  }
+  EXPECT_FALSE(cache.Load(entries).IsOK());
+}
+
+}  // namespace test
+}  // namespace onnxruntime
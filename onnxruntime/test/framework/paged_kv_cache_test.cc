@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <vector>
+
+#include "core/framework/paged_kv_cache.h"
+#include "core/framework/tensor.h"
+#include "gtest/gtest.h"
+#include "test/util/include/asserts.h"
+
+namespace onnxruntime {
+namespace test {
+
+static std::vector<int32_t> GetBlockTable(const PagedKVCacheManager& manager, std::vector<int64_t> sequence_ids) {
+  std::vector<int32_t> block_table(sequence_ids.size() * manager.GetMaxPagesPerSequence());
+  ORT_THROW_IF_ERROR(manager.GetBlockTable(sequence_ids, block_table));
+  return block_table;
+}
+
+TEST(PagedKVCacheManagerTest, ReserveAndRelease) {
+  PagedKVCacheManager manager(8, 16, 4);
+  EXPECT_EQ(manager.GetNumFreePages(), 8u);
+
+  ASSERT_STATUS_OK(manager.Reserve(7, 20));
+  ASSERT_STATUS_OK(manager.Reserve(3, 16));
+  EXPECT_EQ(manager.GetNumFreePages(), 5u);
+  EXPECT_EQ(GetBlockTable(manager, {7, 3}), (std::vector<int32_t>{0, 1, 0, 0, 2, 0, 0, 0}));
+
+  // growing a sequence keeps its pages
+  ASSERT_STATUS_OK(manager.Reserve(3, 17));
+  ASSERT_STATUS_OK(manager.Reserve(7, 1));
+  EXPECT_EQ(GetBlockTable(manager, {3, 7}), (std::vector<int32_t>{2, 3, 0, 0, 0, 1, 0, 0}));
+
+  manager.Release(7);
+  manager.Release(42);
+  EXPECT_EQ(manager.GetNumFreePages(), 6u);
+
+  // released pages are reused first
+  ASSERT_STATUS_OK(manager.Reserve(9, 64));
+  EXPECT_EQ(GetBlockTable(manager, {9}), (std::vector<int32_t>{0, 1, 4, 5}));
+  std::vector<int32_t> block_table(4);
+  EXPECT_FALSE(manager.GetBlockTable(std::vector<int64_t>{7}, block_table).IsOK());
+}
+
+TEST(PagedKVCacheManagerTest, OutOfPages) {
+  PagedKVCacheManager manager(4, 8, 8);
+  ASSERT_STATUS_OK(manager.Reserve(0, 24));
+
+  // a failed reservation takes no page
+  EXPECT_FALSE(manager.Reserve(1, 16).IsOK());
+  EXPECT_FALSE(manager.Reserve(0, 40).IsOK());
+  EXPECT_EQ(manager.GetNumFreePages(), 1u);
+  std::vector<int32_t> block_table(8);
+  EXPECT_FALSE(manager.GetBlockTable(std::vector<int64_t>{1}, block_table).IsOK());
+
+  // more pages than a block table holds
+  EXPECT_FALSE(manager.Reserve(2, 65).IsOK());
+}
+
+TEST(PagedKVCacheManagerTest, CreatePagePool) {
+  OrtValue pool;
+  ASSERT_STATUS_OK(PagedKVCacheManager::CreatePagePool(DataTypeImpl::GetType<float>(), 8, 2, 16, 64,
+                                                       std::make_shared<CPUAllocator>(), pool));
+  const auto& tensor = pool.Get<Tensor>();
+  EXPECT_EQ(tensor.Shape(), TensorShape({8, 2, 16, 64}));
+  EXPECT_TRUE(tensor.IsDataType<float>());
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -0,0 +1,133 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "core/framework/prepacked_weights_file_cache.h"
+#include "test/util/include/asserts.h"
+#include "test/util/include/temp_dir.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace test {
+
+static PrepackedWeightsFileCache::Entry CreateEntry(const std::vector<uint8_t>& packed_b) {
+  PrepackedWeightsFileCache::Entry entry(2);
+  entry[0].input_idx = 1;
+  entry[0].is_packed = true;
+  entry[0].buffers.push_back(gsl::as_bytes(gsl::make_span(packed_b)));
+  entry[1].input_idx = 2;
+  entry[1].is_packed = false;
+  return entry;
+}
+
+static void ExpectEntry(const PrepackedWeightsFileCache::Entry* entry, const std::vector<uint8_t>& packed_b,
+                        bool loaded = true) {
+  ASSERT_NE(entry, nullptr);
+  ASSERT_EQ(entry->size(), 2u);
+  EXPECT_EQ((*entry)[0].input_idx, 1);
+  EXPECT_TRUE((*entry)[0].is_packed);
+  ASSERT_EQ((*entry)[0].buffers.size(), 1u);
+  const auto& buffer = (*entry)[0].buffers[0];
+  ASSERT_EQ(buffer.size(), packed_b.size());
+  if (loaded) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % 64, 0u) << "buffers must be aligned in the mapping";
+  }
+  EXPECT_TRUE(std::equal(packed_b.begin(), packed_b.end(), reinterpret_cast<const uint8_t*>(buffer.data())));
+  EXPECT_EQ((*entry)[1].input_idx, 2);
+  EXPECT_FALSE((*entry)[1].is_packed);
+  EXPECT_TRUE((*entry)[1].buffers.empty());
+}
+
+TEST(PrepackedWeightsFileCacheTest, SaveAndLoad) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("prepacked_weights_file_cache_test_save_and_load"));
+  const auto file_path = std::filesystem::path(tmp_dir.Path()) / "prepacked.bin";
+  const std::vector<uint8_t> packed_b_0{1, 2, 3};
+  const std::vector<uint8_t> packed_b_1(100, 7);
+
+  {
+    PrepackedWeightsFileCache cache(file_path, 42);
+    ASSERT_STATUS_OK(cache.Load());
+    EXPECT_EQ(cache.GetNumberOfEntries(), 0u) << "file does not exist yet";
+    cache.Add("key0", CreateEntry(packed_b_0));
+    EXPECT_TRUE(cache.HasNewEntries());
+    ExpectEntry(cache.Find("key0"), packed_b_0, /*loaded*/ false);
+    ASSERT_STATUS_OK(cache.Save());
+    EXPECT_FALSE(cache.HasNewEntries());
+  }
+  // the temporary file the cache was written to is renamed into place
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator(tmp_dir.Path()), std::filesystem::directory_iterator()),
+            1);
+
+  {
+    PrepackedWeightsFileCache cache(file_path, 42);
+    ASSERT_STATUS_OK(cache.Load());
+    ExpectEntry(cache.Find("key0"), packed_b_0);
+    EXPECT_EQ(cache.Find("key1"), nullptr);
+
+    // loaded entries are kept when the file is rewritten
+    cache.Add("key1", CreateEntry(packed_b_1));
+    ASSERT_STATUS_OK(cache.Save());
+  }
+
+  {
+    PrepackedWeightsFileCache cache(file_path, 42);
+    ASSERT_STATUS_OK(cache.Load());
+    EXPECT_EQ(cache.GetNumberOfEntries(), 2u);
+    ExpectEntry(cache.Find("key0"), packed_b_0);
+    ExpectEntry(cache.Find("key1"), packed_b_1);
+  }
+
+  {
+    PrepackedWeightsFileCache cache(file_path, 43);
+    ASSERT_STATUS_OK(cache.Load());
+    EXPECT_EQ(cache.GetNumberOfEntries(), 0u) << "weights packed on a different CPU must be ignored";
+  }
+}
+
+TEST(PrepackedWeightsFileCacheTest, CorruptFile) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("prepacked_weights_file_cache_test_corrupt_file"));
+  const auto file_path = std::filesystem::path(tmp_dir.Path()) / "prepacked.bin";
+
+  {
+    PrepackedWeightsFileCache cache(file_path, 42);
+    cache.Add("key0", CreateEntry(std::vector<uint8_t>(16, 1)));
+    ASSERT_STATUS_OK(cache.Save());
+  }
+  std::filesystem::resize_file(file_path, std::filesystem::file_size(file_path) - 8);
+
+  PrepackedWeightsFileCache cache(file_path, 42);
+  EXPECT_FALSE(cache.Load().IsOK());
+  EXPECT_EQ(cache.GetNumberOfEntries(), 0u);
+
+  // a buffer that does not hold what was written for it fails its checksum, the file ends with the last buffer
+  {
+    PrepackedWeightsFileCache writer(file_path, 42);
+    writer.Add("key0", CreateEntry(std::vector<uint8_t>(16, 1)));
+    ASSERT_STATUS_OK(writer.Save());
+  }
+  {
+    std::fstream file(file_path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(-1, std::ios::end);
+    file.put(2);
+  }
+  auto status = cache.Load();
+  ASSERT_FALSE(status.IsOK());
+  EXPECT_NE(status.ErrorMessage().find("checksum"), std::string::npos) << status.ErrorMessage();
+  EXPECT_EQ(cache.GetNumberOfEntries(), 0u);
+
+  {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    file << "not a pre-packed weights cache";
+  }
+  EXPECT_FALSE(cache.Load().IsOK());
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <filesystem>
 #include <iostream>
 #include <absl/base/config.h>
 
@@ -26,6 +27,7 @@
 #include "test/util/include/test_environment.h"
 #include "test/util/include/default_providers.h"
 #include "test/util/include/file_util.h"
+#include "test/util/include/temp_dir.h"
 #include "core/optimizer/layout_transformation/layout_transformation.h"
 #include "core/optimizer/graph_optimizer_registry.h"
 
@@ -622,8 +624,29 @@ class PrePackingTestOpKernel : public OpKernel {
     return Status::OK();
   }
 
+  bool SupportsPrePackedWeightsFileCache() const override {
+    return true;
+  }
+
+  Status GetPrePackedBuffersForFileCache(int input_idx, PrePackedWeights& prepacked_buffers) const override {
+    ORT_UNUSED_PARAMETER(input_idx);
+    prepacked_buffers.buffers_.emplace_back(weight_packed_.get(), [](void*) {});
+    prepacked_buffers.buffer_sizes_.push_back(sizeof(float) * 2);
+    return Status::OK();
+  }
+
+  Status UseFileCachedPrePackedBuffers(std::vector<BufferUniquePtr>& prepacked_buffers, int input_idx,
+                                       /*out*/ bool& used_cached_buffers) override {
+    ORT_UNUSED_PARAMETER(input_idx);
+    weight_packed_ = std::move(prepacked_buffers[0]);
+    used_cached_buffers = true;
+    ++use_file_cached_weight_calls_count;
+    return Status::OK();
+  }
+
   int prepack_calls_count = 0;
   int store_pre_packed_weight_calls_count = 0;
+  int use_file_cached_weight_calls_count = 0;
   IAllocatorUniquePtr<void> weight_packed_;
 };
 
@@ -1104,6 +1127,66 @@ TEST_F(SessionStateTestSharedInitalizersWithPrePacking, test3) {
   ASSERT_EQ(session_state_2.GetUsedSharedPrePackedWeightCounter(), static_cast<size_t>(1));
 }
 
+// Pre-packing enabled + pre-packed weights cache file = the second session restores the weights from the file
+TEST_F(SessionStateTestSharedInitalizersWithPrePacking, PrepackedWeightsFileCache) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("prepacked_weights_file_cache_test"));
+  const auto cache_path = std::filesystem::path(tmp_dir.Path()) / "prepacked_weights.bin";
+
+  SessionOptions sess_options;
+  sess_options.enable_mem_pattern = true;
+  sess_options.execution_mode = ExecutionMode::ORT_SEQUENTIAL;
+  sess_options.use_deterministic_compute = false;
+  sess_options.enable_mem_reuse = true;
+  sess_options.config_options.configurations[kOrtSessionOptionsConfigDisablePrepacking] = "0";
+  sess_options.config_options.configurations[kOrtSessionOptionsPrepackedWeightsCacheFile] = cache_path.string();
+
+  auto create_session_state = [&](Model& model) {
+    CreateSimpleGraph(model.MainGraph());
+    PlaceAllNodesToCPUEP(model.MainGraph());
+    return std::make_unique<SessionState>(model.MainGraph(),
+                                          execution_providers,
+                                          tp.get(),
+                                          nullptr, /*inter_op_thread_pool*/
+                                          dtm,
+                                          edlm,
+                                          DefaultLoggingManager().DefaultLogger(),
+                                          profiler,
+                                          sess_options);
+  };
+
+  // First session packs the weight and writes it to the file
+  Model model_1("graph_main", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+                domain_to_version, std::vector<ONNX_NAMESPACE::FunctionProto>(),
+                DefaultLoggingManager().DefaultLogger());
+  auto session_state_1 = create_session_state(model_1);
+  ASSERT_STATUS_OK(session_state_1->FinalizeSessionState(std::basic_string<PATH_CHAR_TYPE>(),
+                                                         kernel_registry_manager));
+
+  const auto* kernel = reinterpret_cast<const PrePackingTestOpKernel*>(session_state_1->GetKernel(0));
+  ASSERT_EQ(kernel->prepack_calls_count, 1);
+  ASSERT_EQ(kernel->use_file_cached_weight_calls_count, 0);
+  ASSERT_EQ(session_state_1->GetUsedFileCachedPrePackedWeightCounter(), static_cast<size_t>(0));
+  ASSERT_TRUE(std::filesystem::exists(cache_path));
+
+  // Second session restores the weight from the file without calling PrePack()
+  Model model_2("graph_main", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+                domain_to_version, std::vector<ONNX_NAMESPACE::FunctionProto>(),
+                DefaultLoggingManager().DefaultLogger());
+  auto session_state_2 = create_session_state(model_2);
+  ASSERT_STATUS_OK(session_state_2->FinalizeSessionState(std::basic_string<PATH_CHAR_TYPE>(),
+                                                         kernel_registry_manager));
+
+  kernel = reinterpret_cast<const PrePackingTestOpKernel*>(session_state_2->GetKernel(0));
+  ASSERT_EQ(kernel->prepack_calls_count, 0);
+  ASSERT_EQ(kernel->use_file_cached_weight_calls_count, 1);
+  ASSERT_EQ(session_state_2->GetUsedFileCachedPrePackedWeightCounter(), static_cast<size_t>(1));
+  ASSERT_EQ(session_state_2->GetNumberOfPrepacksCounter(), static_cast<size_t>(1));
+  ASSERT_TRUE(session_state_2->GetConstantInitializedTensors().empty());
+  const float* restored = reinterpret_cast<const float*>(kernel->weight_packed_.get());
+  EXPECT_EQ(restored[0], 1.2345f);
+  EXPECT_EQ(restored[1], 1.2345f * 2.f);
+}
+
 // Pre-packing enabled + shared initializers +
 // pre-packed weights container + subgraphs =
 // caching enabled in pre-packed weights used in subgraphs
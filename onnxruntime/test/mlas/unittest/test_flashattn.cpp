@@ -0,0 +1,599 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_fp16.h"
+
+#include <cstring>
+#include <vector>
+
+class MlasFlashAttentionTest : public MlasTestBase {
+ private:
+  struct Options {
+    int batch_size;
+    int num_heads;
+    int q_sequence_length;
+    int kv_sequence_length;
+    int qk_head_size;
+    int v_head_size;
+    int q_block_size;
+    int kv_block_size;
+    MLAS_FLASH_ATTENTION_TYPE data_type;
+    bool causal;
+    bool attention_bias;  // of shape 1xNxSxT
+    bool key_bias;        // of shape BxT, masking the last b keys of batch entry b
+  };
+
+  static uint16_t FloatToBFloat16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+  }
+
+  static float BFloat16ToFloat(uint16_t value) {
+    uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+  // Rounds the fp32 values to the data type, keeping both the rounded fp32 values and their encoding
+  static void Round(MLAS_FLASH_ATTENTION_TYPE data_type, float* values, uint16_t* encoded, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      if (data_type == MLAS_FLASH_ATTENTION_TYPE::Float16) {
+        encoded[i] = MLAS_Float2Half(values[i]);
+        values[i] = MLAS_Half2Float(encoded[i]);
+      } else if (data_type == MLAS_FLASH_ATTENTION_TYPE::BFloat16) {
+        encoded[i] = FloatToBFloat16(values[i]);
+        values[i] = BFloat16ToFloat(encoded[i]);
+      }
+    }
+  }
+
+  static void ReferenceAttention(const Options& o, float scale, const float* Q, const float* K, const float* V,
+                                 const float* Bias, const float* KeyBias, float* Output) {
+    const int S = o.q_sequence_length;
+    const int T = o.kv_sequence_length;
+    std::vector<double> probs(static_cast<size_t>(T));
+    for (int b = 0; b < o.batch_size; b++) {
+      for (int h = 0; h < o.num_heads; h++) {
+        const size_t bh = static_cast<size_t>(b) * o.num_heads + h;
+        for (int s = 0; s < S; s++) {
+          const float* q = Q + (bh * S + s) * o.qk_head_size;
+          const int attended = o.causal ? std::min(T, s + T - S + 1) : T;
+          double max_score = -std::numeric_limits<double>::infinity();
+          for (int t = 0; t < attended; t++) {
+            const float* k = K + (bh * T + t) * o.qk_head_size;
+            double score = 0.0;
+            for (int i = 0; i < o.qk_head_size; i++) {
+              score += static_cast<double>(q[i]) * k[i];
+            }
+            score *= scale;
+            if (Bias != nullptr) {
+              score += Bias[(static_cast<size_t>(h) * S + s) * T + t];
+            }
+            if (KeyBias != nullptr) {
+              score += KeyBias[static_cast<size_t>(b) * T + t];
+            }
+            probs[t] = score;
+            max_score = std::max(max_score, score);
+          }
+          double sum = 0.0;
+          for (int t = 0; t < attended; t++) {
+            probs[t] = std::exp(probs[t] - max_score);
+            sum += probs[t];
+          }
+          float* output = Output + ((static_cast<size_t>(b) * S + s) * o.num_heads + h) * o.v_head_size;
+          for (int i = 0; i < o.v_head_size; i++) {
+            double value = 0.0;
+            for (int t = 0; t < attended; t++) {
+              value += probs[t] * V[(bh * T + t) * o.v_head_size + i];
+            }
+            output[i] = attended > 0 ? static_cast<float>(value / sum) : 0.0f;
+          }
+        }
+      }
+    }
+  }
+
+  void Test(const Options& o) {
+    const size_t bn = static_cast<size_t>(o.batch_size) * o.num_heads;
+    const size_t q_elements = bn * o.q_sequence_length * o.qk_head_size;
+    const size_t k_elements = bn * o.kv_sequence_length * o.qk_head_size;
+    const size_t v_elements = bn * o.kv_sequence_length * o.v_head_size;
+    const size_t output_elements = bn * o.q_sequence_length * o.v_head_size;
+    const size_t bias_elements = static_cast<size_t>(o.num_heads) * o.q_sequence_length * o.kv_sequence_length;
+    const size_t key_bias_elements = static_cast<size_t>(o.batch_size) * o.kv_sequence_length;
+
+    std::default_random_engine generator(static_cast<unsigned>(q_elements + k_elements + v_elements));
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    auto fill = [&](MatrixGuardBuffer<float>& buffer, uint16_t* encoded, size_t n) {
+      float* data = buffer.GetBuffer(n);
+      for (size_t i = 0; i < n; i++) {
+        data[i] = distribution(generator);
+      }
+      Round(o.data_type, data, encoded, n);
+      return data;
+    };
+    uint16_t* QEncoded = BufferQEncoded.GetBuffer(q_elements);
+    uint16_t* KEncoded = BufferKEncoded.GetBuffer(k_elements);
+    uint16_t* VEncoded = BufferVEncoded.GetBuffer(v_elements);
+    const float* Q = fill(BufferQ, QEncoded, q_elements);
+    const float* K = fill(BufferK, KEncoded, k_elements);
+    const float* V = fill(BufferV, VEncoded, v_elements);
+
+    float* Bias = nullptr;
+    if (o.attention_bias) {
+      Bias = BufferBias.GetBuffer(bias_elements);
+      for (size_t i = 0; i < bias_elements; i++) {
+        Bias[i] = distribution(generator);
+      }
+    }
+    float* KeyBias = nullptr;
+    if (o.key_bias) {
+      KeyBias = BufferKeyBias.GetBuffer(key_bias_elements);
+      for (int b = 0; b < o.batch_size; b++) {
+        for (int t = 0; t < o.kv_sequence_length; t++) {
+          KeyBias[static_cast<size_t>(b) * o.kv_sequence_length + t] = t >= o.kv_sequence_length - b ? -10000.0f : 0.0f;
+        }
+      }
+    }
+
+    MlasFlashAttentionThreadedArgs args;
+    args.batch_size = o.batch_size;
+    args.num_heads = o.num_heads;
+    args.q_sequence_length = o.q_sequence_length;
+    args.kv_sequence_length = o.kv_sequence_length;
+    args.qk_head_size = o.qk_head_size;
+    args.v_head_size = o.v_head_size;
+    args.q_block_size = o.q_block_size;
+    args.kv_block_size = o.kv_block_size;
+    args.scale = 1.0f / std::sqrt(static_cast<float>(o.qk_head_size));
+    args.thread_count = 3;
+    args.buffer_size_per_thread = MlasFlashAttentionBufferSizePerThread(o.data_type, o.q_block_size, o.kv_block_size,
+                                                                        o.qk_head_size, o.v_head_size);
+    args.buffer = BufferWorkspace.GetBuffer(args.buffer_size_per_thread * args.thread_count / sizeof(float));
+    args.data_type = o.data_type;
+    args.causal = o.causal;
+    args.attention_bias = Bias;
+    args.attention_bias_batch_stride = 0;
+    args.attention_bias_head_stride = static_cast<size_t>(o.q_sequence_length) * o.kv_sequence_length;
+    args.attention_bias_row_stride = static_cast<size_t>(o.kv_sequence_length);
+    args.key_bias = KeyBias;
+
+    float* Output = BufferOutput.GetBuffer(output_elements);
+    uint16_t* OutputEncoded = BufferOutputEncoded.GetBuffer(output_elements);
+    if (o.data_type == MLAS_FLASH_ATTENTION_TYPE::Float32) {
+      args.query = Q;
+      args.key = K;
+      args.value = V;
+      args.output = Output;
+    } else {
+      args.query = QEncoded;
+      args.key = KEncoded;
+      args.value = VEncoded;
+      args.output = OutputEncoded;
+    }
+
+    MlasFlashAttention(&args, GetMlasThreadPool());
+
+    if (o.data_type == MLAS_FLASH_ATTENTION_TYPE::Float16) {
+      for (size_t n = 0; n < output_elements; n++) {
+        Output[n] = MLAS_Half2Float(OutputEncoded[n]);
+      }
+    } else if (o.data_type == MLAS_FLASH_ATTENTION_TYPE::BFloat16) {
+      for (size_t n = 0; n < output_elements; n++) {
+        Output[n] = BFloat16ToFloat(OutputEncoded[n]);
+      }
+    }
+
+    float* OutputReference = BufferOutputReference.GetBuffer(output_elements);
+    ReferenceAttention(o, args.scale, Q, K, V, Bias, KeyBias, OutputReference);
+
+    // the output is rounded to the data type
+    const float Tolerance = o.data_type == MLAS_FLASH_ATTENTION_TYPE::Float32   ? 1e-5f
+                            : o.data_type == MLAS_FLASH_ATTENTION_TYPE::Float16 ? 1e-3f
+                                                                                : 8e-3f;
+    for (size_t n = 0; n < output_elements; n++) {
+      float diff = std::fabs(Output[n] - OutputReference[n]);
+      ASSERT_TRUE(diff <= Tolerance || diff <= std::fabs(OutputReference[n]) * Tolerance)
+          << " @" << n << " of " << output_elements << ", got: " << Output[n] << ", expecting: " << OutputReference[n]
+          << ", data_type=" << static_cast<int>(o.data_type) << ", S=" << o.q_sequence_length
+          << ", T=" << o.kv_sequence_length << ", causal=" << o.causal << ", attention_bias=" << o.attention_bias
+          << ", key_bias=" << o.key_bias;
+    }
+  }
+
+  MatrixGuardBuffer<float> BufferQ;
+  MatrixGuardBuffer<float> BufferK;
+  MatrixGuardBuffer<float> BufferV;
+  MatrixGuardBuffer<uint16_t> BufferQEncoded;
+  MatrixGuardBuffer<uint16_t> BufferKEncoded;
+  MatrixGuardBuffer<uint16_t> BufferVEncoded;
+  MatrixGuardBuffer<float> BufferBias;
+  MatrixGuardBuffer<float> BufferKeyBias;
+  MatrixGuardBuffer<float> BufferOutput;
+  MatrixGuardBuffer<uint16_t> BufferOutputEncoded;
+  MatrixGuardBuffer<float> BufferOutputReference;
+  MatrixGuardBuffer<float> BufferWorkspace;
+
+ public:
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name("FlashAttention");
+    return suite_name.c_str();
+  }
+
+  void ExecuteShort(void) override {
+    for (auto data_type : {MLAS_FLASH_ATTENTION_TYPE::Float32, MLAS_FLASH_ATTENTION_TYPE::Float16,
+                           MLAS_FLASH_ATTENTION_TYPE::BFloat16}) {
+      for (bool causal : {false, true}) {
+        for (bool attention_bias : {false, true}) {
+          for (bool key_bias : {false, true}) {
+            // self attention, with blocks not dividing the sequence
+            Test({2, 3, 13, 13, 16, 16, 4, 5, data_type, causal, attention_bias, key_bias});
+            // more keys than queries, as when attending a past sequence
+            Test({2, 2, 5, 19, 8, 24, 3, 8, data_type, causal, attention_bias, key_bias});
+            // fewer keys than queries, the first rows attend no key with a causal mask
+            Test({1, 2, 9, 6, 8, 8, 2, 4, data_type, causal, attention_bias, key_bias});
+          }
+        }
+      }
+    }
+  }
+};
+
+class MlasGQAFlashAttentionTest : public MlasTestBase {
+ private:
+  struct Options {
+    int batch_size;
+    int num_heads;
+    int kv_num_heads;
+    int sequence_length;
+    int head_size;
+    int kv_buffer_sequence_length;
+    std::vector<int32_t> seqlens_k;
+    bool is_prompt;
+    int local_window_size;
+    float softcap;
+    bool smooth_softmax;
+    bool attention_bias;
+    int q_block_size;
+    int kv_block_size;
+    int kv_split_count;
+    int kv_cache_bit_width;
+    int kv_page_size;  // 0 for contiguous K and V buffers
+  };
+
+  //
+  // Computes the attention of every row of Q with materialized probabilities, as GroupQueryAttention does
+  // without flash attention.
+  //
+  static void ReferenceAttention(const Options& o, float scale, const float* Q, const float* K, const float* V,
+                                 const float* Bias, float* Output) {
+    const int G = o.num_heads / o.kv_num_heads;
+    const int S = o.sequence_length;
+    const int H = o.head_size;
+    const int T = o.kv_buffer_sequence_length;
+    std::vector<float> scores(T);
+
+    for (int b = 0; b < o.batch_size; b++) {
+      const int total_seqlen = o.seqlens_k[b] + 1;
+      const int past_seqlen = o.is_prompt ? 0 : total_seqlen - S;
+      for (int h = 0; h < o.num_heads; h++) {
+        const float* k = K + (static_cast<size_t>(b) * o.kv_num_heads + h / G) * T * H;
+        const float* v = V + (static_cast<size_t>(b) * o.kv_num_heads + h / G) * T * H;
+        for (int s = 0; s < S; s++) {
+          const float* q = Q + ((static_cast<size_t>(b) * o.num_heads + h) * S + s) * H;
+          const int causal_length = past_seqlen + s + 1;
+          const int end = std::min(causal_length, total_seqlen);
+          const int start = (o.local_window_size >= 0 && causal_length > o.local_window_size + 1)
+                                ? causal_length - o.local_window_size - 1
+                                : 0;
+
+          float maximum = o.smooth_softmax ? 0.0f : std::numeric_limits<float>::lowest();
+          for (int t = start; t < end; t++) {
+            float score = 0.0f;
+            for (int i = 0; i < H; i++) {
+              score += q[i] * k[t * H + i];
+            }
+            score *= scale;
+            if (o.softcap > 0.0f) {
+              score = o.softcap * std::tanh(score / o.softcap);
+            }
+            if (Bias != nullptr) {
+              score += Bias[((static_cast<size_t>(b) * o.num_heads + h) * S + s) * T + t];
+            }
+            scores[t] = score;
+            maximum = std::max(maximum, score);
+          }
+
+          double sum = o.smooth_softmax ? std::exp(-maximum) : 0.0;
+          for (int t = start; t < end; t++) {
+            sum += std::exp(scores[t] - maximum);
+          }
+
+          float* output = Output + ((static_cast<size_t>(b) * S + s) * o.num_heads + h) * H;
+          for (int i = 0; i < H; i++) {
+            double value = 0.0;
+            for (int t = start; t < end; t++) {
+              value += std::exp(scores[t] - maximum) / sum * v[t * H + i];
+            }
+            output[i] = static_cast<float>(value);
+          }
+        }
+      }
+    }
+  }
+
+  void Test(const Options& o) {
+    const size_t q_elements = static_cast<size_t>(o.batch_size) * o.num_heads * o.sequence_length * o.head_size;
+    const size_t kv_elements =
+        static_cast<size_t>(o.batch_size) * o.kv_num_heads * o.kv_buffer_sequence_length * o.head_size;
+    const size_t bias_elements =
+        static_cast<size_t>(o.batch_size) * o.num_heads * o.sequence_length * o.kv_buffer_sequence_length;
+
+    std::default_random_engine generator(static_cast<unsigned>(q_elements + kv_elements));
+    std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+    auto fill = [&](float* data, size_t n) {
+      for (size_t i = 0; i < n; i++) {
+        data[i] = distribution(generator);
+      }
+    };
+
+    const float* Q = BufferQ.GetFilledBuffer(q_elements, fill);
+    float* K = BufferK.GetFilledBuffer(kv_elements, fill);
+    float* V = BufferV.GetFilledBuffer(kv_elements, fill);
+    const float* Bias = o.attention_bias ? BufferBias.GetFilledBuffer(bias_elements, fill) : nullptr;
+    float* Output = BufferOutput.GetBuffer(q_elements);
+    float* OutputReference = BufferOutputReference.GetBuffer(q_elements);
+
+    MlasGQAFlashAttentionArgs args;
+    args.batch_size = o.batch_size;
+    args.num_heads = o.num_heads;
+    args.kv_num_heads = o.kv_num_heads;
+    args.sequence_length = o.sequence_length;
+    args.head_size = o.head_size;
+    args.kv_buffer_sequence_length = o.kv_buffer_sequence_length;
+    args.seqlens_k = o.seqlens_k.data();
+    args.is_prompt = o.is_prompt;
+    args.local_window_size = o.local_window_size;
+    args.scale = 1.0f / std::sqrt(static_cast<float>(o.head_size));
+    args.softcap = o.softcap;
+    args.smooth_softmax = o.smooth_softmax;
+    args.attention_bias = Bias;
+    args.attention_bias_batch_stride = static_cast<size_t>(o.num_heads) * o.sequence_length * o.kv_buffer_sequence_length;
+    args.attention_bias_head_stride = static_cast<size_t>(o.sequence_length) * o.kv_buffer_sequence_length;
+    args.attention_bias_row_stride = static_cast<size_t>(o.kv_buffer_sequence_length);
+    args.q_block_size = o.q_block_size;
+    args.kv_block_size = o.kv_block_size;
+    args.kv_split_count = o.kv_split_count;
+    args.thread_count = 3;
+    args.buffer_size_per_thread = MlasGQAFlashAttentionBufferSizePerThread(o.q_block_size, o.kv_block_size, o.head_size,
+                                                                           o.kv_cache_bit_width);
+    args.buffer = BufferWorkspace.GetBuffer(args.buffer_size_per_thread * args.thread_count / sizeof(float));
+    const size_t partial_bytes = MlasGQAFlashAttentionPartialBufferSize(o.batch_size, o.num_heads, o.sequence_length,
+                                                                        o.head_size, o.kv_split_count);
+    args.partial_buffer = partial_bytes > 0 ? BufferPartial.GetBuffer(partial_bytes / sizeof(float)) : nullptr;
+    args.query = Q;
+    args.query_batch_stride = static_cast<size_t>(o.num_heads) * o.sequence_length * o.head_size;
+    args.key = K;
+    args.value = V;
+    args.output = Output;
+
+    args.kv_cache_bit_width = o.kv_cache_bit_width;
+    if (o.kv_cache_bit_width != 0) {
+      // Quantize K and V with a scale per head and channel, and compute the reference from the dequantized values.
+      const size_t kv_rows = kv_elements / o.head_size;
+      const size_t quantized_bytes = kv_elements * o.kv_cache_bit_width / 8;
+      float* Scales = BufferScales.GetFilledBuffer(
+          2 * static_cast<size_t>(o.kv_num_heads) * o.head_size, [&](float* data, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+              data[i] = (o.kv_cache_bit_width == 4 ? 2.0f / 7 : 2.0f / 127) * (1.0f + 0.01f * static_cast<float>(i % 7));
+            }
+          });
+      uint8_t* QuantizedK = BufferQuantizedK.GetBuffer(quantized_bytes);
+      uint8_t* QuantizedV = BufferQuantizedV.GetBuffer(quantized_bytes);
+      const size_t rows_per_head = static_cast<size_t>(o.kv_buffer_sequence_length);
+      for (size_t row = 0; row < kv_rows; row += rows_per_head) {
+        const size_t kv_head = (row / rows_per_head) % o.kv_num_heads;
+        const float* k_scale = Scales + kv_head * o.head_size;
+        const float* v_scale = k_scale + static_cast<size_t>(o.kv_num_heads) * o.head_size;
+        const size_t quantized_offset = row * o.head_size * o.kv_cache_bit_width / 8;
+        MlasQuantizeKVCache(K + row * o.head_size, QuantizedK + quantized_offset, rows_per_head, o.head_size, k_scale,
+                            o.kv_cache_bit_width);
+        MlasQuantizeKVCache(V + row * o.head_size, QuantizedV + quantized_offset, rows_per_head, o.head_size, v_scale,
+                            o.kv_cache_bit_width);
+        MlasDequantizeKVCache(QuantizedK + quantized_offset, K + row * o.head_size, rows_per_head, o.head_size, k_scale,
+                              o.kv_cache_bit_width);
+        MlasDequantizeKVCache(QuantizedV + quantized_offset, V + row * o.head_size, rows_per_head, o.head_size, v_scale,
+                              o.kv_cache_bit_width);
+      }
+      args.key = nullptr;
+      args.value = nullptr;
+      args.quantized_key = QuantizedK;
+      args.quantized_value = QuantizedV;
+      args.key_scale = Scales;
+      args.value_scale = Scales + static_cast<size_t>(o.kv_num_heads) * o.head_size;
+    }
+
+    args.block_table = nullptr;
+    if (o.kv_page_size != 0) {
+      // Scatter the rows of K and V to pools of pages, giving the pages of the sequences out of order.
+      const size_t page_size = static_cast<size_t>(o.kv_page_size);
+      const size_t pages_per_sequence = (static_cast<size_t>(o.kv_buffer_sequence_length) + page_size - 1) / page_size;
+      const size_t page_count = static_cast<size_t>(o.batch_size) * pages_per_sequence;
+      int32_t* BlockTable = BufferBlockTable.GetBuffer(page_count);
+      ASSERT_NE(page_count % 7, 0u) << "the block table shall be a permutation of the pages";
+      for (size_t i = 0; i < page_count; i++) {
+        BlockTable[i] = static_cast<int32_t>((i * 7 + 3) % page_count);
+      }
+
+      const size_t row_bytes = o.kv_cache_bit_width == 0 ? o.head_size * sizeof(float)
+                                                         : static_cast<size_t>(o.head_size) * o.kv_cache_bit_width / 8;
+      const size_t pool_bytes = page_count * o.kv_num_heads * page_size * row_bytes;
+      uint8_t* PoolK = BufferPoolK.GetBuffer(pool_bytes, true);
+      uint8_t* PoolV = BufferPoolV.GetBuffer(pool_bytes, true);
+      const uint8_t* SourceK = o.kv_cache_bit_width == 0 ? reinterpret_cast<const uint8_t*>(K)
+                                                         : static_cast<const uint8_t*>(args.quantized_key);
+      const uint8_t* SourceV = o.kv_cache_bit_width == 0 ? reinterpret_cast<const uint8_t*>(V)
+                                                         : static_cast<const uint8_t*>(args.quantized_value);
+      for (size_t b = 0; b < static_cast<size_t>(o.batch_size); b++) {
+        for (size_t h = 0; h < static_cast<size_t>(o.kv_num_heads); h++) {
+          for (size_t t = 0; t < static_cast<size_t>(o.kv_buffer_sequence_length); t++) {
+            const size_t page = static_cast<size_t>(BlockTable[b * pages_per_sequence + t / page_size]);
+            const size_t source_row = (b * o.kv_num_heads + h) * o.kv_buffer_sequence_length + t;
+            const size_t pool_row = (page * o.kv_num_heads + h) * page_size + t % page_size;
+            std::copy_n(SourceK + source_row * row_bytes, row_bytes, PoolK + pool_row * row_bytes);
+            std::copy_n(SourceV + source_row * row_bytes, row_bytes, PoolV + pool_row * row_bytes);
+          }
+        }
+      }
+
+      if (o.kv_cache_bit_width == 0) {
+        args.key = reinterpret_cast<const float*>(PoolK);
+        args.value = reinterpret_cast<const float*>(PoolV);
+      } else {
+        args.quantized_key = PoolK;
+        args.quantized_value = PoolV;
+      }
+      args.block_table = BlockTable;
+      args.max_pages_per_sequence = static_cast<int>(pages_per_sequence);
+      args.kv_page_size = o.kv_page_size;
+    }
+
+    MlasGQAFlashAttention(&args, GetMlasThreadPool());
+    ReferenceAttention(o, args.scale, Q, K, V, Bias, OutputReference);
+
+    constexpr float AbsoluteTolerance = 1e-5f;
+    constexpr float RelativeTolerance = 1e-4f;
+    for (size_t n = 0; n < q_elements; n++) {
+      float diff = std::fabs(Output[n] - OutputReference[n]);
+      ASSERT_TRUE(diff <= AbsoluteTolerance || diff <= std::fabs(OutputReference[n]) * RelativeTolerance)
+          << " @" << n << " of " << q_elements << ", got: " << Output[n] << ", expecting: " << OutputReference[n]
+          << ", S=" << o.sequence_length << ", local_window_size=" << o.local_window_size
+          << ", softcap=" << o.softcap << ", smooth_softmax=" << o.smooth_softmax
+          << ", attention_bias=" << o.attention_bias << ", kv_split_count=" << o.kv_split_count;
+    }
+  }
+
+  MatrixGuardBuffer<float> BufferQ;
+  MatrixGuardBuffer<float> BufferK;
+  MatrixGuardBuffer<float> BufferV;
+  MatrixGuardBuffer<float> BufferBias;
+  MatrixGuardBuffer<float> BufferOutput;
+  MatrixGuardBuffer<float> BufferOutputReference;
+  MatrixGuardBuffer<float> BufferWorkspace;
+  MatrixGuardBuffer<float> BufferPartial;
+  MatrixGuardBuffer<float> BufferScales;
+  MatrixGuardBuffer<uint8_t> BufferQuantizedK;
+  MatrixGuardBuffer<uint8_t> BufferQuantizedV;
+  MatrixGuardBuffer<int32_t> BufferBlockTable;
+  MatrixGuardBuffer<uint8_t> BufferPoolK;
+  MatrixGuardBuffer<uint8_t> BufferPoolV;
+
+ public:
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name("GQAFlashAttention");
+    return suite_name.c_str();
+  }
+
+  void ExecuteShort(void) override {
+    for (int kv_split_count : {1, 3}) {
+      for (int local_window_size : {-1, 4}) {
+        for (float softcap : {0.0f, 5.0f}) {
+          for (bool smooth_softmax : {false, true}) {
+            for (bool attention_bias : {false, true}) {
+              // token generation with 4 heads of Q per head of K and V
+              Test({2, 8, 2, 1, 16, 40, {20, 39}, false, local_window_size, softcap, smooth_softmax, attention_bias,
+                    3, 7, kv_split_count, 0, 0});
+              // prompt, with padding of the second batch entry
+              Test({2, 4, 4, 6, 8, 32, {9, 4}, true, local_window_size, softcap, smooth_softmax, attention_bias,
+                    4, 5, kv_split_count, 0, 0});
+              // continued prompt
+              Test({1, 6, 2, 3, 8, 24, {17}, false, local_window_size, softcap, smooth_softmax, attention_bias,
+                    16, 64, kv_split_count, 0, 0});
+            }
+          }
+        }
+      }
+
+      // token generation and prompt over a quantized K/V cache
+      for (int kv_cache_bit_width : {8, 4}) {
+        Test({2, 8, 2, 1, 16, 40, {20, 39}, false, -1, 0.0f, false, false, 3, 7, kv_split_count, kv_cache_bit_width, 0});
+        Test({2, 4, 4, 6, 8, 32, {9, 4}, true, 4, 0.0f, false, true, 4, 5, kv_split_count, kv_cache_bit_width, 0});
+      }
+
+      // token generation and prompt over a paged K/V cache, with blocks smaller and larger than the pages
+      for (int kv_cache_bit_width : {0, 4}) {
+        for (int kv_page_size : {4, 16}) {
+          Test({2, 8, 2, 1, 16, 40, {20, 39}, false, -1, 0.0f, false, false, 3, 7, kv_split_count, kv_cache_bit_width,
+                kv_page_size});
+          Test({2, 4, 4, 6, 8, 32, {9, 4}, true, 4, 0.0f, false, true, 4, 5, kv_split_count, kv_cache_bit_width,
+                kv_page_size});
+        }
+      }
+    }
+  }
+};
+
+class MlasKVCacheQuantTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferInput;
+  MatrixGuardBuffer<float> BufferScales;
+  MatrixGuardBuffer<uint8_t> BufferQuantized;
+  MatrixGuardBuffer<float> BufferOutput;
+
+  void Test(size_t Rows, size_t Channels, size_t BitWidth) {
+    const int32_t maximum = BitWidth == 4 ? 7 : 127;
+
+    std::default_random_engine generator(static_cast<unsigned>(Rows * Channels));
+    std::uniform_real_distribution<float> distribution(-1.2f, 1.2f);
+
+    float* Scales = BufferScales.GetBuffer(Channels);
+    for (size_t c = 0; c < Channels; c++) {
+      Scales[c] = (1.0f + static_cast<float>(c % 5)) / static_cast<float>(maximum);
+    }
+    float* Input = BufferInput.GetBuffer(Rows * Channels);
+    for (size_t i = 0; i < Rows * Channels; i++) {
+      Input[i] = distribution(generator) * (1.0f + static_cast<float>((i % Channels) % 5));
+    }
+    uint8_t* Quantized = BufferQuantized.GetBuffer(Rows * Channels * BitWidth / 8);
+    float* Output = BufferOutput.GetBuffer(Rows * Channels);
+
+    MlasQuantizeKVCache(Input, Quantized, Rows, Channels, Scales, BitWidth);
+    MlasDequantizeKVCache(Quantized, Output, Rows, Channels, Scales, BitWidth);
+
+    for (size_t i = 0; i < Rows * Channels; i++) {
+      const float scale = Scales[i % Channels];
+      const float expected = std::clamp(std::nearbyint(Input[i] / scale), static_cast<float>(-maximum - 1),
+                                        static_cast<float>(maximum)) *
+                             scale;
+      ASSERT_EQ(Output[i], expected) << " @" << i << " of " << Rows << "x" << Channels << ", bit width " << BitWidth
+                                     << ", input: " << Input[i];
+    }
+  }
+
+ public:
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name("KVCacheQuant");
+    return suite_name.c_str();
+  }
+
+  void ExecuteShort(void) override {
+    for (size_t BitWidth : {8, 4}) {
+      for (size_t Channels : {8, 16, 24, 64, 80, 128}) {
+        Test(1, Channels, BitWidth);
+        Test(7, Channels, BitWidth);
+      }
+    }
+  }
+};
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasFlashAttentionTest>::RegisterShortExecute();
+    count += MlasDirectShortExecuteTests<MlasGQAFlashAttentionTest>::RegisterShortExecute();
+    count += MlasDirectShortExecuteTests<MlasKVCacheQuantTest>::RegisterShortExecute();
+  }
+  return count;
+});
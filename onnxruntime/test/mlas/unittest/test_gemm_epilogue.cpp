@@ -0,0 +1,260 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_util.h"
+
+#include <cmath>
+#include <vector>
+
+//
+// Verifies the composable GEMM epilogue against a reference that applies the
+// same operations after a plain matrix multiplication.
+//
+
+class MlasGemmEpilogueTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferA;
+  MatrixGuardBuffer<float> BufferB;
+  MatrixGuardBuffer<float> BufferBias;
+  MatrixGuardBuffer<float> BufferResidual;
+  MatrixGuardBuffer<float> BufferC;
+  MatrixGuardBuffer<float> BufferCReference;
+  MatrixGuardBuffer<int8_t> BufferQuantized;
+  MatrixGuardBuffer<uint8_t> BufferQA;
+  MatrixGuardBuffer<uint8_t> BufferQB;
+  MatrixGuardBuffer<int32_t> BufferQC;
+  MLAS_THREADPOOL* threadpool_;
+
+  static constexpr float QuantizedScale = 16.0f;
+  static constexpr int8_t QuantizedZeroPoint = -3;
+
+  static void ReferenceEpilogue(float* C, size_t M, size_t N, size_t ldc, const float* Bias, const float* Residual,
+                                int Variant) {
+    for (size_t m = 0; m < M; m++) {
+      for (size_t n = 0; n < N; n++) {
+        float& c = C[m * ldc + n];
+        switch (Variant) {
+          case 0:
+            c += Bias[n];
+            c = 0.5f * c * (1.0f + std::erf(c * 0.7071067811865476f));
+            c += Residual[m * N + n];
+            break;
+          case 1:
+            c = 0.5f * (c + 2.0f * Bias[n]);
+            c = 0.5f * c * (1.0f + std::tanh(0.7978845608028654f * (c + 0.044715f * c * c * c)));
+            break;
+          case 2:
+            c += Residual[m * N + n];
+            c = c / (1.0f + std::exp(-1.702f * c));
+            break;
+          default:
+            c = std::max(c + Bias[n], 0.0f) - 0.25f * Residual[m * N + n];
+            break;
+        }
+      }
+    }
+  }
+
+  static void BuildEpilogue(MLAS_GEMM_EPILOGUE_PROCESSOR& Epilogue, size_t N, const float* Bias,
+                            const float* Residual, int Variant) {
+    switch (Variant) {
+      case 0:
+        Epilogue.AddBias(Bias);
+        Epilogue.AddActivation(MlasGemmEpilogueGelu);
+        Epilogue.AddResidual(Residual, N);
+        break;
+      case 1:
+        Epilogue.AddBias(Bias, 2.0f);
+        Epilogue.AddScale(0.5f);
+        Epilogue.AddActivation(MlasGemmEpilogueFastGelu);
+        break;
+      case 2:
+        Epilogue.AddResidual(Residual, N);
+        Epilogue.AddActivation(MlasGemmEpilogueSilu, 1.702f);
+        break;
+      default: {
+        MLAS_ACTIVATION Activation;
+        Activation.ActivationKind = MlasReluActivation;
+        Epilogue.AddBias(Bias);
+        Epilogue.AddActivation(Activation);
+        Epilogue.AddResidual(Residual, N, -0.25f);
+        break;
+      }
+    }
+  }
+
+  static bool IsClose(float actual, float expected) {
+    return std::abs(actual - expected) <= 1e-4f + 1e-3f * std::abs(expected);
+  }
+
+  void TestSgemm(bool TransA, bool TransB, bool PackB, size_t M, size_t N, size_t K, float beta, int Variant,
+                 bool Quantize) {
+    const float* A = BufferA.GetBuffer(M * K);
+    const float* B = BufferB.GetBuffer(K * N);
+    const float* Bias = BufferBias.GetBuffer(N);
+    const float* Residual = BufferResidual.GetBuffer(M * N);
+    float* C = BufferC.GetBuffer(M * N);
+    float* CReference = BufferCReference.GetBuffer(M * N);
+    int8_t* Quantized = BufferQuantized.GetBuffer(M * N);
+
+    for (size_t i = 0; i < M * N; i++) {
+      C[i] = CReference[i] = float(int(i % 13) - 6) * 0.25f;
+    }
+
+    MLAS_GEMM_EPILOGUE_PROCESSOR Epilogue;
+    BuildEpilogue(Epilogue, N, Bias, Residual, Variant);
+    if (Quantize) {
+      Epilogue.SetQuantizedOutput(Quantized, N, QuantizedScale, QuantizedZeroPoint);
+    }
+
+    std::vector<uint8_t> PackedB;
+
+    MLAS_SGEMM_DATA_PARAMS Data;
+    Data.A = A;
+    Data.lda = TransA ? M : K;
+    Data.B = B;
+    Data.ldb = TransB ? K : N;
+    Data.C = C;
+    Data.ldc = N;
+    Data.alpha = 0.75f;
+    Data.beta = beta;
+    Data.OutputProcessor = &Epilogue;
+
+    if (PackB) {
+      PackedB.resize(MlasGemmPackBSize(N, K));
+      MlasGemmPackB(TransB ? CblasTrans : CblasNoTrans, N, K, B, Data.ldb, PackedB.data());
+      Data.B = reinterpret_cast<const float*>(PackedB.data());
+      Data.BIsPacked = true;
+    }
+
+    MlasGemm(TransA ? CblasTrans : CblasNoTrans, TransB ? CblasTrans : CblasNoTrans, M, N, K, Data, threadpool_);
+
+    for (size_t m = 0; m < M; m++) {
+      for (size_t n = 0; n < N; n++) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < K; k++) {
+          sum += (TransA ? A[k * M + m] : A[m * K + k]) * (TransB ? B[n * K + k] : B[k * N + n]);
+        }
+        CReference[m * N + n] = 0.75f * sum + beta * CReference[m * N + n];
+      }
+    }
+
+    ReferenceEpilogue(CReference, M, N, N, Bias, Residual, Variant);
+
+    for (size_t i = 0; i < M * N; i++) {
+      ASSERT_TRUE(IsClose(C[i], CReference[i]))
+          << "SGEMM epilogue mismatch at " << i << ": " << C[i] << " vs " << CReference[i] << " Variant=" << Variant
+          << " TransA=" << TransA << " TransB=" << TransB << " PackB=" << PackB << " M=" << M << " N=" << N
+          << " K=" << K;
+      if (Quantize) {
+        int32_t expected = int32_t(std::nearbyint(C[i] / QuantizedScale)) + QuantizedZeroPoint;
+        expected = std::min(std::max(expected, -128), 127);
+        ASSERT_LE(std::abs(int32_t(Quantized[i]) - expected), 1)
+            << "quantized output mismatch at " << i << ": " << int32_t(Quantized[i]) << " vs " << expected;
+      }
+    }
+  }
+
+  void TestQgemm(size_t M, size_t N, size_t K) {
+    const uint8_t* A = BufferQA.GetBuffer(M * K);
+    const uint8_t* B = BufferQB.GetBuffer(K * N);
+    const float* Bias = BufferBias.GetBuffer(N);
+    const float* Residual = BufferResidual.GetBuffer(M * N);
+    int32_t* C = BufferQC.GetBuffer(M * N);
+    float* Output = BufferC.GetBuffer(M * N);
+    float* OutputReference = BufferCReference.GetBuffer(M * N);
+
+    const uint8_t ZeroPointA = 5;
+    const uint8_t ZeroPointB = 9;
+    const float Scale = 0.001f;
+
+    MLAS_GEMM_EPILOGUE_PROCESSOR Epilogue;
+    Epilogue.AddActivation(MlasGemmEpilogueGelu);
+    Epilogue.AddResidual(Residual, N);
+
+    MLAS_QGEMM_SCALE_BIAS_OUTPUT_PROCESSOR OutputProcessor(Output, N, &Scale, Bias,
+                                                           MLAS_QGEMM_OUTPUT_MODE::ZeroMode,
+                                                           MLAS_QUANTIZATION_GRANULARITY::PerMatrix, &Epilogue);
+
+    MLAS_GEMM_QUANT_SHAPE_PARAMS Shape;
+    Shape.M = M;
+    Shape.N = N;
+    Shape.K = K;
+
+    MLAS_GEMM_QUANT_DATA_PARAMS Data;
+    Data.A = A;
+    Data.lda = K;
+    Data.ZeroPointA = ZeroPointA;
+    Data.B = B;
+    Data.ldb = N;
+    Data.ZeroPointB = &ZeroPointB;
+    Data.C = C;
+    Data.ldc = N;
+    Data.OutputProcessor = &OutputProcessor;
+
+    MlasGemm(Shape, Data, threadpool_);
+
+    for (size_t m = 0; m < M; m++) {
+      for (size_t n = 0; n < N; n++) {
+        int32_t sum = 0;
+        for (size_t k = 0; k < K; k++) {
+          sum += (int32_t(A[m * K + k]) - ZeroPointA) * (int32_t(B[k * N + n]) - ZeroPointB);
+        }
+        OutputReference[m * N + n] = float(sum) * Scale;
+      }
+    }
+
+    ReferenceEpilogue(OutputReference, M, N, N, Bias, Residual, 0);
+
+    for (size_t i = 0; i < M * N; i++) {
+      ASSERT_TRUE(IsClose(Output[i], OutputReference[i]))
+          << "QGEMM epilogue mismatch at " << i << ": " << Output[i] << " vs " << OutputReference[i] << " M=" << M
+          << " N=" << N << " K=" << K;
+    }
+  }
+
+ public:
+  MlasGemmEpilogueTest() : threadpool_(GetMlasThreadPool()) {}
+
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name("GemmEpilogue");
+    return suite_name.c_str();
+  }
+
+  void ExecuteShort(void) override {
+    for (int Variant = 0; Variant < 4; Variant++) {
+      for (bool TransA : {false, true}) {
+        for (bool TransB : {false, true}) {
+          for (bool PackB : {false, true}) {
+            for (size_t M : {1, 13, 40}) {
+              for (size_t N : {1, 37, 300}) {
+                for (size_t K : {5, 300}) {
+                  TestSgemm(TransA, TransB, PackB, M, N, K, (M + N) % 2 == 0 ? 0.0f : 1.0f, Variant,
+                            Variant == 0 && !PackB);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+
+    // The output processor also runs for an empty inner dimension.
+    TestSgemm(false, false, false, 7, 33, 0, 0.0f, 0, true);
+    TestSgemm(false, false, false, 7, 33, 0, 1.0f, 3, false);
+
+    for (size_t M : {1, 11, 64}) {
+      for (size_t N : {3, 48, 130}) {
+        TestQgemm(M, N, 33);
+      }
+    }
+  }
+};
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasGemmEpilogueTest>::RegisterShortExecute();
+  }
+  return count;
+});
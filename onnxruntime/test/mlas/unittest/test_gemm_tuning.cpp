@@ -0,0 +1,199 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_util.h"
+
+#include <vector>
+
+//
+// Verifies that GEMM results are unchanged when MlasGemmBatch runs with tuned
+// thread partitions and blocking, including parameters injected as if they
+// were loaded from a previous run.
+//
+
+class MlasGemmTuningTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferA;
+  MatrixGuardBuffer<float> BufferB;
+  MatrixGuardBuffer<float> BufferC;
+  MatrixGuardBuffer<float> BufferCReference;
+  MatrixGuardBuffer<uint8_t> BufferQA;
+  MatrixGuardBuffer<uint8_t> BufferQB;
+  MatrixGuardBuffer<int32_t> BufferQC;
+  MatrixGuardBuffer<int32_t> BufferQCReference;
+  MLAS_THREADPOOL* threadpool_;
+
+  void TestSgemm(bool TransA, bool TransB, size_t M, size_t N, size_t K, float beta) {
+    const float* A = BufferA.GetBuffer(M * K);
+    const float* B = BufferB.GetBuffer(K * N);
+    float* C = BufferC.GetBuffer(M * N);
+    float* CReference = BufferCReference.GetBuffer(M * N);
+
+    for (size_t i = 0; i < M * N; i++) {
+      C[i] = CReference[i] = float(int(i % 13) - 6);
+    }
+
+    MLAS_SGEMM_DATA_PARAMS Data;
+    Data.A = A;
+    Data.lda = TransA ? M : K;
+    Data.B = B;
+    Data.ldb = TransB ? K : N;
+    Data.C = C;
+    Data.ldc = N;
+    Data.beta = beta;
+
+    MlasGemm(TransA ? CblasTrans : CblasNoTrans, TransB ? CblasTrans : CblasNoTrans, M, N, K, Data, threadpool_);
+
+    for (size_t m = 0; m < M; m++) {
+      for (size_t n = 0; n < N; n++) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < K; k++) {
+          sum += (TransA ? A[k * M + m] : A[m * K + k]) * (TransB ? B[n * K + k] : B[k * N + n]);
+        }
+        CReference[m * N + n] = sum + beta * CReference[m * N + n];
+      }
+    }
+
+    for (size_t i = 0; i < M * N; i++) {
+      ASSERT_TRUE(CloseEnough(C[i], CReference[i]))
+          << "SGEMM mismatch at " << i << ": " << C[i] << " vs " << CReference[i] << " TransA=" << TransA
+          << " TransB=" << TransB << " M=" << M << " N=" << N << " K=" << K;
+    }
+  }
+
+  void TestQgemm(size_t M, size_t N, size_t K) {
+    const uint8_t* A = BufferQA.GetBuffer(M * K);
+    const uint8_t* B = BufferQB.GetBuffer(K * N);
+    int32_t* C = BufferQC.GetBuffer(M * N);
+    int32_t* CReference = BufferQCReference.GetBuffer(M * N);
+
+    const uint8_t ZeroPointA = 7;
+    const uint8_t ZeroPointB = 11;
+
+    MLAS_GEMM_QUANT_SHAPE_PARAMS Shape;
+    Shape.M = M;
+    Shape.N = N;
+    Shape.K = K;
+
+    MLAS_GEMM_QUANT_DATA_PARAMS Data;
+    Data.A = A;
+    Data.lda = K;
+    Data.ZeroPointA = ZeroPointA;
+    Data.B = B;
+    Data.ldb = N;
+    Data.ZeroPointB = &ZeroPointB;
+    Data.C = C;
+    Data.ldc = N;
+
+    MlasGemm(Shape, Data, threadpool_);
+
+    for (size_t m = 0; m < M; m++) {
+      for (size_t n = 0; n < N; n++) {
+        int32_t sum = 0;
+        for (size_t k = 0; k < K; k++) {
+          sum += (int32_t(A[m * K + k]) - ZeroPointA) * (int32_t(B[k * N + n]) - ZeroPointB);
+        }
+        CReference[m * N + n] = sum;
+      }
+    }
+
+    ASSERT_EQ(memcmp(C, CReference, M * N * sizeof(int32_t)), 0) << "QGEMM mismatch M=" << M << " N=" << N << " K=" << K;
+  }
+
+  void TestAll() {
+    for (bool TransA : {false, true}) {
+      for (bool TransB : {false, true}) {
+        for (size_t M : {1, 7, 64}) {
+          for (size_t N : {5, 48, 257}) {
+            for (size_t K : {3, 96}) {
+              TestSgemm(TransA, TransB, M, N, K, M % 2 == 0 ? 0.0f : 0.5f);
+            }
+          }
+        }
+      }
+    }
+
+    for (size_t M : {1, 9, 64}) {
+      for (size_t N : {3, 64, 200}) {
+        TestQgemm(M, N, 40);
+      }
+    }
+  }
+
+ public:
+  MlasGemmTuningTest() : threadpool_(GetMlasThreadPool()) {}
+
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name("GemmTuning");
+    return suite_name.c_str();
+  }
+
+  void ExecuteShort(void) override {
+    MlasGemmTuningClearResults();
+
+    //
+    // The mode of another thread pool does not apply to these GEMMs.
+    //
+
+    if (threadpool_ != nullptr) {
+      MlasGemmTuningSetMode(nullptr, this, true, true, 0);
+      TestAll();
+      ASSERT_EQ(MlasGemmTuningGetResults(nullptr, 0), size_t(0));
+      MlasGemmTuningSetMode(nullptr, this, false, false, 0);
+    }
+
+    //
+    // The thread pool keeps tuning while any of its owners has a mode set.
+    //
+
+    int OtherOwner = 0;
+    MlasGemmTuningSetMode(threadpool_, &OtherOwner, true, true, 0);
+    MlasGemmTuningSetMode(threadpool_, this, true, true, 0);
+    MlasGemmTuningSetMode(threadpool_, &OtherOwner, false, false, 0);
+    TestAll();
+
+    std::vector<MLAS_GEMM_TUNING_RESULT> Results(MlasGemmTuningGetResults(nullptr, 0));
+    ASSERT_GT(Results.size(), size_t(0));
+    MlasGemmTuningGetResults(Results.data(), Results.size());
+
+    //
+    // Replace the tuned parameters with arbitrary valid and invalid ones.
+    // Invalid parameters must be ignored in favor of the defaults.
+    //
+
+    MlasGemmTuningSetMode(threadpool_, this, true, false, 0);
+
+    for (auto Result : Results) {
+      Result.ThreadCountM = std::min(Result.M, Result.MaximumThreadCount);
+      Result.ThreadCountN = 1;
+      Result.StrideN = (Result.Kind == MlasGemmTuningSgemm) ? 256 : 0;
+      MlasGemmTuningAddResult(Result);
+    }
+    TestAll();
+
+    for (auto Result : Results) {
+      Result.ThreadCountM = Result.M + 1;
+      Result.StrideN = 48;
+      MlasGemmTuningAddResult(Result);
+    }
+    TestAll();
+
+    MlasGemmTuningClearResults();
+    MlasGemmTuningSetMode(threadpool_, this, false, false, 0);
+
+    //
+    // Without a mode the thread pool does not tune anymore.
+    //
+
+    TestAll();
+    ASSERT_EQ(MlasGemmTuningGetResults(nullptr, 0), size_t(0));
+  }
+};
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasGemmTuningTest>::RegisterShortExecute();
+  }
+  return count;
+});
@@ -0,0 +1,133 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    test_hgemm.cpp
+
+Abstract:
+
+    Tests for MLAS fp16 GEMM on x64 CPU.
+
+--*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "test_util.h"
+#include "core/mlas/lib/mlasi.h"
+
+#if defined(MLAS_TARGET_AMD64)
+
+class MlasHGemmTest : public MlasTestBase {
+ private:
+  unsigned int seed_;
+  std::mt19937 gen_;
+  std::uniform_real_distribution<float> distrib_;
+  MatrixGuardBuffer<MLAS_FP16> A_, B_, ref_, C_;
+
+  template <bool transB>
+  void HGemm(size_t M, size_t N, size_t K, const MLAS_FP16* A, const MLAS_FP16* B, MLAS_FP16* C,
+             MLAS_FP16 alpha, MLAS_FP16 beta, size_t lda, size_t ldb, size_t ldc) {
+    float alphaf = alpha.ToFloat();
+    float betaf = beta.ToFloat();
+    for (size_t i = 0; i < M; ++i) {
+      for (size_t j = 0; j < N; ++j) {
+        float accu = 0.0f;
+        for (size_t k = 0; k < K; ++k) {
+          accu += A[i * lda + k].ToFloat() * B[transB ? j * ldb + k : k * ldb + j].ToFloat();
+        }
+        float c = accu * alphaf;
+        if (betaf != 0.0f) {
+          c += C[i * ldc + j].ToFloat() * betaf;
+        }
+        C[i * ldc + j] = MLAS_FP16(c);
+      }
+    }
+  }
+
+  template <bool transB>
+  void TestHGemm(size_t M, size_t N, size_t K, MLAS_FP16 alpha, MLAS_FP16 beta) {
+    auto InitializeBuffer = [this](MLAS_FP16* buffer, size_t count) {
+      for (size_t i = 0; i < count; i++) {
+        buffer[i] = MLAS_FP16(distrib_(gen_));
+      }
+    };
+
+    const size_t lda = K + 3;
+    const size_t ldb = transB ? K + 5 : N + 5;
+    const size_t ldc = N + 7;
+    const auto* A = A_.GetFilledBuffer(M * lda, InitializeBuffer);
+    const auto* B = B_.GetFilledBuffer(transB ? N * ldb : K * ldb, InitializeBuffer);
+    auto* C = C_.GetFilledBuffer(M * ldc, InitializeBuffer);
+    auto* ref = ref_.GetBuffer(M * ldc, true);
+    if (beta.ToFloat() == 0.0f) {
+      // C is not read when beta is 0
+      for (size_t i = 0; i < M * ldc; ++i) {
+        C[i] = MLAS_FP16(std::numeric_limits<float>::quiet_NaN());
+      }
+    }
+    std::copy(C, C + M * ldc, ref);
+
+    MlasGemm(CblasNoTrans, transB ? CblasTrans : CblasNoTrans,
+             M, N, K, A, lda, B, ldb, C, ldc, alpha.val, beta.val, nullptr);
+    HGemm<transB>(M, N, K, A, B, ref, alpha, beta, lda, ldb, ldc);
+
+    for (size_t i = 0; i < M; ++i) {
+      for (size_t j = 0; j < N; ++j) {
+        const float value = C[i * ldc + j].ToFloat();
+        const float expected = ref[i * ldc + j].ToFloat();
+        ASSERT_TRUE(std::abs(value - expected) <= std::abs(expected * 0.02f) + 0.055f)
+            << " seed " << seed_ << " i " << i << " j " << j << " M " << M << " N " << N << " K " << K
+            << " transB " << transB << " value " << value << " ref " << expected;
+      }
+      // the padding of C is untouched
+      for (size_t j = N; j < ldc; ++j) {
+        ASSERT_EQ(C[i * ldc + j].val, ref[i * ldc + j].val);
+      }
+    }
+  }
+
+ public:
+  MlasHGemmTest()
+      : seed_(192837), gen_(seed_), distrib_(-0.25f, 0.25f) {
+  }
+
+  static const char* GetTestSuiteName() {
+    return "HGemm";
+  }
+
+  void ExecuteShort(void) override {
+    for (bool transB : {false, true}) {
+      auto test = transB ? &MlasHGemmTest::TestHGemm<true> : &MlasHGemmTest::TestHGemm<false>;
+      (this->*test)(1, 1, 1, MLAS_FP16(1.0f), MLAS_FP16(0.0f));
+      (this->*test)(2, 17, 3, MLAS_FP16(1.0f), MLAS_FP16(1.0f));
+      (this->*test)(1, 512, 128, MLAS_FP16(0.5f), MLAS_FP16(1.0f));
+      (this->*test)(2, 513, 128, MLAS_FP16(1.5f), MLAS_FP16(0.5f));
+      (this->*test)(2, 511, 129, MLAS_FP16(0.5f), MLAS_FP16(0.0f));
+      (this->*test)(1, 1023, 513, MLAS_FP16(0.5f), MLAS_FP16(1.0f));
+      (this->*test)(3, 15, 33, MLAS_FP16(1.0f), MLAS_FP16(0.0f));
+      (this->*test)(5, 31, 700, MLAS_FP16(1.0f), MLAS_FP16(1.0f));
+      (this->*test)(16, 100, 7, MLAS_FP16(1.0f), MLAS_FP16(0.5f));
+      (this->*test)(127, 1023, 513, MLAS_FP16(1.0f), MLAS_FP16(0.0f));
+      (this->*test)(129, 1025, 511, MLAS_FP16(0.5f), MLAS_FP16(1.0f));
+      (this->*test)(64, 257, 2049, MLAS_FP16(0.25f), MLAS_FP16(0.5f));
+    }
+  }
+};
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute && MlasHGemmSupported(CblasNoTrans, CblasTrans)) {
+    count += MlasDirectShortExecuteTests<MlasHGemmTest>::RegisterShortExecute();
+  }
+  return count;
+});
+
+#endif  // defined(MLAS_TARGET_AMD64)
@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_util.h"
+
+#include <vector>
+
+//
+// Verifies batches of small SGEMM operations, both as strided batches and as
+// arrays of data parameters, including the shapes that read matrix B in place.
+//
+
+class MlasSgemmBatchTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferA;
+  MatrixGuardBuffer<float> BufferB;
+  MatrixGuardBuffer<float> BufferC;
+  MatrixGuardBuffer<float> BufferCReference;
+  MLAS_THREADPOOL* threadpool_;
+
+  static void ReferenceGemm(bool TransA, bool TransB, size_t M, size_t N, size_t K, float alpha, const float* A,
+                            size_t lda, const float* B, size_t ldb, float beta, float* C, size_t ldc) {
+    for (size_t m = 0; m < M; m++) {
+      for (size_t n = 0; n < N; n++) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < K; k++) {
+          sum += (TransA ? A[k * lda + m] : A[m * lda + k]) * (TransB ? B[n * ldb + k] : B[k * ldb + n]);
+        }
+        C[m * ldc + n] = alpha * sum + (beta == 0.0f ? 0.0f : beta * C[m * ldc + n]);
+      }
+    }
+  }
+
+  //
+  // Runs a batch where the leading dimensions are padded beyond the matrix
+  // shapes, so that kernels that ignore them produce wrong results.
+  //
+
+  void Test(bool TransA, bool TransB, bool SharedB, bool PackB, bool Strided, size_t M, size_t N, size_t K,
+            size_t BatchSize, float alpha, float beta) {
+    const size_t lda = (TransA ? M : K) + 3;
+    const size_t ldb = (TransB ? K : N) + 5;
+    const size_t ldc = N + 2;
+    const size_t StrideA = (TransA ? K : M) * lda;
+    const size_t StrideB = SharedB ? 0 : (TransB ? N : K) * ldb;
+    const size_t StrideC = M * ldc;
+
+    const float* A = BufferA.GetBuffer(StrideA * BatchSize);
+    const float* B = BufferB.GetBuffer(SharedB ? (TransB ? N : K) * ldb : StrideB * BatchSize);
+    float* C = BufferC.GetBuffer(StrideC * BatchSize);
+    float* CReference = BufferCReference.GetBuffer(StrideC * BatchSize);
+
+    for (size_t i = 0; i < StrideC * BatchSize; i++) {
+      C[i] = CReference[i] = float(int(i % 11) - 5);
+    }
+
+    std::vector<uint8_t> PackedB;
+
+    MLAS_SGEMM_DATA_PARAMS Data;
+    Data.A = A;
+    Data.lda = lda;
+    Data.B = B;
+    Data.ldb = ldb;
+    Data.C = C;
+    Data.ldc = ldc;
+    Data.alpha = alpha;
+    Data.beta = beta;
+
+    if (PackB) {
+      PackedB.resize(MlasGemmPackBSize(N, K));
+      MlasGemmPackB(TransB ? CblasTrans : CblasNoTrans, N, K, B, ldb, PackedB.data());
+      Data.B = reinterpret_cast<const float*>(PackedB.data());
+      Data.BIsPacked = true;
+    }
+
+    if (Strided) {
+      MlasGemmStridedBatch(TransA ? CblasTrans : CblasNoTrans, TransB ? CblasTrans : CblasNoTrans, M, N, K, Data,
+                           StrideA, PackB ? 0 : StrideB, StrideC, BatchSize, threadpool_);
+    } else {
+      std::vector<MLAS_SGEMM_DATA_PARAMS> BatchData(BatchSize, Data);
+      for (size_t b = 0; b < BatchSize; b++) {
+        BatchData[b].A = A + b * StrideA;
+        BatchData[b].C = C + b * StrideC;
+        if (!PackB) {
+          BatchData[b].B = B + b * StrideB;
+        }
+      }
+      MlasGemmBatch(TransA ? CblasTrans : CblasNoTrans, TransB ? CblasTrans : CblasNoTrans, M, N, K,
+                    BatchData.data(), BatchSize, threadpool_);
+    }
+
+    for (size_t b = 0; b < BatchSize; b++) {
+      ReferenceGemm(TransA, TransB, M, N, K, alpha, A + b * StrideA, lda, B + b * StrideB, ldb, beta,
+                    CReference + b * StrideC, ldc);
+    }
+
+    for (size_t i = 0; i < StrideC * BatchSize; i++) {
+      ASSERT_TRUE(CloseEnough(C[i], CReference[i]))
+          << "mismatch at " << i << ": " << C[i] << " vs " << CReference[i] << " TransA=" << TransA
+          << " TransB=" << TransB << " SharedB=" << SharedB << " PackB=" << PackB << " Strided=" << Strided
+          << " M=" << M << " N=" << N << " K=" << K << " BatchSize=" << BatchSize;
+    }
+  }
+
+ public:
+  MlasSgemmBatchTest() : threadpool_(GetMlasThreadPool()) {}
+
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name("SgemmBatch");
+    return suite_name.c_str();
+  }
+
+  void ExecuteShort(void) override {
+    for (bool TransA : {false, true}) {
+      for (bool TransB : {false, true}) {
+        for (bool Strided : {false, true}) {
+          for (size_t M : {1, 2, 3, 4, 5, 9}) {
+            for (size_t N : {1, 3, 4, 7, 8, 13, 40}) {
+              for (size_t K : {1, 3, 8, 33}) {
+                Test(TransA, TransB, false, false, Strided, M, N, K, 7, 1.0f, 0.0f);
+                Test(TransA, TransB, true, false, Strided, M, N, K, 3, 0.5f, 1.5f);
+              }
+            }
+          }
+        }
+        Test(TransA, TransB, true, true, true, 3, 37, 20, 9, 1.0f, 1.0f);
+        Test(TransA, TransB, true, true, false, 16, 37, 20, 9, 2.0f, 0.0f);
+      }
+    }
+
+    // Multiplications large enough to be partitioned individually.
+    Test(false, false, false, false, true, 64, 64, 64, 5, 1.0f, 0.0f);
+    Test(true, true, true, false, true, 130, 70, 90, 3, 1.0f, 0.5f);
+  }
+};
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasSgemmBatchTest>::RegisterShortExecute();
+  }
+  return count;
+});
@@ -78,6 +78,7 @@
 #include "core/session/inference_session.h"
 #include "core/session/onnxruntime_session_options_config_keys.h"
 #include "core/util/math.h"
+#include "core/util/thread_utils.h"
 #include "test/capturing_sink.h"
 #include "test/common/tensor_op_test_utils.h"
 #include "test/compare_ortvalue.h"
@@ -660,7 +661,8 @@ TEST_F(GraphTransformationTests, ConstantFoldingUnsupportedFloat16) {
   }
 }
 
-TEST_F(GraphTransformationTests, ConstantFoldingSubgraph) {
+// Folds constants in both branches of an If, optionally transforming the branches concurrently.
+static void TestConstantFoldingSubgraph(const logging::Logger& logger, concurrency::ThreadPool* thread_pool) {
   TensorProto value_tensor;
   value_tensor.add_dims(1);
   value_tensor.add_float_data(1.f);
@@ -672,7 +674,7 @@ TEST_F(GraphTransformationTests, ConstantFoldingSubgraph) {
 
   auto create_subgraph = [&](GraphProto& graph_proto) {
     // create subgraph that has an Add node to add a local and parent graph initializer
-    Model model("ConstantFoldingSubgraphTest_subgraph", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(), {{kOnnxDomain, 12}}, {}, *logger_);
+    Model model("ConstantFoldingSubgraphTest_subgraph", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(), {{kOnnxDomain, 12}}, {}, logger);
     auto& graph = model.MainGraph();
 
     TensorProto local_constant(value_tensor);
@@ -693,7 +695,7 @@ TEST_F(GraphTransformationTests, ConstantFoldingSubgraph) {
     graph_proto = graph.ToGraphProto();
   };
 
-  Model model("ConstantFoldingSubgraphTest_main_graph", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(), {{kOnnxDomain, 12}}, {}, *logger_);
+  Model model("ConstantFoldingSubgraphTest_main_graph", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(), {{kOnnxDomain, 12}}, {}, logger);
   auto& graph = model.MainGraph();
 
   // add initializer at parent level
@@ -722,18 +724,31 @@ TEST_F(GraphTransformationTests, ConstantFoldingSubgraph) {
   ASSERT_TRUE(op_to_count["Add"] == 2);  // one in each subgraph
   std::unique_ptr<CPUExecutionProvider> e = std::make_unique<CPUExecutionProvider>(CPUExecutionProviderInfo());
   onnxruntime::GraphTransformerManager graph_transformation_mgr{5};
+  graph_transformation_mgr.SetThreadPool(thread_pool);
   const ConfigOptions empty_config_options;
   ASSERT_STATUS_OK(graph_transformation_mgr.Register(
       std::make_unique<ConstantFolding>(*e.get(), false /*skip_dequantize_linear*/, empty_config_options),
       TransformerLevel::Level1));
 
-  ASSERT_STATUS_OK(graph_transformation_mgr.ApplyTransformers(graph, TransformerLevel::Level1, *logger_));
+  ASSERT_STATUS_OK(graph_transformation_mgr.ApplyTransformers(graph, TransformerLevel::Level1, logger));
 
   op_to_count = CountOpsInGraph(graph);
   ASSERT_TRUE(op_to_count["Add"] == 0)
       << "Constant folding should have been able to remove the Add node in both subgraphs";
 }
 
+TEST_F(GraphTransformationTests, ConstantFoldingSubgraph) {
+  TestConstantFoldingSubgraph(*logger_, nullptr);
+}
+
+TEST_F(GraphTransformationTests, ConstantFoldingSubgraphParallel) {
+  OrtThreadPoolParams thread_pool_params;
+  thread_pool_params.thread_pool_size = 2;
+  auto thread_pool = concurrency::CreateThreadPool(&Env::Default(), thread_pool_params,
+                                                   concurrency::ThreadPoolType::INTRA_OP);
+  TestConstantFoldingSubgraph(*logger_, thread_pool.get());
+}
+
 TEST_F(GraphTransformationTests, ConstantFoldingWithShapeToInitializer) {
   constexpr const ORTCHAR_T* model_uri = MODEL_FOLDER "fusion/constant_folding_with_shape_to_initializer.onnx";
   std::shared_ptr<Model> model;
@@ -2981,6 +2996,48 @@ TEST_F(GraphTransformationTests, Gemm_LeakyRelu_Fusion) {
   ASSERT_TRUE(op_to_count["Gemm"] == 0);
   ASSERT_TRUE(op_to_count["com.microsoft.FusedGemm"] == 1);
 }
+
+TEST_F(GraphTransformationTests, Gemm_Gelu_Residual_Fusion) {
+  auto build_test_case = [&](ModelTestBuilder& builder) {
+    auto* input_arg = builder.MakeInput<float>({{16, 32}});
+    auto* weight_arg = builder.MakeInput<float>({{32, 64}});
+    auto* bias_arg = builder.MakeInput<float>({{64}});
+    auto* residual_arg = builder.MakeInput<float>({{16, 64}});
+    auto* gemm_out = builder.MakeIntermediate();
+    auto* gelu_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+    builder.AddNode("Gemm", {input_arg, weight_arg, bias_arg}, {gemm_out});
+    builder.AddNode("Gelu", {gemm_out}, {gelu_out});
+    builder.AddNode("Add", {residual_arg, gelu_out}, {output_arg});
+  };
+
+  auto pre_graph_checker = [](Graph& graph) {
+    std::map<std::string, int> op_to_count = CountOpsInGraph(graph);
+    TEST_RETURN_IF_NOT(op_to_count["Gemm"] == 1);
+    TEST_RETURN_IF_NOT(op_to_count["Gelu"] == 1);
+    TEST_RETURN_IF_NOT(op_to_count["Add"] == 1);
+    return Status::OK();
+  };
+
+  auto post_graph_checker = [](Graph& graph) {
+    std::map<std::string, int> op_to_count = CountOpsInGraph(graph);
+    TEST_RETURN_IF_NOT(op_to_count["Gemm"] == 0);
+    TEST_RETURN_IF_NOT(op_to_count["Gelu"] == 0);
+    TEST_RETURN_IF_NOT(op_to_count["Add"] == 0);
+    TEST_RETURN_IF_NOT(op_to_count["com.microsoft.FusedGemm"] == 1);
+    for (const Node& node : graph.Nodes()) {
+      if (node.OpType() == "FusedGemm") {
+        TEST_RETURN_IF_NOT(node.InputDefs().size() == 4);
+        TEST_RETURN_IF_NOT(node.GetAttributes().at("activation").s() == "Gelu");
+      }
+    }
+    return Status::OK();
+  };
+
+  std::unique_ptr<GraphTransformer> transformer = std::make_unique<GemmActivationFusion>();
+  ASSERT_STATUS_OK(TestGraphTransformer(build_test_case, 20, *logger_, std::move(transformer), TransformerLevel::Level2,
+                                        1, pre_graph_checker, post_graph_checker));
+}
 #endif
 
 // (A')'B' = AB'
@@ -171,11 +171,6 @@ TEST(FileIoTest, MapFileIntoMemory) {
     const auto offset = offset_and_length.first;
     const auto length = offset_and_length.second;
 
-    // The offset must be a multiple of the allocation granularity
-    if (offset % allocation_granularity != 0) {
-      continue;
-    }
-
     Env::MappedMemoryPtr mapped_memory{};
     auto status = Env::Default().MapFileIntoMemory(
         tmp.path.c_str(), offset, length, mapped_memory);
@@ -193,10 +188,17 @@ TEST(FileIoTest, MapFileIntoMemory) {
   {
     Env::MappedMemoryPtr mapped_memory{};
 
-    // invalid - offset is not a multiple of the allocation granularity
-    ASSERT_FALSE(Env::Default().MapFileIntoMemory(
-                                   tmp.path.c_str(), allocation_granularity * 3 / 2, page_size / 10, mapped_memory)
-                     .IsOK());
+    // offsets that are not a multiple of the allocation granularity are mapped from the preceding multiple
+    TempFilePath large_tmp(ORT_TSTR("map_file_test_"));
+    const auto large_data = GenerateData(allocation_granularity * 2);
+    WriteDataToFile(gsl::make_span(large_data), large_tmp.path);
+
+    const size_t offset = allocation_granularity * 3 / 2;
+    const size_t length = page_size / 10;
+    auto status = Env::Default().MapFileIntoMemory(large_tmp.path.c_str(), offset, length, mapped_memory);
+    ASSERT_TRUE(status.IsOK()) << status.ErrorMessage();
+    ASSERT_TRUE(SpanEq(gsl::make_span(mapped_memory.get(), length),
+                       gsl::make_span(large_data.data() + offset, length)));
   }
 
   {
@@ -544,6 +544,32 @@ TEST(ThreadPoolTest, TestStackSize) {
 #endif
 #endif
 
+TEST(ThreadPoolTest, TestParallelLoopStats) {
+  for (int num_threads : {0, 1, 4}) {
+    CreateThreadPoolAndTest("TestParallelLoopStats", num_threads, [&](ThreadPool* tp) {
+      ThreadPool::ParallelLoopStats stats;
+      ASSERT_EQ(ThreadPool::SetParallelLoopStatsCollector(&stats), nullptr);
+      std::atomic<int> count{0};
+      ThreadPool::TrySimpleParallelFor(tp, 1000, [&](std::ptrdiff_t) { count++; });
+      ASSERT_EQ(ThreadPool::SetParallelLoopStatsCollector(nullptr), &stats);
+      ASSERT_EQ(count, 1000);
+
+      if (num_threads > 1) {
+        EXPECT_EQ(stats.num_loops, 1u);
+        EXPECT_EQ(stats.requested_parallelism, static_cast<uint64_t>(num_threads));
+        EXPECT_GE(stats.achieved_parallelism, 1u);
+        EXPECT_LE(stats.achieved_parallelism, stats.requested_parallelism);
+      } else {
+        EXPECT_EQ(stats.num_loops, 0u) << "loops run in the calling thread only are not parallel";
+      }
+
+      // loops run while no collector is set are not accounted
+      ThreadPool::TrySimpleParallelFor(tp, 1000, [&](std::ptrdiff_t) { count++; });
+      EXPECT_LE(stats.num_loops, 1u);
+    });
+  }
+}
+
 #if !defined(ORT_MINIMAL_BUILD) && !defined(ORT_EXTENDED_MINIMAL_BUILD)
 
 #ifndef ORT_NO_EXCEPTIONS
@@ -588,8 +614,69 @@ TEST(ThreadPoolTest, TestAffinityStringMisshaped) {
                  std::exception);
   }
 }
+
+TEST(ThreadPoolTest, TestNumaNodeStringMisshaped) {
+  OrtThreadPoolParams tp_params;
+  tp_params.thread_pool_size = 3;
+  const char* wrong_formats[] = {
+      ";",      // node ids for both threads are empty
+      ";1",     // missing the node id for the 1st thread
+      "a;0",    // invalid char, must be digit
+      "-1;0",   // invalid char, must be digit
+      "0",      // less than expected
+      "0;1;1",  // more than expected
+      "0,1;1"   // one node per thread
+  };
+  for (const auto* wrong_format : wrong_formats) {
+    tp_params.numa_node_str = wrong_format;
+    ASSERT_THROW(concurrency::CreateThreadPool(&onnxruntime::Env::Default(),
+                                               tp_params,
+                                               concurrency::ThreadPoolType::INTRA_OP),
+                 std::exception);
+  }
+}
 #endif
 
+TEST(ThreadPoolTest, TestNumaNodesWellShaped) {
+  // Two workers per node, and nodes with a single worker that can only steal from the other nodes.
+  for (const char* numa_node_str : {"0;0;1;1", "0;1;1;2"}) {
+    OrtThreadPoolParams tp_params;
+    tp_params.thread_pool_size = 5;
+    tp_params.numa_node_str = numa_node_str;
+    auto tp = concurrency::CreateThreadPool(&onnxruntime::Env::Default(),
+                                            tp_params,
+                                            concurrency::ThreadPoolType::INTRA_OP);
+    ASSERT_TRUE(tp != nullptr);
+
+    // Loops from the main thread, and loops scheduled from inside the pool whose
+    // tasks are then pushed and stolen within a node.
+    constexpr int num_concurrent = 4;
+    constexpr int num_tasks = 1024;
+    for (int rep = 0; rep < 5; rep++) {
+      std::vector<std::unique_ptr<TestData>> td;
+      onnxruntime::Barrier b(num_concurrent - 1);
+      for (int c = 0; c < num_concurrent; c++) {
+        td.push_back(CreateTestData(num_tasks));
+      }
+      for (int c = 0; c < num_concurrent - 1; c++) {
+        concurrency::ThreadPool::Schedule(tp.get(), [&, c]() {
+          concurrency::ThreadPool::TrySimpleParallelFor(tp.get(), num_tasks, [&](std::ptrdiff_t i) {
+            IncrementElement(*td[c], i);
+          });
+          b.Notify();
+        });
+      }
+      concurrency::ThreadPool::TrySimpleParallelFor(tp.get(), num_tasks, [&](std::ptrdiff_t i) {
+        IncrementElement(*td[num_concurrent - 1], i);
+      });
+      b.Wait();
+      for (int c = 0; c < num_concurrent; c++) {
+        ValidateTestData(*td[c]);
+      }
+    }
+  }
+}
+
 TEST(ThreadPoolTest, TestAffinityStringWellShaped) {
   OrtThreadPoolParams tp_params;
   auto default_tp = concurrency::CreateThreadPool(&onnxruntime::Env::Default(),
@@ -484,6 +484,28 @@ TYPED_TEST(GemmOpTypedTests, TestGemmScalarBroadcast) {
   run_test(true, true);
 }
 
+// A scalar C with a single output column, where the element count of C matches N.
+TYPED_TEST(GemmOpTypedTests, TestGemmScalarBiasSingleColumn) {
+  OpTester test("Gemm");
+
+  test.AddAttribute("transA", (int64_t)0);
+  test.AddAttribute("transB", (int64_t)0);
+  test.AddAttribute("alpha", 1.0f);
+  test.AddAttribute("beta", 2.0f);
+
+  test.AddInput<TypeParam>("A", {3, 2},
+                           {static_cast<TypeParam>(1.0f), static_cast<TypeParam>(2.0f),
+                            static_cast<TypeParam>(3.0f), static_cast<TypeParam>(4.0f),
+                            static_cast<TypeParam>(-1.0f), static_cast<TypeParam>(-2.0f)});
+  test.AddInput<TypeParam>("B", {2, 1}, {static_cast<TypeParam>(1.0f), static_cast<TypeParam>(-1.0f)});
+  test.AddInput<TypeParam>("C", {}, {static_cast<TypeParam>(0.5f)});
+  test.AddOutput<TypeParam>("Y", {3, 1},
+                            {static_cast<TypeParam>(0.0f), static_cast<TypeParam>(0.0f),
+                             static_cast<TypeParam>(2.0f)});
+  test.Config(run_with_tunable_op)
+      .RunWithConfig();
+}
+
 TYPED_TEST(GemmOpTypedTests, TestGemm2DBroadcast_2) {
   OpTester test("Gemm");
 
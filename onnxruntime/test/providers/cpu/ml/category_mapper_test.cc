@@ -43,5 +43,70 @@ TEST(CategoryMapper, IntToString) {
 
   RunTest(dims, input, output);
 }
+
+// Enough categories and inputs to grow the lookup tables and split the inputs across threads.
+// Repeated categories keep the last mapping, in both directions.
+TEST(CategoryMapper, ManyCategories) {
+  const int64_t num_categories = 1000;
+  const int64_t num_inputs = 5000;
+
+  std::vector<std::string> categories;
+  std::vector<int64_t> indexes;
+  for (int64_t i = 0; i < num_categories; ++i) {
+    categories.push_back("cat" + std::to_string(i));
+    indexes.push_back(i * 7);
+  }
+  categories.push_back("cat5");
+  indexes.push_back(7001);
+  categories.push_back("dup");
+  indexes.push_back(14);
+
+  std::vector<std::string> string_input;
+  std::vector<int64_t> int_output;
+  std::vector<int64_t> int_input;
+  std::vector<std::string> string_output;
+  for (int64_t i = 0; i < num_inputs; ++i) {
+    const int64_t category = (i * 37) % (num_categories + 100);
+    string_input.push_back("cat" + std::to_string(category));
+    int_output.push_back(category == 5 ? 7001 : category < num_categories ? category * 7 : -1);
+
+    const int64_t index = (i * 13) % (num_categories * 7 + 50);
+    int_input.push_back(index);
+    if (index == 7001 || index == 14) {
+      string_output.push_back(index == 7001 ? "cat5" : "dup");
+    } else {
+      string_output.push_back(index % 7 == 0 && index < num_categories * 7 ? "cat" + std::to_string(index / 7)
+                                                                           : "default");
+    }
+  }
+  string_input.push_back("dup");
+  int_output.push_back(14);
+  int_input.push_back(7001);
+  string_output.push_back("cat5");
+
+  const int64_t num_rows = num_inputs + 1;
+
+  {
+    OpTester test("CategoryMapper", 1, onnxruntime::kMLDomain);
+    test.AddAttribute("cats_strings", categories);
+    test.AddAttribute("cats_int64s", indexes);
+    test.AddAttribute("default_string", "default");
+    test.AddAttribute<int64_t>("default_int64", -1);
+    test.AddInput<std::string>("X", {num_rows}, string_input);
+    test.AddOutput<int64_t>("Y", {num_rows}, int_output);
+    test.Run();
+  }
+
+  {
+    OpTester test("CategoryMapper", 1, onnxruntime::kMLDomain);
+    test.AddAttribute("cats_strings", categories);
+    test.AddAttribute("cats_int64s", indexes);
+    test.AddAttribute("default_string", "default");
+    test.AddAttribute<int64_t>("default_int64", -1);
+    test.AddInput<int64_t>("X", {num_rows}, int_input);
+    test.AddOutput<std::string>("Y", {num_rows}, string_output);
+    test.Run();
+  }
+}
 }  // namespace test
 }  // namespace onnxruntime
@@ -137,6 +137,82 @@ TEST(MLOpTest, SVMClassifierSVCProbabilities) {
   test.Run();
 }
 
+// Same model as SVMClassifierSVCProbabilities with every support vector duplicated and its coefficients halved,
+// which leaves the decision functions unchanged, evaluated over enough rows to be processed in parallel.
+TEST(MLOpTest, SVMClassifierSVCProbabilitiesBatch) {
+  OpTester test("SVMClassifier", 1, onnxruntime::kMLDomain);
+
+  const int64_t vector_count = 6;
+  const int64_t feature_count = 3;
+  const int64_t repeat = 100;
+
+  std::vector<float> base_coefficients = {1.14360327f, 1.95968249f, -1.175683f, -1.92760275f, -1.32575698f, -1.32575698f,
+                                          0.66332785f, 0.66242913f, 0.53120854f, 0.53510444f, -1.06631298f, -1.06631298f,
+                                          0.66332785f, 0.66242913f, 0.53120854f, 0.53510444f, 1.f, -1.f};
+  std::vector<float> base_support_vectors = {0.f, 0.5f, 32.f,
+                                             2.f, 2.9f, -32.f,
+                                             1.f, 1.5f, 1.f,
+                                             3.f, 13.3f, -11.f,
+                                             12.f, 12.9f, -312.f,
+                                             43.f, 413.3f, -114.f};
+
+  std::vector<float> coefficients;
+  for (float coefficient : base_coefficients) {
+    coefficients.push_back(coefficient / 2);
+    coefficients.push_back(coefficient / 2);
+  }
+
+  std::vector<float> support_vectors;
+  for (int64_t i = 0; i < vector_count; ++i) {
+    for (int copy = 0; copy < 2; ++copy) {
+      support_vectors.insert(support_vectors.end(), base_support_vectors.begin() + i * feature_count,
+                             base_support_vectors.begin() + (i + 1) * feature_count);
+    }
+  }
+
+  std::vector<float> rho = {0.5279583f, 0.32605162f, 0.32605162f, 0.06663721f, 0.06663721f, 0.f};
+  std::vector<float> kernel_params = {0.001f, 0.f, 3.f};  // gamma, coef0, degree
+  std::vector<float> proba = {-3.8214362f, 1.82177748f, 1.82177748f, 7.17655643f, 7.17655643f, 0.69314718f};
+  std::vector<float> probb = {-1.72839673e+00f, -1.12863030e+00f, -1.12863030e+00f, -6.48340925e+00f, -6.48340925e+00f, 2.39189538e-16f};
+  std::vector<int64_t> classes = {0, 1, 2, 3};
+  std::vector<int64_t> vectors_per_class = {4, 4, 2, 2};
+
+  std::vector<float> base_X = {1.f, 0.0f, 0.4f, 3.0f, 44.0f, -3.f, 12.0f, 12.9f, -312.f, 23.0f, 11.3f, -222.f, 23.0f, 11.3f, -222.f};
+  std::vector<float> base_prob_predictions = {
+      0.13766955f, 0.21030431f, 0.32596754f, 0.3260586f,
+      0.45939931f, 0.26975416f, 0.13539588f, 0.13545066f,
+      0.71045899f, 0.07858939f, 0.05400437f, 0.15694726f,
+      0.58274772f, 0.10203105f, 0.15755227f, 0.15766896f,
+      0.58274772f, 0.10203105f, 0.15755227f, 0.15766896f};
+  std::vector<int64_t> base_class_predictions = {1, 1, 2, 0, 0};
+
+  std::vector<float> X;
+  std::vector<float> prob_predictions;
+  std::vector<int64_t> class_predictions;
+  for (int64_t i = 0; i < repeat; ++i) {
+    X.insert(X.end(), base_X.begin(), base_X.end());
+    prob_predictions.insert(prob_predictions.end(), base_prob_predictions.begin(), base_prob_predictions.end());
+    class_predictions.insert(class_predictions.end(), base_class_predictions.begin(), base_class_predictions.end());
+  }
+
+  test.AddAttribute("kernel_type", std::string("RBF"));
+  test.AddAttribute("coefficients", coefficients);
+  test.AddAttribute("support_vectors", support_vectors);
+  test.AddAttribute("vectors_per_class", vectors_per_class);
+  test.AddAttribute("rho", rho);
+  test.AddAttribute("kernel_params", kernel_params);
+  test.AddAttribute("classlabels_ints", classes);
+  test.AddAttribute("prob_a", proba);
+  test.AddAttribute("prob_b", probb);
+
+  const int64_t num_rows = 5 * repeat;
+  test.AddInput<float>("X", {num_rows, feature_count}, X);
+  test.AddOutput<int64_t>("Y", {num_rows}, class_predictions);
+  test.AddOutput<float>("Z", {num_rows, 4}, prob_predictions);
+
+  test.Run();
+}
+
 TEST(MLOpTest, SVMClassifierSVC) {
   OpTester test("SVMClassifier", 1, onnxruntime::kMLDomain);
 
@@ -1,8 +1,13 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <cmath>
+#include <limits>
+
+#include "core/session/onnxruntime_session_options_config_keys.h"
 #include "gtest/gtest.h"
 #include "test/providers/provider_test_utils.h"
+#include "test/util/include/asserts.h"
 
 namespace onnxruntime {
 namespace test {
@@ -617,6 +622,18 @@ TEST(MLOpTest, TreeRegressorSingleTargetMax) {
   GenTreeAndRunTest1(3, "MAX", true);
 }
 
+TEST(MLOpTest, TreeRegressorCompactNodes) {
+  // Ensembles with enough nodes to be evaluated on compact nodes and binned inputs.
+  GenTreeAndRunTest1(3, "MIN", false, 3, 15000);
+  GenTreeAndRunTest1(3, "MAX", false, 201, 15000);
+
+  std::vector<float> X = {1.f, 0.0f, 0.4f, 3.0f, 44.0f, -3.f, 12.0f, 12.9f, -312.f, 23.0f, 11.3f, -222.f, 23.0f, 11.3f, -222.f, 23.0f, 3311.3f, -222.f, 23.0f, 11.3f, -222.f, 43.0f, 413.3f, -114.f};
+  std::vector<float> results = {2.f, 41.f, 3.f, 14.f, 2.f, 23.f, 2.f, 23.f, 2.f, 23.f, 3.f, 23.f, 2.f, 23.f, 3.f, 14.f};
+  std::vector<float> base_values{0.f, 0.f};
+  GenTreeAndRunTest<float>(3, X, base_values, results, "MAX", false, 8, 11000);
+  GenTreeAndRunTest<float>(3, X, base_values, results, "MAX", false, 200, 11000);
+}
+
 void GenTreeAndRunTest1_as_tensor_precision(int opsetml) {
   OpTester test("TreeEnsembleRegressor", opsetml, onnxruntime::kMLDomain);
 
@@ -721,6 +738,57 @@ TEST(MLOpTest, TreeRegressorCategoricals) {
   test.Run();
 }
 
+TEST(MLOpTest, TreeRegressorCategoricalsBatch) {
+  // Mixed modes on enough rows to evaluate the tree with matrix multiplications.
+  OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
+
+  // tree
+  int64_t n_targets = 1;
+  std::vector<int64_t> nodes_featureids = {0, 0, 0, 0, 1, 0, 0};
+  std::vector<std::string> nodes_modes = {"BRANCH_EQ", "BRANCH_EQ", "BRANCH_EQ", "LEAF", "BRANCH_LEQ", "LEAF", "LEAF"};
+  std::vector<float> nodes_values = {1, 3, 4, 0, 5.5, 0, 0};
+
+  std::vector<int64_t> nodes_treeids = {0, 0, 0, 0, 0, 0, 0};
+  std::vector<int64_t> nodes_nodeids = {0, 1, 2, 3, 4, 5, 6};
+  std::vector<int64_t> nodes_falsenodeids = {1, 2, 3, 0, 5, 0, 0};
+  std::vector<int64_t> nodes_truenodeids = {4, 4, 4, 0, 6, 0, 0};
+
+  std::string post_transform = "NONE";
+  std::vector<int64_t> target_ids = {0, 0, 0};
+  std::vector<int64_t> target_nodeids = {3, 5, 6};
+  std::vector<int64_t> target_treeids = {0, 0, 0};
+  std::vector<float> target_weights = {-4.699999809265137, 17.700000762939453, 11.100000381469727};
+
+  // add attributes
+  test.AddAttribute("nodes_truenodeids", nodes_truenodeids);
+  test.AddAttribute("nodes_falsenodeids", nodes_falsenodeids);
+  test.AddAttribute("nodes_treeids", nodes_treeids);
+  test.AddAttribute("nodes_nodeids", nodes_nodeids);
+  test.AddAttribute("nodes_featureids", nodes_featureids);
+  test.AddAttribute("nodes_values", nodes_values);
+  test.AddAttribute("nodes_modes", nodes_modes);
+  test.AddAttribute("target_treeids", target_treeids);
+  test.AddAttribute("target_nodeids", target_nodeids);
+  test.AddAttribute("target_ids", target_ids);
+  test.AddAttribute("target_weights", target_weights);
+  test.AddAttribute("n_targets", n_targets);
+
+  // fill input data
+  std::vector<float> X = {3.0f, 6.6f, 1.0f, 5.0f, 5.0f, 5.5f};
+  std::vector<float> Y = {17.700000762939453, 11.100000381469727, -4.699999809265137};
+  _multiply_update_array(X, 40);
+  _multiply_update_array(Y, 40);
+  test.AddInput<float>("X", {120, 2}, X);
+  test.AddOutput<float>("Y", {120, 1}, Y);
+
+  // A single thread evaluates every tree on all the rows at once, so the rows are not split into blocks
+  // shorter than the batches the matrix multiplications are used for.
+  SessionOptions so;
+  so.intra_op_param.thread_pool_size = 1;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsTreeEnsembleGemm, "1"));
+  test.Config(so).RunWithConfig();
+}
+
 TEST(MLOpTest, TreeRegressorCategoricalsFolding) {
   OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
 
@@ -885,5 +953,56 @@ TEST(MLOpTest, TreeRegressorBranchEq) {
   test.Run();
 }
 
+TEST(MLOpTest, TreeRegressorMissingTracksBatch) {
+  // Enough rows to evaluate the trees on blocks of rows, the last block being incomplete.
+  OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
+
+  // tree
+  int64_t n_targets = 1;
+  std::vector<int64_t> nodes_featureids = {0, 1, 0, 0, 0};
+  std::vector<std::string> nodes_modes = {"BRANCH_LT", "BRANCH_LT", "LEAF", "LEAF", "LEAF"};
+  std::vector<float> nodes_values = {0.5f, -1.f, 0.f, 0.f, 0.f};
+  std::vector<int64_t> nodes_treeids = {0, 0, 0, 0, 0};
+  std::vector<int64_t> nodes_nodeids = {0, 1, 2, 3, 4};
+  std::vector<int64_t> nodes_falsenodeids = {4, 3, 0, 0, 0};
+  std::vector<int64_t> nodes_truenodeids = {1, 2, 0, 0, 0};
+  std::vector<int64_t> nodes_missing_value_tracks_true = {1, 0, 0, 0, 0};
+
+  std::vector<int64_t> target_ids = {0, 0, 0};
+  std::vector<int64_t> target_nodeids = {2, 3, 4};
+  std::vector<int64_t> target_treeids = {0, 0, 0};
+  std::vector<float> target_weights = {1.f, 2.f, 3.f};
+
+  // add attributes
+  test.AddAttribute("nodes_truenodeids", nodes_truenodeids);
+  test.AddAttribute("nodes_falsenodeids", nodes_falsenodeids);
+  test.AddAttribute("nodes_treeids", nodes_treeids);
+  test.AddAttribute("nodes_nodeids", nodes_nodeids);
+  test.AddAttribute("nodes_featureids", nodes_featureids);
+  test.AddAttribute("nodes_values", nodes_values);
+  test.AddAttribute("nodes_modes", nodes_modes);
+  test.AddAttribute("nodes_missing_value_tracks_true", nodes_missing_value_tracks_true);
+  test.AddAttribute("target_treeids", target_treeids);
+  test.AddAttribute("target_nodeids", target_nodeids);
+  test.AddAttribute("target_ids", target_ids);
+  test.AddAttribute("target_weights", target_weights);
+  test.AddAttribute("n_targets", n_targets);
+
+  // fill input data
+  const int64_t n_obs = 67;
+  std::vector<float> X(n_obs * 2);
+  std::vector<float> Y(n_obs);
+  for (int64_t i = 0; i < n_obs; ++i) {
+    float x0 = i % 5 == 0 ? std::numeric_limits<float>::quiet_NaN() : static_cast<float>(i % 3) * 0.4f;
+    float x1 = i % 7 == 3 ? std::numeric_limits<float>::quiet_NaN() : static_cast<float>(i % 4) - 2.5f;
+    X[i * 2] = x0;
+    X[i * 2 + 1] = x1;
+    Y[i] = (std::isnan(x0) || x0 < 0.5f) ? (x1 < -1.f ? 1.f : 2.f) : 3.f;
+  }
+  test.AddInput<float>("X", {n_obs, 2}, X);
+  test.AddOutput<float>("Y", {n_obs, 1}, Y);
+  test.Run();
+}
+
 }  // namespace test
 }  // namespace onnxruntime
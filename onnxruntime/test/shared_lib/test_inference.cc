@@ -490,6 +490,23 @@ TEST(CApiTest, dim_param) {
   ASSERT_EQ(strcmp(dim_param, ""), 0);
 }
 
+TEST(CApiTest, GetDynamicBatchingStats) {
+  {
+    Ort::SessionOptions session_options;
+    Ort::Session session(*ort_env, MODEL_URI, session_options);
+    ASSERT_TRUE(session.GetDynamicBatchingStats().GetKeyValuePairs().empty());
+  }
+
+  Ort::SessionOptions session_options;
+  session_options.AddConfigEntry(kOrtSessionOptionsDynamicBatchingMaxBatchSize, "8");
+  Ort::Session session(*ort_env, MODEL_URI, session_options);
+  auto stats = session.GetDynamicBatchingStats().GetKeyValuePairs();
+  ASSERT_EQ(stats.size(), 5u);
+  ASSERT_EQ(stats["num_requests"], "0");
+  ASSERT_EQ(stats["num_batches"], "0");
+  ASSERT_EQ(stats["mean_queue_delay_us"], "0");
+}
+
 INSTANTIATE_TEST_SUITE_P(CApiTestWithProviders,
                          CApiTestWithProvider,
                          ::testing::Values(0, 1, 2, 3, 4));